@@ -1,6 +1,11 @@
 import type { IFileSystem } from '@refinio/one.models/lib/fileSystems/IFileSystem.js';
 import ObjectsFileSystem from '@refinio/one.models/lib/fileSystems/ObjectsFileSystem.js';
 
+/**
+ * Receives paths (relative to the mount point) whose cached attributes are stale.
+ */
+export type CacheInvalidator = (path: string, recursive: boolean) => void;
+
 /**
  * Performance-optimized wrapper around ObjectsFileSystem that limits initial enumeration
  * to prevent hanging during ProjFS pre-caching, but allows full access on-demand
@@ -9,6 +14,8 @@ export class PerformantObjectsFileSystem implements IFileSystem {
     private readonly objectsFileSystem: ObjectsFileSystem;
     private readonly initialLimit: number;
     private hasBeenFullyEnumerated: boolean = false;
+    private invalidator: CacheInvalidator | null = null;
+    private mountPath: string = '/objects';
 
     constructor(initialLimit: number = 50) {
         this.objectsFileSystem = new ObjectsFileSystem();
@@ -38,6 +45,32 @@ export class PerformantObjectsFileSystem implements IFileSystem {
         return await this.objectsFileSystem.readDir(path);
     }
 
+    /**
+     * Keep the attribute cache of the FUSE frontend coherent with writes made through this file
+     * system. Objects arriving through CHUM replication are reported by ReplicationInvalidator.
+     *
+     * @param invalidator - Usually FuseFrontend.invalidate
+     * @param mountPath - Where this file system is mounted in the root file system
+     */
+    setCacheInvalidator(invalidator: CacheInvalidator, mountPath: string = '/objects'): void {
+        this.invalidator = invalidator;
+        this.mountPath = mountPath;
+    }
+
+    /**
+     * Report a change below path (relative to this file system).
+     */
+    notifyChanged(path: string): void {
+        if (this.invalidator === null) {
+            return;
+        }
+
+        const absolute = path === '/' ? this.mountPath : `${this.mountPath}${path}`;
+        const parent = absolute.slice(0, absolute.lastIndexOf('/')) || '/';
+        this.invalidator(absolute, true);
+        this.invalidator(parent, false);
+    }
+
     /**
      * Call this method to enable full enumeration (e.g., when user explicitly browses objects)
      */
@@ -52,7 +85,8 @@ export class PerformantObjectsFileSystem implements IFileSystem {
     }
 
     async writeFile(path: string, content: string | Uint8Array): Promise<void> {
-        return await this.objectsFileSystem.writeFile(path, content);
+        await this.objectsFileSystem.writeFile(path, content);
+        this.notifyChanged(path);
     }
 
     async stat(path: string): Promise<{ 
@@ -65,15 +99,18 @@ export class PerformantObjectsFileSystem implements IFileSystem {
     }
 
     async mkdir(path: string): Promise<void> {
-        return await this.objectsFileSystem.mkdir(path);
+        await this.objectsFileSystem.mkdir(path);
+        this.notifyChanged(path);
     }
 
     async rmdir(path: string): Promise<void> {
-        return await this.objectsFileSystem.rmdir(path);
+        await this.objectsFileSystem.rmdir(path);
+        this.notifyChanged(path);
     }
 
     async unlink(path: string): Promise<void> {
-        return await this.objectsFileSystem.unlink(path);
+        await this.objectsFileSystem.unlink(path);
+        this.notifyChanged(path);
     }
 
     async mountFileSystem?(path: string, fileSystem: IFileSystem): Promise<void> {
@@ -17,6 +17,7 @@ import {DefaultFilerConfig} from './FilerConfig';
 import type {FilerConfig} from './FilerConfig';
 
 import {FuseFrontend} from './FuseFrontend';
+import {ReplicationInvalidator} from './ReplicationInvalidator.js';
 import {fillMissingWithDefaults} from '../misc/configHelper';
 
 export interface FilerModels {
@@ -63,6 +64,11 @@ export class Filer {
         console.log('🐧 Starting FUSE in WSL2...');
         const fuseFrontend = new FuseFrontend();
         await fuseFrontend.start(rootFileSystem, this.config.mountPoint, this.config.logCalls, this.config.fuseOptions || {});
+
+        // Objects replicated in must not hide behind cached attributes
+        const replication = new ReplicationInvalidator((path, recursive) => fuseFrontend.invalidate(path, recursive));
+        replication.start();
+        this.shutdownFunctions.push(async () => replication.stop());
         this.shutdownFunctions.push(fuseFrontend.stop.bind(fuseFrontend));
         
         console.log(`[info]: Filer file system was mounted at ${this.config.mountPoint}`);
@@ -255,6 +255,7 @@ export class FilerWithProjFS {
         console.log('🐧 Starting FUSE in WSL2...');
         
         const { FuseFrontend } = await import('./FuseFrontend.js');
+        const { ReplicationInvalidator } = await import('./ReplicationInvalidator.js');
         const fuseFrontend = new FuseFrontend();
         await fuseFrontend.start(
             this.rootFileSystem!,
@@ -263,6 +264,10 @@ export class FilerWithProjFS {
             this.config.fuseOptions || {}
         );
 
+        // Objects replicated in must not hide behind cached attributes
+        const replication = new ReplicationInvalidator((path, recursive) => fuseFrontend.invalidate(path, recursive));
+        replication.start();
+        this.shutdownFunctions.push(async () => replication.stop());
         this.shutdownFunctions.push(fuseFrontend.stop.bind(fuseFrontend));
         console.log(`[info]: Filer file system was mounted at ${this.config.mountPoint}`);
     }
@@ -8,8 +8,11 @@
  * @version 0.0.1
  */
 
-import type {Stats as FuseStats} from '../fuse/types.js';
-import {ENOENT} from '../fuse/types.js';
+import {constants} from 'fs';
+import {open} from 'fs/promises';
+import type {FileHandle} from 'fs/promises';
+import type {Stats as FuseStats, OpenReply} from '../fuse/types.js';
+import {ENOENT, packStats} from '../fuse/types.js';
 import type {IFileSystem, FileDescription, FileSystemFile, FileSystemDirectory} from '@refinio/one.models/lib/fileSystems/IFileSystem.js';
 import {OEvent} from '@refinio/one.models/lib/misc/OEvent.js';
 import {FS_ERRORS} from '@refinio/one.models/lib/fileSystems/FileSystemErrors.js';
@@ -19,6 +22,54 @@ import FuseTemporaryFilesManager from './FuseTemporaryFilesManager';
 
 let fuseFd = 10;
 
+/**
+ * Files below /objects/<hash> are derived from an immutable ONE object, so the hash plus the
+ * rest of the path identifies their content. Files that show a stored file unchanged are keyed by
+ * its hash alone instead (see STORED_FILE_PATH).
+ */
+const OBJECT_CONTENT_PATH = /^\/objects\/([0-9a-f]{64}(?:\/.*)?)$/;
+
+/**
+ * Paths that may show a stored file unchanged: a BLOB named by its hash, or the raw microdata of
+ * an object.
+ */
+const STORED_FILE_PATH = /(?:^|\/)([0-9a-f]{64})(?:\/raw\.txt)?$/;
+
+/**
+ * Children of one listing that are stat'ed at the same time.
+ */
+const READDIR_STAT_CONCURRENCY = 16;
+
+/**
+ * Like Promise.allSettled(items.map(fn)), but with at most limit calls of fn running at a time.
+ *
+ * @param items
+ * @param limit
+ * @param fn
+ */
+async function settleLimited<T, R>(
+    items: T[],
+    limit: number,
+    fn: (item: T) => Promise<R>
+): Promise<Array<PromiseSettledResult<R>>> {
+    const results: Array<PromiseSettledResult<R>> = new Array(items.length);
+    let next = 0;
+
+    async function worker(): Promise<void> {
+        while (next < items.length) {
+            const index = next++;
+            try {
+                results[index] = {status: 'fulfilled', value: await fn(items[index])};
+            } catch (reason) {
+                results[index] = {status: 'rejected', reason};
+            }
+        }
+    }
+
+    await Promise.all(Array.from({length: Math.min(limit, items.length)}, worker));
+    return results;
+}
+
 /**
  * This class implements the fuse api and forward those calls to {@link IFileSystem}.
  */
@@ -145,21 +196,23 @@ export default class FuseApiToIFileSystemAdapter {
             // if getAttr was called on a persisted file
             this.fs
                 .stat(path)
-                .then((res: FileDescription) => {
-                    cb(0, {
-                        mtime: this.constTimes,
-                        atime: this.constTimes,
-                        ctime: this.constTimes,
-                        size: res.size,
-                        mode: res.mode,
-                        uid: this.getUid(),
-                        gid: this.getGid()
-                    } as FuseStats);
-                })
+                .then((res: FileDescription) => cb(0, this.toFuseStats(res)))
                 .catch((err: Error) => cb(handleError(err, this.logCalls, 'getattr')));
         }
     }
 
+    private toFuseStats(res: FileDescription): FuseStats {
+        return {
+            mtime: this.constTimes,
+            atime: this.constTimes,
+            ctime: this.constTimes,
+            size: res.size,
+            mode: res.mode,
+            uid: this.getUid(),
+            gid: this.getGid()
+        } as FuseStats;
+    }
+
     /**
      * Truncate only on the temporary files that are being written
      * @param _path
@@ -187,17 +240,37 @@ export default class FuseApiToIFileSystemAdapter {
     }
 
     /**
+     * Lists a directory together with the attributes of its children, so the native
+     * addon can answer READDIRPLUS and the getattr calls that follow a listing
+     * without coming back here once per entry. Children that cannot be stat'ed are
+     * still listed, just without attributes. The stats go out in the binary layout.
+     * At most READDIR_STAT_CONCURRENCY children are stat'ed at a time, so a huge
+     * directory does not start a stat per entry at once.
      *
      * @param path
      * @param cb
      */
     public fuseReaddir(
         path: string,
-        cb: (err: number, names?: string[], stats?: FuseStats[]) => void
+        cb: (err: number, names?: string[], stats?: Float64Array) => void
     ): void {
         this.fs
             .readDir(path)
-            .then((res: FileSystemDirectory) => cb(0, res.children))
+            .then(async (res: FileSystemDirectory) => {
+                const prefix = path.endsWith('/') ? path : `${path}/`;
+                const stats = await settleLimited(res.children, READDIR_STAT_CONCURRENCY, child =>
+                    this.fs.stat(prefix + child)
+                );
+                cb(
+                    0,
+                    res.children,
+                    packStats(
+                        stats.map(result =>
+                            result.status === 'fulfilled' ? this.toFuseStats(result.value) : undefined
+                        )
+                    )
+                );
+            })
             .catch((err: Error) => cb(handleError(err, this.logCalls)));
     }
 
@@ -216,13 +289,77 @@ export default class FuseApiToIFileSystemAdapter {
     }
 
     /**
+     * Reports a content key for immutable object files so the native content cache can serve
+     * repeated reads without calling back into JS. Read-only opens of files one stores as they are
+     * shown also hand over the stored file, which the addon then reads by itself. Those are keyed
+     * by the hash of the stored file, so a BLOB shares its cache entries between objects/, chats/
+     * and types/.
      *
-     * @param _path
-     * @param _flags
+     * @param path
+     * @param flags
      * @param cb
      */
-    public fuseOpen(_path: string, _flags: number, cb: (err: number, fd?: number) => void): void {
-        cb(0, fuseFd++);
+    public fuseOpen(
+        path: string,
+        flags: number,
+        cb: (err: number, fd?: number, reply?: OpenReply) => void
+    ): void {
+        const fd = fuseFd++;
+        const match = OBJECT_CONTENT_PATH.exec(path);
+        const contentHash = match === null ? undefined : match[1];
+
+        if ((flags & constants.O_ACCMODE) !== constants.O_RDONLY) {
+            cb(0, fd, {contentHash});
+            return;
+        }
+
+        this.openStoredFile(path)
+            .catch(() => undefined)
+            .then(handle => {
+                if (handle === undefined) {
+                    cb(0, fd, {contentHash});
+                    return;
+                }
+                // The addon keeps a duplicate of the descriptor, ours can go right away
+                const stored = STORED_FILE_PATH.exec(path);
+                try {
+                    cb(0, fd, {
+                        contentHash: stored === null ? contentHash : stored[1],
+                        backingFd: handle.fd,
+                        backingOffset: 0
+                    });
+                } finally {
+                    handle.close().catch(() => undefined);
+                }
+            });
+    }
+
+    /**
+     * Opens the file one stores for path, if path shows it unchanged. The stored file is only
+     * used if its size matches what the file system reports for path.
+     *
+     * @param path
+     */
+    private async openStoredFile(path: string): Promise<FileHandle | undefined> {
+        const match = STORED_FILE_PATH.exec(path);
+
+        if (match === null) {
+            return undefined;
+        }
+
+        const description = await this.fs.stat(path);
+        const handle = await open(this.tmpFilesMgr.retrieveStoredFilePath(match[1]), 'r');
+
+        try {
+            if ((await handle.stat()).size === description.size) {
+                return handle;
+            }
+        } catch (_) {
+            // fall through
+        }
+
+        await handle.close();
+        return undefined;
     }
 
     /**
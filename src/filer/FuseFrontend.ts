@@ -73,7 +73,7 @@ export class FuseFrontend {
                 console.log('🔧 FUSE getattr called:', path);
                 fuseFileSystemAdapter.fuseGetattr(path, cb);
             },
-            readdir: (path: string, cb: (err: number, files?: string[]) => void) => {
+            readdir: (path: string, cb: (err: number, files?: string[], stats?: Float64Array) => void) => {
                 console.log('🔧 FUSE readdir called:', path);
                 fuseFileSystemAdapter.fuseReaddir(path, cb);
             },
@@ -169,6 +169,186 @@ export class FuseFrontend {
         }
     }
 
+    /**
+     * Tell the mounted file system that a path changed behind its back (e.g. through
+     * replication), so cached attributes are not served any longer.
+     *
+     * @param path - Path relative to the mount point
+     * @param recursive - Also drop everything below path
+     */
+    public invalidate(path: string, recursive: boolean = false): void {
+        if (this.fuseInstance === null || typeof this.fuseInstance.invalidate !== 'function') {
+            return;
+        }
+
+        if (recursive) {
+            this.fuseInstance.invalidatePrefix(path);
+        } else {
+            this.fuseInstance.invalidate(path);
+        }
+    }
+
+    /**
+     * Tell the kernel that paths changed behind the mount, so attr_timeout and entry_timeout
+     * can be long. Sent from a native thread; the addon's own caches are dropped right away.
+     *
+     * @param paths - Paths relative to the mount point
+     * @param kind - 'change': attributes or data; 'entry': the name was created or replaced;
+     * 'delete': the name is gone
+     * @returns false if the addon cannot notify (or is not mounted)
+     */
+    public notifyKernel(paths: string | string[], kind: 'change' | 'entry' | 'delete' = 'change'): boolean {
+        if (this.fuseInstance === null || typeof this.fuseInstance.notifyChange !== 'function') {
+            return false;
+        }
+
+        switch (kind) {
+            case 'entry':
+                return this.fuseInstance.notifyEntry(paths);
+            case 'delete':
+                return this.fuseInstance.notifyDelete(paths);
+            default:
+                return this.fuseInstance.notifyChange(paths);
+        }
+    }
+
+    /**
+     * Counters of the native content cache, or null if the addon has none (or it is disabled).
+     */
+    public getContentCacheStats(): Record<string, number> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getContentCacheStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getContentCacheStats();
+    }
+
+    /**
+     * Counters of the native dispatch queue, or null if the addon has none.
+     */
+    public getDispatchStats(): Record<string, unknown> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getDispatchStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getDispatchStats();
+    }
+
+    /**
+     * Counters of the native path table, or null if the addon has none (or it is disabled).
+     */
+    public getPathStats(): Record<string, number> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getPathStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getPathStats();
+    }
+
+    /**
+     * Lookups the native probe filter answered, or null if the addon has none (or it is disabled).
+     */
+    public getProbeFilterStats(): Record<string, number> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getProbeFilterStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getProbeFilterStats();
+    }
+
+    /**
+     * Requests failed past their deadline or on a kernel interrupt, or null if the addon has none (or they are disabled).
+     */
+    public getDeadlineStats(): Record<string, number> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getDeadlineStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getDeadlineStats();
+    }
+
+    /**
+     * Request slots of the native addon, or null if it has none (or they are disabled).
+     */
+    public getRequestSlotStats(): Record<string, number> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getRequestSlotStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getRequestSlotStats();
+    }
+
+    /**
+     * Progress of the native pre-warm walk, or null if the addon has none (or it is disabled).
+     */
+    public getPrewarmStats(): Record<string, number | boolean> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getPrewarmStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getPrewarmStats();
+    }
+
+    /**
+     * Kernel notifications queued and sent, or null if the addon has none.
+     */
+    public getNotifyStats(): Record<string, number> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getNotifyStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getNotifyStats();
+    }
+
+    /**
+     * The last requests of the mount as Chrome trace JSON, or null if the addon has no flight
+     * recorder (or it is disabled).
+     */
+    public dumpTrace(): string | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.dumpTrace !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.dumpTrace();
+    }
+
+    /**
+     * Requests routed to each JS thread serving the mount, or null if the addon has no workers.
+     */
+    public getWorkerStats(): Array<Record<string, unknown>> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getWorkerStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getWorkerStats();
+    }
+
+    /**
+     * Capabilities and limits negotiated with the kernel, or null if the addon does not report them.
+     */
+    public getConnectionInfo(): Record<string, unknown> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getConnectionInfo !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getConnectionInfo();
+    }
+
+    /**
+     * Per-operation latencies, bytes and errors of the native addon, or null if it keeps none.
+     */
+    public getStats(): Record<string, unknown> | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getStats();
+    }
+
+    /**
+     * getStats() as Prometheus text, or null if the addon keeps no stats.
+     */
+    public getPrometheusStats(): string | null {
+        if (this.fuseInstance === null || typeof this.fuseInstance.getPrometheusStats !== 'function') {
+            return null;
+        }
+        return this.fuseInstance.getPrometheusStats();
+    }
+
+    public resetStats(): void {
+        if (this.fuseInstance !== null && typeof this.fuseInstance.resetStats === 'function') {
+            this.fuseInstance.resetStats();
+        }
+    }
+
     public static async isFuseNativeConfigured(): Promise<boolean> {
         const Fuse = await getFuse();
         return new Promise((resolve, reject) => {
@@ -341,6 +341,14 @@ export default class FuseTemporaryFilesManager {
         return existingFile.temporaryFilePath;
     }
 
+    /**
+     * Retrieves the path under which one stores the object or BLOB with the given hash
+     * @param hash
+     */
+    public retrieveStoredFilePath(hash: string): string {
+        return path.join(FuseTemporaryFilesManager.getOnePath(this.oneStoragePath, 'objects'), hash);
+    }
+
     /**
      * Creates a temporary file in one tmp folder with a random name
      * @param fileName
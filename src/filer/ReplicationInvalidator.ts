@@ -0,0 +1,134 @@
+import {onUnversionedObj} from '@refinio/one.core/lib/storage-unversioned-objects.js';
+import {onVersionedObj} from '@refinio/one.core/lib/storage-versioned-objects.js';
+import type {CacheInvalidator} from '../fileSystems/PerformantObjectsFileSystem.js';
+
+/**
+ * What the storage events report about an object that was stored, locally or through CHUM.
+ */
+export interface StoredObject {
+    hash: string;
+    obj?: {$type$?: string};
+}
+
+/**
+ * An event of stored objects, like onUnversionedObj. addListener returns the function that
+ * disconnects the listener.
+ */
+export interface StoredObjectEvent {
+    addListener(listener: (result: StoredObject) => void): (() => void) | void;
+}
+
+/**
+ * Where the views that show stored objects are mounted in the root file system.
+ */
+export interface ReplicationViews {
+    objects: string;
+    types: string;
+    chats: string;
+}
+
+/**
+ * Types whose objects change what the chats view lists.
+ */
+const CHAT_TYPES = new Set(['ChatMessage', 'ChannelInfo', 'ChannelEntry', 'CreationTime', 'Topic']);
+
+/**
+ * Forwards objects arriving in storage (CHUM replication included) to the attribute cache of the
+ * FUSE frontend, so a replicated object is not hidden behind a stale stat or listing. Every view
+ * showing the object is invalidated: objects/<hash> and the objects listing right away, the
+ * type's directory in types/ and the chats when the object belongs to a chat once per tick.
+ *
+ * objects/<hash> is dropped on its own: an object never changes under its hash, so nothing below
+ * it can be stale. Prefix invalidations walk the whole cache, so a burst of replicated objects
+ * shares them.
+ */
+export class ReplicationInvalidator {
+    private readonly invalidator: CacheInvalidator;
+    private readonly events: StoredObjectEvent[];
+    private readonly views: ReplicationViews;
+    private disconnects: Array<() => void> = [];
+    private pendingTypes = new Set<string>();
+    private pendingChats = false;
+    private flushScheduled: ReturnType<typeof setImmediate> | null = null;
+
+    /**
+     * @param invalidator - Usually FuseFrontend.invalidate
+     * @param events - The storage events to follow (by default those of one.core)
+     * @param views - Mount points of the views
+     */
+    constructor(
+        invalidator: CacheInvalidator,
+        events: StoredObjectEvent[] = [
+            onUnversionedObj as unknown as StoredObjectEvent,
+            onVersionedObj as unknown as StoredObjectEvent
+        ],
+        views: ReplicationViews = {objects: '/objects', types: '/types', chats: '/chats'}
+    ) {
+        this.invalidator = invalidator;
+        this.events = events;
+        this.views = views;
+    }
+
+    /** Start following the storage events. */
+    start(): void {
+        if (this.disconnects.length > 0) {
+            return;
+        }
+
+        for (const event of this.events) {
+            const disconnect = event.addListener(result => this.objectStored(result));
+            if (typeof disconnect === 'function') {
+                this.disconnects.push(disconnect);
+            }
+        }
+    }
+
+    /** Stop following the storage events, invalidating what is still pending. */
+    stop(): void {
+        for (const disconnect of this.disconnects) {
+            disconnect();
+        }
+        this.disconnects = [];
+        this.flush();
+    }
+
+    /**
+     * Invalidate every view of a stored object. The type and chat views follow on the next tick.
+     */
+    objectStored(result: StoredObject): void {
+        this.invalidator(`${this.views.objects}/${result.hash}`, false);
+        this.invalidator(this.views.objects, false);
+
+        const type = result.obj?.$type$;
+        if (type === undefined) {
+            return;
+        }
+
+        this.pendingTypes.add(type);
+        this.pendingChats = this.pendingChats || CHAT_TYPES.has(type);
+        if (this.flushScheduled === null) {
+            this.flushScheduled = setImmediate(() => this.flush());
+        }
+    }
+
+    /** Invalidate the type and chat views of the objects stored since the last flush. */
+    flush(): void {
+        if (this.flushScheduled !== null) {
+            clearImmediate(this.flushScheduled);
+            this.flushScheduled = null;
+        }
+        if (this.pendingTypes.size === 0) {
+            return;
+        }
+
+        for (const type of this.pendingTypes) {
+            this.invalidator(`${this.views.types}/${type}`, true);
+        }
+        this.invalidator(this.views.types, false);
+        if (this.pendingChats) {
+            this.invalidator(this.views.chats, true);
+        }
+        this.pendingTypes.clear();
+        this.pendingChats = false;
+    }
+}
@@ -97,11 +97,11 @@ export default new Proxy({}, {
 });
 
 // Re-export shared types for all platforms
-export type { Stats, FuseOperations, FuseError, OPERATIONS } from './types.js';
+export type { Stats, FuseOperations, FuseError, Fuse3Options, OPERATIONS } from './types.js';
 
 // Export platform detection utilities
 export const platform = {
     isWindows,
     isLinux,
     isSupported: isWindows || isLinux
-};
\ No newline at end of file
+};
\ No newline at end of file
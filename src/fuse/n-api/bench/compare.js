@@ -0,0 +1,82 @@
+#!/usr/bin/env node
+'use strict';
+
+/**
+ * Compares two bench/run.js result files.
+ *
+ *   node bench/compare.js BASE.json HEAD.json [--threshold PERCENT]
+ *
+ * Exits with 1 if any workload run in both lost more than PERCENT (default
+ * 10) of its ops/s or gained more than PERCENT on p99.
+ */
+
+const fs = require('fs');
+
+function parseArgs(argv) {
+    const files = [];
+    let threshold = 10;
+    for (let i = 2; i < argv.length; i++) {
+        if (argv[i] === '--threshold') {
+            threshold = Number(argv[++i]);
+        } else {
+            files.push(argv[i]);
+        }
+    }
+    if (files.length !== 2 || !(threshold >= 0)) {
+        throw new Error('Usage: compare.js BASE.json HEAD.json [--threshold PERCENT]');
+    }
+    return { base: files[0], head: files[1], threshold };
+}
+
+function load(file) {
+    const report = JSON.parse(fs.readFileSync(file, 'utf8'));
+    const byKey = new Map();
+    for (const result of report.results) {
+        byKey.set(`${result.workload} x${result.clients}`, result);
+    }
+    return { report, byKey };
+}
+
+function change(from, to) {
+    return from > 0 ? ((to - from) / from) * 100 : 0;
+}
+
+function formatChange(percent) {
+    return `${percent >= 0 ? '+' : ''}${percent.toFixed(1)}%`;
+}
+
+function main() {
+    const args = parseArgs(process.argv);
+    const base = load(args.base);
+    const head = load(args.head);
+
+    console.log(`base ${base.report.commit || args.base}  head ${head.report.commit || args.head}`);
+    if (JSON.stringify(base.report.options) !== JSON.stringify(head.report.options) ||
+        base.report.scale !== head.report.scale) {
+        console.log('warning: the runs used different options or scale');
+    }
+
+    const regressions = [];
+    for (const [key, to] of head.byKey) {
+        const from = base.byKey.get(key);
+        if (!from) {
+            continue;
+        }
+        const throughput = change(from.opsPerSec, to.opsPerSec);
+        const p99 = change(from.latencyUs.p99, to.latencyUs.p99);
+        const regressed = throughput < -args.threshold || p99 > args.threshold;
+        console.log(
+            `${key.padEnd(22)} ${String(from.opsPerSec).padStart(9)} -> ${String(to.opsPerSec).padStart(9)} ops/s ` +
+            `${formatChange(throughput).padStart(8)}   p99 ${formatChange(p99).padStart(8)}${regressed ? '  REGRESSION' : ''}`);
+        if (regressed) {
+            regressions.push(key);
+        }
+    }
+
+    if (regressions.length > 0) {
+        console.log(`${regressions.length} workload(s) regressed by more than ${args.threshold}%`);
+        process.exit(1);
+    }
+}
+
+main();
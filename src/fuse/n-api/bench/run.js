@@ -0,0 +1,241 @@
+#!/usr/bin/env node
+'use strict';
+
+/**
+ * Benchmark of the FUSE bridge. Mounts the addon over the in-memory stub
+ * operations and runs the fixed workloads from client threads, which do
+ * blocking file system calls while the main thread serves the mount.
+ *
+ *   node bench/run.js [--mount DIR] [--clients 1,4] [--workloads a,b]
+ *                     [--scale N] [--file-mb N] [--options JSON]
+ *                     [--addon PATH] [--out FILE]
+ *
+ * Prints a table to stderr and the results as JSON to stdout (or --out).
+ * Compare two result files with bench/compare.js.
+ */
+
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+const { execFileSync } = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { WORKLOADS } = require('./workloads.js');
+
+function parseArgs(argv) {
+    const args = {
+        mount: path.join(os.tmpdir(), `fuse3-bench-${process.pid}`),
+        clients: [1, 4],
+        workloads: WORKLOADS.map(w => w.name),
+        scale: 1,
+        fileMb: 64,
+        options: {},
+        addon: path.join(__dirname, '..', 'build', 'Release', 'fuse3_napi.node'),
+        out: null
+    };
+    for (let i = 2; i < argv.length; i++) {
+        const value = argv[i + 1];
+        switch (argv[i]) {
+            case '--mount': args.mount = value; break;
+            case '--clients': args.clients = value.split(',').map(Number); break;
+            case '--workloads': args.workloads = value.split(','); break;
+            case '--scale': args.scale = Number(value); break;
+            case '--file-mb': args.fileMb = Number(value); break;
+            case '--options': args.options = JSON.parse(value); break;
+            case '--addon': args.addon = path.resolve(value); break;
+            case '--out': args.out = value; break;
+            default: throw new Error(`Unknown argument ${argv[i]}`);
+        }
+        i++;
+    }
+    for (const name of args.workloads) {
+        if (!WORKLOADS.some(w => w.name === name)) {
+            throw new Error(`Unknown workload ${name}`);
+        }
+    }
+    return args;
+}
+
+// Nearest-rank percentile of sorted nanosecond samples, in microseconds
+function percentile(sorted, q) {
+    const rank = Math.max(1, Math.ceil(q * sorted.length));
+    return sorted[rank - 1] / 1000;
+}
+
+function summarize(samples) {
+    samples.sort();
+    let sum = 0;
+    for (const ns of samples) {
+        sum += ns;
+    }
+    const round = us => Math.round(us * 100) / 100;
+    return {
+        mean: round(sum / samples.length / 1000),
+        p50: round(percentile(samples, 0.5)),
+        p99: round(percentile(samples, 0.99)),
+        p999: round(percentile(samples, 0.999)),
+        max: round(samples[samples.length - 1] / 1000)
+    };
+}
+
+function gitCommit() {
+    try {
+        return execFileSync('git', ['rev-parse', '--short', 'HEAD'], { cwd: __dirname, encoding: 'utf8' }).trim();
+    } catch {
+        return null;
+    }
+}
+
+function mountStub(args, ops) {
+    const addon = require(args.addon);
+    const Fuse3 = addon.Fuse3 || addon.Fuse || addon;
+    fs.mkdirSync(args.mount, { recursive: true });
+    const fuse = new Fuse3(args.mount, ops, args.options);
+    return new Promise((resolve, reject) => {
+        fuse.mount(err => (err ? reject(new Error(String(err))) : resolve(fuse)));
+    });
+}
+
+function unmountStub(args, fuse) {
+    // fusermount wakes the session loop, which then returns on its own
+    for (const tool of ['fusermount3', 'fusermount']) {
+        try {
+            execFileSync(tool, ['-u', args.mount], { stdio: 'ignore' });
+            break;
+        } catch {
+            // try the next one
+        }
+    }
+    try {
+        fuse.unmount();
+    } catch {
+        // the loop already returned after fusermount
+    }
+}
+
+// Runs one workload with n client threads. Clients prepare, wait for the
+// start signal, then run their ops back to back.
+let runCount = 0;
+
+async function runWorkload(args, workload, clients, fileSize) {
+    const run = runCount++;
+    const ops = Math.max(1, Math.round(workload.ops * args.scale));
+    const workers = [];
+    const ready = [];
+    const done = [];
+    for (let client = 0; client < clients; client++) {
+        const worker = new Worker(__filename, {
+            workerData: { workload: workload.name, mnt: args.mount, run, client, ops, fileSize }
+        });
+        ready.push(new Promise((resolve, reject) => {
+            worker.once('message', resolve);
+            worker.once('error', reject);
+        }));
+        workers.push(worker);
+    }
+    await Promise.all(ready);
+
+    const start = process.hrtime.bigint();
+    for (const worker of workers) {
+        done.push(new Promise((resolve, reject) => {
+            worker.once('message', resolve);
+            worker.once('error', reject);
+        }));
+        worker.postMessage('go');
+    }
+    const results = await Promise.all(done);
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+    await Promise.all(workers.map(worker => worker.terminate()));
+
+    const samples = new Float64Array(ops * clients);
+    results.forEach((result, i) => samples.set(new Float64Array(result.samples), i * ops));
+    return {
+        workload: workload.name,
+        clients,
+        ops: samples.length,
+        seconds: Math.round(seconds * 1000) / 1000,
+        opsPerSec: Math.round(samples.length / seconds),
+        latencyUs: summarize(samples)
+    };
+}
+
+function runClient() {
+    const { workload: name, mnt, run, client, ops, fileSize } = workerData;
+    const workload = WORKLOADS.find(w => w.name === name);
+    const state = workload.prepare({ mnt, run, client, fileSize });
+    const samples = new Float64Array(ops);
+    parentPort.postMessage('ready');
+    parentPort.once('message', () => {
+        for (let i = 0; i < ops; i++) {
+            const t0 = process.hrtime.bigint();
+            workload.op(state, i);
+            samples[i] = Number(process.hrtime.bigint() - t0);
+        }
+        if (workload.finish) {
+            workload.finish(state);
+        }
+        parentPort.postMessage({ samples: samples.buffer }, [samples.buffer]);
+    });
+}
+
+async function main() {
+    const args = parseArgs(process.argv);
+    const { createStubOperations } = require('./stub-operations.js');
+    const { ops, fileSize } = createStubOperations({ fileSize: args.fileMb * 1024 * 1024 });
+    const fuse = await mountStub(args, ops);
+
+    const results = [];
+    let addonStats = null;
+    let dispatchStats = null;
+    try {
+        for (const workload of WORKLOADS.filter(w => args.workloads.includes(w.name))) {
+            for (const clients of args.clients) {
+                const result = await runWorkload(args, workload, clients, fileSize);
+                const l = result.latencyUs;
+                process.stderr.write(
+                    `${result.workload.padEnd(16)} clients=${String(clients).padEnd(3)} ` +
+                    `${String(result.opsPerSec).padStart(9)} ops/s  ` +
+                    `p50 ${l.p50}us  p99 ${l.p99}us  p999 ${l.p999}us\n`);
+                results.push(result);
+            }
+        }
+    } finally {
+        // Older builds lack these; results stay comparable without them
+        if (typeof fuse.getStats === 'function') {
+            addonStats = fuse.getStats();
+        }
+        if (typeof fuse.getDispatchStats === 'function') {
+            dispatchStats = fuse.getDispatchStats();
+        }
+        unmountStub(args, fuse);
+        fs.rmdirSync(args.mount);
+    }
+
+    const report = {
+        version: 1,
+        date: new Date().toISOString(),
+        commit: gitCommit(),
+        node: process.version,
+        kernel: os.release(),
+        cpus: os.cpus().length,
+        options: args.options,
+        scale: args.scale,
+        results,
+        addonStats,
+        dispatchStats
+    };
+    const json = JSON.stringify(report, null, 2) + '\n';
+    if (args.out) {
+        fs.writeFileSync(args.out, json);
+    } else {
+        process.stdout.write(json);
+    }
+}
+
+if (isMainThread) {
+    main().catch(err => {
+        console.error(err);
+        process.exit(1);
+    });
+} else {
+    runClient();
+}
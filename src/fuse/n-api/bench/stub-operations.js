@@ -0,0 +1,146 @@
+'use strict';
+
+/**
+ * In-memory FuseOperations for the benchmark. Everything is answered
+ * synchronously from prepared data so the numbers measure the bridge
+ * (kernel -> addon -> JS -> addon -> kernel), not a backend.
+ *
+ *   /stat/<name>      any name exists as an empty file, so every stat of a
+ *                     new name is a real lookup
+ *   /dir10k, /dir100k directories with 10 000 and 100 000 empty files
+ *   /data/blob        read-only file of fileSize pseudo-random bytes
+ *   /write/<name>     files created by the write workloads; only their size
+ *                     is kept, the data is dropped
+ */
+
+const crypto = require('crypto');
+
+const ENOENT = -2;
+const EACCES = -13;
+const EISDIR = -21;
+
+const DIR_MODE = 0o40755;
+const FILE_MODE = 0o100644;
+
+function makeStat(mode, size) {
+    const now = new Date();
+    return { mode, size, uid: process.getuid(), gid: process.getgid(), nlink: 1, mtime: now, atime: now, ctime: now };
+}
+
+function createStubOperations({ fileSize = 64 * 1024 * 1024 } = {}) {
+    const blob = Buffer.allocUnsafe(fileSize);
+    crypto.randomFillSync(blob);
+
+    const listings = new Map();
+    for (const [dir, count] of [['/dir10k', 10000], ['/dir100k', 100000]]) {
+        const names = new Array(count);
+        for (let i = 0; i < count; i++) {
+            names[i] = `entry-${i}`;
+        }
+        // One shared stat object keeps the listing cost on the bridge side
+        const stat = makeStat(FILE_MODE, 0);
+        listings.set(dir, { names, stats: new Array(count).fill(stat) });
+    }
+    const dirs = new Set(['/', '/stat', '/data', '/write', ...listings.keys()]);
+    const written = new Map();  // /write/<name> -> size
+
+    const dirStat = makeStat(DIR_MODE, 4096);
+    const emptyStat = makeStat(FILE_MODE, 0);
+    const blobStat = makeStat(FILE_MODE, fileSize);
+    let nextFd = 10;
+
+    function statOf(path) {
+        if (dirs.has(path)) {
+            return dirStat;
+        }
+        if (path === '/data/blob') {
+            return blobStat;
+        }
+        const slash = path.lastIndexOf('/');
+        const parent = path.slice(0, slash);
+        if (parent === '/stat' || (listings.has(parent) && path.slice(slash + 1).startsWith('entry-'))) {
+            return emptyStat;
+        }
+        if (written.has(path)) {
+            return makeStat(FILE_MODE, written.get(path));
+        }
+        return null;
+    }
+
+    const ops = {
+        getattr(path, cb) {
+            const stat = statOf(path);
+            stat ? cb(0, stat) : cb(ENOENT);
+        },
+        readdir(path, cb) {
+            const listing = listings.get(path);
+            if (listing) {
+                cb(0, listing.names, listing.stats);
+            } else if (path === '/write') {
+                cb(0, [...written.keys()].map(p => p.slice('/write/'.length)));
+            } else if (path === '/') {
+                cb(0, ['stat', 'data', 'write', 'dir10k', 'dir100k']);
+            } else if (path === '/data') {
+                cb(0, ['blob']);
+            } else if (dirs.has(path)) {
+                cb(0, []);
+            } else {
+                cb(ENOENT);
+            }
+        },
+        open(path, flags, cb) {
+            if (dirs.has(path)) {
+                cb(EISDIR);
+            } else if (statOf(path)) {
+                cb(0, nextFd++);
+            } else {
+                cb(ENOENT);
+            }
+        },
+        create(path, mode, cb) {
+            if (!path.startsWith('/write/')) {
+                cb(EACCES);
+                return;
+            }
+            written.set(path, 0);
+            cb(0, nextFd++);
+        },
+        read(path, fd, buffer, length, position, cb) {
+            if (path !== '/data/blob') {
+                cb(0, 0);
+                return;
+            }
+            const end = Math.min(position + length, fileSize);
+            const n = end > position ? blob.copy(buffer, 0, position, end) : 0;
+            cb(0, n);
+        },
+        write(path, fd, buffer, length, position, cb) {
+            const size = written.get(path);
+            if (size === undefined) {
+                cb(ENOENT);
+                return;
+            }
+            written.set(path, Math.max(size, position + length));
+            cb(0, length);
+        },
+        truncate(path, size, cb) {
+            if (written.has(path)) {
+                written.set(path, size);
+            }
+            cb(0);
+        },
+        unlink(path, cb) {
+            written.delete(path) ? cb(0) : cb(ENOENT);
+        },
+        release(path, fd, cb) { cb(0); },
+        flush(path, fd, cb) { cb(0); },
+        fsync(path, datasync, fd, cb) { cb(0); },
+        access(path, mode, cb) { cb(statOf(path) ? 0 : ENOENT); },
+        utimens(path, atime, mtime, cb) { cb(0); },
+        chmod(path, mode, cb) { cb(0); },
+        chown(path, uid, gid, cb) { cb(0); }
+    };
+    return { ops, fileSize };
+}
+
+module.exports = { createStubOperations };
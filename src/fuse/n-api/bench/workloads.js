@@ -0,0 +1,119 @@
+'use strict';
+
+/**
+ * Fixed workloads, run by every client thread against the mounted stub.
+ * prepare() does the untimed setup, op(state, i) is one timed operation and
+ * the optional finish() cleans up. Op counts are per client and scaled by
+ * --scale.
+ */
+
+const fs = require('fs');
+
+const KiB = 1024;
+const MiB = 1024 * KiB;
+
+// Deterministic offsets so runs on different commits do the same I/O
+function lcg(seed) {
+    let state = seed >>> 0;
+    return () => {
+        state = (Math.imul(state, 1664525) + 1013904223) >>> 0;
+        return state;
+    };
+}
+
+function statWorkload(name, ops, pathOf) {
+    return {
+        name,
+        ops,
+        prepare({ mnt, run, client }) {
+            return { mnt, run, client };
+        },
+        op(state, i) {
+            fs.statSync(pathOf(state, i));
+        }
+    };
+}
+
+function readdirWorkload(name, ops, dir) {
+    return {
+        name,
+        ops,
+        prepare({ mnt }) {
+            return { path: `${mnt}${dir}` };
+        },
+        op(state) {
+            fs.readdirSync(state.path);
+        }
+    };
+}
+
+function readWorkload(name, ops, blockSize, random) {
+    return {
+        name,
+        ops,
+        prepare({ mnt, client, fileSize }) {
+            const blocks = Math.floor(fileSize / blockSize);
+            return {
+                fd: fs.openSync(`${mnt}/data/blob`, 'r'),
+                buffer: Buffer.allocUnsafe(blockSize),
+                blocks,
+                next: lcg(client + 1)
+            };
+        },
+        op(state, i) {
+            const block = random ? state.next() % state.blocks : i % state.blocks;
+            fs.readSync(state.fd, state.buffer, 0, blockSize, block * blockSize);
+        },
+        finish(state) {
+            fs.closeSync(state.fd);
+        }
+    };
+}
+
+function writeWorkload(name, ops, blockSize, random) {
+    // Files stay below this size; only their length is kept by the stub
+    const span = 64 * MiB;
+    return {
+        name,
+        ops,
+        prepare({ mnt, run, client }) {
+            const path = `${mnt}/write/${name}-${run}-${client}`;
+            return {
+                path,
+                fd: fs.openSync(path, 'w'),
+                buffer: Buffer.alloc(blockSize, client & 0xff),
+                blocks: span / blockSize,
+                next: lcg(client + 1)
+            };
+        },
+        op(state, i) {
+            const block = random ? state.next() % state.blocks : i % state.blocks;
+            fs.writeSync(state.fd, state.buffer, 0, blockSize, block * blockSize);
+        },
+        finish(state) {
+            fs.closeSync(state.fd);
+            fs.unlinkSync(state.path);
+        }
+    };
+}
+
+const WORKLOADS = [
+    // Every name is new, so each stat is a lookup that reaches the addon
+    statWorkload('stat-cold', 20000, (s, i) => `${s.mnt}/stat/c${s.run}-${s.client}-${i}`),
+    // The same 64 names over and over: kernel and addon caches
+    statWorkload('stat-hot', 20000, (s, i) => `${s.mnt}/stat/h${i % 64}`),
+    readdirWorkload('readdir-10k', 50, '/dir10k'),
+    readdirWorkload('readdir-100k', 5, '/dir100k'),
+    readWorkload('seq-read-4k', 16384, 4 * KiB, false),
+    readWorkload('seq-read-64k', 2048, 64 * KiB, false),
+    readWorkload('seq-read-1m', 256, MiB, false),
+    readWorkload('rand-read-4k', 8192, 4 * KiB, true),
+    readWorkload('rand-read-64k', 2048, 64 * KiB, true),
+    writeWorkload('seq-write-4k', 16384, 4 * KiB, false),
+    writeWorkload('seq-write-64k', 2048, 64 * KiB, false),
+    writeWorkload('seq-write-1m', 256, MiB, false),
+    writeWorkload('rand-write-4k', 8192, 4 * KiB, true),
+    writeWorkload('rand-write-64k', 2048, 64 * KiB, true)
+];
+
+module.exports = { WORKLOADS };
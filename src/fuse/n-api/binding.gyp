@@ -1,17 +1,37 @@
 {
+  "variables": {
+    "native_tests%": 0
+  },
   "targets": [
     {
       "target_name": "fuse3_napi",
       "sources": [ 
         "fuse3_napi.cc",
-        "fuse3_operations.cc"
+        "fuse3_operations.cc",
+        "fuse3_attr_cache.cc",
+        "fuse3_content_cache.cc",
+        "fuse3_backing_files.cc",
+        "fuse3_write_buffer.cc",
+        "fuse3_readahead.cc",
+        "fuse3_path_table.cc",
+        "fuse3_probe_filter.cc",
+        "fuse3_notify.cc",
+        "fuse3_workers.cc",
+        "fuse3_dispatch.cc",
+        "fuse3_op_stats.cc",
+        "fuse3_flight_recorder.cc",
+        "fuse3_request_slots.cc",
+        "fuse3_prewarm.cc",
+        "fuse3_buffer_pool.cc",
+        "fuse3_inode_table.cc",
+        "fuse3_lowlevel.cc"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")"
       ],
       "defines": [ 
         "NAPI_DISABLE_CPP_EXCEPTIONS",
-        "FUSE_USE_VERSION=31",
+        "FUSE_USE_VERSION=<!(pkg-config --atleast-version=3.12 fuse3 && echo 312 || echo 35)",
         "_FILE_OFFSET_BITS=64"
       ],
       "cflags!": [ "-fno-exceptions" ],
@@ -34,6 +54,52 @@
           "type": "none"
         }]
       ]
+    },
+    {
+      "target_name": "fuse3_native_tests",
+      "type": "executable",
+      "sources": [
+        "fuse3_write_buffer.cc",
+        "fuse3_readahead.cc",
+        "fuse3_attr_cache.cc",
+        "fuse3_content_cache.cc",
+        "fuse3_probe_filter.cc",
+        "fuse3_flight_recorder.cc",
+        "fuse3_op_stats.cc",
+        "fuse3_request_slots.cc",
+        "fuse3_inode_table.cc",
+        "fuse3_notify.cc",
+        "fuse3_prewarm.cc",
+        "../../../test/native/main.cc",
+        "../../../test/native/write_buffer.test.cc",
+        "../../../test/native/readahead.test.cc",
+        "../../../test/native/attr_cache.test.cc",
+        "../../../test/native/content_cache.test.cc",
+        "../../../test/native/probe_filter.test.cc",
+        "../../../test/native/flight_recorder.test.cc",
+        "../../../test/native/lanes.test.cc",
+        "../../../test/native/request_slots.test.cc",
+        "../../../test/native/inode_table.test.cc",
+        "../../../test/native/op_stats.test.cc",
+        "../../../test/native/notify.test.cc",
+        "../../../test/native/prewarm.test.cc"
+      ],
+      "include_dirs": [
+        ".",
+        "../../../test/native"
+      ],
+      "cflags!": [ "-fno-exceptions" ],
+      "cflags_cc!": [ "-fno-exceptions" ],
+      "cflags": [
+        "-Wall",
+        "-Wextra"
+      ],
+      "ldflags": [ "-pthread" ],
+      "conditions": [
+        ["OS!='linux' or native_tests!=1", {
+          "type": "none"
+        }]
+      ]
     }
   ]
 }
\ No newline at end of file
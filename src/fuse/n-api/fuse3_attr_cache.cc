@@ -0,0 +1,159 @@
+#include "fuse3_attr_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Longer ttls (Infinity included) are cut to this, so the expiry stays far
+// inside int64_t nanoseconds. It is about 31 years.
+static constexpr double kMaxTtl = 1e9;
+
+int64_t AttrCache::Now() const {
+    return options_.now ? options_.now() : NowNs();
+}
+
+AttrCache::AttrCache(const Options& options)
+    : options_(options),
+      shardCapacity_(options.maxEntries / kShardCount > 0 ? options.maxEntries / kShardCount : 1) {
+}
+
+AttrCache::Shard& AttrCache::ShardFor(std::string_view path) {
+    return shards_[std::hash<std::string_view>()(path) % kShardCount];
+}
+
+void AttrCache::Erase(Shard& shard, std::list<Entry>::iterator it) {
+    shard.index.erase(std::string_view(it->path));
+    shard.lru.erase(it);
+}
+
+bool AttrCache::Lookup(std::string_view path, struct stat* st, int* err) {
+    Shard& shard = ShardFor(path);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(path);
+    if (found == shard.index.end()) {
+        shard.misses++;
+        return false;
+    }
+
+    auto it = found->second;
+    if (it->expiresAt <= Now()) {
+        Erase(shard, it);
+        shard.misses++;
+        return false;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    *err = it->err;
+    if (it->err == 0) {
+        *st = it->st;
+        shard.hits++;
+    } else {
+        shard.negativeHits++;
+    }
+    return true;
+}
+
+void AttrCache::Store(std::string_view path, const struct stat* st, int err, double ttl) {
+    if (!(ttl > 0)) {  // NaN too
+        return;
+    }
+
+    int64_t expiresAt = Now() + static_cast<int64_t>(std::min(ttl, kMaxTtl) * 1e9);
+    Shard& shard = ShardFor(path);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(path);
+    if (found != shard.index.end()) {
+        auto it = found->second;
+        if (st) {
+            it->st = *st;
+        }
+        it->err = err;
+        it->expiresAt = expiresAt;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it);
+        return;
+    }
+
+    while (shard.lru.size() >= shardCapacity_) {
+        Erase(shard, std::prev(shard.lru.end()));
+        shard.evictions++;
+    }
+
+    Entry entry;
+    entry.path.assign(path.data(), path.size());
+    if (st) {
+        entry.st = *st;
+    }
+    entry.err = err;
+    entry.expiresAt = expiresAt;
+    shard.lru.push_front(std::move(entry));
+    // The key views the string owned by the list node, which never moves.
+    shard.index.emplace(std::string_view(shard.lru.front().path), shard.lru.begin());
+}
+
+void AttrCache::Insert(std::string_view path, const struct stat& st, double ttl) {
+    Store(path, &st, 0, ttl);
+}
+
+void AttrCache::InsertNegative(std::string_view path, int err) {
+    Store(path, nullptr, err, options_.negativeTtl);
+}
+
+void AttrCache::Invalidate(std::string_view path) {
+    Shard& shard = ShardFor(path);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(path);
+    if (found != shard.index.end()) {
+        Erase(shard, found->second);
+    }
+}
+
+void AttrCache::InvalidatePrefix(std::string_view prefix) {
+    while (prefix.size() > 1 && prefix.back() == '/') {
+        prefix.remove_suffix(1);
+    }
+    bool everything = prefix.empty() || prefix == "/";
+
+    // Children hash to arbitrary shards, so every shard has to be scanned.
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto it = shard.lru.begin(); it != shard.lru.end();) {
+            std::string_view path(it->path);
+            bool below = everything ||
+                (path.size() >= prefix.size() && path.compare(0, prefix.size(), prefix) == 0 &&
+                 (path.size() == prefix.size() || path[prefix.size()] == '/'));
+            auto next = std::next(it);
+            if (below) {
+                Erase(shard, it);
+            }
+            it = next;
+        }
+    }
+}
+
+void AttrCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.lru.clear();
+    }
+}
+
+AttrCache::Counters AttrCache::GetCounters() {
+    Counters counters;
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        counters.hits += shard.hits;
+        counters.negativeHits += shard.negativeHits;
+        counters.misses += shard.misses;
+        counters.evictions += shard.evictions;
+        counters.entries += shard.lru.size();
+    }
+    return counters;
+}
\ No newline at end of file
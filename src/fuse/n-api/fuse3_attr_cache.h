@@ -0,0 +1,80 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Path -> struct stat cache consulted by fuse3_getattr before going to JS.
+// Entries carry their own expiry; negative entries remember an errno (usually
+// ENOENT). The key space is split over independent shards, each an LRU capped
+// at maxEntries / kShardCount, so concurrent FUSE workers rarely contend.
+class AttrCache {
+public:
+    struct Options {
+        size_t maxEntries = 65536;
+        double ttl = 1.0;           // seconds, 0 disables positive caching
+        double negativeTtl = 0.0;   // seconds, 0 disables negative caching
+        int64_t (*now)() = nullptr;  // nanoseconds; null for the steady clock (tests set it)
+    };
+
+    struct Counters {
+        uint64_t hits = 0;
+        uint64_t negativeHits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t entries = 0;
+    };
+
+    explicit AttrCache(const Options& options);
+
+    // Returns true on a fresh hit. err is 0 for positive entries, -errno for
+    // negative ones; st is only written for positive entries.
+    bool Lookup(std::string_view path, struct stat* st, int* err);
+
+    void Insert(std::string_view path, const struct stat& st, double ttl);
+    void Insert(std::string_view path, const struct stat& st) { Insert(path, st, options_.ttl); }
+    void InsertNegative(std::string_view path, int err);
+
+    void Invalidate(std::string_view path);
+    // Drops path itself and everything below it.
+    void InvalidatePrefix(std::string_view prefix);
+    void Clear();
+
+    Counters GetCounters();
+    const Options& GetOptions() const { return options_; }
+
+private:
+    static constexpr size_t kShardCount = 64;
+
+    int64_t Now() const;
+
+    struct Entry {
+        std::string path;
+        struct stat st;
+        int err;
+        int64_t expiresAt;  // steady clock, nanoseconds
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;  // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        uint64_t hits = 0;
+        uint64_t negativeHits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    Shard& ShardFor(std::string_view path);
+    void Store(std::string_view path, const struct stat* st, int err, double ttl);
+    static void Erase(Shard& shard, std::list<Entry>::iterator it);
+
+    Options options_;
+    size_t shardCapacity_;
+    Shard shards_[kShardCount];
+};
\ No newline at end of file
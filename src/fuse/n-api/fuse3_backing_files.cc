@@ -0,0 +1,56 @@
+#include "fuse3_backing_files.h"
+#include <unistd.h>
+
+BackingFiles::~BackingFiles() {
+    for (auto& entry : files_) {
+        Close(entry.second);
+    }
+}
+
+void BackingFiles::Attach(uint64_t fh, const File& file) {
+    File previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = files_.find(fh);
+        if (found != files_.end()) {
+            previous = found->second;
+        }
+        files_[fh] = file;
+    }
+    Close(previous);
+}
+
+bool BackingFiles::Find(uint64_t fh, File* file) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = files_.find(fh);
+    if (found == files_.end()) {
+        return false;
+    }
+    *file = found->second;
+    return true;
+}
+
+void BackingFiles::SetBackingId(uint64_t fh, int backingId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = files_.find(fh);
+    if (found != files_.end()) {
+        found->second.backingId = backingId;
+    }
+}
+
+bool BackingFiles::Detach(uint64_t fh, File* file) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = files_.find(fh);
+    if (found == files_.end()) {
+        return false;
+    }
+    *file = found->second;
+    files_.erase(found);
+    return true;
+}
+
+void BackingFiles::Close(const File& file) {
+    if (file.fd >= 0) {
+        close(file.fd);
+    }
+}
\ No newline at end of file
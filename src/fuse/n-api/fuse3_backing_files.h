@@ -0,0 +1,38 @@
+#pragma once
+
+#include <sys/types.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Host files backing open handles. An open handler that reports a backing fd
+// hands the bytes of the file over to the addon: reads of that handle are
+// answered from the fd without calling into JS until release.
+class BackingFiles {
+public:
+    struct File {
+        int fd = -1;          // owned, closed on Detach
+        off_t offset = 0;     // where the content starts in the host file
+        int backingId = 0;    // kernel passthrough id, 0 if not passed through
+    };
+
+    BackingFiles() = default;
+    BackingFiles(const BackingFiles&) = delete;
+    BackingFiles& operator=(const BackingFiles&) = delete;
+    ~BackingFiles();
+
+    // Takes ownership of file.fd. A handle that is attached again (handles
+    // are reused after release) closes the previous fd.
+    void Attach(uint64_t fh, const File& file);
+    bool Find(uint64_t fh, File* file);
+    void SetBackingId(uint64_t fh, int backingId);
+    // Forgets fh and returns its entry. The caller closes the passthrough id
+    // (it needs the request) before calling Close.
+    bool Detach(uint64_t fh, File* file);
+    static void Close(const File& file);
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, File> files_;
+};
\ No newline at end of file
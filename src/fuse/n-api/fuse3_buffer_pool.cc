@@ -0,0 +1,47 @@
+#include "fuse3_buffer_pool.h"
+#include <cstdlib>
+
+BufferPool::BufferPool(size_t blockSize, size_t maxFree)
+    : blockSize_(blockSize), maxFree_(maxFree) {
+    free_.reserve(maxFree);
+}
+
+BufferPool::~BufferPool() {
+    for (char* block : free_) {
+        std::free(block);
+    }
+}
+
+char* BufferPool::Acquire(size_t size) {
+    if (size <= blockSize_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            char* block = free_.back();
+            free_.pop_back();
+            reused_++;
+            return block;
+        }
+        allocated_++;
+    }
+    return static_cast<char*>(std::malloc(size <= blockSize_ ? blockSize_ : size));
+}
+
+void BufferPool::Release(char* block, size_t size) {
+    if (size <= blockSize_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.size() < maxFree_) {
+            free_.push_back(block);
+            return;
+        }
+    }
+    std::free(block);
+}
+
+BufferPool::Counters BufferPool::GetCounters() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Counters counters;
+    counters.reused = reused_;
+    counters.allocated = allocated_;
+    counters.free = free_.size();
+    return counters;
+}
\ No newline at end of file
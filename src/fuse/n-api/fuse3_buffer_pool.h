@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Fixed-size blocks recycled between requests. The low-level backend owns its
+// read and write payload memory (the high-level API allocates its own), and a
+// 128 KiB malloc per request is exactly what the pool avoids. Larger requests
+// bypass the pool.
+class BufferPool {
+public:
+    struct Counters {
+        uint64_t reused = 0;
+        uint64_t allocated = 0;
+        uint64_t free = 0;
+    };
+
+    BufferPool(size_t blockSize, size_t maxFree);
+    ~BufferPool();
+
+    char* Acquire(size_t size);
+    void Release(char* block, size_t size);
+
+    Counters GetCounters();
+
+private:
+    size_t blockSize_;
+    size_t maxFree_;
+    std::mutex mutex_;
+    std::vector<char*> free_;
+    uint64_t reused_ = 0;
+    uint64_t allocated_ = 0;
+};
+
+// One block on loan, returned by Release() or at the latest when the last
+// reference goes away. Requests that die on an error path therefore cannot
+// leak their block.
+class BufferLease {
+public:
+    BufferLease(std::shared_ptr<BufferPool> pool, size_t size)
+        : pool_(std::move(pool)), size_(size), data_(pool_->Acquire(size)) {}
+    ~BufferLease() { Release(); }
+
+    BufferLease(const BufferLease&) = delete;
+    BufferLease& operator=(const BufferLease&) = delete;
+
+    char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+    void Release() {
+        if (data_) {
+            pool_->Release(data_, size_);
+            data_ = nullptr;
+        }
+    }
+
+private:
+    std::shared_ptr<BufferPool> pool_;
+    size_t size_;
+    char* data_;
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "fuse3_content_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+ContentCache::ContentCache(const Options& options)
+    : options_(options),
+      shardBudget_(options.maxBytes / kShardCount) {
+}
+
+std::string ContentCache::KeyFor(std::string_view hash, uint64_t chunk) {
+    std::string key(hash.data(), hash.size());
+    key.push_back('@');
+    key.append(std::to_string(chunk));
+    return key;
+}
+
+ContentCache::Shard& ContentCache::ShardFor(const std::string& key) {
+    return shards_[std::hash<std::string>()(key) % kShardCount];
+}
+
+ContentCache::Chunk ContentCache::Find(const std::string& key) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    return found->second->chunk;
+}
+
+bool ContentCache::Lookup(std::string_view hash, uint64_t offset, size_t size, std::vector<Slice>* slices) {
+    slices->clear();
+    uint64_t pos = offset;
+    uint64_t end = offset + size;
+    while (pos < end) {
+        uint64_t index = pos / kChunkSize;
+        Chunk chunk = Find(KeyFor(hash, index));
+        if (!chunk) {
+            slices->clear();
+            misses_++;
+            return false;
+        }
+
+        size_t within = pos - index * kChunkSize;
+        if (within >= chunk->size()) {
+            break;  // past the end of the content
+        }
+        size_t length = std::min<uint64_t>(chunk->size() - within, end - pos);
+        slices->push_back({chunk, within, length});
+        pos += length;
+        if (chunk->size() < kChunkSize) {
+            break;
+        }
+    }
+    hits_++;
+    return true;
+}
+
+void ContentCache::Store(std::string key, Chunk chunk) {
+    if (chunk->size() > shardBudget_) {
+        return;
+    }
+
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        // Content-addressed, so the bytes are the same; just refresh
+        shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+        return;
+    }
+
+    while (!shard.lru.empty() && shard.bytes + chunk->size() > shardBudget_) {
+        Entry& victim = shard.lru.back();
+        shard.bytes -= victim.chunk->size();
+        shard.index.erase(std::string_view(victim.key));
+        shard.lru.pop_back();
+        shard.evictions++;
+    }
+
+    shard.bytes += chunk->size();
+    shard.lru.push_front(Entry{std::move(key), std::move(chunk)});
+    // The key views the string owned by the list node, which never moves.
+    shard.index.emplace(std::string_view(shard.lru.front().key), shard.lru.begin());
+}
+
+void ContentCache::Insert(std::string_view hash, uint64_t offset, const char* data, size_t size, bool eof) {
+    if (offset % kChunkSize != 0) {
+        return;
+    }
+    uint64_t index = offset / kChunkSize;
+    size_t pos = 0;
+    while (size - pos >= kChunkSize) {
+        Store(KeyFor(hash, index++), std::make_shared<const std::string>(data + pos, kChunkSize));
+        pos += kChunkSize;
+    }
+    // A trailing partial chunk is only complete if the content ends there
+    if (eof) {
+        Store(KeyFor(hash, index), std::make_shared<const std::string>(data + pos, size - pos));
+    }
+}
+
+size_t ContentCache::CopySlices(const std::vector<Slice>& slices, char* out) {
+    size_t copied = 0;
+    for (const Slice& slice : slices) {
+        memcpy(out + copied, slice.chunk->data() + slice.offset, slice.length);
+        copied += slice.length;
+    }
+    return copied;
+}
+
+void ContentCache::Bind(uint64_t fh, std::string hash) {
+    std::lock_guard<std::mutex> lock(handlesMutex_);
+    handles_[fh] = std::move(hash);
+}
+
+void ContentCache::Unbind(uint64_t fh) {
+    std::lock_guard<std::mutex> lock(handlesMutex_);
+    handles_.erase(fh);
+}
+
+bool ContentCache::HashOf(uint64_t fh, std::string* hash) {
+    std::lock_guard<std::mutex> lock(handlesMutex_);
+    auto found = handles_.find(fh);
+    if (found == handles_.end()) {
+        return false;
+    }
+    *hash = found->second;
+    return true;
+}
+
+void ContentCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+    }
+}
+
+ContentCache::Counters ContentCache::GetCounters() {
+    Counters counters;
+    counters.hits = hits_;
+    counters.misses = misses_;
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        counters.evictions += shard.evictions;
+        counters.entries += shard.lru.size();
+        counters.bytes += shard.bytes;
+    }
+    return counters;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// File content keyed by a content hash that JS reports from open(). ONE
+// objects are immutable and reachable through several paths, so bytes read
+// once are served natively from then on, whichever path they are read
+// through. Content is stored in fixed-size chunks; each shard is an LRU
+// bounded by maxBytes / kShardCount.
+class ContentCache {
+public:
+    static constexpr size_t kChunkSize = 128 * 1024;
+
+    struct Options {
+        size_t maxBytes = 64 * 1024 * 1024;
+    };
+
+    struct Counters {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+    };
+
+    // A chunk shorter than kChunkSize ends the content
+    using Chunk = std::shared_ptr<const std::string>;
+
+    struct Slice {
+        Chunk chunk;
+        size_t offset;
+        size_t length;
+    };
+
+    explicit ContentCache(const Options& options);
+
+    // Collects [offset, offset + size) of the content. Returns false, and
+    // counts a miss, unless every chunk of the range up to the end of the
+    // content is cached. Slices keep their chunks alive after eviction.
+    bool Lookup(std::string_view hash, uint64_t offset, size_t size, std::vector<Slice>* slices);
+
+    // Stores content read at a chunk-aligned offset. eof means the read came
+    // back short, so the last (possibly empty) chunk ends the content.
+    void Insert(std::string_view hash, uint64_t offset, const char* data, size_t size, bool eof);
+
+    static size_t CopySlices(const std::vector<Slice>& slices, char* out);
+
+    // Open handles whose content hash is known
+    void Bind(uint64_t fh, std::string hash);
+    void Unbind(uint64_t fh);
+    bool HashOf(uint64_t fh, std::string* hash);
+
+    void Clear();
+    Counters GetCounters();
+    const Options& GetOptions() const { return options_; }
+
+private:
+    static constexpr size_t kShardCount = 16;
+
+    struct Entry {
+        std::string key;
+        Chunk chunk;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;  // most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        uint64_t evictions = 0;
+    };
+
+    static std::string KeyFor(std::string_view hash, uint64_t chunk);
+    Shard& ShardFor(const std::string& key);
+    Chunk Find(const std::string& key);
+    void Store(std::string key, Chunk chunk);
+
+    Options options_;
+    size_t shardBudget_;
+    Shard shards_[kShardCount];
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+
+    std::mutex handlesMutex_;
+    std::unordered_map<uint64_t, std::string> handles_;
+};
\ No newline at end of file
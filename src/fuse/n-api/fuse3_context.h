@@ -0,0 +1,298 @@
+#pragma once
+
+#include <napi.h>
+#include <fuse.h>
+#include "fuse3_attr_cache.h"
+#include "fuse3_backing_files.h"
+#include "fuse3_content_cache.h"
+#include "fuse3_dispatch.h"
+#include "fuse3_flight_recorder.h"
+#include "fuse3_notify.h"
+#include "fuse3_op_stats.h"
+#include "fuse3_path_table.h"
+#include "fuse3_prewarm.h"
+#include "fuse3_probe_filter.h"
+#include "fuse3_readahead.h"
+#include "fuse3_workers.h"
+#include "fuse3_write_buffer.h"
+#include <errno.h>
+#include <string_view>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <memory>
+
+// How the FUSE session loop is run. Names follow the libfuse mount options.
+struct FuseLoopOptions {
+    bool multithreaded = false;     // fuse_loop_mt instead of fuse_loop
+    unsigned int maxThreads = 10;   // worker count (libfuse >= 3.12 only)
+    bool cloneFd = false;           // one /dev/fuse fd per worker thread
+    unsigned int maxIdleThreads = 10;
+};
+
+// Kernel connection settings (fuseOptions), applied when the kernel sends
+// INIT. A zero size or count leaves libfuse's default in place.
+struct FuseConnOptions {
+    double entryTimeout = 1.0;     // seconds the kernel keeps a dentry
+    double attrTimeout = 1.0;      // seconds the kernel keeps attributes
+    double negativeTimeout = 0;    // seconds the kernel keeps an ENOENT
+    bool kernelCache = false;      // keep the page cache across opens
+    bool autoCache = false;        // ... unless mtime or size changed (high-level only)
+    bool asyncRead = true;         // FUSE_CAP_ASYNC_READ
+    bool parallelDirops = true;    // FUSE_CAP_PARALLEL_DIROPS
+    unsigned int maxRead = 0;      // mount option, bytes
+    unsigned int maxWrite = 0;     // bytes; max_pages pages when only that is given
+    unsigned int maxReadahead = 0; // bytes
+    unsigned int maxBackground = 0;
+    unsigned int congestionThreshold = 0;
+};
+
+// How long a request may wait for its handler (op_timeout, op_timeouts) and
+// whether kernel interrupts end it (interrupts). A request ended either way
+// is answered with timeoutErr or EINTR; its handler is told through
+// ops.cancel(cb, reason) and whatever it reports later is dropped.
+struct FuseDeadlineOptions {
+    // Seconds per operation, 0 for none; [StatOp::Count] is used where the
+    // operation is not known
+    double timeouts[static_cast<size_t>(StatOp::Count) + 1] = {};
+    int timeoutErr = -EIO;
+    bool interrupts = false;
+
+    double For(StatOp op) const { return timeouts[static_cast<size_t>(std::min(op, StatOp::Count))]; }
+    // When op started now runs out of time; time_point::max() without a timeout
+    std::chrono::steady_clock::time_point Deadline(StatOp op) const {
+        using Clock = std::chrono::steady_clock;
+        double timeout = For(op);
+        if (timeout <= 0) {
+            return Clock::time_point::max();
+        }
+        return Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout));
+    }
+    bool Enabled() const {
+        return interrupts || std::any_of(std::begin(timeouts), std::end(timeouts), [](double t) { return t > 0; });
+    }
+};
+
+struct DeadlineCounters {
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<uint64_t> interrupts{0};
+};
+
+struct fuse_session;
+struct LowLevelState;  // fuse3_lowlevel.cc
+
+// FUSE operation callback context
+struct FuseContext {
+    Napi::ThreadSafeFunction tsfn;
+    std::shared_ptr<Dispatcher> dispatcher;  // of the thread that created the mount
+    std::shared_ptr<WorkerPool> workers;  // every operation reaches JS through this
+    std::shared_ptr<OpStats> stats;  // null when op_stats is off
+    std::shared_ptr<FlightRecorder> recorder;  // null when flight_recorder is off
+    Napi::ObjectReference operations;
+    std::string mountPoint;
+    FuseLoopOptions loop;
+    FuseConnOptions conn;
+    FuseDeadlineOptions deadlines;
+    DeadlineCounters deadlineCounters;
+    // What the kernel and libfuse settled on in init; valid once connected
+    std::mutex negotiatedMutex;
+    bool connected = false;
+    struct fuse_conn_info negotiated;
+    std::shared_ptr<AttrCache> attrCache;  // null when attr_cache is off
+    std::shared_ptr<ContentCache> contentCache;  // null when content_cache is off
+    std::shared_ptr<PathTable> paths;  // null when path_cache and path_ids are off
+    std::shared_ptr<ProbeFilter> probeFilter;  // null when probe_filter is off
+    bool zeroCopyRead = true;  // read handlers fill the FUSE reply buffer
+    bool spliceRead = false;   // FUSE_CAP_SPLICE_READ for large writes
+    bool lowLevel = false;     // inode-based backend (fuse3_lowlevel.cc)
+    bool passthrough = true;   // FUSE passthrough for backed handles (low-level)
+    bool writebackCache = false;  // FUSE_CAP_WRITEBACK_CACHE
+    std::shared_ptr<WriteBuffer> writeBuffer;  // null unless write_coalesce is on
+    std::shared_ptr<Readahead> readahead;  // null when readahead is off
+    std::shared_ptr<KernelNotifier> notifier;  // runs while mounted
+    std::shared_ptr<RequestSlots> requestSlots;  // null when request_slots is off
+    std::shared_ptr<Prewarmer> prewarmer;  // null when prewarm is off
+    Napi::FunctionReference prewarmListener;  // JS thread only
+    BackingFiles backingFiles;
+    struct fuse *fuse;
+    struct fuse_session *session = nullptr;  // low-level only
+    // Held while unmounting and destroying fuse or session: unmount() and
+    // the FUSE thread may both get there
+    std::mutex unmountMutex;
+    std::shared_ptr<LowLevelState> lowLevelState;
+    std::thread *fuseThread;
+    std::atomic<bool> mounted;
+};
+
+// Binary stat replies: getattr may call back with a Float64Array holding one
+// entry and readdir with one of kStatFields doubles per name, in place of
+// Stats objects. Times are split into seconds and nanoseconds so they stay
+// exact; a ttl of NaN keeps the attr_cache_timeout default.
+enum StatField {
+    kStatMode,
+    kStatSize,
+    kStatUid,
+    kStatGid,
+    kStatNlink,
+    kStatAtimeSec,
+    kStatAtimeNsec,
+    kStatMtimeSec,
+    kStatMtimeNsec,
+    kStatCtimeSec,
+    kStatCtimeNsec,
+    kStatTtl,
+    kStatFields
+};
+
+// What open reported besides the handle: cb(0, fd, contentHash) or
+// cb(0, fd, { contentHash, backingFd, backingOffset })
+struct OpenReply {
+    std::string contentHash;
+    BackingFiles::File backing;  // fd is our own duplicate
+};
+
+// High-level backend: timer of the operation the calling FUSE worker is
+// serving, set around every fuse3_* callback (fuse3_napi.cc)
+extern thread_local OpTimer* t_opTimer;
+
+// Payload size of the current read or write, when the result does not say
+inline void CountBytes(uint64_t bytes) {
+    if (t_opTimer) {
+        t_opTimer->bytes = bytes;
+    }
+}
+
+// Result handed from the JS thread back to a waiting FUSE worker. JS handlers
+// may call back more than once, or after the worker stopped waiting
+// (Abandon), so only the first completion is delivered. Memory of the worker
+// (stbuf, buffers, the path) is only touched while it still waits.
+struct OpCompletion {
+    std::promise<int> promise;
+    std::atomic<bool> done{false};
+    // Lives while the worker waits, which is as long as done is false
+    OpTimer* timer = t_opTimer;
+    std::mutex mutex;  // held while a result is written for the worker
+    CancelHandle cancel;
+
+    // The work item started on the JS thread. Returns false if the worker
+    // stopped waiting already; otherwise read ran, and could still read
+    // memory of the worker.
+    template<typename Read>
+    bool Started(Read read) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (done) {
+            return false;
+        }
+        read();
+        if (timer) {
+            timer->Running();
+        }
+        return true;
+    }
+
+    bool Started() {
+        return Started([] {});
+    }
+
+    // fill writes the result into memory of the worker; it only runs if the
+    // worker still waits
+    template<typename Fill>
+    void Complete(int result, Fill fill) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (done) {
+            return;
+        }
+        fill();
+        done = true;
+        if (timer) {
+            timer->Answered();
+        }
+        promise.set_value(result);
+    }
+
+    void Complete(int result) {
+        Complete(result, [] {});
+    }
+
+    // On the worker: ends the request with err unless a result came first.
+    // Returns true if it did.
+    bool Abandon(int err) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (done) {
+            return false;
+        }
+        done = true;
+        promise.set_value(err);
+        return true;
+    }
+};
+
+// Mount served by the calling FUSE worker (high-level backend). fuse_new is
+// given the context as user data, so this needs no lookup or lock; the
+// low-level backend gets it the same way through fuse_req_userdata.
+inline FuseContext* CurrentContext() {
+    struct fuse_context* context = fuse_get_context();
+    return context ? static_cast<FuseContext*>(context->private_data) : nullptr;
+}
+
+// Queues work for the JS thread serving path (see WorkerPool)
+inline napi_status PostJs(FuseContext* ctx, std::string_view path, Dispatcher::Work&& work,
+                          Dispatcher::Lane lane = Dispatcher::Lane::Metadata) {
+    return ctx->workers->Post(path, std::move(work), lane);
+}
+
+// Queues work on an open handle for the JS thread that opened it
+inline napi_status PostHandleJs(FuseContext* ctx, uint64_t fh, std::string_view path, Dispatcher::Work&& work,
+                                Dispatcher::Lane lane = Dispatcher::Lane::Metadata) {
+    return ctx->workers->PostHandle(fh, path, std::move(work), lane);
+}
+
+// The operations of the JS thread running the current work item
+inline Napi::Object JsOperations(FuseContext* ctx) {
+    Dispatcher* current = Dispatcher::Current();
+    return current ? current->Operations() : ctx->operations.Value();
+}
+
+// A path argument for a JS handler (JS thread only): interned string or ID.
+// Every JS thread has its own table.
+inline Napi::Value PathToJs(Napi::Env env, FuseContext* ctx, std::string_view path) {
+    Dispatcher* current = Dispatcher::Current();
+    PathTable* paths = current ? current->Paths() : ctx->paths.get();
+    if (paths) {
+        return paths->ToJs(env, path);
+    }
+    return Napi::String::New(env, path.data(), path.size());
+}
+
+// Shared by the high-level (fuse3_operations.cc) and low-level
+// (fuse3_lowlevel.cc) backends
+bool ParseJsStat(Napi::Value value, struct stat* stbuf, double* ttl);
+void CacheJsStat(AttrCache* cache, std::string_view path, const struct stat& stbuf, double ttl);
+// Walks a readdir reply: the names in info[1] (string[] or one string of
+// NUL-separated names) with the stats in info[2] (an array of Stats, or a
+// Float64Array of kStatFields doubles per name). st is null for names that
+// come without stats. Returns false if info[1] holds no names.
+using JsEntryFn = std::function<void(std::string& name, const struct stat* st, double ttl)>;
+bool ForEachJsEntry(const JsArgs& info, const JsEntryFn& each);
+void InvalidateAttrs(FuseContext* ctx, const char* path, bool withParent = false);
+void InvalidateAttrTree(FuseContext* ctx, const char* path);
+bool NewExternalBuffer(Napi::Env env, char* data, size_t size, Napi::Buffer<char>& buffer);
+void DetachBuffer(Napi::Buffer<char> buffer);
+int ParseWriteResult(const JsArgs& info, size_t size);
+void ParseOpenReply(Napi::Value value, OpenReply* reply);
+void BindOpenReply(FuseContext* ctx, uint64_t fh, int flags, OpenReply& reply);
+void UnbindHandle(FuseContext* ctx, uint64_t fh);
+int WriteToJs(FuseContext* ctx, const char* path, uint64_t fh, const char* data, size_t size, off_t offset);
+std::shared_ptr<WriteBuffer> NewWriteBuffer(FuseContext* ctx, const WriteBuffer::Options& options);
+std::shared_ptr<Readahead> NewReadahead(FuseContext* ctx, const Readahead::Options& options);
+std::shared_ptr<Prewarmer> NewPrewarmer(FuseContext* ctx, const Prewarmer::Options& options,
+                                        Prewarmer::ProgressFn progress);
+void FlushPendingWrites(FuseContext* ctx, const char* path, StatOp op);
+void AddMountOptions(FuseContext* ctx, struct fuse_args* args);
+void ApplyConnectionOptions(FuseContext* ctx, struct fuse_conn_info* conn);
\ No newline at end of file
@@ -0,0 +1,429 @@
+#include "fuse3_dispatch.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct PendingCall {
+    std::string name;
+    std::vector<napi_value> args;
+    std::function<void()> onThrow;
+};
+
+// Set on the JS thread while a drain collects calls for ops.batch
+thread_local std::vector<PendingCall>* t_batch = nullptr;
+
+// Set on a JS thread while it runs work of a dispatcher
+thread_local Dispatcher* t_current = nullptr;
+
+class CurrentScope {
+public:
+    explicit CurrentScope(Dispatcher* dispatcher) : previous_(t_current) { t_current = dispatcher; }
+    ~CurrentScope() { t_current = previous_; }
+
+private:
+    Dispatcher* previous_;
+};
+
+}  // namespace
+
+void Dispatcher::Start(Napi::ThreadSafeFunction tsfn, Napi::ObjectReference* operations, PathTable* paths) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tsfn_ = tsfn;
+    operations_ = operations;
+    paths_ = paths;
+}
+
+Dispatcher* Dispatcher::Current() {
+    return t_current;
+}
+
+// The thread-safe function is only called with the lock held, so Close() can
+// not return while a call is on its way into a function being finalized.
+// Neither call waits for the JS thread: the queue is unbounded.
+napi_status Dispatcher::Post(Work&& work, Lane lane, uint64_t route) {
+    if (!options_.batching) {
+        // One wakeup per request, as before batching existed
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            return napi_closing;
+        }
+        return tsfn_.BlockingCall([this, work](Napi::Env env, Napi::Function) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                counters_.wakeups++;
+                counters_.requests++;
+                counters_.maxBatch = 1;
+            }
+            Napi::HandleScope scope(env);
+            CurrentScope current(this);
+            work(env);
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+        return napi_closing;
+    }
+    // A lane at its limit is scheduled by the answer that frees a place
+    if (!lanes_.Push(Queued{std::move(work), route}, lane, NowNs())) {
+        return napi_ok;
+    }
+
+    napi_status status = Schedule();
+    if (status != napi_ok) {
+        // The caller may post it elsewhere, or fail the request it belongs to
+        Queued queued;
+        lanes_.Unpush(lane, &queued);
+        work = std::move(queued.work);
+    }
+    return status;
+}
+
+napi_status Dispatcher::Schedule() {
+    if (scheduled_) {
+        return napi_ok;
+    }
+    napi_status status = tsfn_.NonBlockingCall([this](Napi::Env env, Napi::Function) { Drain(env); });
+    if (status == napi_ok) {
+        scheduled_ = true;
+    }
+    return status;
+}
+
+bool Dispatcher::AnyCanRun() const {
+    return !cancels_.empty() || lanes_.AnyCanRun();
+}
+
+// Each picked item gets the flight that lands it once answered
+void Dispatcher::Pick(std::vector<Picked>& picked) {
+    std::vector<LaneQueues<Queued>::Picked> items;
+    lanes_.Pick(kDrainMax, NowNs(), items);
+    std::weak_ptr<Dispatcher> self = weak_from_this();
+    picked.reserve(items.size());
+    for (auto& item : items) {
+        picked.push_back(Picked{std::move(item.work.work), std::make_shared<Flight>(self, item.lane)});
+    }
+}
+
+void Dispatcher::Flight::End() {
+    if (ended_.exchange(true)) {
+        return;
+    }
+    std::shared_ptr<Dispatcher> dispatcher = dispatcher_.lock();
+    if (dispatcher) {
+        dispatcher->Land(lane_);
+    }
+}
+
+void Dispatcher::Land(Lane lane) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (lanes_.Land(lane) && !closed_) {
+        Schedule();
+    }
+}
+
+// Flights of watched callbacks and of unanswered slots end outside the lock
+std::vector<Dispatcher::Left> Dispatcher::Close() {
+    std::unordered_map<uint64_t, Watched> watched;
+    std::vector<Left> left;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        watched.swap(watched_);
+        replies_.clear();
+        cancels_.clear();
+        for (auto& item : lanes_.TakeAll()) {
+            left.push_back(Left{std::move(item.first.work), item.second, item.first.route});
+        }
+    }
+    if (slots_) {
+        slots_->ReleaseOwned(this);
+        slots_.reset();
+    }
+    return left;
+}
+
+void Dispatcher::PostCancel(Work work) {
+    if (!options_.batching) {
+        Post(std::move(work));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!closed_) {
+        cancels_.push_back(std::move(work));
+        Schedule();
+    }
+}
+
+void Dispatcher::Drain(Napi::Env env) {
+    std::vector<Work> cancels;
+    std::vector<Picked> items;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancels.swap(cancels_);
+        Pick(items);
+        // Work queued from here on needs a wakeup of its own, and so does
+        // work left behind by the weights or kDrainMax
+        scheduled_ = false;
+        if (AnyCanRun()) {
+            Schedule();
+        }
+        counters_.wakeups++;
+        counters_.requests += items.size();
+        counters_.maxBatch = std::max<uint64_t>(counters_.maxBatch, items.size());
+    }
+
+    Napi::HandleScope scope(env);
+    CurrentScope current(this);
+    for (Work& cancel : cancels) {
+        cancel(env);
+    }
+    Napi::Object ops = operations_->Value();
+    Napi::Value batchFn = ops.Get("batch");
+    if (!batchFn.IsFunction()) {
+        for (Picked& item : items) {
+            Napi::HandleScope itemScope(env);
+            running_ = std::move(item.flight);
+            item.work(env);
+            running_.reset();
+        }
+        return;
+    }
+
+    // Every call collected here stays referenced by this scope until batch()
+    // has been called
+    std::vector<PendingCall> calls;
+    t_batch = &calls;
+    for (Picked& item : items) {
+        running_ = std::move(item.flight);
+        item.work(env);
+        running_.reset();
+    }
+    t_batch = nullptr;
+    if (calls.empty()) {
+        return;
+    }
+
+    Napi::Array array = Napi::Array::New(env, calls.size());
+    for (size_t i = 0; i < calls.size(); i++) {
+        Napi::Array args = Napi::Array::New(env, calls[i].args.size());
+        for (size_t j = 0; j < calls[i].args.size(); j++) {
+            args.Set(static_cast<uint32_t>(j), Napi::Value(env, calls[i].args[j]));
+        }
+        Napi::Object call = Napi::Object::New(env);
+        call.Set("op", Napi::String::New(env, calls[i].name));
+        call.Set("args", args);
+        array.Set(static_cast<uint32_t>(i), call);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counters_.batchCalls++;
+    }
+
+    batchFn.As<Napi::Function>().Call(ops, {array});
+    if (env.IsExceptionPending()) {
+        env.GetAndClearPendingException();
+        // Calls that did call back ignore this
+        for (PendingCall& call : calls) {
+            call.onThrow();
+        }
+    }
+}
+
+uint64_t Dispatcher::Watch(const JsReply& reply) {
+    if (!reply.id && (!operations_ || !operations_->Value().Get("cancel").IsFunction())) {
+        return 0;
+    }
+    uint64_t id = nextWatch_++;
+    Watched& watched = watched_[id];
+    if (reply.id) {
+        watched.slot = reply.id;
+        watched.slots = reply.slots;
+    } else {
+        watched.callback = Napi::Persistent(reply.function);
+    }
+    watched.flight = reply.flight;
+    return id;
+}
+
+void Dispatcher::Unwatch(uint64_t id) {
+    watched_.erase(id);
+}
+
+void Dispatcher::Cancel(uint64_t id, const char* reason) {
+    std::weak_ptr<Dispatcher> weak = weak_from_this();
+    PostCancel([weak, id, reason](Napi::Env env) {
+        std::shared_ptr<Dispatcher> self = weak.lock();
+        // Work of a closed dispatcher may be run by another thread
+        if (!self || Current() != self.get()) {
+            return;
+        }
+        auto it = self->watched_.find(id);
+        if (it == self->watched_.end()) {
+            return;
+        }
+        Napi::Value request;
+        if (it->second.slot) {
+            std::shared_ptr<RequestSlots> slots = it->second.slots.lock();
+            if (slots) {
+                slots->Release(it->second.slot);
+            }
+            request = Napi::Number::New(env, static_cast<double>(it->second.slot));
+        } else {
+            request = it->second.callback.Value();
+        }
+        // A callback JS may never call no longer holds the lane
+        if (it->second.flight) {
+            it->second.flight->End();
+        }
+        self->watched_.erase(it);
+
+        Napi::Object ops = self->Operations();
+        Napi::Value cancel = ops.Get("cancel");
+        if (cancel.IsFunction()) {
+            cancel.As<Napi::Function>().Call(ops, {request, Napi::String::New(env, reason)});
+            if (env.IsExceptionPending()) {
+                env.GetAndClearPendingException();
+            }
+        }
+    });
+}
+
+Napi::Function Dispatcher::ReplyFunction(Napi::Env env, StatOp op, const std::shared_ptr<RequestSlots>& slots) {
+    size_t index = static_cast<size_t>(std::min(op, StatOp::Count));
+    if (replies_.empty()) {
+        replies_.resize(static_cast<size_t>(StatOp::Count) + 1);
+    }
+    if (!slots_) {
+        slots_ = slots;
+    }
+    Napi::FunctionReference& reply = replies_[index];
+    if (reply.IsEmpty()) {
+        // A dispatcher serves one mount, so one pool
+        std::weak_ptr<RequestSlots> weak = slots;
+        const char* name = op < StatOp::Count ? StatOpName(op) : "reply";
+        reply = Napi::Persistent(Napi::Function::New(env, [weak](const Napi::CallbackInfo& info) {
+            std::shared_ptr<RequestSlots> slots = weak.lock();
+            if (slots && info.Length() > 0 && info[0].IsNumber()) {
+                slots->Reply(static_cast<uint64_t>(info[0].As<Napi::Number>().Int64Value()), JsArgs(info, 1));
+            }
+        }, name));
+    }
+    return reply.Value();
+}
+
+bool NewJsReply(Napi::Env env, const std::shared_ptr<RequestSlots>& slots, StatOp op,
+                RequestSlots::Handler handler, JsReply* reply) {
+    Dispatcher* dispatcher = Dispatcher::Current();
+    reply->withId = slots != nullptr;
+    reply->flight = dispatcher ? dispatcher->TakeFlight() : nullptr;
+    if (reply->flight) {
+        std::shared_ptr<Dispatcher::Flight> flight = reply->flight;
+        handler = [flight, handler = std::move(handler)](const JsArgs& args) {
+            flight->End();
+            handler(args);
+        };
+    }
+    if (slots && dispatcher) {
+        uint64_t id = slots->Acquire(handler, dispatcher);
+        if (id) {
+            reply->function = dispatcher->ReplyFunction(env, op, slots);
+            reply->id = id;
+            reply->slots = slots;
+            return true;
+        }
+        if (slots->GetOptions().exhausted == RequestSlots::Exhausted::Fail) {
+            return false;
+        }
+    }
+    size_t skip = reply->withId ? 1 : 0;
+    reply->function = Napi::Function::New(env, [handler, skip](const Napi::CallbackInfo& info) {
+        handler(JsArgs(info, skip));
+    });
+    return true;
+}
+
+void AddJsReply(const JsReply& reply, std::vector<napi_value>& args) {
+    args.push_back(reply.function);
+    if (reply.withId) {
+        args.push_back(Napi::Number::New(reply.function.Env(), static_cast<double>(reply.id)));
+    }
+}
+
+void ReleaseJsReply(const JsReply& reply) {
+    std::shared_ptr<RequestSlots> slots = reply.slots.lock();
+    if (reply.id && slots) {
+        slots->Release(reply.id);
+    }
+    if (reply.flight) {
+        reply.flight->End();
+    }
+}
+
+void CancelHandle::Watch(const JsReply& reply) {
+    Dispatcher* dispatcher = Dispatcher::Current();
+    uint64_t id = dispatcher ? dispatcher->Watch(reply) : 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    flight_ = reply.flight;
+    if (id == 0) {
+        return;
+    }
+    dispatcher_ = dispatcher->weak_from_this();
+    id_ = id;
+}
+
+void CancelHandle::Unwatch() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<Dispatcher> dispatcher = dispatcher_.lock();
+    if (id_ != 0 && dispatcher) {
+        dispatcher->Unwatch(id_);
+    }
+    id_ = 0;
+    flight_.reset();
+}
+
+// The flight ends outside the lock, as ending it may schedule a drain
+void CancelHandle::Cancel(const char* reason) {
+    std::shared_ptr<Dispatcher::Flight> flight;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<Dispatcher> dispatcher = dispatcher_.lock();
+        if (id_ != 0 && dispatcher) {
+            dispatcher->Cancel(id_, reason);
+        }
+        id_ = 0;
+        flight.swap(flight_);
+    }
+    if (flight) {
+        flight->End();
+    }
+}
+
+Dispatcher::Counters Dispatcher::GetCounters() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Counters counters = counters_;
+    lanes_.GetCounters(counters.lanes);
+    counters.depth = lanes_.Depth();
+    counters.maxDepth = lanes_.MaxDepth();
+    return counters;
+}
+
+void CallOp(Napi::Env env, Napi::Object ops, const std::string& name, Napi::Function fn,
+            const std::vector<napi_value>& args, std::function<void()> onThrow) {
+    if (t_batch) {
+        t_batch->push_back(PendingCall{name, args, std::move(onThrow)});
+        return;
+    }
+
+    fn.Call(ops, args);
+    if (env.IsExceptionPending()) {
+        env.GetAndClearPendingException();
+        onThrow();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <napi.h>
+#include "fuse3_js_args.h"
+#include "fuse3_lanes.h"
+#include "fuse3_op_stats.h"
+#include "fuse3_path_table.h"
+#include "fuse3_request_slots.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct JsReply;
+
+// Queues in front of the thread-safe function. A wakeup of the JS thread
+// drains what is queued by the time it runs within one callback scope, so a
+// burst of requests costs one libuv wakeup and one microtask checkpoint
+// instead of one per request. If the operations object has a batch()
+// handler, the handler calls of a drain are handed to it as one array
+// instead of being made one by one. There is one dispatcher per JS thread
+// serving a mount (see WorkerPool).
+//
+// Work waits in one of three lanes (LaneQueues): metadata requests, data
+// requests (read, write, flush, fsync, write-outs and readahead) and
+// background work (pre-warming). A drain takes up to kDrainMax items,
+// weighted round robin: each round takes up to weight items of every lane,
+// metadata first. Background items are only taken while the other lanes
+// have nothing they can run, so no request waits behind them. An item
+// stays in flight from its drain until JS answered it; a lane at its
+// in-flight limit is skipped, and the answer that frees a place schedules a
+// wakeup. So a lookup queued behind a bulk copy waits for at most a round,
+// not for the copy.
+class Dispatcher : public std::enable_shared_from_this<Dispatcher> {
+public:
+    using Work = std::function<void(Napi::Env)>;
+
+    using Lane = DispatchLane;
+    using LaneOptions = ::LaneOptions;
+    using LaneCounters = ::LaneCounters;
+
+    static constexpr size_t kLanes = kDispatchLanes;
+    static constexpr size_t kDrainMax = 64;
+
+    // In-flight limits are opt-in: without deadlines an item JS never
+    // answers keeps its place for good
+    struct Options {
+        bool batching = true;
+        LaneOptions lanes[kLanes] = {{8, 0}, {4, 0}, {1, 0}};
+    };
+
+    struct Counters {
+        uint64_t wakeups = 0;    // drains run on the JS thread
+        uint64_t requests = 0;   // work items run
+        uint64_t batchCalls = 0; // calls of ops.batch
+        uint64_t maxBatch = 0;   // largest drain
+        uint64_t depth = 0;      // queued right now
+        uint64_t maxDepth = 0;
+        LaneCounters lanes[kLanes];
+    };
+
+    // The place of a drained item under the in-flight limit of its lane.
+    // The reply the item makes holds it (NewJsReply) and ends it once
+    // answered, released or cancelled; an item that made none ends it when
+    // it returns. Only the first End counts.
+    class Flight {
+    public:
+        Flight(std::weak_ptr<Dispatcher> dispatcher, Lane lane) : dispatcher_(std::move(dispatcher)), lane_(lane) {}
+        ~Flight() { End(); }
+        void End();
+
+    private:
+        std::weak_ptr<Dispatcher> dispatcher_;
+        Lane lane_;
+        std::atomic<bool> ended_{false};
+    };
+
+    explicit Dispatcher(const Options& options) : options_(options), lanes_(options_.lanes) {}
+
+    // Called once the thread-safe function exists. operations and paths (null
+    // when the path table is off) belong to the JS thread of tsfn.
+    void Start(Napi::ThreadSafeFunction tsfn, Napi::ObjectReference* operations, PathTable* paths);
+
+    // Work queued but never ran, as Close returns it
+    struct Left {
+        Work work;
+        Lane lane;
+        uint64_t route;
+    };
+
+    // Queues work for the JS thread, taking it. Fails without queueing
+    // anything, and with work left to the caller, once the thread-safe
+    // function is gone. Without batching every item gets a wakeup of its own
+    // and lanes do not apply. route is kept with the work for Close (the
+    // routing hash of WorkerPool).
+    napi_status Post(Work&& work, Lane lane = Lane::Metadata, uint64_t route = 0);
+
+    // Stops taking work and returns what was queued but never ran, for a
+    // dispatcher whose thread-safe function is being finalized. On the JS
+    // thread: the handlers of requests in slots JS never answered are
+    // destroyed here.
+    std::vector<Left> Close();
+
+    // The dispatcher whose work is running on the calling thread, if any
+    static Dispatcher* Current();
+    Napi::Object Operations() const { return operations_->Value(); }
+    PathTable* Paths() const { return paths_; }
+
+    // Callbacks of running handlers that JS may be told to give up on. Watch
+    // (JS thread) keeps the callback if ops.cancel exists and returns its id,
+    // 0 otherwise; Unwatch (JS thread) drops it once it was called. Cancel
+    // (any thread) hands a callback still watched to ops.cancel(cb, reason).
+    // A request slot is always watched, as Cancel also frees it; ops.cancel
+    // then gets the request id.
+    uint64_t Watch(const JsReply& reply);
+    void Unwatch(uint64_t id);
+    void Cancel(uint64_t id, const char* reason);
+
+    // The reply function of op for requests in slots (JS thread), made on
+    // first use
+    Napi::Function ReplyFunction(Napi::Env env, StatOp op, const std::shared_ptr<RequestSlots>& slots);
+
+    // The flight of the item running (JS thread), for the first reply it
+    // makes; null once taken and without batching
+    std::shared_ptr<Flight> TakeFlight() { return std::move(running_); }
+
+    Counters GetCounters();
+    const Options& GetOptions() const { return options_; }
+
+private:
+    struct Queued {
+        Work work;
+        uint64_t route;
+    };
+    struct Picked {
+        Work work;
+        std::shared_ptr<Flight> flight;
+    };
+
+    void Drain(Napi::Env env);
+    // Cancels skip the lanes and their limits: they free places
+    void PostCancel(Work work);
+    // With mutex_ held
+    napi_status Schedule();
+    bool AnyCanRun() const;
+    void Pick(std::vector<Picked>& picked);
+    void Land(Lane lane);
+
+    Options options_;
+    Napi::ThreadSafeFunction tsfn_;
+    Napi::ObjectReference* operations_ = nullptr;
+    PathTable* paths_ = nullptr;
+
+    std::mutex mutex_;
+    LaneQueues<Queued> lanes_;
+    std::vector<Work> cancels_;
+    bool scheduled_ = false;
+    bool closed_ = false;
+    Counters counters_;
+
+    struct Watched {
+        Napi::FunctionReference callback;
+        uint64_t slot = 0;
+        std::weak_ptr<RequestSlots> slots;
+        std::shared_ptr<Flight> flight;
+    };
+
+    // JS thread only
+    std::shared_ptr<Flight> running_;
+    std::unordered_map<uint64_t, Watched> watched_;
+    uint64_t nextWatch_ = 1;
+    std::vector<Napi::FunctionReference> replies_;  // by StatOp
+    // The pool this thread took slots of, kept until Close frees them
+    std::shared_ptr<RequestSlots> slots_;
+};
+
+// How a handler answers its request: through a callback made for it, or,
+// with request slots, through the reply function of its operation given
+// the request id. id is 0 for a callback; with slots such a callback takes
+// (and ignores) an id as well, so handlers need not tell the two apart.
+struct JsReply {
+    Napi::Function function;
+    uint64_t id = 0;
+    bool withId = false;
+    std::weak_ptr<RequestSlots> slots;
+    std::shared_ptr<Dispatcher::Flight> flight;
+};
+
+// The lane of the requests of op
+inline Dispatcher::Lane LaneOf(StatOp op) {
+    bool data = op == StatOp::Read || op == StatOp::Write || op == StatOp::Flush || op == StatOp::Fsync;
+    return data ? Dispatcher::Lane::Data : Dispatcher::Lane::Metadata;
+}
+
+// Makes the reply for a request whose answer goes to handler (JS thread);
+// slots is null when request_slots is off. Returns false if every slot is
+// taken and the pool is set to fail then.
+bool NewJsReply(Napi::Env env, const std::shared_ptr<RequestSlots>& slots, StatOp op,
+                RequestSlots::Handler handler, JsReply* reply);
+// Appends the reply to the arguments of a handler: the callback, or the
+// reply function and the id
+void AddJsReply(const JsReply& reply, std::vector<napi_value>& args);
+// Frees the slot (and flight) of a request whose handler threw (JS thread)
+void ReleaseJsReply(const JsReply& reply);
+
+// A running handler JS may be told to give up on, for requests that end
+// without it (deadlines, interrupts). Watch and Unwatch run on the JS thread
+// calling the handler, Cancel on any thread; only the first Cancel counts.
+// Cancel also ends the flight of the request, with or without ops.cancel,
+// as JS may never answer it.
+class CancelHandle {
+public:
+    void Watch(const JsReply& reply);
+    void Unwatch();
+    void Cancel(const char* reason);
+
+private:
+    std::mutex mutex_;
+    std::weak_ptr<Dispatcher> dispatcher_;
+    uint64_t id_ = 0;
+    std::shared_ptr<Dispatcher::Flight> flight_;
+};
+
+// Calls ops[name](...args). While a drain hands calls to ops.batch the call
+// is collected instead. onThrow runs if the handler (or batch) throws
+// synchronously, as it will never call back then.
+void CallOp(Napi::Env env, Napi::Object ops, const std::string& name, Napi::Function fn,
+            const std::vector<napi_value>& args, std::function<void()> onThrow);
\ No newline at end of file
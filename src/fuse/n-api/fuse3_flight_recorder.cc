@@ -0,0 +1,271 @@
+#include "fuse3_flight_recorder.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+static std::atomic<uint64_t> g_nextRecorderId{1};
+
+// The rings a thread writes to, by recorder id, given back when the thread
+// exits
+struct FlightRecorder::ThreadRings {
+    struct Held {
+        uint64_t id;
+        std::weak_ptr<RingSet> set;
+        Ring* ring;
+    };
+
+    ~ThreadRings() {
+        for (const Held& held : rings) {
+            std::shared_ptr<RingSet> set = held.set.lock();
+            if (set) {
+                std::lock_guard<std::mutex> lock(set->mutex);
+                set->free.push_back(held.ring);
+            }
+        }
+    }
+
+    std::vector<Held> rings;
+};
+
+struct FlightRecorder::Entry {
+    long tid;
+    StatOp op;
+    int32_t error;
+    uint64_t start, running, answered, end, bytes;
+    FlightNote note;
+};
+
+FlightRecorder::FlightRecorder(const Options& options, const std::string& label)
+    : options_(options), label_(label), id_(g_nextRecorderId++) {
+    options_.entries = std::max<size_t>(options_.entries, 16);
+    triggerNs_ = static_cast<uint64_t>(options_.triggerMs * 1e6);
+    cooldownNs_ = static_cast<uint64_t>(options_.cooldown * 1e9);
+    if (triggerNs_) {
+        writer_ = std::thread([this] { WriteDumps(); });
+    }
+}
+
+FlightRecorder::~FlightRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+FlightRecorder::Ring* FlightRecorder::LocalRing() {
+    static thread_local ThreadRings local;
+    for (const ThreadRings::Held& held : local.rings) {
+        if (held.id == id_) {
+            return held.ring;
+        }
+    }
+    // Forget the rings of recorders that are gone (unmounted)
+    local.rings.erase(std::remove_if(local.rings.begin(), local.rings.end(),
+                                     [](const ThreadRings::Held& held) { return held.set.expired(); }),
+                      local.rings.end());
+
+    Ring* ring;
+    {
+        std::lock_guard<std::mutex> lock(rings_->mutex);
+        if (rings_->free.empty()) {
+            rings_->rings.push_back(std::make_unique<Ring>(options_.entries));
+            ring = rings_->rings.back().get();
+        } else {
+            ring = rings_->free.back();
+            rings_->free.pop_back();
+        }
+    }
+    ring->tid = static_cast<long>(syscall(SYS_gettid));
+    local.rings.push_back(ThreadRings::Held{id_, rings_, ring});
+    return ring;
+}
+
+void FlightRecorder::Record(const OpTimer& timer, uint64_t end) {
+    Ring* ring = LocalRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    Slot& slot = ring->slots[head % ring->slots.size()];
+
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.tid = ring->tid;
+    slot.op = timer.op;
+    slot.error = timer.error;
+    slot.start = timer.start;
+    slot.running = timer.running.load(std::memory_order_relaxed);
+    slot.answered = timer.answered.load(std::memory_order_relaxed);
+    slot.end = end;
+    slot.bytes = timer.bytes;
+    slot.note = timer.note;
+    slot.seq.store(seq + 2, std::memory_order_release);
+    ring->head.store(head + 1, std::memory_order_release);
+
+    if (triggerNs_ && end - timer.start >= triggerNs_) {
+        Trigger(end);
+    }
+}
+
+void FlightRecorder::Trigger(uint64_t now) {
+    uint64_t last = lastTrigger_.load(std::memory_order_relaxed);
+    if (last && now - last < cooldownNs_) {
+        return;
+    }
+    if (!lastTrigger_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dumpWanted_ = true;
+    }
+    wake_.notify_one();
+}
+
+static void AppendEscaped(std::string& out, const char* s) {
+    for (; *s; s++) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+}
+
+// Begin or end of a nestable async slice, ts in microseconds
+static void AppendEvent(std::string& out, const char* name, char phase, uint64_t id, uint64_t ns, int pid,
+                        long tid, const std::string& args = std::string()) {
+    char line[256];
+    snprintf(line, sizeof(line),
+             ",\n{\"name\":\"%s\",\"cat\":\"fuse\",\"ph\":\"%c\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%ld",
+             name, phase, static_cast<unsigned long long>(id), ns / 1e3, pid, tid);
+    out += line;
+    if (!args.empty()) {
+        out += ",\"args\":{";
+        out += args;
+        out += '}';
+    }
+    out += '}';
+}
+
+std::string FlightRecorder::Dump() {
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(rings_->mutex);
+        for (const auto& ring : rings_->rings) {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            size_t size = ring->slots.size();
+            for (uint64_t i = head > size ? head - size : 0; i < head; i++) {
+                Slot& slot = ring->slots[i % size];
+                uint32_t before = slot.seq.load(std::memory_order_acquire);
+                if (before & 1) {
+                    continue;
+                }
+                Entry entry{slot.tid, slot.op, slot.error, slot.start, slot.running, slot.answered,
+                            slot.end, slot.bytes, slot.note};
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq.load(std::memory_order_relaxed) != before) {
+                    continue;  // overwritten while copied
+                }
+                entries.push_back(entry);
+            }
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.start < b.start; });
+
+    int pid = static_cast<int>(getpid());
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"args\":{\"name\":\"fuse3 ";
+    AppendEscaped(out, label_.c_str());
+    out += "\"}}";
+
+    uint64_t id = 0;
+    for (const Entry& e : entries) {
+        const char* name = StatOpName(e.op);
+        id++;
+        std::string args = "\"path\":\"";
+        AppendEscaped(args, e.note.path);
+        args += "\",\"result\":" + std::to_string(e.error < 0 ? static_cast<int64_t>(e.error)
+                                                              : static_cast<int64_t>(e.bytes));
+        if (e.note.fh) {
+            args += ",\"fh\":" + std::to_string(e.note.fh);
+        }
+        if (e.note.offset >= 0) {
+            args += ",\"size\":" + std::to_string(e.note.size) + ",\"offset\":" + std::to_string(e.note.offset);
+        }
+
+        AppendEvent(out, name, 'b', id, e.start, pid, e.tid, args);
+        if (e.running >= e.start) {
+            AppendEvent(out, "queue", 'b', id, e.start, pid, e.tid);
+            AppendEvent(out, "queue", 'e', id, e.running, pid, e.tid);
+            if (e.answered >= e.running) {
+                AppendEvent(out, "js", 'b', id, e.running, pid, e.tid);
+                AppendEvent(out, "js", 'e', id, e.answered, pid, e.tid);
+            }
+        }
+        AppendEvent(out, name, 'e', id, e.end, pid, e.tid);
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+// The writer thread: one dump per trigger, named after the mount and the
+// wall clock
+void FlightRecorder::WriteDumps() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stopping_ || dumpWanted_; });
+        if (stopping_) {
+            return;
+        }
+        dumpWanted_ = false;
+        lock.unlock();
+
+        std::string name;
+        for (char c : label_) {
+            name += isalnum(static_cast<unsigned char>(c)) ? c : '_';
+        }
+        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::string file = options_.dir + "/fuse3-trace" + name + "-" + std::to_string(ms) + ".json";
+        std::string trace = Dump();
+        FILE* out = fopen(file.c_str(), "w");
+        bool written = out && fwrite(trace.data(), 1, trace.size(), out) == trace.size();
+        if (out && fclose(out) != 0) {
+            written = false;
+        }
+
+        lock.lock();
+        if (written) {
+            dumps_++;
+            lastDump_ = file;
+        }
+    }
+}
+
+FlightRecorder::Counters FlightRecorder::GetCounters() {
+    Counters counters;
+    {
+        std::lock_guard<std::mutex> lock(rings_->mutex);
+        for (const auto& ring : rings_->rings) {
+            counters.recorded += ring->head.load(std::memory_order_relaxed);
+        }
+        counters.threads = rings_->rings.size();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters.dumps = dumps_;
+    counters.lastDump = lastDump_;
+    return counters;
+}
\ No newline at end of file
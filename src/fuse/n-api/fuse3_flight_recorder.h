@@ -0,0 +1,106 @@
+#pragma once
+
+#include "fuse3_op_stats.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The last requests of a mount, kept for when a user reports a stall. Every
+// thread that finishes requests writes them into a ring of its own, without
+// locks or allocation, so the recorder can stay on in production; a reader
+// copying a slot that is being overwritten notices by its sequence number.
+// A thread that exits hands its ring, records kept, to the next thread that
+// starts recording, so there are only as many rings as threads recording at
+// once.
+//
+// Dump() renders what the rings hold as Chrome trace JSON (chrome://tracing,
+// ui.perfetto.dev): one async slice per request with its queue and js phases
+// nested inside. With triggerMs, a request that took longer makes a thread
+// of the recorder write a dump to dir, at most one per cooldown, so the
+// trace is there even if JS is the part that hangs.
+class FlightRecorder {
+public:
+    struct Options {
+        size_t entries = 4096;  // per thread
+        double triggerMs = 0;   // 0: only dump on request
+        double cooldown = 60;   // seconds between triggered dumps
+        std::string dir = "/tmp";
+    };
+
+    struct Counters {
+        uint64_t recorded = 0;
+        uint64_t threads = 0;   // rings, the most threads recording at once
+        uint64_t dumps = 0;     // written on a trigger
+        std::string lastDump;   // file of the last one
+    };
+
+    // label names the mount in the trace and in dump file names
+    FlightRecorder(const Options& options, const std::string& label);
+    ~FlightRecorder();
+
+    // At OpTimer::End, on the thread ending the request
+    void Record(const OpTimer& timer, uint64_t end);
+
+    std::string Dump();
+    Counters GetCounters();
+    const Options& GetOptions() const { return options_; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq{0};  // odd while being written
+        long tid = 0;
+        StatOp op = StatOp::Count;
+        int32_t error = 0;
+        uint64_t start = 0;
+        uint64_t running = 0;
+        uint64_t answered = 0;
+        uint64_t end = 0;
+        uint64_t bytes = 0;
+        FlightNote note;
+    };
+
+    struct Ring {
+        explicit Ring(size_t entries) : slots(entries) {}
+        long tid = 0;  // of the thread writing to it
+        std::vector<Slot> slots;
+        std::atomic<uint64_t> head{0};  // records written so far
+    };
+
+    // Shared with the threads holding a ring, which may exit after the
+    // recorder is gone
+    struct RingSet {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Ring>> rings;
+        std::vector<Ring*> free;  // of threads that exited
+    };
+
+    struct Entry;
+    struct ThreadRings;
+
+    Ring* LocalRing();
+    void Trigger(uint64_t now);
+    void WriteDumps();
+
+    Options options_;
+    std::string label_;
+    uint64_t id_;  // tells recorders apart in thread-local caches
+    uint64_t triggerNs_;
+    uint64_t cooldownNs_;
+    std::atomic<uint64_t> lastTrigger_{0};
+
+    std::shared_ptr<RingSet> rings_ = std::make_shared<RingSet>();
+
+    std::mutex mutex_;
+    std::thread writer_;
+    std::condition_variable wake_;
+    bool dumpWanted_ = false;
+    bool stopping_ = false;
+    uint64_t dumps_ = 0;
+    std::string lastDump_;
+};
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "fuse3_inode_table.h"
+
+std::string JoinPath(std::string_view parent, std::string_view name) {
+    std::string path;
+    path.reserve(parent.size() + name.size() + 1);
+    path.append(parent.data(), parent.size());
+    if (path.empty() || path.back() != '/') {
+        path.push_back('/');
+    }
+    path.append(name.data(), name.size());
+    return path;
+}
+
+InodeTable::InodeTable() {
+    nodes_.emplace(kRootIno, Node{"/", 1, true});
+    byPath_.emplace("/", kRootIno);
+}
+
+bool InodeTable::GetPath(uint64_t ino, std::string* path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = nodes_.find(ino);
+    if (it == nodes_.end()) {
+        return false;
+    }
+    *path = it->second.path;
+    return true;
+}
+
+uint64_t InodeTable::Ref(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = byPath_.find(path);
+    if (found != byPath_.end()) {
+        nodes_[found->second].nlookup++;
+        return found->second;
+    }
+    uint64_t ino = next_++;
+    nodes_.emplace(ino, Node{path, 1, true});
+    byPath_.emplace(path, ino);
+    return ino;
+}
+
+uint64_t InodeTable::Find(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = byPath_.find(path);
+    return found != byPath_.end() ? found->second : 0;
+}
+
+void InodeTable::Forget(uint64_t ino, uint64_t nlookup) {
+    if (ino == kRootIno) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = nodes_.find(ino);
+    if (it == nodes_.end()) {
+        return;
+    }
+    Node& node = it->second;
+    node.nlookup = nlookup < node.nlookup ? node.nlookup - nlookup : 0;
+    if (node.nlookup == 0) {
+        if (node.linked) {
+            byPath_.erase(node.path);
+        }
+        nodes_.erase(it);
+    }
+}
+
+void InodeTable::UnlinkLocked(const std::string& path) {
+    auto found = byPath_.find(path);
+    if (found == byPath_.end() || found->second == kRootIno) {
+        return;
+    }
+    nodes_[found->second].linked = false;
+    byPath_.erase(found);
+}
+
+void InodeTable::Unlink(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    UnlinkLocked(path);
+}
+
+void InodeTable::Rename(const std::string& from, const std::string& to) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A replaced target keeps its inode for open handles only.
+    UnlinkLocked(to);
+
+    // Children can have been looked up in any order, so every linked node
+    // is checked. Renames are rare compared to lookups.
+    for (auto& [ino, node] : nodes_) {
+        if (!node.linked || node.path.compare(0, from.size(), from) != 0 ||
+            (node.path.size() > from.size() && node.path[from.size()] != '/')) {
+            continue;
+        }
+        byPath_.erase(node.path);
+        node.path = to + node.path.substr(from.size());
+        byPath_[node.path] = ino;
+    }
+}
+
+size_t InodeTable::Size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nodes_.size();
+}
+
+InodeRefs::~InodeRefs() {
+    for (uint64_t ino : refs_) {
+        inodes_.Forget(ino, 1);
+    }
+}
+
+uint64_t InodeRefs::Ref(const std::string& path) {
+    uint64_t ino = inodes_.Ref(path);
+    refs_.push_back(ino);
+    return ino;
+}
+
+void InodeRefs::Unref() {
+    inodes_.Forget(refs_.back(), 1);
+    refs_.pop_back();
+}
\ No newline at end of file
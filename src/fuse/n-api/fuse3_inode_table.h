@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Inode numbers handed to the kernel by the low-level backend, mapped to the
+// paths the JS FuseOperations work with. Numbers are never reused; a node
+// lives until the kernel has forgotten every lookup that returned it. The
+// root (FUSE_ROOT_ID) is permanent.
+class InodeTable {
+public:
+    static constexpr uint64_t kRootIno = 1;
+
+    InodeTable();
+
+    // Path of ino; false if the kernel already forgot it.
+    bool GetPath(uint64_t ino, std::string* path);
+    // Inode of path, counting one kernel lookup. Creates the node if needed.
+    uint64_t Ref(const std::string& path);
+    // Inode of path without counting a lookup, 0 if unknown.
+    uint64_t Find(const std::string& path);
+    void Forget(uint64_t ino, uint64_t nlookup);
+
+    // The name is gone; open handles keep their inode, but the next lookup
+    // of path gets a new one.
+    void Unlink(const std::string& path);
+    // Moves path and everything below it.
+    void Rename(const std::string& from, const std::string& to);
+
+    size_t Size();
+
+private:
+    struct Node {
+        std::string path;
+        uint64_t nlookup;
+        bool linked;  // still reachable under path
+    };
+
+    void UnlinkLocked(const std::string& path);
+
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, Node> nodes_;
+    std::unordered_map<std::string, uint64_t> byPath_;
+    uint64_t next_ = kRootIno + 1;
+};
+
+// Lookups counted for a reply that may not reach the kernel, like a
+// readdirplus chunk. Unless the reply was sent (Keep), they are forgotten
+// again when this goes out of scope.
+class InodeRefs {
+public:
+    explicit InodeRefs(InodeTable& inodes) : inodes_(inodes) {}
+    ~InodeRefs();
+    InodeRefs(const InodeRefs&) = delete;
+    InodeRefs& operator=(const InodeRefs&) = delete;
+
+    uint64_t Ref(const std::string& path);
+    // Takes back the last Ref: its entry did not make it into the reply
+    void Unref();
+    void Keep() { refs_.clear(); }
+
+private:
+    InodeTable& inodes_;
+    std::vector<uint64_t> refs_;
+};
+
+// Path of name inside the directory at parent ("/" + "a" -> "/a")
+std::string JoinPath(std::string_view parent, std::string_view name);
\ No newline at end of file
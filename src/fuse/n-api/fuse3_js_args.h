@@ -0,0 +1,20 @@
+#pragma once
+
+#include <napi.h>
+#include <cstddef>
+
+// What JS answered a request with: the arguments of its callback, or those
+// of a reply function after the request id. Indexing past the end gives
+// undefined, as with Napi::CallbackInfo.
+class JsArgs {
+public:
+    explicit JsArgs(const Napi::CallbackInfo& info, size_t skip = 0) : info_(info), skip_(skip) {}
+
+    size_t Length() const { return info_.Length() > skip_ ? info_.Length() - skip_ : 0; }
+    Napi::Value operator[](size_t index) const { return info_[index + skip_]; }
+    Napi::Env Env() const { return info_.Env(); }
+
+private:
+    const Napi::CallbackInfo& info_;
+    size_t skip_;
+};
\ No newline at end of file
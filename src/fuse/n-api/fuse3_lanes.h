@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// The lanes of a dispatcher, without its JS side: metadata requests, data
+// requests (read, write, flush, fsync, write-outs, readahead) and
+// background work (pre-warming).
+enum class DispatchLane : uint8_t { Metadata, Data, Background, Count };
+
+constexpr size_t kDispatchLanes = static_cast<size_t>(DispatchLane::Count);
+
+struct LaneOptions {
+    unsigned int weight = 1;    // items per round, at least 1
+    unsigned int inFlight = 0;  // 0 for no limit
+};
+
+struct LaneCounters {
+    uint64_t run = 0;        // items drained
+    uint64_t depth = 0;      // queued right now
+    uint64_t maxDepth = 0;
+    uint64_t inFlight = 0;   // drained, not answered yet
+    uint64_t maxInFlight = 0;
+    uint64_t waitNs = 0;     // summed over the items drained
+    uint64_t maxWaitNs = 0;
+};
+
+// The queues of the lanes and what they have in flight. Pick takes items
+// weighted round robin: each round up to weight items of every lane that is
+// below its in-flight limit, metadata first. Background items are only
+// taken while the other lanes have nothing they can run. A picked item is in
+// flight until Land. Not thread-safe: the dispatcher holds its mutex.
+template <typename Work>
+class LaneQueues {
+public:
+    struct Picked {
+        Work work;
+        DispatchLane lane;
+    };
+
+    explicit LaneQueues(const LaneOptions (&options)[kDispatchLanes]) {
+        std::copy(std::begin(options), std::end(options), options_);
+    }
+
+    // Queues work at now (ns). False if its lane is at its in-flight limit:
+    // the answer that frees a place (Land) says when it can run.
+    bool Push(Work&& work, DispatchLane lane, uint64_t now) {
+        size_t index = static_cast<size_t>(lane);
+        queues_[index].push_back(Item{now, std::move(work)});
+        maxDepth_ = std::max(maxDepth_, Depth());
+        counters_[index].maxDepth = std::max<uint64_t>(counters_[index].maxDepth, queues_[index].size());
+        return CanRun(index);
+    }
+
+    // Takes back the work Push just queued in lane
+    void Unpush(DispatchLane lane, Work* work) {
+        std::deque<Item>& queue = queues_[static_cast<size_t>(lane)];
+        *work = std::move(queue.back().work);
+        queue.pop_back();
+    }
+
+    bool CanRun(size_t lane) const {
+        unsigned int limit = options_[lane].inFlight;
+        return !queues_[lane].empty() && (limit == 0 || inFlight_[lane] < limit);
+    }
+
+    // CanRun, and for background work the other lanes idle
+    bool CanPick(size_t lane) const {
+        if (!CanRun(lane)) {
+            return false;
+        }
+        if (lane != static_cast<size_t>(DispatchLane::Background)) {
+            return true;
+        }
+        return !CanRun(static_cast<size_t>(DispatchLane::Metadata)) &&
+               !CanRun(static_cast<size_t>(DispatchLane::Data));
+    }
+
+    bool AnyCanRun() const {
+        for (size_t lane = 0; lane < kDispatchLanes; lane++) {
+            if (CanRun(lane)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Appends up to max items to picked, each in flight from now on
+    void Pick(size_t max, uint64_t now, std::vector<Picked>& picked) {
+        bool more = true;
+        while (more && picked.size() < max) {
+            more = false;
+            for (size_t lane = 0; lane < kDispatchLanes; lane++) {
+                LaneCounters& counters = counters_[lane];
+                for (unsigned int n = 0; n < options_[lane].weight && picked.size() < max && CanPick(lane); n++) {
+                    Item& item = queues_[lane].front();
+                    uint64_t wait = now > item.queued ? now - item.queued : 0;
+                    counters.run++;
+                    counters.waitNs += wait;
+                    counters.maxWaitNs = std::max(counters.maxWaitNs, wait);
+                    inFlight_[lane]++;
+                    counters.maxInFlight = std::max(counters.maxInFlight, inFlight_[lane]);
+                    picked.push_back(Picked{std::move(item.work), static_cast<DispatchLane>(lane)});
+                    queues_[lane].pop_front();
+                }
+            }
+            for (size_t lane = 0; lane < kDispatchLanes; lane++) {
+                more = more || CanPick(lane);
+            }
+        }
+    }
+
+    // A picked item of lane was answered; true if the lane can run again
+    bool Land(DispatchLane lane) {
+        size_t index = static_cast<size_t>(lane);
+        inFlight_[index]--;
+        return CanRun(index);
+    }
+
+    // Empties the queues, returning what never ran
+    std::vector<std::pair<Work, DispatchLane>> TakeAll() {
+        std::vector<std::pair<Work, DispatchLane>> left;
+        for (size_t lane = 0; lane < kDispatchLanes; lane++) {
+            for (Item& item : queues_[lane]) {
+                left.emplace_back(std::move(item.work), static_cast<DispatchLane>(lane));
+            }
+            queues_[lane].clear();
+        }
+        return left;
+    }
+
+    uint64_t Depth() const {
+        uint64_t depth = 0;
+        for (const std::deque<Item>& queue : queues_) {
+            depth += queue.size();
+        }
+        return depth;
+    }
+    uint64_t MaxDepth() const { return maxDepth_; }
+
+    // Counters of every lane, with its depth and items in flight now
+    void GetCounters(LaneCounters (&counters)[kDispatchLanes]) const {
+        for (size_t lane = 0; lane < kDispatchLanes; lane++) {
+            counters[lane] = counters_[lane];
+            counters[lane].depth = queues_[lane].size();
+            counters[lane].inFlight = inFlight_[lane];
+        }
+    }
+
+private:
+    struct Item {
+        uint64_t queued;  // ns
+        Work work;
+    };
+
+    LaneOptions options_[kDispatchLanes];
+    std::deque<Item> queues_[kDispatchLanes];
+    uint64_t inFlight_[kDispatchLanes] = {};
+    LaneCounters counters_[kDispatchLanes];
+    uint64_t maxDepth_ = 0;
+};
\ No newline at end of file
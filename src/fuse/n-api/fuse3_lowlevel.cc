@@ -0,0 +1,1316 @@
+#include "fuse3_lowlevel.h"
+#include "fuse3_buffer_pool.h"
+#include "fuse3_inode_table.h"
+#include <fuse_lowlevel.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+extern int fuse3_statfs(const char *path, struct statvfs *stbuf);
+
+// d_ino of directory entries the kernel has not looked up
+static constexpr ino_t kUnknownIno = 0xffffffff;
+
+// A kernel request on its way through JS. Handlers may call back twice, or
+// after shutdown, a deadline or an interrupt already failed the request, so
+// only the first reply is sent.
+struct LowLevelState;
+struct LowLevelRequest {
+    fuse_req_t req;
+    FuseContext* ctx;
+    std::shared_ptr<LowLevelState> state;
+    std::atomic<bool> replied{false};
+    OpTimer timer;
+    CancelHandle cancel;
+    int64_t deadline = 0;  // steady clock, nanoseconds; 0: none
+    std::atomic<bool> interrupted{false};
+};
+
+using RequestPtr = std::shared_ptr<LowLevelRequest>;
+
+struct DirHandle;
+
+struct LowLevelState {
+    InodeTable inodes;
+    // Sized for max_read; larger writes bypass the pool
+    std::shared_ptr<BufferPool> buffers = std::make_shared<BufferPool>(128 * 1024, 64);
+
+    // Requests that have not been replied to yet
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::unordered_set<RequestPtr> inFlight;
+
+    // Fails requests past their deadline or interrupted by the kernel
+    // (op_timeout, interrupts)
+    std::thread sweeper;
+    std::condition_variable sweep;
+    bool stopping = false;
+
+    // Open directories by fh, from opendir to releasedir
+    std::mutex dirsMutex;
+    std::unordered_map<uint64_t, std::shared_ptr<DirHandle>> dirs;
+    uint64_t nextDir = 1;
+};
+using ResultHandler = std::function<void(const JsArgs& info)>;
+using ArgsBuilder = std::function<std::vector<napi_value>(Napi::Env env)>;
+
+// Listing of an open directory. It is fetched from JS when reading starts at
+// offset 0 and then served from here for as many chunks as the kernel asks.
+// A JS answer may come after a deadline or interrupt failed the readdir and
+// the kernel released the directory, so the handle is shared and the mutex
+// guards the rest.
+struct DirHandle {
+    std::string path;
+    std::mutex mutex;
+    bool released = false;
+    bool loaded = false;
+    std::vector<std::string> names;
+    std::vector<struct stat> stats;
+    std::vector<bool> hasStats;
+};
+
+static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// libfuse calls this with the request locked, possibly from within
+// fuse_req_interrupt_func; the sweeper sends the reply
+static void OnInterrupt(fuse_req_t req, void* data) {
+    auto state = static_cast<LowLevelState*>(data);
+    std::lock_guard<std::mutex> lock(state->mutex);
+    for (const RequestPtr& r : state->inFlight) {
+        if (r->req == req) {
+            r->interrupted = true;
+            state->sweep.notify_one();
+            break;
+        }
+    }
+}
+
+static RequestPtr TrackRequest(fuse_req_t req, StatOp op) {
+    auto r = std::make_shared<LowLevelRequest>();
+    r->req = req;
+    r->ctx = static_cast<FuseContext*>(fuse_req_userdata(req));
+    r->state = r->ctx->lowLevelState;
+    r->timer.Begin(r->ctx->stats.get(), op, r->ctx->recorder.get());
+    const FuseDeadlineOptions& deadlines = r->ctx->deadlines;
+    double timeout = deadlines.For(op);
+    if (timeout > 0) {
+        r->deadline = NowNs() + static_cast<int64_t>(timeout * 1e9);
+    }
+    {
+        std::lock_guard<std::mutex> lock(r->state->mutex);
+        r->state->inFlight.insert(r);
+    }
+    if (deadlines.interrupts) {
+        fuse_req_interrupt_func(req, OnInterrupt, r->state.get());
+    }
+    return r;
+}
+
+// Runs send(req) unless the request was answered already. Returns true if
+// the reply reached libfuse. err and bytes only go into the stats.
+template<typename Send>
+static bool Reply(const RequestPtr& r, Send send, int err = 0, uint64_t bytes = 0) {
+    if (r->replied.exchange(true)) {
+        return false;
+    }
+    bool sent = send(r->req) == 0;
+    r->timer.error = err;
+    r->timer.bytes = bytes;
+    r->timer.End();
+    std::lock_guard<std::mutex> lock(r->state->mutex);
+    r->state->inFlight.erase(r);
+    if (r->state->inFlight.empty()) {
+        r->state->drained.notify_all();
+    }
+    return sent;
+}
+
+// err is a negative errno as used by the JS handlers, 0 for success
+static bool ReplyErr(const RequestPtr& r, int err) {
+    return Reply(r, [err](fuse_req_t req) { return fuse_reply_err(req, -err); }, err);
+}
+
+// Runs while deadlines are enabled. Every tick, and whenever the kernel
+// interrupts a request, fails what is overdue or interrupted and tells JS
+// to stop working on it.
+static void Sweep(FuseContext* ctx, LowLevelState* state) {
+    const FuseDeadlineOptions& deadlines = ctx->deadlines;
+    double shortest = 1.0;
+    for (double timeout : deadlines.timeouts) {
+        if (timeout > 0) {
+            shortest = std::min(shortest, timeout);
+        }
+    }
+    auto tick = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::duration<double>(std::max(shortest / 8, 0.01)));
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (!state->stopping) {
+        state->sweep.wait_for(lock, tick);
+        std::vector<RequestPtr> overdue;
+        int64_t now = NowNs();
+        for (const RequestPtr& r : state->inFlight) {
+            if (!r->replied && (r->interrupted || (r->deadline > 0 && r->deadline <= now))) {
+                overdue.push_back(r);
+            }
+        }
+        if (overdue.empty()) {
+            continue;
+        }
+
+        lock.unlock();
+        for (const RequestPtr& r : overdue) {
+            bool interrupted = r->interrupted;
+            if (!ReplyErr(r, interrupted ? -EINTR : deadlines.timeoutErr)) {
+                continue;
+            }
+            (interrupted ? ctx->deadlineCounters.interrupts : ctx->deadlineCounters.timeouts)++;
+            r->cancel.Cancel(interrupted ? "interrupt" : "timeout");
+        }
+        lock.lock();
+    }
+}
+
+static bool ResolvePath(const RequestPtr& r, fuse_ino_t ino, std::string* path) {
+    if (r->state->inodes.GetPath(ino, path)) {
+        r->timer.NotePath(*path);
+        return true;
+    }
+    ReplyErr(r, -ESTALE);
+    return false;
+}
+
+static int ErrorOf(const JsArgs& info) {
+    return info.Length() > 0 && info[0].IsNumber() ? info[0].As<Napi::Number>().Int32Value() : 0;
+}
+
+// Work for the JS thread that skips requests failed in the meantime
+static Dispatcher::Work RequestWork(const RequestPtr& r, std::function<void(Napi::Env)> work) {
+    return [r, work](Napi::Env env) {
+        if (r->replied) {
+            return;
+        }
+        r->timer.Running();
+        try {
+            work(env);
+        } catch (...) {
+            ReplyErr(r, -EIO);
+        }
+    };
+}
+
+// Queues work for the JS thread serving path, in the lane of its operation
+static void Dispatch(const RequestPtr& r, std::string_view path, std::function<void(Napi::Env)> work) {
+    if (PostJs(r->ctx, path, RequestWork(r, std::move(work)), LaneOf(r->timer.op)) != napi_ok) {
+        ReplyErr(r, -EIO);
+    }
+}
+
+// Queues work on an open handle for the JS thread that opened it
+static void DispatchHandle(const RequestPtr& r, uint64_t fh, std::string_view path,
+                           std::function<void(Napi::Env)> work) {
+    if (PostHandleJs(r->ctx, fh, path, RequestWork(r, std::move(work)), LaneOf(r->timer.op)) != napi_ok) {
+        ReplyErr(r, -EIO);
+    }
+}
+
+// Calls ops[name](args..., cb) on the JS thread. A missing handler fails the
+// request with ENOSYS and a synchronous throw with EIO; otherwise onResult
+// runs on the first callback and is responsible for the reply.
+static void CallJs(Napi::Env env, const RequestPtr& r, const char* name,
+                   std::vector<napi_value> args, ResultHandler onResult) {
+    Napi::Object ops = JsOperations(r->ctx);
+    Napi::Value fn = ops.Get(name);
+    if (!fn.IsFunction()) {
+        ReplyErr(r, -ENOSYS);
+        return;
+    }
+
+    // A slot runs its handler once; a callback may be called again
+    auto called = std::make_shared<bool>(false);
+    JsReply reply;
+    bool hasReply = NewJsReply(env, r->ctx->requestSlots, r->timer.op, [r, called, onResult](const JsArgs& info) {
+        r->cancel.Unwatch();
+        if (*called || r->replied) {
+            return;
+        }
+        *called = true;
+        r->timer.Answered();
+        onResult(info);
+    }, &reply);
+    if (!hasReply) {
+        ReplyErr(r, -EAGAIN);
+        return;
+    }
+    if (r->ctx->deadlines.Enabled()) {
+        r->cancel.Watch(reply);
+    }
+    AddJsReply(reply, args);
+
+    CallOp(env, ops, name, fn.As<Napi::Function>(), args, [r, reply]() {
+        ReleaseJsReply(reply);
+        r->cancel.Unwatch();
+        ReplyErr(r, -EIO);
+    });
+}
+
+// Calls ops[name](args..., cb(err)) and replies with the status alone.
+// after runs first, e.g. to invalidate caches.
+static std::function<void(Napi::Env)> StatusWork(const RequestPtr& r, const char* name, ArgsBuilder args,
+                                                 std::function<void(int err)> after) {
+    return [r, name, args, after](Napi::Env env) {
+        CallJs(env, r, name, args(env), [r, after](const JsArgs& info) {
+            int err = ErrorOf(info);
+            if (after) {
+                after(err);
+            }
+            ReplyErr(r, err < 0 ? err : 0);
+        });
+    };
+}
+
+// ops[name](args..., cb(err)) for requests answered with the status alone
+static void ForwardStatus(const RequestPtr& r, const char* name, std::string_view path, ArgsBuilder args,
+                          std::function<void(int err)> after = nullptr) {
+    Dispatch(r, path, StatusWork(r, name, std::move(args), std::move(after)));
+}
+
+// The same for requests on the open handle fh
+static void ForwardHandleStatus(const RequestPtr& r, const char* name, uint64_t fh, std::string_view path,
+                                ArgsBuilder args) {
+    DispatchHandle(r, fh, path, StatusWork(r, name, std::move(args), nullptr));
+}
+
+// getattr(path) on the JS thread. done gets 0 and the stat, or a negative
+// errno; results go into the attr cache like in the high-level backend.
+static void StatPath(Napi::Env env, const RequestPtr& r, const std::string& path,
+                     std::function<void(int err, const struct stat& st)> done) {
+    if (!JsOperations(r->ctx).Get("getattr").IsFunction() && path == "/") {
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        st.st_mode = S_IFDIR | 0755;
+        st.st_nlink = 2;
+        done(0, st);
+        return;
+    }
+
+    CallJs(env, r, "getattr", {PathToJs(env, r->ctx, path)}, [r, path, done](const JsArgs& info) {
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        AttrCache* cache = r->ctx->attrCache.get();
+        ProbeFilter* filter = r->ctx->probeFilter.get();
+
+        int err = ErrorOf(info);
+        double ttl;
+        if (err == 0 && (info.Length() < 2 || !ParseJsStat(info[1], &st, &ttl))) {
+            err = -EINVAL;
+        }
+        if (err < 0) {
+            if (cache && err == -ENOENT) {
+                cache->InsertNegative(path, err);
+            }
+            if (filter && err == -ENOENT) {
+                filter->Missing(path);
+            }
+            done(err, st);
+            return;
+        }
+
+        CacheJsStat(cache, path, st, ttl);
+        if (filter) {
+            filter->Exists(path);
+        }
+        done(0, st);
+    });
+}
+
+static bool CachedStat(FuseContext* ctx, const std::string& path, struct stat* st, int* err) {
+    return ctx->attrCache && ctx->attrCache->Lookup(path, st, err);
+}
+
+static void ReplyAttr(const RequestPtr& r, fuse_ino_t ino, struct stat st) {
+    st.st_ino = ino;
+    double timeout = r->ctx->conn.attrTimeout;
+    Reply(r, [&st, timeout](fuse_req_t req) { return fuse_reply_attr(req, &st, timeout); });
+}
+
+// Every entry the kernel receives counts as one lookup of its inode, until
+// it sends a forget. A reply that never arrives must not count.
+static void ReplyEntry(const RequestPtr& r, const std::string& path, const struct stat& st,
+                       const struct fuse_file_info* fi = nullptr) {
+    struct fuse_entry_param e;
+    memset(&e, 0, sizeof(e));
+    e.ino = r->state->inodes.Ref(path);
+    e.attr = st;
+    e.attr.st_ino = e.ino;
+    e.attr_timeout = r->ctx->conn.attrTimeout;
+    e.entry_timeout = r->ctx->conn.entryTimeout;
+
+    bool sent = Reply(r, [&e, fi](fuse_req_t req) {
+        return fi ? fuse_reply_create(req, &e, fi) : fuse_reply_entry(req, &e);
+    });
+    if (!sent) {
+        r->state->inodes.Forget(e.ino, 1);
+    }
+}
+
+// A failed lookup. The kernel may keep the negative dentry for
+// negative_timeout, or as long as the attr cache keeps the ENOENT, or
+// minTtl.
+static void ReplyNoEntry(const RequestPtr& r, int err, double minTtl = 0) {
+    double ttl = std::max(r->ctx->conn.negativeTimeout, minTtl);
+    if (r->ctx->attrCache) {
+        ttl = std::max(ttl, r->ctx->attrCache->GetOptions().negativeTtl);
+    }
+    if (err != -ENOENT || ttl <= 0) {
+        ReplyErr(r, err);
+        return;
+    }
+
+    struct fuse_entry_param e;
+    memset(&e, 0, sizeof(e));
+    e.entry_timeout = ttl;
+    Reply(r, [&e](fuse_req_t req) { return fuse_reply_entry(req, &e); }, err);
+}
+
+// External Buffer over leased memory. The lease goes back to the pool once V8
+// lets go of the Buffer, which DetachBuffer() after the reply makes immediate.
+// Runtimes without external buffers get a copy instead.
+static Napi::Buffer<char> LeasedBuffer(Napi::Env env, const std::shared_ptr<BufferLease>& lease, size_t length) {
+    auto hint = new std::shared_ptr<BufferLease>(lease);
+    Napi::Buffer<char> buffer = Napi::Buffer<char>::New(env, lease->Data(), length,
+        [](Napi::Env, char*, std::shared_ptr<BufferLease>* held) { delete held; }, hint);
+    if (env.IsExceptionPending()) {
+        env.GetAndClearPendingException();
+        delete hint;
+        buffer = Napi::Buffer<char>::Copy(env, lease->Data(), length);
+    }
+    return buffer;
+}
+
+static void ll_init(void *userdata, struct fuse_conn_info *conn) {
+    ApplyConnectionOptions(static_cast<FuseContext*>(userdata), conn);
+}
+
+static void ll_lookup(fuse_req_t req, fuse_ino_t parent, const char *name) {
+    RequestPtr r = TrackRequest(req, StatOp::Lookup);
+    std::string dir;
+    if (!ResolvePath(r, parent, &dir)) return;
+    std::string path = JoinPath(dir, name);
+    r->timer.NotePath(path);
+
+    struct stat st;
+    int err = 0;
+    if (CachedStat(r->ctx, path, &st, &err)) {
+        if (err < 0) {
+            ReplyNoEntry(r, err);
+        } else {
+            ReplyEntry(r, path, st);
+        }
+        return;
+    }
+    ProbeFilter* filter = r->ctx->probeFilter.get();
+    if (filter && filter->Absorb(path)) {
+        ReplyNoEntry(r, -ENOENT, filter->GetOptions().negativeTimeout);
+        return;
+    }
+
+    Dispatch(r, path, [r, path](Napi::Env env) {
+        StatPath(env, r, path, [r, path](int err, const struct stat& st) {
+            if (err < 0) {
+                ReplyNoEntry(r, err);
+            } else {
+                ReplyEntry(r, path, st);
+            }
+        });
+    });
+}
+
+static void ll_forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup) {
+    auto ctx = static_cast<FuseContext*>(fuse_req_userdata(req));
+    ctx->lowLevelState->inodes.Forget(ino, nlookup);
+    fuse_reply_none(req);
+}
+
+static void ll_forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data *forgets) {
+    auto ctx = static_cast<FuseContext*>(fuse_req_userdata(req));
+    for (size_t i = 0; i < count; i++) {
+        ctx->lowLevelState->inodes.Forget(forgets[i].ino, forgets[i].nlookup);
+    }
+    fuse_reply_none(req);
+}
+
+static void ll_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+    (void)fi;
+    RequestPtr r = TrackRequest(req, StatOp::Getattr);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+    FlushPendingWrites(r->ctx, path.c_str(), r->timer.op);
+
+    struct stat st;
+    int err = 0;
+    if (CachedStat(r->ctx, path, &st, &err)) {
+        if (err < 0) {
+            ReplyErr(r, err);
+        } else {
+            ReplyAttr(r, ino, st);
+        }
+        return;
+    }
+
+    Dispatch(r, path, [r, ino, path](Napi::Env env) {
+        StatPath(env, r, path, [r, ino](int err, const struct stat& st) {
+            if (err < 0) {
+                ReplyErr(r, err);
+            } else {
+                ReplyAttr(r, ino, st);
+            }
+        });
+    });
+}
+
+// setattr is split into the chmod/chown/truncate/utimens calls the JS
+// surface knows, run one after another and answered with a fresh getattr.
+// A time utimens is to keep is NaN until read back with getattr.
+struct SetattrStep {
+    const char* op;
+    std::vector<double> args;
+};
+
+static void RunSetattr(Napi::Env env, const RequestPtr& r, fuse_ino_t ino, const std::string& path,
+                       std::shared_ptr<std::vector<SetattrStep>> steps, size_t next) {
+    if (next == steps->size()) {
+        StatPath(env, r, path, [r, ino](int err, const struct stat& st) {
+            if (err < 0) {
+                ReplyErr(r, err);
+            } else {
+                ReplyAttr(r, ino, st);
+            }
+        });
+        return;
+    }
+
+    SetattrStep& step = (*steps)[next];
+    if (std::any_of(step.args.begin(), step.args.end(), [](double value) { return std::isnan(value); })) {
+        StatPath(env, r, path, [env, r, ino, path, steps, next](int err, const struct stat& st) {
+            if (err < 0) {
+                ReplyErr(r, err);
+                return;
+            }
+            std::vector<double>& times = (*steps)[next].args;
+            times[0] = std::isnan(times[0]) ? static_cast<double>(st.st_atime) : times[0];
+            times[1] = std::isnan(times[1]) ? static_cast<double>(st.st_mtime) : times[1];
+            RunSetattr(env, r, ino, path, steps, next);
+        });
+        return;
+    }
+    std::vector<napi_value> args = {PathToJs(env, r->ctx, path)};
+    for (double value : step.args) {
+        args.push_back(Napi::Number::New(env, value));
+    }
+    CallJs(env, r, step.op, args, [r, ino, path, steps, next](const JsArgs& info) {
+        InvalidateAttrs(r->ctx, path.c_str());
+        int err = ErrorOf(info);
+        if (err < 0) {
+            ReplyErr(r, err);
+            return;
+        }
+        RunSetattr(info.Env(), r, ino, path, steps, next + 1);
+    });
+}
+
+static void ll_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set,
+                       struct fuse_file_info *fi) {
+    (void)fi;
+    RequestPtr r = TrackRequest(req, StatOp::Setattr);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+    FlushPendingWrites(r->ctx, path.c_str(), r->timer.op);
+
+    auto steps = std::make_shared<std::vector<SetattrStep>>();
+    if (to_set & FUSE_SET_ATTR_MODE) {
+        steps->push_back({"chmod", {static_cast<double>(attr->st_mode)}});
+    }
+    if (to_set & (FUSE_SET_ATTR_UID | FUSE_SET_ATTR_GID)) {
+        uid_t uid = (to_set & FUSE_SET_ATTR_UID) ? attr->st_uid : static_cast<uid_t>(-1);
+        gid_t gid = (to_set & FUSE_SET_ATTR_GID) ? attr->st_gid : static_cast<gid_t>(-1);
+        steps->push_back({"chown", {static_cast<double>(uid), static_cast<double>(gid)}});
+    }
+    if (to_set & FUSE_SET_ATTR_SIZE) {
+        steps->push_back({"truncate", {static_cast<double>(attr->st_size)}});
+    }
+    if (to_set & (FUSE_SET_ATTR_ATIME | FUSE_SET_ATTR_MTIME)) {
+        // utimens always takes both times; one that is not being set keeps
+        // its cached value, or the one getattr reports right before.
+        time_t now = time(nullptr);
+        struct stat current;
+        memset(&current, 0, sizeof(current));
+        int err = 0;
+        bool known = CachedStat(r->ctx, path, &current, &err) && err == 0;
+        auto pick = [&](int setBit, int nowBit, time_t value, time_t currentValue) {
+            if (to_set & nowBit) return static_cast<double>(now);
+            if (to_set & setBit) return static_cast<double>(value);
+            return known ? static_cast<double>(currentValue) : std::nan("");
+        };
+        steps->push_back({"utimens", {
+            pick(FUSE_SET_ATTR_ATIME, FUSE_SET_ATTR_ATIME_NOW, attr->st_atime, current.st_atime),
+            pick(FUSE_SET_ATTR_MTIME, FUSE_SET_ATTR_MTIME_NOW, attr->st_mtime, current.st_mtime),
+        }});
+    }
+
+    Dispatch(r, path, [r, ino, path, steps](Napi::Env env) {
+        RunSetattr(env, r, ino, path, steps, 0);
+    });
+}
+
+static void ll_mkdir(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode) {
+    RequestPtr r = TrackRequest(req, StatOp::Mkdir);
+    std::string dir;
+    if (!ResolvePath(r, parent, &dir)) return;
+    std::string path = JoinPath(dir, name);
+    r->timer.NotePath(path);
+
+    Dispatch(r, path, [r, path, mode](Napi::Env env) {
+        std::vector<napi_value> args = {PathToJs(env, r->ctx, path), Napi::Number::New(env, mode)};
+        CallJs(env, r, "mkdir", args, [r, path](const JsArgs& info) {
+            InvalidateAttrs(r->ctx, path.c_str(), true);
+            int err = ErrorOf(info);
+            if (err < 0) {
+                ReplyErr(r, err);
+                return;
+            }
+            StatPath(info.Env(), r, path, [r, path](int err, const struct stat& st) {
+                if (err < 0) {
+                    ReplyErr(r, err);
+                } else {
+                    ReplyEntry(r, path, st);
+                }
+            });
+        });
+    });
+}
+
+static void ll_unlink(fuse_req_t req, fuse_ino_t parent, const char *name) {
+    RequestPtr r = TrackRequest(req, StatOp::Unlink);
+    std::string dir;
+    if (!ResolvePath(r, parent, &dir)) return;
+    std::string path = JoinPath(dir, name);
+    r->timer.NotePath(path);
+    FlushPendingWrites(r->ctx, path.c_str(), r->timer.op);
+
+    ForwardStatus(r, "unlink", path, [r, path](Napi::Env env) {
+        return std::vector<napi_value>{PathToJs(env, r->ctx, path)};
+    }, [r, path](int err) {
+        if (err >= 0) {
+            r->state->inodes.Unlink(path);
+        }
+        InvalidateAttrs(r->ctx, path.c_str(), true);
+    });
+}
+
+static void ll_rmdir(fuse_req_t req, fuse_ino_t parent, const char *name) {
+    RequestPtr r = TrackRequest(req, StatOp::Rmdir);
+    std::string dir;
+    if (!ResolvePath(r, parent, &dir)) return;
+    std::string path = JoinPath(dir, name);
+    r->timer.NotePath(path);
+
+    ForwardStatus(r, "rmdir", path, [r, path](Napi::Env env) {
+        return std::vector<napi_value>{PathToJs(env, r->ctx, path)};
+    }, [r, path](int err) {
+        if (err >= 0) {
+            r->state->inodes.Unlink(path);
+        }
+        InvalidateAttrTree(r->ctx, path.c_str());
+    });
+}
+
+static void ll_rename(fuse_req_t req, fuse_ino_t parent, const char *name,
+                      fuse_ino_t newparent, const char *newname, unsigned int flags) {
+    RequestPtr r = TrackRequest(req, StatOp::Rename);
+    // rename(src, dest) has no way to express RENAME_NOREPLACE/EXCHANGE
+    if (flags != 0) {
+        ReplyErr(r, -EINVAL);
+        return;
+    }
+    std::string dir, newdir;
+    if (!ResolvePath(r, parent, &dir) || !ResolvePath(r, newparent, &newdir)) return;
+    std::string from = JoinPath(dir, name);
+    r->timer.NotePath(from);
+    std::string to = JoinPath(newdir, newname);
+    FlushPendingWrites(r->ctx, from.c_str(), r->timer.op);
+
+    ForwardStatus(r, "rename", from, [r, from, to](Napi::Env env) {
+        return std::vector<napi_value>{PathToJs(env, r->ctx, from), PathToJs(env, r->ctx, to)};
+    }, [r, from, to](int err) {
+        if (err >= 0) {
+            r->state->inodes.Rename(from, to);
+        }
+        InvalidateAttrTree(r->ctx, from.c_str());
+        InvalidateAttrTree(r->ctx, to.c_str());
+    });
+}
+
+// Lets the kernel read a backed handle from the host file itself. Needs
+// CAP_SYS_ADMIN; when the kernel refuses, reads are served by ll_read.
+static void PassThrough(FuseContext* ctx, fuse_req_t req, struct fuse_file_info* fi) {
+#ifdef FUSE_CAP_PASSTHROUGH
+    BackingFiles::File backing;
+    if (!ctx->passthrough || !ctx->backingFiles.Find(fi->fh, &backing) || backing.offset != 0) {
+        return;
+    }
+    int backingId = fuse_passthrough_open(req, backing.fd);
+    if (backingId > 0) {
+        fi->backing_id = backingId;
+        ctx->backingFiles.SetBackingId(fi->fh, backingId);
+    }
+#else
+    (void)ctx;
+    (void)req;
+    (void)fi;
+#endif
+}
+
+static void ll_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+    RequestPtr r = TrackRequest(req, StatOp::Open);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+    // fi only lives for the duration of this call
+    struct fuse_file_info file = *fi;
+
+    Dispatch(r, path, [r, path, file](Napi::Env env) {
+        std::vector<napi_value> args = {PathToJs(env, r->ctx, path), Napi::Number::New(env, file.flags)};
+        uint32_t owner = r->ctx->workers->IdOf(Dispatcher::Current());
+        CallJs(env, r, "open", args, [r, file, owner](const JsArgs& info) {
+            int err = ErrorOf(info);
+            if (err < 0) {
+                ReplyErr(r, err);
+                return;
+            }
+            struct fuse_file_info opened = file;
+            OpenReply reply;
+            if (info.Length() > 1 && info[1].IsNumber()) {
+                if (!WorkerPool::MakeHandle(owner, info[1].As<Napi::Number>().Int64Value(), &opened.fh)) {
+                    ReplyErr(r, -EOVERFLOW);
+                    return;
+                }
+                if (info.Length() > 2) {
+                    ParseOpenReply(info[2], &reply);
+                }
+            }
+            BindOpenReply(r->ctx, opened.fh, opened.flags, reply);
+            opened.keep_cache = r->ctx->conn.kernelCache;
+            bool sent = Reply(r, [r, &opened](fuse_req_t req) {
+                PassThrough(r->ctx, req, &opened);
+                return fuse_reply_open(req, &opened);
+            });
+            if (!sent) {
+                // No release will follow
+                UnbindHandle(r->ctx, opened.fh);
+            }
+        });
+    });
+}
+
+static void ll_create(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode,
+                      struct fuse_file_info *fi) {
+    RequestPtr r = TrackRequest(req, StatOp::Create);
+    std::string dir;
+    if (!ResolvePath(r, parent, &dir)) return;
+    std::string path = JoinPath(dir, name);
+    r->timer.NotePath(path);
+    struct fuse_file_info file = *fi;
+
+    Dispatch(r, path, [r, path, mode, file](Napi::Env env) {
+        std::vector<napi_value> args = {PathToJs(env, r->ctx, path), Napi::Number::New(env, mode)};
+        uint32_t owner = r->ctx->workers->IdOf(Dispatcher::Current());
+        CallJs(env, r, "create", args, [r, path, file, owner](const JsArgs& info) {
+            InvalidateAttrs(r->ctx, path.c_str(), true);
+            int err = ErrorOf(info);
+            if (err < 0) {
+                ReplyErr(r, err);
+                return;
+            }
+            struct fuse_file_info created = file;
+            if (info.Length() > 1 && info[1].IsNumber() &&
+                !WorkerPool::MakeHandle(owner, info[1].As<Napi::Number>().Int64Value(), &created.fh)) {
+                ReplyErr(r, -EOVERFLOW);
+                return;
+            }
+            StatPath(info.Env(), r, path, [r, path, created](int err, const struct stat& st) {
+                if (err < 0) {
+                    ReplyErr(r, err);
+                } else {
+                    ReplyEntry(r, path, st, &created);
+                }
+            });
+        });
+    });
+}
+
+static void ReplySlices(const RequestPtr& r, const std::vector<ContentCache::Slice>& slices) {
+    std::vector<struct iovec> iov;
+    iov.reserve(slices.size());
+    size_t bytes = 0;
+    for (const ContentCache::Slice& slice : slices) {
+        iov.push_back({const_cast<char*>(slice.chunk->data() + slice.offset), slice.length});
+        bytes += slice.length;
+    }
+    Reply(r, [&iov](fuse_req_t req) { return fuse_reply_iov(req, iov.data(), static_cast<int>(iov.size())); },
+          0, bytes);
+}
+
+static void ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                    struct fuse_file_info *fi) {
+    RequestPtr r = TrackRequest(req, StatOp::Read);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+    uint64_t fh = fi->fh;
+    r->timer.NoteIo(fh, size, off);
+    FlushPendingWrites(r->ctx, path.c_str(), r->timer.op);
+
+    // Backed handles never reach JS: libfuse splices or reads the host file
+    BackingFiles::File backing;
+    if (r->ctx->backingFiles.Find(fh, &backing)) {
+        struct fuse_bufvec bufv = FUSE_BUFVEC_INIT(size);
+        bufv.buf[0].flags = static_cast<enum fuse_buf_flags>(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+        bufv.buf[0].fd = backing.fd;
+        bufv.buf[0].pos = backing.offset + off;
+        // Counts what was asked for; the host file may end earlier
+        Reply(r, [&bufv](fuse_req_t req) { return fuse_reply_data(req, &bufv, FUSE_BUF_SPLICE_MOVE); }, 0, size);
+        return;
+    }
+
+    // Content with a known hash is answered straight from the cache. On a
+    // miss the whole chunks around the range are read so they can be cached.
+    auto hash = std::make_shared<std::string>();
+    ContentCache* cache = r->ctx->contentCache.get();
+    bool cacheable = cache && cache->HashOf(fh, hash.get());
+    off_t start = off;
+    size_t length = size;
+    if (cacheable) {
+        std::vector<ContentCache::Slice> slices;
+        if (cache->Lookup(*hash, off, size, &slices)) {
+            ReplySlices(r, slices);
+            return;
+        }
+        const size_t chunk = ContentCache::kChunkSize;
+        start = off - off % chunk;
+        length = (off + size - start + chunk - 1) / chunk * chunk;
+    }
+
+    auto lease = std::make_shared<BufferLease>(r->state->buffers, length);
+    if (!lease->Data()) {
+        ReplyErr(r, -ENOMEM);
+        return;
+    }
+
+    // Sequential readers are served from data fetched ahead of them
+    Readahead* readahead = r->ctx->readahead.get();
+    if (!cacheable && readahead && readahead->Read(path, fh, lease->Data(), size, off, [r, lease](int res) {
+            if (res < 0) {
+                ReplyErr(r, res);
+                return;
+            }
+            Reply(r, [&](fuse_req_t req) { return fuse_reply_buf(req, lease->Data(), res); }, 0, res);
+        })) {
+        return;
+    }
+
+    DispatchHandle(r, fh, path, [r, path, fh, size, off, start, length, cacheable, hash, lease](Napi::Env env) {
+        Napi::Buffer<char> buffer = LeasedBuffer(env, lease, length);
+        auto jsBuffer = std::make_shared<Napi::Reference<Napi::Buffer<char>>>(
+            Napi::Reference<Napi::Buffer<char>>::New(buffer, 1));
+
+        std::vector<napi_value> args = {
+            PathToJs(env, r->ctx, path),
+            Napi::Number::New(env, WorkerPool::JsHandle(fh)),
+            buffer,
+            Napi::Number::New(env, length),
+            Napi::Number::New(env, start)
+        };
+        CallJs(env, r, "read", args, [r, size, off, start, length, cacheable, hash, jsBuffer](const JsArgs& info) {
+            Napi::Buffer<char> filled = jsBuffer->Value();
+            const char* data = filled.Data();
+            size_t bytesRead = 0;
+            int err = ErrorOf(info);
+            if (err >= 0 && info.Length() > 1 && info[1].IsBuffer()) {
+                // Older handlers return a Buffer of their own
+                Napi::Buffer<char> result = info[1].As<Napi::Buffer<char>>();
+                data = result.Data();
+                bytesRead = std::min(length, result.Length());
+            } else if (err >= 0 && info.Length() > 1 && info[1].IsNumber()) {
+                int64_t reported = info[1].As<Napi::Number>().Int64Value();
+                if (reported < 0) {
+                    err = -EIO;
+                } else {
+                    bytesRead = std::min<size_t>(reported, length);
+                }
+            }
+
+            if (err < 0) {
+                ReplyErr(r, err);
+            } else {
+                if (cacheable) {
+                    r->ctx->contentCache->Insert(*hash, start, data, bytesRead, bytesRead < length);
+                }
+                size_t skip = off - start;
+                size_t replied = bytesRead > skip ? std::min(size, bytesRead - skip) : 0;
+                Reply(r, [&](fuse_req_t req) { return fuse_reply_buf(req, data + skip, replied); }, 0, replied);
+            }
+            DetachBuffer(filled);
+        });
+    });
+}
+
+static void ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t off,
+                     struct fuse_file_info *fi) {
+    RequestPtr r = TrackRequest(req, StatOp::Write);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+    uint64_t fh = fi->fh;
+    r->timer.NoteIo(fh, size, off);
+
+    // Buffered writes are acknowledged from here; only a write-out waits for JS
+    if (r->ctx->writeBuffer) {
+        int res = r->ctx->writeBuffer->Write(path, fh, buf, size, off, r->ctx->deadlines.Deadline(StatOp::Write));
+        if (res < 0) {
+            ReplyErr(r, res);
+        } else {
+            Reply(r, [res](fuse_req_t req) { return fuse_reply_write(req, res); }, 0, res);
+        }
+        return;
+    }
+
+    // buf is reused by libfuse as soon as this returns
+    auto lease = std::make_shared<BufferLease>(r->state->buffers, size);
+    if (!lease->Data()) {
+        ReplyErr(r, -ENOMEM);
+        return;
+    }
+    memcpy(lease->Data(), buf, size);
+
+    DispatchHandle(r, fh, path, [r, path, fh, size, off, lease](Napi::Env env) {
+        Napi::Buffer<char> buffer = LeasedBuffer(env, lease, size);
+        auto jsBuffer = std::make_shared<Napi::Reference<Napi::Buffer<char>>>(
+            Napi::Reference<Napi::Buffer<char>>::New(buffer, 1));
+
+        std::vector<napi_value> args = {
+            PathToJs(env, r->ctx, path),
+            Napi::Number::New(env, WorkerPool::JsHandle(fh)),
+            buffer,
+            Napi::Number::New(env, size),
+            Napi::Number::New(env, off)
+        };
+        CallJs(env, r, "write", args, [r, path, size, jsBuffer](const JsArgs& info) {
+            int result = ParseWriteResult(info, size);
+            InvalidateAttrs(r->ctx, path.c_str());
+            if (result < 0) {
+                ReplyErr(r, result);
+            } else {
+                Reply(r, [result](fuse_req_t req) { return fuse_reply_write(req, result); }, 0, result);
+            }
+            DetachBuffer(jsBuffer->Value());
+        });
+    });
+}
+
+static void ll_flush(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+    RequestPtr r = TrackRequest(req, StatOp::Flush);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+    uint64_t fh = fi->fh;
+
+    // Backed handles are read-only and only go back to JS on release
+    BackingFiles::File backing;
+    if (r->ctx->backingFiles.Find(fh, &backing)) {
+        ReplyErr(r, 0);
+        return;
+    }
+    // close() reports errors of buffered writes from here
+    if (r->ctx->writeBuffer) {
+        int res = r->ctx->writeBuffer->Flush(fh, r->ctx->deadlines.Deadline(r->timer.op));
+        if (res < 0) {
+            ReplyErr(r, res);
+            return;
+        }
+    }
+    ForwardHandleStatus(r, "flush", fh, path, [r, path, fh](Napi::Env env) {
+        return std::vector<napi_value>{PathToJs(env, r->ctx, path), Napi::Number::New(env, WorkerPool::JsHandle(fh))};
+    });
+}
+
+static void ll_release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+    RequestPtr r = TrackRequest(req, StatOp::Release);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+    uint64_t fh = fi->fh;
+
+    BackingFiles::File backing;
+    if (r->ctx->backingFiles.Detach(fh, &backing)) {
+#ifdef FUSE_CAP_PASSTHROUGH
+        if (backing.backingId > 0) {
+            fuse_passthrough_close(req, backing.backingId);
+        }
+#endif
+        BackingFiles::Close(backing);
+    }
+    UnbindHandle(r->ctx, fh);
+    if (r->ctx->writeBuffer) {
+        // Nobody is left to see an error; flush already reported it
+        r->ctx->writeBuffer->Release(fh);
+    }
+    ForwardHandleStatus(r, "release", fh, path, [r, path, fh](Napi::Env env) {
+        return std::vector<napi_value>{PathToJs(env, r->ctx, path), Napi::Number::New(env, WorkerPool::JsHandle(fh))};
+    });
+}
+
+static void ll_fsync(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info *fi) {
+    RequestPtr r = TrackRequest(req, StatOp::Fsync);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+    uint64_t fh = fi->fh;
+
+    if (r->ctx->writeBuffer) {
+        int res = r->ctx->writeBuffer->Flush(fh, r->ctx->deadlines.Deadline(r->timer.op));
+        if (res < 0) {
+            ReplyErr(r, res);
+            return;
+        }
+    }
+    ForwardHandleStatus(r, "fsync", fh, path, [r, path, datasync, fh](Napi::Env env) {
+        return std::vector<napi_value>{
+            PathToJs(env, r->ctx, path),
+            Napi::Boolean::New(env, datasync != 0),
+            Napi::Number::New(env, WorkerPool::JsHandle(fh))
+        };
+    });
+}
+
+static void ll_access(fuse_req_t req, fuse_ino_t ino, int mask) {
+    RequestPtr r = TrackRequest(req, StatOp::Access);
+    std::string path;
+    if (!ResolvePath(r, ino, &path)) return;
+
+    ForwardStatus(r, "access", path, [r, path, mask](Napi::Env env) {
+        return std::vector<napi_value>{PathToJs(env, r->ctx, path), Napi::Number::New(env, mask)};
+    });
+}
+
+static std::shared_ptr<DirHandle> FindDir(LowLevelState* state, uint64_t fh) {
+    std::lock_guard<std::mutex> lock(state->dirsMutex);
+    auto it = state->dirs.find(fh);
+    return it != state->dirs.end() ? it->second : nullptr;
+}
+
+// Drops the handle from the table; answers still on their way skip it
+static void ReleaseDir(LowLevelState* state, uint64_t fh) {
+    std::shared_ptr<DirHandle> dir;
+    {
+        std::lock_guard<std::mutex> lock(state->dirsMutex);
+        auto it = state->dirs.find(fh);
+        if (it == state->dirs.end()) {
+            return;
+        }
+        dir = std::move(it->second);
+        state->dirs.erase(it);
+    }
+    std::lock_guard<std::mutex> lock(dir->mutex);
+    dir->released = true;
+}
+
+static void ll_opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+    RequestPtr r = TrackRequest(req, StatOp::Opendir);
+    auto dir = std::make_shared<DirHandle>();
+    if (!ResolvePath(r, ino, &dir->path)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(r->state->dirsMutex);
+        fi->fh = r->state->nextDir++;
+        r->state->dirs.emplace(fi->fh, std::move(dir));
+    }
+    if (!Reply(r, [fi](fuse_req_t req) { return fuse_reply_open(req, fi); })) {
+        ReleaseDir(r->state.get(), fi->fh);
+    }
+}
+
+static void ll_releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+    (void)ino;
+    auto ctx = static_cast<FuseContext*>(fuse_req_userdata(req));
+    ReleaseDir(ctx->lowLevelState.get(), fi->fh);
+    fuse_reply_err(req, 0);
+}
+
+static void LoadListing(FuseContext* ctx, DirHandle* dir, const JsArgs& info) {
+    dir->names.clear();
+    dir->stats.clear();
+    dir->hasStats.clear();
+    ForEachJsEntry(info, [ctx, dir](std::string& name, const struct stat* st, double ttl) {
+        struct stat entry;
+        memset(&entry, 0, sizeof(entry));
+        if (st || ctx->probeFilter) {
+            std::string path = JoinPath(dir->path, name);
+            if (ctx->probeFilter) {
+                ctx->probeFilter->Exists(path);
+            }
+            if (st) {
+                entry = *st;
+                CacheJsStat(ctx->attrCache.get(), path, entry, ttl);
+            }
+        }
+        dir->names.push_back(std::move(name));
+        dir->stats.push_back(entry);
+        dir->hasStats.push_back(st != nullptr);
+    });
+    dir->loaded = true;
+}
+
+// Entry 0 is ".", entry 1 "..", then the listing. The offset stored with an
+// entry is the index of the one after it.
+static void ReplyDirChunk(const RequestPtr& r, DirHandle* dir, size_t size, off_t off, bool plus) {
+    InodeTable& inodes = r->state->inodes;
+    InodeRefs refs(inodes);
+    std::vector<char> buf(size);
+    size_t used = 0;
+    size_t total = dir->names.size() + 2;
+
+    for (size_t i = static_cast<size_t>(off); i < total; i++) {
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        const char* name;
+        std::string child;
+        bool known = false;
+        if (i < 2) {
+            name = i == 0 ? "." : "..";
+            st.st_mode = S_IFDIR;
+        } else {
+            name = dir->names[i - 2].c_str();
+            child = JoinPath(dir->path, name);
+            known = dir->hasStats[i - 2];
+            if (known) {
+                st = dir->stats[i - 2];
+            }
+        }
+
+        size_t entrySize;
+        if (plus) {
+            // Entries without attributes are listed but not linked (ino 0)
+            struct fuse_entry_param e;
+            memset(&e, 0, sizeof(e));
+            e.attr = st;
+            e.attr.st_ino = kUnknownIno;
+            if (known) {
+                e.ino = refs.Ref(child);
+                e.attr.st_ino = e.ino;
+                e.attr_timeout = r->ctx->conn.attrTimeout;
+                e.entry_timeout = r->ctx->conn.entryTimeout;
+            }
+            entrySize = fuse_add_direntry_plus(r->req, buf.data() + used, size - used, name, &e, i + 1);
+            if (entrySize > size - used) {
+                if (e.ino) {
+                    refs.Unref();
+                }
+                break;
+            }
+        } else {
+            uint64_t ino = i < 2 ? 0 : inodes.Find(child);
+            st.st_ino = ino ? ino : kUnknownIno;
+            entrySize = fuse_add_direntry(r->req, buf.data() + used, size - used, name, &st, i + 1);
+            if (entrySize > size - used) {
+                break;
+            }
+        }
+        used += entrySize;
+    }
+
+    // Entries the kernel never got are not looked up
+    if (Reply(r, [&](fuse_req_t req) { return fuse_reply_buf(req, buf.data(), used); })) {
+        refs.Keep();
+    }
+}
+
+static void ReadDir(fuse_req_t req, size_t size, off_t off, struct fuse_file_info *fi, bool plus) {
+    RequestPtr r = TrackRequest(req, StatOp::Readdir);
+    std::shared_ptr<DirHandle> dir = FindDir(r->state.get(), fi->fh);
+    if (!dir) {
+        ReplyErr(r, -EBADF);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(dir->mutex);
+        if (dir->loaded && off > 0) {
+            ReplyDirChunk(r, dir.get(), size, off, plus);
+            return;
+        }
+    }
+
+    // path never changes, so it is read without the lock
+    Dispatch(r, dir->path, [r, dir, size, off, plus](Napi::Env env) {
+        CallJs(env, r, "readdir", {PathToJs(env, r->ctx, dir->path)}, [r, dir, size, off, plus](const JsArgs& info) {
+            int err = ErrorOf(info);
+            if (err < 0) {
+                ReplyErr(r, err);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(dir->mutex);
+            if (dir->released) {
+                ReplyErr(r, -EBADF);
+                return;
+            }
+            LoadListing(r->ctx, dir.get(), info);
+            ReplyDirChunk(r, dir.get(), size, off, plus);
+        });
+    });
+}
+
+static void ll_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info *fi) {
+    (void)ino;
+    ReadDir(req, size, off, fi, false);
+}
+
+static void ll_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info *fi) {
+    (void)ino;
+    ReadDir(req, size, off, fi, true);
+}
+
+static void ll_statfs(fuse_req_t req, fuse_ino_t ino) {
+    (void)ino;
+    struct statvfs st;
+    fuse3_statfs("/", &st);
+    fuse_reply_statfs(req, &st);
+}
+
+static const struct fuse_lowlevel_ops* LowLevelOperations() {
+    static const struct fuse_lowlevel_ops ops = [] {
+        struct fuse_lowlevel_ops o = {};
+        o.init = ll_init;
+        o.lookup = ll_lookup;
+        o.forget = ll_forget;
+        o.forget_multi = ll_forget_multi;
+        o.getattr = ll_getattr;
+        o.setattr = ll_setattr;
+        o.mkdir = ll_mkdir;
+        o.unlink = ll_unlink;
+        o.rmdir = ll_rmdir;
+        o.rename = ll_rename;
+        o.open = ll_open;
+        o.create = ll_create;
+        o.read = ll_read;
+        o.write = ll_write;
+        o.flush = ll_flush;
+        o.release = ll_release;
+        o.fsync = ll_fsync;
+        o.access = ll_access;
+        o.opendir = ll_opendir;
+        o.readdir = ll_readdir;
+        o.readdirplus = ll_readdirplus;
+        o.releasedir = ll_releasedir;
+        o.statfs = ll_statfs;
+        return o;
+    }();
+    return &ops;
+}
+
+bool LowLevelMount(FuseContext* ctx) {
+    ctx->lowLevelState = std::make_shared<LowLevelState>();
+
+    struct fuse_args args = FUSE_ARGS_INIT(0, nullptr);
+    fuse_opt_add_arg(&args, "fuse3_napi");
+    AddMountOptions(ctx, &args);
+    ctx->session = fuse_session_new(&args, LowLevelOperations(), sizeof(struct fuse_lowlevel_ops), ctx);
+    fuse_opt_free_args(&args);
+    if (!ctx->session) {
+        return false;
+    }
+
+    if (fuse_session_mount(ctx->session, ctx->mountPoint.c_str()) != 0) {
+        fuse_session_destroy(ctx->session);
+        ctx->session = nullptr;
+        return false;
+    }
+
+    if (ctx->deadlines.Enabled()) {
+        LowLevelState* state = ctx->lowLevelState.get();
+        state->sweeper = std::thread(Sweep, ctx, state);
+    }
+    return true;
+}
+
+void LowLevelUnmount(FuseContext* ctx) {
+    LowLevelState* state = ctx->lowLevelState.get();
+    if (state->sweeper.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stopping = true;
+        }
+        state->sweep.notify_one();
+        state->sweeper.join();
+    }
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        // Nothing JS sends after this point reaches the kernel
+        for (auto it = state->inFlight.begin(); it != state->inFlight.end();) {
+            const RequestPtr& r = *it;
+            if (!r->replied.exchange(true)) {
+                fuse_reply_err(r->req, EIO);
+                it = state->inFlight.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        // Replies already claimed on the JS thread are being sent right now
+        state->drained.wait(lock, [state] { return state->inFlight.empty(); });
+    }
+
+    std::lock_guard<std::mutex> lock(ctx->unmountMutex);
+    fuse_session_unmount(ctx->session);
+    // A notification may be waiting for a request nobody answers anymore;
+    // the unmount ended both
+    ctx->notifier->Stop();
+    fuse_session_destroy(ctx->session);
+    ctx->session = nullptr;
+}
+int LowLevelNotify(FuseContext* ctx, KernelNotifier::Kind kind, const std::string& path) {
+    LowLevelState* state = ctx->lowLevelState.get();
+    if (!ctx->session || !state) {
+        return -ENOTCONN;
+    }
+    if (kind == KernelNotifier::Change) {
+        fuse_ino_t ino = state->inodes.Find(path);
+        return ino ? fuse_lowlevel_notify_inval_inode(ctx->session, ino, 0, 0) : -ENOENT;
+    }
+
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos || slash + 1 == path.size()) {
+        return -EINVAL;
+    }
+    fuse_ino_t parent = state->inodes.Find(slash == 0 ? "/" : path.substr(0, slash));
+    const char* name = path.c_str() + slash + 1;
+    size_t length = path.size() - slash - 1;
+    if (kind == KernelNotifier::Entry) {
+        return parent ? fuse_lowlevel_notify_inval_entry(ctx->session, parent, name, length) : -ENOENT;
+    }
+
+    // The next lookup gets a new inode, as after an unlink through the mount
+    fuse_ino_t child = state->inodes.Find(path);
+    state->inodes.Unlink(path);
+    if (!parent) {
+        return -ENOENT;
+    }
+    return child ? fuse_lowlevel_notify_delete(ctx->session, parent, child, name, length)
+                 : fuse_lowlevel_notify_inval_entry(ctx->session, parent, name, length);
+}
\ No newline at end of file
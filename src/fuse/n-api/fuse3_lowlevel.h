@@ -0,0 +1,20 @@
+#pragma once
+
+#include "fuse3_context.h"
+
+// Inode-based backend on fuse_lowlevel.h, selected with low_level: true. The
+// JS FuseOperations are the same as for the high-level backend, but replies
+// are sent with fuse_reply_* straight from the JS callbacks, so no FUSE thread
+// is parked while a request is in flight.
+
+// Creates the session for ctx->mountPoint and mounts it. Returns false if
+// either step failed; nothing is left to clean up in that case.
+bool LowLevelMount(FuseContext* ctx);
+
+// Called once the session loop has returned. Fails whatever JS has not
+// answered yet, then unmounts and destroys the session.
+void LowLevelUnmount(FuseContext* ctx);
+
+// KernelNotifier::SendFn of a low-level mount: inval_inode, inval_entry or
+// notify_delete for the inodes the kernel got for path
+int LowLevelNotify(FuseContext* ctx, KernelNotifier::Kind kind, const std::string& path);
\ No newline at end of file
@@ -1,32 +1,17 @@
-#include <napi.h>
-#include <fuse.h>
+#include "fuse3_context.h"
+#include "fuse3_lowlevel.h"
 #include <fuse_lowlevel.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <string.h>
 #include <errno.h>
-#include <memory>
-#include <thread>
-#include <mutex>
+#include <climits>
+#include <cmath>
 #include <condition_variable>
+#include <mutex>
 #include <queue>
 #include <unordered_map>
-#include <future>
-
-// FUSE operation callback context
-struct FuseContext {
-    Napi::ThreadSafeFunction tsfn;
-    Napi::ObjectReference operations;
-    std::string mountPoint;
-    struct fuse *fuse;
-    std::thread *fuseThread;
-    bool mounted;
-};
-
-// Global map to store contexts by mount point
-std::unordered_map<std::string, std::unique_ptr<FuseContext>> g_contexts;
-std::mutex g_contexts_mutex;
 
 // Forward declarations - these are defined in fuse3_operations.cc
 extern int fuse3_getattr(const char *path, struct stat *stbuf, struct fuse_file_info *fi);
@@ -35,8 +20,10 @@ extern int fuse3_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 extern int fuse3_open(const char *path, struct fuse_file_info *fi);
 extern int fuse3_read(const char *path, char *buf, size_t size, off_t offset,
                       struct fuse_file_info *fi);
-extern int fuse3_write(const char *path, const char *buf, size_t size, off_t offset,
-                       struct fuse_file_info *fi);
+extern int fuse3_read_buf(const char *path, struct fuse_bufvec **bufp, size_t size, off_t offset,
+                          struct fuse_file_info *fi);
+extern int fuse3_write_buf(const char *path, struct fuse_bufvec *bufv, off_t offset,
+                           struct fuse_file_info *fi);
 extern int fuse3_create(const char *path, mode_t mode, struct fuse_file_info *fi);
 extern int fuse3_unlink(const char *path);
 extern int fuse3_mkdir(const char *path, mode_t mode);
@@ -51,43 +38,90 @@ extern int fuse3_fsync(const char *path, int isdatasync, struct fuse_file_info *
 extern int fuse3_flush(const char *path, struct fuse_file_info *fi);
 extern int fuse3_access(const char *path, int mask);
 extern int fuse3_statfs(const char *path, struct statvfs *stbuf);
+extern void* fuse3_init(struct fuse_conn_info *conn, struct fuse_config *cfg);
 
-// FUSE operations structure - initialize all fields to NULL first
-static struct fuse_operations fuse3_ops = {};
-
-// Initialize operations in a function to avoid initialization order issues
-static void init_fuse_operations() {
-    fuse3_ops.getattr = fuse3_getattr;
-    fuse3_ops.readdir = fuse3_readdir;
-    fuse3_ops.open = fuse3_open;
-    fuse3_ops.read = fuse3_read;
-    fuse3_ops.write = fuse3_write;
-    fuse3_ops.create = fuse3_create;
-    fuse3_ops.unlink = fuse3_unlink;
-    fuse3_ops.mkdir = fuse3_mkdir;
-    fuse3_ops.rmdir = fuse3_rmdir;
-    fuse3_ops.rename = fuse3_rename;
-    fuse3_ops.chmod = fuse3_chmod;
-    fuse3_ops.chown = fuse3_chown;
-    fuse3_ops.truncate = fuse3_truncate;
-    fuse3_ops.utimens = fuse3_utimens;
-    fuse3_ops.release = fuse3_release;
-    fuse3_ops.fsync = fuse3_fsync;
-    fuse3_ops.flush = fuse3_flush;
-    fuse3_ops.access = fuse3_access;
-    fuse3_ops.statfs = fuse3_statfs;
-}
-
-// Helper to get context from path
-FuseContext* GetContextFromPath(const char* path) {
-    std::lock_guard<std::mutex> lock(g_contexts_mutex);
-    
-    // For now, we'll use a simple approach - return the first context
-    // In a real implementation, you might want to match based on mount point
-    if (!g_contexts.empty()) {
-        return g_contexts.begin()->second.get();
+thread_local OpTimer* t_opTimer = nullptr;
+
+// What the flight recorder notes of an operation's arguments: the first
+// path, the handle and the size and offset of reads and writes
+static void NoteArg(OpTimer& timer, const char* path) {
+    if (!timer.note.path[0] && path) {
+        timer.note.SetPath(path);
     }
-    return nullptr;
+}
+static void NoteArg(OpTimer& timer, struct fuse_file_info* fi) {
+    if (fi) {
+        timer.note.fh = fi->fh;
+    }
+}
+static void NoteArg(OpTimer& timer, size_t size) {
+    timer.note.size = size;
+}
+static void NoteArg(OpTimer& timer, off_t offset) {
+    timer.note.offset = offset;
+}
+template<typename T>
+static void NoteArg(OpTimer&, T) {}
+
+// Wraps a high-level operation in an OpTimer. A positive result is the byte
+// count of a read or write; read_buf reports its own (CountBytes).
+template<StatOp Op, typename Fn, Fn fn>
+struct TimedOperation;
+
+template<StatOp Op, typename... Args, int (*fn)(Args...)>
+struct TimedOperation<Op, int (*)(Args...), fn> {
+    static int Call(Args... args) {
+        FuseContext* ctx = CurrentContext();
+        OpTimer timer;
+        timer.Begin(ctx ? ctx->stats.get() : nullptr, Op, ctx ? ctx->recorder.get() : nullptr);
+        if (timer.recorder) {
+            (NoteArg(timer, args), ...);
+        }
+        OpTimer* outer = t_opTimer;
+        t_opTimer = &timer;
+        int res = fn(args...);
+        t_opTimer = outer;
+        if (res < 0) {
+            timer.error = res;
+        } else if (res > 0) {
+            timer.bytes = res;
+        }
+        timer.End();
+        return res;
+    }
+};
+
+#define TIMED(op, fn) TimedOperation<StatOp::op, decltype(&fn), &fn>::Call
+
+// Shared by all high-level mounts; each one finds its context through
+// fuse_get_context()
+static const struct fuse_operations* HighLevelOperations() {
+    static const struct fuse_operations ops = [] {
+        struct fuse_operations o = {};
+        o.getattr = TIMED(Getattr, fuse3_getattr);
+        o.readdir = TIMED(Readdir, fuse3_readdir);
+        o.open = TIMED(Open, fuse3_open);
+        o.read = TIMED(Read, fuse3_read);
+        o.read_buf = TIMED(Read, fuse3_read_buf);
+        o.write_buf = TIMED(Write, fuse3_write_buf);
+        o.create = TIMED(Create, fuse3_create);
+        o.unlink = TIMED(Unlink, fuse3_unlink);
+        o.mkdir = TIMED(Mkdir, fuse3_mkdir);
+        o.rmdir = TIMED(Rmdir, fuse3_rmdir);
+        o.rename = TIMED(Rename, fuse3_rename);
+        o.chmod = TIMED(Chmod, fuse3_chmod);
+        o.chown = TIMED(Chown, fuse3_chown);
+        o.truncate = TIMED(Truncate, fuse3_truncate);
+        o.utimens = TIMED(Utimens, fuse3_utimens);
+        o.release = TIMED(Release, fuse3_release);
+        o.fsync = TIMED(Fsync, fuse3_fsync);
+        o.flush = TIMED(Flush, fuse3_flush);
+        o.access = TIMED(Access, fuse3_access);
+        o.statfs = TIMED(Statfs, fuse3_statfs);
+        o.init = fuse3_init;
+        return o;
+    }();
+    return &ops;
 }
 
 // JavaScript callback structure
@@ -106,28 +140,98 @@ public:
     ~Fuse3();
 
 private:
-    static Napi::FunctionReference constructor;
-    
     Napi::Value Mount(const Napi::CallbackInfo& info);
     Napi::Value Unmount(const Napi::CallbackInfo& info);
+    void MountEnded();
+    void Unmounted(Napi::Env env);
+    void MountFailed(const char* message);
     Napi::Value IsMounted(const Napi::CallbackInfo& info);
+    Napi::Value Invalidate(const Napi::CallbackInfo& info);
+    Napi::Value InvalidatePrefix(const Napi::CallbackInfo& info);
+    Napi::Value NotifyChange(const Napi::CallbackInfo& info);
+    Napi::Value NotifyEntry(const Napi::CallbackInfo& info);
+    Napi::Value NotifyDelete(const Napi::CallbackInfo& info);
+    Napi::Value Notify(const Napi::CallbackInfo& info, KernelNotifier::Kind kind);
+    Napi::Value GetNotifyStats(const Napi::CallbackInfo& info);
+    Napi::Value DumpTrace(const Napi::CallbackInfo& info);
+    Napi::Value GetFlightRecorderStats(const Napi::CallbackInfo& info);
+    Napi::Value GetContentCacheStats(const Napi::CallbackInfo& info);
+    Napi::Value GetDispatchStats(const Napi::CallbackInfo& info);
+    Napi::Value RemoveWorker(const Napi::CallbackInfo& info);
+    Napi::Value GetWorkerStats(const Napi::CallbackInfo& info);
+    Napi::Value GetConnectionInfo(const Napi::CallbackInfo& info);
+    Napi::Value PathOf(const Napi::CallbackInfo& info);
+    Napi::Value GetPathStats(const Napi::CallbackInfo& info);
+    Napi::Value GetProbeFilterStats(const Napi::CallbackInfo& info);
+    Napi::Value GetDeadlineStats(const Napi::CallbackInfo& info);
+    Napi::Value GetRequestSlotStats(const Napi::CallbackInfo& info);
+    Napi::Value SetPrewarmListener(const Napi::CallbackInfo& info);
+    Napi::Value GetPrewarmStats(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+    Napi::Value ResetStats(const Napi::CallbackInfo& info);
     
+    // Every mount has its own context, dispatcher and session threads. It
+    // lives as long as this object, which is kept alive while mounted.
     std::unique_ptr<FuseContext> context_;
+    bool started_ = false;  // an instance mounts once
+    std::thread unmounter_;  // joins the FUSE thread for unmount()
+    Napi::FunctionReference unmountCallback_;
+    std::string mountPoint_;
+    // Shared with the context so JS can invalidate before and after mounting
+    std::shared_ptr<AttrCache> attrCache_;
+    std::shared_ptr<ContentCache> contentCache_;
+    std::shared_ptr<Dispatcher> dispatcher_;
+    std::shared_ptr<WorkerPool> workers_;
+    std::shared_ptr<OpStats> stats_;
 };
 
-Napi::FunctionReference Fuse3::constructor;
+// Mounted file systems by mount point, so worker_threads can find the pool
+// they register with (registerWorker). Only used to register.
+static std::mutex g_poolsMutex;
+static std::unordered_map<std::string, std::weak_ptr<WorkerPool>> g_pools;
+
+static void ForgetPool(const std::string& mountPoint, const std::shared_ptr<WorkerPool>& pool) {
+    std::lock_guard<std::mutex> lock(g_poolsMutex);
+    auto it = g_pools.find(mountPoint);
+    if (it != g_pools.end() && it->second.lock() == pool) {
+        g_pools.erase(it);
+    }
+}
+
+static Napi::Value RegisterWorker(const Napi::CallbackInfo& info);
 
 Napi::Object Fuse3::Init(Napi::Env env, Napi::Object exports) {
     Napi::Function func = DefineClass(env, "Fuse3", {
         InstanceMethod("mount", &Fuse3::Mount),
         InstanceMethod("unmount", &Fuse3::Unmount),
         InstanceMethod("isMounted", &Fuse3::IsMounted),
+        InstanceMethod("invalidate", &Fuse3::Invalidate),
+        InstanceMethod("invalidatePrefix", &Fuse3::InvalidatePrefix),
+        InstanceMethod("notifyChange", &Fuse3::NotifyChange),
+        InstanceMethod("notifyEntry", &Fuse3::NotifyEntry),
+        InstanceMethod("notifyDelete", &Fuse3::NotifyDelete),
+        InstanceMethod("getNotifyStats", &Fuse3::GetNotifyStats),
+        InstanceMethod("dumpTrace", &Fuse3::DumpTrace),
+        InstanceMethod("getFlightRecorderStats", &Fuse3::GetFlightRecorderStats),
+        InstanceMethod("getContentCacheStats", &Fuse3::GetContentCacheStats),
+        InstanceMethod("getDispatchStats", &Fuse3::GetDispatchStats),
+        InstanceMethod("removeWorker", &Fuse3::RemoveWorker),
+        InstanceMethod("getWorkerStats", &Fuse3::GetWorkerStats),
+        InstanceMethod("getConnectionInfo", &Fuse3::GetConnectionInfo),
+        InstanceMethod("pathOf", &Fuse3::PathOf),
+        InstanceMethod("getPathStats", &Fuse3::GetPathStats),
+        InstanceMethod("getProbeFilterStats", &Fuse3::GetProbeFilterStats),
+        InstanceMethod("getDeadlineStats", &Fuse3::GetDeadlineStats),
+        InstanceMethod("getRequestSlotStats", &Fuse3::GetRequestSlotStats),
+        InstanceMethod("setPrewarmListener", &Fuse3::SetPrewarmListener),
+        InstanceMethod("getPrewarmStats", &Fuse3::GetPrewarmStats),
+        InstanceMethod("getStats", &Fuse3::GetStats),
+        InstanceMethod("resetStats", &Fuse3::ResetStats),
     });
 
-    constructor = Napi::Persistent(func);
-    constructor.SuppressDestruct();
-
+    // Also loaded by worker_threads, so nothing here may outlive one env
     exports.Set("Fuse3", func);
+    exports.Set("registerWorker", Napi::Function::New(env, RegisterWorker, "registerWorker"));
     
     // Export error constants
     exports.Set("EPERM", Napi::Number::New(env, -EPERM));
@@ -141,48 +245,624 @@ Napi::Object Fuse3::Init(Napi::Env env, Napi::Object exports) {
     exports.Set("ENOSPC", Napi::Number::New(env, -ENOSPC));
     exports.Set("EROFS", Napi::Number::New(env, -EROFS));
     exports.Set("EBUSY", Napi::Number::New(env, -EBUSY));
+    exports.Set("EINTR", Napi::Number::New(env, -EINTR));
+    exports.Set("ETIMEDOUT", Napi::Number::New(env, -ETIMEDOUT));
     exports.Set("ENOTEMPTY", Napi::Number::New(env, -ENOTEMPTY));
 
     return exports;
 }
 
+// Read an optional unsigned option, rejecting anything that is not an
+// integer from 0 to UINT_MAX. Uint32Value() would wrap or truncate the rest.
+static bool ReadUintOption(Napi::Env env, Napi::Object options, const char* name, unsigned int& out) {
+    if (!options.Has(name)) {
+        return true;
+    }
+    Napi::Value value = options.Get(name);
+    if (!value.IsNumber()) {
+        Napi::TypeError::New(env, std::string("Option '") + name + "' must be a non-negative integer")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    double number = value.As<Napi::Number>().DoubleValue();
+    if (!std::isfinite(number) || number != std::trunc(number) || number < 0 || number > UINT_MAX) {
+        Napi::RangeError::New(env, std::string("Option '") + name + "' must be an integer from 0 to " +
+                                       std::to_string(UINT_MAX))
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    out = static_cast<unsigned int>(number);
+    return true;
+}
+
+static bool ReadSecondsOption(Napi::Env env, Napi::Object options, const char* name, double& out) {
+    if (!options.Has(name)) {
+        return true;
+    }
+    Napi::Value value = options.Get(name);
+    if (!value.IsNumber() || value.As<Napi::Number>().DoubleValue() < 0) {
+        Napi::TypeError::New(env, std::string("Option '") + name + "' must be a non-negative number of seconds")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    out = value.As<Napi::Number>().DoubleValue();
+    return true;
+}
+
+static bool ParseLoopOptions(Napi::Env env, Napi::Object options, FuseLoopOptions& loop) {
+    if (options.Has("multithreaded")) {
+        loop.multithreaded = options.Get("multithreaded").ToBoolean().Value();
+    }
+    if (options.Has("clone_fd")) {
+        loop.cloneFd = options.Get("clone_fd").ToBoolean().Value();
+    }
+    if (!ReadUintOption(env, options, "max_threads", loop.maxThreads) ||
+        !ReadUintOption(env, options, "max_idle_threads", loop.maxIdleThreads)) {
+        return false;
+    }
+    if (loop.maxThreads == 0) {
+        Napi::RangeError::New(env, "Option 'max_threads' must be at least 1").ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+// Returns false with a pending exception on invalid input. enabled is left
+// untouched unless attr_cache is given.
+static bool ParseAttrCacheOptions(Napi::Env env, Napi::Object options, bool& enabled, AttrCache::Options& cache) {
+    if (options.Has("attr_cache")) {
+        enabled = options.Get("attr_cache").ToBoolean().Value();
+    }
+    unsigned int maxEntries = static_cast<unsigned int>(cache.maxEntries);
+    if (!ReadUintOption(env, options, "attr_cache_max_entries", maxEntries) ||
+        !ReadSecondsOption(env, options, "attr_cache_timeout", cache.ttl) ||
+        !ReadSecondsOption(env, options, "attr_cache_negative_timeout", cache.negativeTtl)) {
+        return false;
+    }
+    cache.maxEntries = maxEntries;
+    return true;
+}
+
+static bool ParseContentCacheOptions(Napi::Env env, Napi::Object options, bool& enabled, ContentCache::Options& cache) {
+    if (options.Has("content_cache")) {
+        enabled = options.Get("content_cache").ToBoolean().Value();
+    }
+    unsigned int sizeMb = static_cast<unsigned int>(cache.maxBytes >> 20);
+    if (!ReadUintOption(env, options, "content_cache_size_mb", sizeMb)) {
+        return false;
+    }
+    cache.maxBytes = static_cast<size_t>(sizeMb) << 20;
+    if (cache.maxBytes == 0) {
+        enabled = false;
+    }
+    return true;
+}
+
+static bool ParseWriteBufferOptions(Napi::Env env, Napi::Object options, bool& enabled, WriteBuffer::Options& buffer) {
+    if (options.Has("write_coalesce")) {
+        enabled = options.Get("write_coalesce").ToBoolean().Value();
+    }
+    unsigned int maxKb = static_cast<unsigned int>(buffer.maxBytes >> 10);
+    if (!ReadUintOption(env, options, "write_coalesce_max_kb", maxKb) ||
+        !ReadUintOption(env, options, "write_coalesce_delay_ms", buffer.maxDelayMs)) {
+        return false;
+    }
+    if (maxKb == 0) {
+        Napi::RangeError::New(env, "Option 'write_coalesce_max_kb' must be at least 1").ThrowAsJavaScriptException();
+        return false;
+    }
+    buffer.maxBytes = static_cast<size_t>(maxKb) << 10;
+    return true;
+}
+
+static bool ReadBoolOption(Napi::Env env, Napi::Object options, const char* name, bool& out) {
+    if (!options.Has(name)) {
+        return true;
+    }
+    Napi::Value value = options.Get(name);
+    if (!value.IsBoolean()) {
+        Napi::TypeError::New(env, std::string("Option '") + name + "' must be a boolean")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    out = value.As<Napi::Boolean>().Value();
+    return true;
+}
+
+// The kernel keeps its background limits in 16 bits and takes at most 256
+// pages per request by default (fs.fuse.max_pages_limit)
+static constexpr unsigned int kMaxBackground = 65535;
+static constexpr unsigned int kMaxPages = 256;
+
+static bool ParseConnOptions(Napi::Env env, Napi::Object options, FuseConnOptions& conn) {
+    bool syncRead = !conn.asyncRead;
+    unsigned int maxPages = 0;
+    if (!ReadSecondsOption(env, options, "entry_timeout", conn.entryTimeout) ||
+        !ReadSecondsOption(env, options, "attr_timeout", conn.attrTimeout) ||
+        !ReadSecondsOption(env, options, "negative_timeout", conn.negativeTimeout) ||
+        !ReadBoolOption(env, options, "kernel_cache", conn.kernelCache) ||
+        !ReadBoolOption(env, options, "auto_cache", conn.autoCache) ||
+        !ReadBoolOption(env, options, "sync_read", syncRead) ||
+        !ReadBoolOption(env, options, "parallel_dirops", conn.parallelDirops) ||
+        !ReadUintOption(env, options, "max_read", conn.maxRead) ||
+        !ReadUintOption(env, options, "max_write", conn.maxWrite) ||
+        !ReadUintOption(env, options, "max_pages", maxPages) ||
+        !ReadUintOption(env, options, "max_readahead", conn.maxReadahead) ||
+        !ReadUintOption(env, options, "max_background", conn.maxBackground) ||
+        !ReadUintOption(env, options, "congestion_threshold", conn.congestionThreshold)) {
+        return false;
+    }
+    // async_read wins over the older sync_read where both are given
+    conn.asyncRead = !syncRead;
+    if (!ReadBoolOption(env, options, "async_read", conn.asyncRead)) {
+        return false;
+    }
+
+    if (maxPages > kMaxPages) {
+        Napi::RangeError::New(env, "Option 'max_pages' must be at most " + std::to_string(kMaxPages))
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    if (conn.maxBackground > kMaxBackground || conn.congestionThreshold > kMaxBackground) {
+        Napi::RangeError::New(env, "Options 'max_background' and 'congestion_threshold' must be at most " +
+                              std::to_string(kMaxBackground)).ThrowAsJavaScriptException();
+        return false;
+    }
+    if (conn.maxBackground > 0 && conn.congestionThreshold > conn.maxBackground) {
+        Napi::RangeError::New(env, "Option 'congestion_threshold' must not exceed 'max_background'")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    // libfuse derives the kernel's max_pages from max_write
+    if (conn.maxWrite == 0 && maxPages > 0) {
+        conn.maxWrite = maxPages * static_cast<unsigned int>(sysconf(_SC_PAGESIZE));
+    }
+    return true;
+}
+
+static bool ParsePathTableOptions(Napi::Env env, Napi::Object options, bool& enabled, PathTable::Options& paths) {
+    if (options.Has("path_cache")) {
+        enabled = options.Get("path_cache").ToBoolean().Value();
+    }
+    if (options.Has("path_ids")) {
+        paths.ids = options.Get("path_ids").ToBoolean().Value();
+    }
+    unsigned int maxEntries = static_cast<unsigned int>(paths.maxEntries);
+    if (!ReadUintOption(env, options, "path_cache_max_entries", maxEntries)) {
+        return false;
+    }
+    if (maxEntries == 0) {
+        Napi::RangeError::New(env, "Option 'path_cache_max_entries' must be at least 1").ThrowAsJavaScriptException();
+        return false;
+    }
+    paths.maxEntries = maxEntries;
+    // IDs only exist in the table
+    enabled = enabled || paths.ids;
+    return true;
+}
+
+static bool ParseReadaheadOptions(Napi::Env env, Napi::Object options, bool& enabled, Readahead::Options& readahead) {
+    if (options.Has("readahead")) {
+        enabled = options.Get("readahead").ToBoolean().Value();
+    }
+    unsigned int minKb = static_cast<unsigned int>(readahead.minWindow >> 10);
+    unsigned int maxKb = static_cast<unsigned int>(readahead.maxWindow >> 10);
+    unsigned int totalMb = static_cast<unsigned int>(readahead.maxTotal >> 20);
+    if (!ReadUintOption(env, options, "readahead_min_kb", minKb) ||
+        !ReadUintOption(env, options, "readahead_max_kb", maxKb) ||
+        !ReadUintOption(env, options, "readahead_total_mb", totalMb)) {
+        return false;
+    }
+    if (minKb == 0 || maxKb < minKb) {
+        Napi::RangeError::New(env, "Options 'readahead_min_kb' and 'readahead_max_kb' must satisfy 1 <= min <= max")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    readahead.minWindow = static_cast<size_t>(minKb) << 10;
+    readahead.maxWindow = static_cast<size_t>(maxKb) << 10;
+    readahead.maxTotal = static_cast<size_t>(totalMb) << 20;
+    if (readahead.maxTotal == 0) {
+        enabled = false;
+    }
+    return true;
+}
+
+static bool ParseProbeFilterOptions(Napi::Env env, Napi::Object options, bool& enabled, ProbeFilter::Options& filter) {
+    if (!ReadBoolOption(env, options, "probe_filter", enabled) ||
+        !ReadUintOption(env, options, "probe_filter_learn", filter.learnThreshold) ||
+        !ReadSecondsOption(env, options, "probe_filter_ttl", filter.ttl) ||
+        !ReadSecondsOption(env, options, "probe_filter_negative_timeout", filter.negativeTimeout)) {
+        return false;
+    }
+    if (!options.Has("probe_filter_rules")) {
+        return true;
+    }
+    Napi::Value value = options.Get("probe_filter_rules");
+    bool valid = value.IsArray();
+    std::vector<std::string> rules;
+    if (valid) {
+        Napi::Array array = value.As<Napi::Array>();
+        for (uint32_t i = 0; valid && i < array.Length(); i++) {
+            Napi::Value rule = array.Get(i);
+            valid = rule.IsString();
+            if (valid) {
+                rules.push_back(rule.As<Napi::String>().Utf8Value());
+            }
+        }
+    }
+    if (!valid) {
+        Napi::TypeError::New(env, "Option 'probe_filter_rules' must be an array of strings")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    filter.rules = std::move(rules);
+    return true;
+}
+
+// request_slots: how many requests may wait on JS in slots, 0 for none
+// (handlers get a callback per request then)
+static bool ParseRequestSlotOptions(Napi::Env env, Napi::Object options, RequestSlots::Options& slots) {
+    unsigned int size = 0;
+    if (!ReadUintOption(env, options, "request_slots", size)) {
+        return false;
+    }
+    if (size > RequestSlots::kMaxSize) {
+        Napi::RangeError::New(env, "Option 'request_slots' must be at most " + std::to_string(RequestSlots::kMaxSize))
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    slots.size = size;
+    if (options.Has("request_slots_exhausted")) {
+        Napi::Value value = options.Get("request_slots_exhausted");
+        std::string mode = value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+        if (mode == "callback") {
+            slots.exhausted = RequestSlots::Exhausted::Callback;
+        } else if (mode == "fail") {
+            slots.exhausted = RequestSlots::Exhausted::Fail;
+        } else {
+            Napi::TypeError::New(env, "Option 'request_slots_exhausted' must be 'callback' or 'fail'")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+    return true;
+}
+
+// prewarm_paths are absolute paths below the mount point
+static bool ParsePrewarmOptions(Napi::Env env, Napi::Object options, bool& enabled, Prewarmer::Options& prewarm) {
+    unsigned int entries = static_cast<unsigned int>(prewarm.maxEntries);
+    if (!ReadBoolOption(env, options, "prewarm", enabled) ||
+        !ReadUintOption(env, options, "prewarm_depth", prewarm.maxDepth) ||
+        !ReadUintOption(env, options, "prewarm_entries", entries) ||
+        !ReadUintOption(env, options, "prewarm_rate", prewarm.rate)) {
+        return false;
+    }
+    prewarm.maxEntries = entries;
+    if (!options.Has("prewarm_paths")) {
+        return true;
+    }
+    Napi::Value value = options.Get("prewarm_paths");
+    bool valid = value.IsArray();
+    std::vector<std::string> roots;
+    if (valid) {
+        Napi::Array array = value.As<Napi::Array>();
+        for (uint32_t i = 0; valid && i < array.Length(); i++) {
+            Napi::Value root = array.Get(i);
+            valid = root.IsString();
+            if (valid) {
+                roots.push_back(root.As<Napi::String>().Utf8Value());
+                valid = roots.back().size() > 0 && roots.back()[0] == '/';
+            }
+        }
+    }
+    if (!valid) {
+        Napi::TypeError::New(env, "Option 'prewarm_paths' must be an array of absolute paths")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    prewarm.roots = std::move(roots);
+    return true;
+}
+
+static Napi::Object PrewarmProgressToJs(Napi::Env env, const Prewarmer::Progress& progress) {
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("directories", Napi::Number::New(env, static_cast<double>(progress.directories)));
+    stats.Set("entries", Napi::Number::New(env, static_cast<double>(progress.entries)));
+    stats.Set("stats", Napi::Number::New(env, static_cast<double>(progress.stats)));
+    stats.Set("errors", Napi::Number::New(env, static_cast<double>(progress.errors)));
+    stats.Set("pending", Napi::Number::New(env, static_cast<double>(progress.pending)));
+    stats.Set("depth", Napi::Number::New(env, progress.depth));
+    stats.Set("elapsed", Napi::Number::New(env, progress.elapsed));
+    stats.Set("done", Napi::Boolean::New(env, progress.done));
+    return stats;
+}
+
+// <lane>_weight and <lane>_in_flight for the lanes of the dispatchers
+static const char* const kLaneNames[Dispatcher::kLanes] = {"metadata", "data", "background"};
+
+static bool ParseDispatchOptions(Napi::Env env, Napi::Object options, Dispatcher::Options& dispatch) {
+    if (options.Has("batch_dispatch")) {
+        dispatch.batching = options.Get("batch_dispatch").ToBoolean().Value();
+    }
+    for (size_t lane = 0; lane < Dispatcher::kLanes; lane++) {
+        std::string weight = std::string(kLaneNames[lane]) + "_weight";
+        std::string inFlight = std::string(kLaneNames[lane]) + "_in_flight";
+        if (!ReadUintOption(env, options, weight.c_str(), dispatch.lanes[lane].weight) ||
+            !ReadUintOption(env, options, inFlight.c_str(), dispatch.lanes[lane].inFlight)) {
+            return false;
+        }
+        if (dispatch.lanes[lane].weight == 0) {
+            Napi::RangeError::New(env, "Option '" + weight + "' must be at least 1").ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool ParseFlightRecorderOptions(Napi::Env env, Napi::Object options, bool& enabled,
+                                       FlightRecorder::Options& recorder) {
+    unsigned int entries = static_cast<unsigned int>(recorder.entries);
+    unsigned int triggerMs = 0;
+    if (!ReadBoolOption(env, options, "flight_recorder", enabled) ||
+        !ReadUintOption(env, options, "flight_recorder_entries", entries) ||
+        !ReadUintOption(env, options, "flight_recorder_trigger_ms", triggerMs) ||
+        !ReadSecondsOption(env, options, "flight_recorder_cooldown", recorder.cooldown)) {
+        return false;
+    }
+    recorder.entries = entries;
+    recorder.triggerMs = triggerMs;
+    if (options.Has("flight_recorder_dir")) {
+        Napi::Value dir = options.Get("flight_recorder_dir");
+        if (!dir.IsString()) {
+            Napi::TypeError::New(env, "Option 'flight_recorder_dir' must be a string").ThrowAsJavaScriptException();
+            return false;
+        }
+        recorder.dir = dir.As<Napi::String>().Utf8Value();
+    }
+    return true;
+}
+
+// op_timeout sets every operation, op_timeouts single ones by their name in
+// getStats(), e.g. { read: 30, lookup: 2 }
+static bool ParseDeadlineOptions(Napi::Env env, Napi::Object options, FuseDeadlineOptions& deadlines) {
+    double timeout = 0;
+    if (!ReadSecondsOption(env, options, "op_timeout", timeout) ||
+        !ReadBoolOption(env, options, "interrupts", deadlines.interrupts)) {
+        return false;
+    }
+    std::fill(std::begin(deadlines.timeouts), std::end(deadlines.timeouts), timeout);
+
+    if (options.Has("op_timeouts")) {
+        Napi::Value value = options.Get("op_timeouts");
+        if (!value.IsObject()) {
+            Napi::TypeError::New(env, "Option 'op_timeouts' must be an object").ThrowAsJavaScriptException();
+            return false;
+        }
+        Napi::Object perOp = value.As<Napi::Object>();
+        Napi::Array names = perOp.GetPropertyNames();
+        for (uint32_t i = 0; i < names.Length(); i++) {
+            std::string name = names.Get(i).ToString().Utf8Value();
+            size_t op = 0;
+            while (op < static_cast<size_t>(StatOp::Count) && name != StatOpName(static_cast<StatOp>(op))) {
+                op++;
+            }
+            if (op == static_cast<size_t>(StatOp::Count)) {
+                Napi::TypeError::New(env, "Option 'op_timeouts' has no operation '" + name + "'")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+            if (!ReadSecondsOption(env, perOp, name.c_str(), deadlines.timeouts[op])) {
+                return false;
+            }
+        }
+    }
+
+    // Either sign, so the exported (negative) constants work
+    if (options.Has("op_timeout_errno")) {
+        Napi::Value value = options.Get("op_timeout_errno");
+        int err = value.IsNumber() ? value.As<Napi::Number>().Int32Value() : 0;
+        err = err > 0 ? -err : err;
+        if (err == 0 || err < -4095) {
+            Napi::RangeError::New(env, "Option 'op_timeout_errno' must be an errno such as ETIMEDOUT")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+        deadlines.timeoutErr = err;
+    }
+    return true;
+}
+
 Fuse3::Fuse3(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Fuse3>(info) {
     Napi::Env env = info.Env();
     
     if (info.Length() < 2 || !info[0].IsString() || !info[1].IsObject()) {
-        Napi::TypeError::New(env, "Arguments: (mountPoint: string, operations: object)")
+        Napi::TypeError::New(env, "Arguments: (mountPoint: string, operations: object, options?: object)")
             .ThrowAsJavaScriptException();
         return;
     }
     
     context_ = std::make_unique<FuseContext>();
-    context_->mountPoint = info[0].As<Napi::String>().Utf8Value();
+    bool attrCacheEnabled = true;
+    AttrCache::Options attrCacheOptions;
+    bool contentCacheEnabled = true;
+    ContentCache::Options contentCacheOptions;
+    bool writeBufferEnabled = false;
+    WriteBuffer::Options writeBufferOptions;
+    bool readaheadEnabled = true;
+    Readahead::Options readaheadOptions;
+    bool pathTableEnabled = true;
+    PathTable::Options pathTableOptions;
+    bool probeFilterEnabled = false;
+    ProbeFilter::Options probeFilterOptions;
+    bool flightRecorderEnabled = false;
+    FlightRecorder::Options flightRecorderOptions;
+    RequestSlots::Options requestSlotOptions;
+    requestSlotOptions.size = 0;
+    bool prewarmEnabled = false;
+    Prewarmer::Options prewarmOptions;
+    Dispatcher::Options dispatchOptions;
+    bool opStats = true;
+    if (info.Length() > 2 && info[2].IsObject()) {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (!ParseLoopOptions(env, options, context_->loop) ||
+            !ParseConnOptions(env, options, context_->conn) ||
+            !ParseAttrCacheOptions(env, options, attrCacheEnabled, attrCacheOptions) ||
+            !ParseContentCacheOptions(env, options, contentCacheEnabled, contentCacheOptions) ||
+            !ParseWriteBufferOptions(env, options, writeBufferEnabled, writeBufferOptions) ||
+            !ParseReadaheadOptions(env, options, readaheadEnabled, readaheadOptions) ||
+            !ParsePathTableOptions(env, options, pathTableEnabled, pathTableOptions) ||
+            !ParseProbeFilterOptions(env, options, probeFilterEnabled, probeFilterOptions) ||
+            !ParseDeadlineOptions(env, options, context_->deadlines) ||
+            !ParseFlightRecorderOptions(env, options, flightRecorderEnabled, flightRecorderOptions) ||
+            !ParseRequestSlotOptions(env, options, requestSlotOptions) ||
+            !ParsePrewarmOptions(env, options, prewarmEnabled, prewarmOptions) ||
+            !ParseDispatchOptions(env, options, dispatchOptions)) {
+            return;
+        }
+        if (options.Has("zero_copy_read")) {
+            context_->zeroCopyRead = options.Get("zero_copy_read").ToBoolean().Value();
+        }
+        if (options.Has("splice_read")) {
+            context_->spliceRead = options.Get("splice_read").ToBoolean().Value();
+        }
+        if (options.Has("passthrough")) {
+            context_->passthrough = options.Get("passthrough").ToBoolean().Value();
+        }
+        if (options.Has("writeback_cache")) {
+            context_->writebackCache = options.Get("writeback_cache").ToBoolean().Value();
+        }
+        if (options.Has("low_level")) {
+            context_->lowLevel = options.Get("low_level").ToBoolean().Value();
+        }
+        if (options.Has("op_stats")) {
+            opStats = options.Get("op_stats").ToBoolean().Value();
+        }
+    }
+    if (opStats) {
+        stats_ = std::make_shared<OpStats>();
+    }
+    context_->stats = stats_;
+    if (flightRecorderEnabled) {
+        context_->recorder = std::make_shared<FlightRecorder>(flightRecorderOptions,
+                                                              info[0].As<Napi::String>().Utf8Value());
+    }
+    if (requestSlotOptions.size > 0) {
+        context_->requestSlots = std::make_shared<RequestSlots>(requestSlotOptions);
+    }
+    dispatcher_ = std::make_shared<Dispatcher>(dispatchOptions);
+    context_->dispatcher = dispatcher_;
+    if (attrCacheEnabled) {
+        attrCache_ = std::make_shared<AttrCache>(attrCacheOptions);
+    }
+    context_->attrCache = attrCache_;
+    if (contentCacheEnabled) {
+        contentCache_ = std::make_shared<ContentCache>(contentCacheOptions);
+    }
+    context_->contentCache = contentCache_;
+    if (writeBufferEnabled) {
+        context_->writeBuffer = NewWriteBuffer(context_.get(), writeBufferOptions);
+    }
+    if (readaheadEnabled) {
+        context_->readahead = NewReadahead(context_.get(), readaheadOptions);
+    }
+    if (pathTableEnabled) {
+        context_->paths = std::make_shared<PathTable>(pathTableOptions);
+    }
+    if (probeFilterEnabled) {
+        context_->probeFilter = std::make_shared<ProbeFilter>(probeFilterOptions);
+    }
+    workers_ = std::make_shared<WorkerPool>(dispatcher_, pathTableEnabled ? &pathTableOptions : nullptr);
+    context_->workers = workers_;
+    FuseContext* ctx = context_.get();
+    context_->notifier = std::make_shared<KernelNotifier>([ctx](KernelNotifier::Kind kind, const std::string& path) {
+        if (ctx->lowLevel) {
+            return LowLevelNotify(ctx, kind, path);
+        }
+        // Drops both the dentry and the inode's caches, whatever the kind
+        return fuse_invalidate_path(ctx->fuse, path.c_str());
+    }, stats_);
+    if (prewarmEnabled) {
+        // Progress goes to the listener on the creating thread; the last
+        // report lets it go
+        context_->prewarmer = NewPrewarmer(ctx, prewarmOptions, [ctx](const Prewarmer::Progress& progress) {
+            ctx->dispatcher->Post([ctx, progress](Napi::Env env) {
+                if (ctx->prewarmListener.IsEmpty()) {
+                    return;
+                }
+                ctx->prewarmListener.Call({PrewarmProgressToJs(env, progress)});
+                if (env.IsExceptionPending()) {
+                    env.GetAndClearPendingException();
+                }
+                if (progress.done) {
+                    ctx->prewarmListener.Reset();
+                }
+            });
+        });
+    }
+    mountPoint_ = info[0].As<Napi::String>().Utf8Value();
+    context_->mountPoint = mountPoint_;
     context_->operations = Napi::Persistent(info[1].As<Napi::Object>());
     context_->mounted = false;
     context_->fuse = nullptr;
     context_->fuseThread = nullptr;
 }
 
+// Only runs once unmounted or a failed mount was cleaned up: Mount() holds a
+// reference until then
 Fuse3::~Fuse3() {
-    if (context_ && context_->mounted) {
-        // Clean unmount on destruction
-        if (context_->fuse) {
-            fuse_exit(context_->fuse);
-        }
-        if (context_->fuseThread) {
+    if (workers_) {
+        ForgetPool(mountPoint_, workers_);
+        workers_->RemoveAll();
+    }
+    if (unmounter_.joinable()) {
+        unmounter_.join();
+    }
+    if (context_ && context_->fuseThread) {
+        if (context_->fuseThread->joinable()) {
             context_->fuseThread->join();
-            delete context_->fuseThread;
         }
+        delete context_->fuseThread;
     }
+    // Frees what the handlers of this thread never answered
+    if (dispatcher_) {
+        dispatcher_->Close();
+    }
+}
+
+// Run the session loop until fuse_exit() or unmount. In multithreaded mode
+// every kernel request gets its own worker, so a slow read no longer holds
+// up getattr calls queued behind it.
+static int RunFuseLoop(FuseContext* ctx) {
+    if (!ctx->loop.multithreaded) {
+        return ctx->session ? fuse_session_loop(ctx->session) : fuse_loop(ctx->fuse);
+    }
+
+#if FUSE_USE_VERSION >= FUSE_MAKE_VERSION(3, 12)
+    struct fuse_loop_config *config = fuse_loop_cfg_create();
+    fuse_loop_cfg_set_clone_fd(config, ctx->loop.cloneFd ? 1 : 0);
+    fuse_loop_cfg_set_max_threads(config, ctx->loop.maxThreads);
+    fuse_loop_cfg_set_idle_threads(config, ctx->loop.maxIdleThreads);
+    int res = ctx->session ? fuse_session_loop_mt(ctx->session, config) : fuse_loop_mt(ctx->fuse, config);
+    fuse_loop_cfg_destroy(config);
+    return res;
+#else
+    // Older libfuse spawns workers on demand without an upper bound, so
+    // max_threads cannot be enforced here.
+    struct fuse_loop_config config = {};
+    config.clone_fd = ctx->loop.cloneFd ? 1 : 0;
+    config.max_idle_threads = ctx->loop.maxIdleThreads;
+    return ctx->session ? fuse_session_loop_mt(ctx->session, &config) : fuse_loop_mt(ctx->fuse, &config);
+#endif
 }
 
 Napi::Value Fuse3::Mount(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     
-    if (context_->mounted) {
+    if (!context_ || started_) {
         Napi::Error::New(env, "Already mounted").ThrowAsJavaScriptException();
         return env.Undefined();
     }
+    started_ = true;
     
     // Create thread-safe function for callbacks
     context_->tsfn = Napi::ThreadSafeFunction::New(
@@ -192,65 +872,90 @@ Napi::Value Fuse3::Mount(const Napi::CallbackInfo& info) {
         0,                              // Unlimited queue
         1                               // One thread
     );
-    
-    // Store context in global map
+    context_->dispatcher->Start(context_->tsfn, &context_->operations, context_->paths.get());
     {
-        std::lock_guard<std::mutex> lock(g_contexts_mutex);
-        g_contexts[context_->mountPoint] = std::move(context_);
+        std::lock_guard<std::mutex> lock(g_poolsMutex);
+        g_pools[mountPoint_] = workers_;
     }
     
-    // Get context back from map
-    FuseContext* ctx = nullptr;
-    {
-        std::lock_guard<std::mutex> lock(g_contexts_mutex);
-        ctx = g_contexts[context_->mountPoint].get();
-    }
+    // The FUSE threads use the context until Unmount() joined them
+    Ref();
+    FuseContext* ctx = context_.get();
     
     // Create FUSE thread
-    ctx->fuseThread = new std::thread([ctx]() {
-        // Initialize FUSE operations
-        init_fuse_operations();
+    ctx->fuseThread = new std::thread([this, ctx]() {
+        if (ctx->lowLevel) {
+            if (!LowLevelMount(ctx)) {
+                MountFailed("Failed to mount FUSE filesystem");
+                return;
+            }
+            ctx->mounted = true;
+            ctx->notifier->Start();
+            ctx->tsfn.BlockingCall([](Napi::Env env, Napi::Function callback) {
+                callback.Call({env.Null()});
+            });
+            if (ctx->prewarmer) {
+                ctx->prewarmer->Start();
+            }
+            RunFuseLoop(ctx);
+            if (ctx->prewarmer) {
+                ctx->prewarmer->Stop();
+            }
+            LowLevelUnmount(ctx);
+            ctx->mounted = false;
+            return;
+        }
         
-        // FUSE arguments
+        // FUSE arguments. We always run in the foreground of this thread and
+        // pick the loop flavour below, so -f/-s are not needed here.
         struct fuse_args args = FUSE_ARGS_INIT(0, nullptr);
         fuse_opt_add_arg(&args, "fuse3_napi");
-        fuse_opt_add_arg(&args, ctx->mountPoint.c_str());
-        fuse_opt_add_arg(&args, "-f"); // Foreground operation
-        fuse_opt_add_arg(&args, "-s"); // Single-threaded
+        AddMountOptions(ctx, &args);
         
         // Create FUSE instance
-        ctx->fuse = fuse_new(&args, &fuse3_ops, sizeof(fuse3_ops), nullptr);
+        ctx->fuse = fuse_new(&args, HighLevelOperations(), sizeof(struct fuse_operations), ctx);
         if (!ctx->fuse) {
-            ctx->tsfn.BlockingCall([](Napi::Env env, Napi::Function callback) {
-                callback.Call({Napi::String::New(env, "Failed to create FUSE instance")});
-            });
             fuse_opt_free_args(&args);
+            MountFailed("Failed to create FUSE instance");
             return;
         }
         
         // Mount
         if (fuse_mount(ctx->fuse, ctx->mountPoint.c_str()) != 0) {
-            ctx->tsfn.BlockingCall([](Napi::Env env, Napi::Function callback) {
-                callback.Call({Napi::String::New(env, "Failed to mount FUSE filesystem")});
-            });
             fuse_destroy(ctx->fuse);
+            ctx->fuse = nullptr;
             fuse_opt_free_args(&args);
+            MountFailed("Failed to mount FUSE filesystem");
             return;
         }
         
         ctx->mounted = true;
+        ctx->notifier->Start();
         
         // Notify mount success
         ctx->tsfn.BlockingCall([](Napi::Env env, Napi::Function callback) {
             callback.Call({env.Null()});
         });
         
+        if (ctx->prewarmer) {
+            ctx->prewarmer->Start();
+        }
+        
         // Run FUSE main loop
-        fuse_loop(ctx->fuse);
+        RunFuseLoop(ctx);
+        if (ctx->prewarmer) {
+            ctx->prewarmer->Stop();
+        }
         
-        // Cleanup
-        fuse_unmount(ctx->fuse);
-        fuse_destroy(ctx->fuse);
+        // Cleanup. The unmount also ends notifications waiting for requests
+        // nobody answers anymore.
+        {
+            std::lock_guard<std::mutex> lock(ctx->unmountMutex);
+            fuse_unmount(ctx->fuse);
+            ctx->notifier->Stop();
+            fuse_destroy(ctx->fuse);
+            ctx->fuse = nullptr;
+        }
         fuse_opt_free_args(&args);
         
         ctx->mounted = false;
@@ -262,57 +967,611 @@ Napi::Value Fuse3::Mount(const Napi::CallbackInfo& info) {
 Napi::Value Fuse3::Unmount(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     
-    FuseContext* ctx = nullptr;
-    {
-        std::lock_guard<std::mutex> lock(g_contexts_mutex);
-        auto it = g_contexts.find(context_->mountPoint);
-        if (it != g_contexts.end()) {
-            ctx = it->second.get();
-        }
-    }
-    
-    if (!ctx || !ctx->mounted) {
+    FuseContext* ctx = context_.get();
+    if (!ctx || !ctx->mounted || unmounter_.joinable()) {
         Napi::Error::New(env, "Not mounted").ThrowAsJavaScriptException();
         return env.Undefined();
     }
-    
-    // Signal FUSE to exit
-    if (ctx->fuse) {
-        fuse_exit(ctx->fuse);
+    if (info.Length() > 0 && info[0].IsFunction()) {
+        unmountCallback_ = Napi::Persistent(info[0].As<Napi::Function>());
     }
     
-    // Wait for thread to finish
-    if (ctx->fuseThread) {
+    // The FUSE thread is not joined here: its workers may be waiting for
+    // this thread to answer them, and the loop blocks in read() until the
+    // kernel sends something. The exit flag alone waits for that; the kernel
+    // unmount wakes the loop right away.
+    unmounter_ = std::thread([this, ctx]() {
+        {
+            std::lock_guard<std::mutex> lock(ctx->unmountMutex);
+            if (ctx->session) {
+                fuse_session_exit(ctx->session);
+                fuse_session_unmount(ctx->session);
+            } else if (ctx->fuse) {
+                fuse_exit(ctx->fuse);
+                fuse_unmount(ctx->fuse);
+            }
+        }
         ctx->fuseThread->join();
+        ctx->tsfn.BlockingCall([this](Napi::Env env, Napi::Function) {
+            Unmounted(env);
+        });
+    });
+    
+    return env.Undefined();
+}
+
+// The FUSE thread of unmount() has returned (JS thread)
+void Fuse3::Unmounted(Napi::Env env) {
+    unmounter_.join();
+    MountEnded();
+    if (!unmountCallback_.IsEmpty()) {
+        Napi::FunctionReference callback = std::move(unmountCallback_);
+        callback.Call({env.Null()});
+    }
+}
+
+// Undoes Mount() once the FUSE thread is done or about to return (JS thread)
+void Fuse3::MountEnded() {
+    FuseContext* ctx = context_.get();
+    // Wait for thread to finish, unless unmount() already did
+    if (ctx->fuseThread) {
+        if (ctx->fuseThread->joinable()) {
+            ctx->fuseThread->join();
+        }
         delete ctx->fuseThread;
         ctx->fuseThread = nullptr;
     }
+    // Lets registered workers exit
+    ForgetPool(mountPoint_, workers_);
+    workers_->RemoveAll();
+    ctx->prewarmListener.Reset();
+    Unref();
+}
+
+// Runs on the FUSE thread right before it returns without a mount. The JS
+// thread cleans up before the mount callback hears of the error, so the
+// mount point is free again when it does.
+void Fuse3::MountFailed(const char* message) {
+    context_->tsfn.BlockingCall([this, message](Napi::Env env, Napi::Function callback) {
+        MountEnded();
+        callback.Call({Napi::String::New(env, message)});
+    });
+}
+
+Napi::Value Fuse3::IsMounted(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
     
-    // Remove from global map
-    {
-        std::lock_guard<std::mutex> lock(g_contexts_mutex);
-        g_contexts.erase(context_->mountPoint);
+    return Napi::Boolean::New(env, context_ && context_->mounted);
+}
+
+// invalidate(path): drop the cached attributes of a single path
+Napi::Value Fuse3::Invalidate(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Arguments: (path: string)").ThrowAsJavaScriptException();
+        return env.Undefined();
     }
     
+    std::string path = info[0].As<Napi::String>().Utf8Value();
+    if (attrCache_) {
+        attrCache_->Invalidate(path);
+    }
+    // The path may have been created behind our back
+    if (context_->probeFilter) {
+        context_->probeFilter->Exists(path);
+    }
     return env.Undefined();
 }
 
-Napi::Value Fuse3::IsMounted(const Napi::CallbackInfo& info) {
+// invalidatePrefix(path): drop path and everything below it
+Napi::Value Fuse3::InvalidatePrefix(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     
-    std::lock_guard<std::mutex> lock(g_contexts_mutex);
-    auto it = g_contexts.find(context_->mountPoint);
-    if (it != g_contexts.end() && it->second->mounted) {
-        return Napi::Boolean::New(env, true);
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Arguments: (path: string)").ThrowAsJavaScriptException();
+        return env.Undefined();
     }
     
-    return Napi::Boolean::New(env, false);
+    std::string path = info[0].As<Napi::String>().Utf8Value();
+    if (attrCache_) {
+        attrCache_->InvalidatePrefix(path);
+    }
+    if (context_->probeFilter) {
+        context_->probeFilter->Exists(path);
+        context_->probeFilter->ForgetBelow(path);
+    }
+    return env.Undefined();
+}
+
+// notifyChange/notifyEntry/notifyDelete(path | path[]): tell the kernel a
+// path changed behind the mount. The addon's own caches are dropped right
+// away; the kernel is notified from another thread. Returns false when not
+// mounted.
+Napi::Value Fuse3::Notify(const Napi::CallbackInfo& info, KernelNotifier::Kind kind) {
+    Napi::Env env = info.Env();
+
+    std::vector<std::string> paths;
+    bool valid = info.Length() > 0 && (info[0].IsString() || info[0].IsArray());
+    if (valid && info[0].IsString()) {
+        paths.push_back(info[0].As<Napi::String>().Utf8Value());
+    } else if (valid) {
+        Napi::Array array = info[0].As<Napi::Array>();
+        for (uint32_t i = 0; valid && i < array.Length(); i++) {
+            Napi::Value path = array.Get(i);
+            valid = path.IsString();
+            if (valid) {
+                paths.push_back(path.As<Napi::String>().Utf8Value());
+            }
+        }
+    }
+    if (!valid) {
+        Napi::TypeError::New(env, "Arguments: (path: string | string[])").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    FuseContext* ctx = context_.get();
+    bool queued = true;
+    for (const std::string& path : paths) {
+        if (kind == KernelNotifier::Delete) {
+            InvalidateAttrTree(ctx, path.c_str());
+        } else {
+            InvalidateAttrs(ctx, path.c_str(), kind == KernelNotifier::Entry);
+        }
+        queued = ctx->mounted && ctx->notifier->Push(kind, path) && queued;
+    }
+    return Napi::Boolean::New(env, queued);
+}
+
+// Attributes or data of the path changed
+Napi::Value Fuse3::NotifyChange(const Napi::CallbackInfo& info) {
+    return Notify(info, KernelNotifier::Change);
+}
+
+// The name was created or now refers to another file
+Napi::Value Fuse3::NotifyEntry(const Napi::CallbackInfo& info) {
+    return Notify(info, KernelNotifier::Entry);
+}
+
+// The name is gone
+Napi::Value Fuse3::NotifyDelete(const Napi::CallbackInfo& info) {
+    return Notify(info, KernelNotifier::Delete);
+}
+
+// getNotifyStats(): kernel notifications queued and sent. How long they took
+// is in getStats() as the notify operation.
+Napi::Value Fuse3::GetNotifyStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    KernelNotifier::Counters counters = context_->notifier->GetCounters();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("queued", Napi::Number::New(env, static_cast<double>(counters.queued)));
+    stats.Set("merged", Napi::Number::New(env, static_cast<double>(counters.merged)));
+    stats.Set("sent", Napi::Number::New(env, static_cast<double>(counters.sent)));
+    stats.Set("uncached", Napi::Number::New(env, static_cast<double>(counters.uncached)));
+    stats.Set("failed", Napi::Number::New(env, static_cast<double>(counters.failed)));
+    stats.Set("batches", Napi::Number::New(env, static_cast<double>(counters.batches)));
+    stats.Set("pending", Napi::Number::New(env, static_cast<double>(counters.pending)));
+    return stats;
+}
+
+// dumpTrace(): the requests the flight recorder holds as Chrome trace JSON,
+// or null when it is off
+Napi::Value Fuse3::DumpTrace(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!context_->recorder) {
+        return env.Null();
+    }
+    return Napi::String::New(env, context_->recorder->Dump());
+}
+
+// getFlightRecorderStats(): requests recorded, threads recording and dumps
+// written on a trigger; null when the recorder is off
+Napi::Value Fuse3::GetFlightRecorderStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!context_->recorder) {
+        return env.Null();
+    }
+    FlightRecorder::Counters counters = context_->recorder->GetCounters();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("recorded", Napi::Number::New(env, static_cast<double>(counters.recorded)));
+    stats.Set("threads", Napi::Number::New(env, static_cast<double>(counters.threads)));
+    stats.Set("dumps", Napi::Number::New(env, static_cast<double>(counters.dumps)));
+    stats.Set("lastDump", counters.lastDump.empty() ? env.Null() : Napi::String::New(env, counters.lastDump));
+    return stats;
+}
+
+// getContentCacheStats(): counters of the content cache, or null when it is
+// disabled
+Napi::Value Fuse3::GetContentCacheStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!contentCache_) {
+        return env.Null();
+    }
+
+    ContentCache::Counters counters = contentCache_->GetCounters();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("hits", Napi::Number::New(env, static_cast<double>(counters.hits)));
+    stats.Set("misses", Napi::Number::New(env, static_cast<double>(counters.misses)));
+    stats.Set("evictions", Napi::Number::New(env, static_cast<double>(counters.evictions)));
+    stats.Set("entries", Napi::Number::New(env, static_cast<double>(counters.entries)));
+    stats.Set("bytes", Napi::Number::New(env, static_cast<double>(counters.bytes)));
+    stats.Set("maxBytes", Napi::Number::New(env, static_cast<double>(contentCache_->GetOptions().maxBytes)));
+    return stats;
+}
+
+static void SetDispatchCounters(Napi::Env env, Napi::Object stats, const Dispatcher::Counters& counters) {
+    stats.Set("wakeups", Napi::Number::New(env, static_cast<double>(counters.wakeups)));
+    stats.Set("requests", Napi::Number::New(env, static_cast<double>(counters.requests)));
+    stats.Set("batchCalls", Napi::Number::New(env, static_cast<double>(counters.batchCalls)));
+    stats.Set("maxBatch", Napi::Number::New(env, static_cast<double>(counters.maxBatch)));
+    stats.Set("depth", Napi::Number::New(env, static_cast<double>(counters.depth)));
+    stats.Set("maxDepth", Napi::Number::New(env, static_cast<double>(counters.maxDepth)));
+    Napi::Object lanes = Napi::Object::New(env);
+    for (size_t i = 0; i < Dispatcher::kLanes; i++) {
+        const Dispatcher::LaneCounters& lane = counters.lanes[i];
+        Napi::Object stat = Napi::Object::New(env);
+        stat.Set("run", Napi::Number::New(env, static_cast<double>(lane.run)));
+        stat.Set("depth", Napi::Number::New(env, static_cast<double>(lane.depth)));
+        stat.Set("maxDepth", Napi::Number::New(env, static_cast<double>(lane.maxDepth)));
+        stat.Set("inFlight", Napi::Number::New(env, static_cast<double>(lane.inFlight)));
+        stat.Set("maxInFlight", Napi::Number::New(env, static_cast<double>(lane.maxInFlight)));
+        stat.Set("meanWaitMs", Napi::Number::New(env, lane.run ? lane.waitNs / 1e6 / lane.run : 0));
+        stat.Set("maxWaitMs", Napi::Number::New(env, lane.maxWaitNs / 1e6));
+        lanes.Set(kLaneNames[i], stat);
+    }
+    stats.Set("lanes", lanes);
+}
+
+// getDispatchStats(): how requests were drained on the JS thread. Counters
+// accumulate over the lifetime of the instance; depth is the current queue.
+Napi::Value Fuse3::GetDispatchStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    Napi::Object stats = Napi::Object::New(env);
+    SetDispatchCounters(env, stats, dispatcher_->GetCounters());
+    return stats;
+}
+
+// registerWorker(mountPoint, operations), called on a worker_threads thread:
+// from now on requests of that mount are spread over the registered workers
+// and served with their operations. Returns { id, pathOf(id), unregister() };
+// pathOf resolves the path IDs this worker was given.
+static Napi::Value RegisterWorker(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsObject()) {
+        Napi::TypeError::New(env, "Arguments: (mountPoint: string, operations: object)")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    std::string mountPoint = info[0].As<Napi::String>().Utf8Value();
+    std::shared_ptr<WorkerPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(g_poolsMutex);
+        auto it = g_pools.find(mountPoint);
+        if (it != g_pools.end()) {
+            pool = it->second.lock();
+        }
+    }
+    if (!pool) {
+        Napi::Error::New(env, "Nothing is mounted at " + mountPoint).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t id = pool->Add(env, info[1].As<Napi::Object>());
+    std::weak_ptr<WorkerPool> weak = pool;
+    Napi::Object worker = Napi::Object::New(env);
+    worker.Set("id", Napi::Number::New(env, id));
+    worker.Set("pathOf", Napi::Function::New(env, [weak, id](const Napi::CallbackInfo& info) -> Napi::Value {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Arguments: (id: number)").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        double pathId = info[0].As<Napi::Number>().DoubleValue();
+        std::shared_ptr<WorkerPool> pool = weak.lock();
+        PathTable* paths = pool ? pool->PathsOf(id) : nullptr;
+        if (!paths || !(pathId >= 1)) {
+            return env.Undefined();
+        }
+        return paths->Lookup(env, static_cast<uint64_t>(pathId));
+    }));
+    worker.Set("unregister", Napi::Function::New(env, [weak, id](const Napi::CallbackInfo& info) -> Napi::Value {
+        std::shared_ptr<WorkerPool> pool = weak.lock();
+        return Napi::Boolean::New(info.Env(), pool && pool->Remove(id));
+    }));
+    return worker;
+}
+
+// removeWorker(id): stop routing requests to a registered worker. What was
+// queued for it still runs there. Returns false for unknown ids.
+Napi::Value Fuse3::RemoveWorker(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Arguments: (id: number)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return Napi::Boolean::New(env, workers_->Remove(info[0].As<Napi::Number>().Uint32Value()));
+}
+
+// getWorkerStats(): one entry per JS thread serving the mount, id 0 being the
+// thread that created it, with the requests routed to it and its dispatch
+// counters
+Napi::Value Fuse3::GetWorkerStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    std::vector<WorkerPool::Counters> counters = workers_->GetCounters();
+    Napi::Array result = Napi::Array::New(env, counters.size());
+    for (size_t i = 0; i < counters.size(); i++) {
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("id", Napi::Number::New(env, counters[i].id));
+        stats.Set("routed", Napi::Number::New(env, static_cast<double>(counters[i].routed)));
+        SetDispatchCounters(env, stats, counters[i].dispatch);
+        result.Set(static_cast<uint32_t>(i), stats);
+    }
+    return result;
+}
+
+// pathOf(id): the path a handler got as ID with path_ids on, or undefined
+// once it dropped out of the table
+Napi::Value Fuse3::PathOf(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Arguments: (id: number)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    double id = info[0].As<Napi::Number>().DoubleValue();
+    if (!context_->paths || !(id >= 1)) {
+        return env.Undefined();
+    }
+    return context_->paths->Lookup(env, static_cast<uint64_t>(id));
+}
+
+// getPathStats(): counters of the path table, or null when it is off
+Napi::Value Fuse3::GetPathStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!context_->paths) {
+        return env.Null();
+    }
+    PathTable::Counters counters = context_->paths->GetCounters();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("hits", Napi::Number::New(env, static_cast<double>(counters.hits)));
+    stats.Set("misses", Napi::Number::New(env, static_cast<double>(counters.misses)));
+    stats.Set("evictions", Napi::Number::New(env, static_cast<double>(counters.evictions)));
+    stats.Set("entries", Napi::Number::New(env, static_cast<double>(counters.entries)));
+    return stats;
+}
+
+// getProbeFilterStats(): lookups the probe filter answered, by rule and by
+// learned path, and the paths learned right now; null when it is off
+Napi::Value Fuse3::GetProbeFilterStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!context_->probeFilter) {
+        return env.Null();
+    }
+    ProbeFilter::Counters counters = context_->probeFilter->GetCounters();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("absorbed", Napi::Number::New(env, static_cast<double>(counters.ruleHits + counters.learnedHits)));
+    stats.Set("ruleHits", Napi::Number::New(env, static_cast<double>(counters.ruleHits)));
+    stats.Set("learnedHits", Napi::Number::New(env, static_cast<double>(counters.learnedHits)));
+    stats.Set("learnedNames", Napi::Number::New(env, static_cast<double>(counters.learnedNames)));
+    return stats;
+}
+
+// getDeadlineStats(): requests failed because their handler missed the
+// deadline or the kernel interrupted them; null unless deadlines are on
+Napi::Value Fuse3::GetDeadlineStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!context_->deadlines.Enabled()) {
+        return env.Null();
+    }
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("timeouts", Napi::Number::New(env, static_cast<double>(context_->deadlineCounters.timeouts.load())));
+    stats.Set("interrupts", Napi::Number::New(env, static_cast<double>(context_->deadlineCounters.interrupts.load())));
+    return stats;
+}
+
+// getRequestSlotStats(): slots taken right now and at most, requests that
+// found none free and answers to ids no longer taken; null when
+// request_slots is off
+Napi::Value Fuse3::GetRequestSlotStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!context_->requestSlots) {
+        return env.Null();
+    }
+    RequestSlots::Counters counters = context_->requestSlots->GetCounters();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("size", Napi::Number::New(env, static_cast<double>(counters.size)));
+    stats.Set("inUse", Napi::Number::New(env, static_cast<double>(counters.inUse)));
+    stats.Set("maxInUse", Napi::Number::New(env, static_cast<double>(counters.maxInUse)));
+    stats.Set("acquired", Napi::Number::New(env, static_cast<double>(counters.acquired)));
+    stats.Set("exhausted", Napi::Number::New(env, static_cast<double>(counters.exhausted)));
+    stats.Set("stale", Napi::Number::New(env, static_cast<double>(counters.stale)));
+    return stats;
+}
+
+// setPrewarmListener(fn | null): fn(progress) gets what getPrewarmStats()
+// returns about twice a second while the walk runs and once at its end
+Napi::Value Fuse3::SetPrewarmListener(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !(info[0].IsFunction() || info[0].IsNull() || info[0].IsUndefined())) {
+        Napi::TypeError::New(env, "Arguments: (listener: function | null)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (info[0].IsFunction() && context_->prewarmer) {
+        context_->prewarmListener = Napi::Persistent(info[0].As<Napi::Function>());
+    } else {
+        context_->prewarmListener.Reset();
+    }
+    return env.Undefined();
+}
+
+// getPrewarmStats(): progress of the pre-warm walk, or null when prewarm is
+// off
+Napi::Value Fuse3::GetPrewarmStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (!context_->prewarmer) {
+        return env.Null();
+    }
+    return PrewarmProgressToJs(env, context_->prewarmer->GetProgress());
+}
+
+struct CapabilityName {
+    unsigned int flag;
+    const char* name;
+};
+
+static const CapabilityName kCapabilities[] = {
+    {FUSE_CAP_ASYNC_READ, "async_read"},
+    {FUSE_CAP_POSIX_LOCKS, "posix_locks"},
+    {FUSE_CAP_ATOMIC_O_TRUNC, "atomic_o_trunc"},
+    {FUSE_CAP_EXPORT_SUPPORT, "export_support"},
+    {FUSE_CAP_DONT_MASK, "dont_mask"},
+    {FUSE_CAP_SPLICE_WRITE, "splice_write"},
+    {FUSE_CAP_SPLICE_MOVE, "splice_move"},
+    {FUSE_CAP_SPLICE_READ, "splice_read"},
+    {FUSE_CAP_FLOCK_LOCKS, "flock_locks"},
+    {FUSE_CAP_IOCTL_DIR, "ioctl_dir"},
+    {FUSE_CAP_AUTO_INVAL_DATA, "auto_inval_data"},
+    {FUSE_CAP_READDIRPLUS, "readdirplus"},
+    {FUSE_CAP_READDIRPLUS_AUTO, "readdirplus_auto"},
+    {FUSE_CAP_ASYNC_DIO, "async_dio"},
+    {FUSE_CAP_WRITEBACK_CACHE, "writeback_cache"},
+    {FUSE_CAP_NO_OPEN_SUPPORT, "no_open_support"},
+    {FUSE_CAP_PARALLEL_DIROPS, "parallel_dirops"},
+    {FUSE_CAP_POSIX_ACL, "posix_acl"},
+    {FUSE_CAP_HANDLE_KILLPRIV, "handle_killpriv"},
+#ifdef FUSE_CAP_CACHE_SYMLINKS
+    {FUSE_CAP_CACHE_SYMLINKS, "cache_symlinks"},
+#endif
+#ifdef FUSE_CAP_NO_OPENDIR_SUPPORT
+    {FUSE_CAP_NO_OPENDIR_SUPPORT, "no_opendir_support"},
+#endif
+#ifdef FUSE_CAP_EXPLICIT_INVAL_DATA
+    {FUSE_CAP_EXPLICIT_INVAL_DATA, "explicit_inval_data"},
+#endif
+#ifdef FUSE_CAP_PASSTHROUGH
+    {FUSE_CAP_PASSTHROUGH, "passthrough"},
+#endif
+};
+
+static Napi::Array CapabilitiesToJs(Napi::Env env, unsigned int flags) {
+    Napi::Array names = Napi::Array::New(env);
+    uint32_t count = 0;
+    for (const CapabilityName& capability : kCapabilities) {
+        if (flags & capability.flag) {
+            names.Set(count++, Napi::String::New(env, capability.name));
+        }
+    }
+    return names;
+}
+
+// getConnectionInfo(): what the kernel offered (capable) and what was
+// switched on (want) when it sent INIT, with the negotiated limits. null
+// until then.
+Napi::Value Fuse3::GetConnectionInfo(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    FuseContext* ctx = context_.get();
+    if (!ctx) {
+        return env.Null();
+    }
+    struct fuse_conn_info conn;
+    {
+        std::lock_guard<std::mutex> lock(ctx->negotiatedMutex);
+        if (!ctx->connected) {
+            return env.Null();
+        }
+        conn = ctx->negotiated;
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("protocol", Napi::String::New(env, std::to_string(conn.proto_major) + "." +
+                                                  std::to_string(conn.proto_minor)));
+    result.Set("capable", CapabilitiesToJs(env, conn.capable));
+    result.Set("want", CapabilitiesToJs(env, conn.want));
+    result.Set("maxRead", Napi::Number::New(env, conn.max_read));
+    result.Set("maxWrite", Napi::Number::New(env, conn.max_write));
+    result.Set("maxReadahead", Napi::Number::New(env, conn.max_readahead));
+    result.Set("maxBackground", Napi::Number::New(env, conn.max_background));
+    result.Set("congestionThreshold", Napi::Number::New(env, conn.congestion_threshold));
+    result.Set("timeGran", Napi::Number::New(env, conn.time_gran));
+    return result;
+}
+
+static Napi::Object PhaseToJs(Napi::Env env, const OpStats::Summary& s) {
+    // Microseconds, which keeps sub-millisecond cache hits readable
+    auto us = [env](uint64_t ns) { return Napi::Number::New(env, ns / 1000.0); };
+    Napi::Object phase = Napi::Object::New(env);
+    phase.Set("count", Napi::Number::New(env, static_cast<double>(s.count)));
+    phase.Set("mean", us(s.count ? s.sumNs / s.count : 0));
+    phase.Set("p50", us(s.p50Ns));
+    phase.Set("p90", us(s.p90Ns));
+    phase.Set("p99", us(s.p99Ns));
+    phase.Set("p999", us(s.p999Ns));
+    phase.Set("max", us(s.maxNs));
+    return phase;
+}
+
+// getStats(format?): per-operation latencies (queue, js, total), bytes and
+// errors since the last reset, or null when op_stats is off.
+// getStats('prometheus') renders the same as Prometheus text.
+Napi::Value Fuse3::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!stats_) {
+        return env.Null();
+    }
+
+    if (info.Length() > 0 && info[0].IsString()) {
+        std::string format = info[0].As<Napi::String>().Utf8Value();
+        if (format != "prometheus") {
+            Napi::RangeError::New(env, "Unknown stats format '" + format + "'").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        return Napi::String::New(env, stats_->RenderPrometheus(mountPoint_));
+    }
+
+    Napi::Object ops = Napi::Object::New(env);
+    for (const OpStats::OpSummary& summary : stats_->Snapshot()) {
+        Napi::Object op = Napi::Object::New(env);
+        op.Set("queue", PhaseToJs(env, summary.phases[static_cast<size_t>(StatPhase::Queue)]));
+        op.Set("js", PhaseToJs(env, summary.phases[static_cast<size_t>(StatPhase::Js)]));
+        op.Set("total", PhaseToJs(env, summary.phases[static_cast<size_t>(StatPhase::Total)]));
+        op.Set("bytes", Napi::Number::New(env, static_cast<double>(summary.bytes)));
+        Napi::Object errors = Napi::Object::New(env);
+        for (const auto& error : summary.errors) {
+            errors.Set(std::to_string(error.first), Napi::Number::New(env, static_cast<double>(error.second)));
+        }
+        op.Set("errors", errors);
+        ops.Set(StatOpName(summary.op), op);
+    }
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("since", Napi::Number::New(env, stats_->ResetAt()));
+    result.Set("ops", ops);
+    return result;
+}
+
+// resetStats(): start all counters of getStats() from zero
+Napi::Value Fuse3::ResetStats(const Napi::CallbackInfo& info) {
+    if (stats_) {
+        stats_->Reset();
+    }
+    return info.Env().Undefined();
 }
 
 // Initialize the addon
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
-    // Initialize FUSE operations structure
-    init_fuse_operations();
     return Fuse3::Init(env, exports);
 }
 
@@ -0,0 +1,111 @@
+#include "fuse3_notify.h"
+#include <errno.h>
+
+KernelNotifier::KernelNotifier(SendFn send, std::shared_ptr<OpStats> stats)
+    : send_(std::move(send)), stats_(std::move(stats)) {}
+
+KernelNotifier::~KernelNotifier() {
+    Stop();
+}
+
+void KernelNotifier::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread([this] { Run(); });
+}
+
+void KernelNotifier::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        order_.clear();
+        pending_.clear();
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool KernelNotifier::Push(Kind kind, const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return false;
+        }
+        counters_.queued++;
+        auto it = pending_.find(path);
+        if (it != pending_.end()) {
+            it->second.kinds |= kind;
+            counters_.merged++;
+            return true;
+        }
+        pending_.emplace(path, Pending{static_cast<uint8_t>(kind), OpStats::Now()});
+        order_.push_back(path);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+// Sends in the order paths were first queued. A deleted name needs no
+// separate entry invalidation.
+void KernelNotifier::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return !running_ || !order_.empty(); });
+        if (!running_) {
+            return;
+        }
+        std::vector<std::string> batch;
+        batch.swap(order_);
+        std::unordered_map<std::string, Pending> kinds;
+        kinds.swap(pending_);
+        counters_.batches++;
+        lock.unlock();
+
+        uint64_t sent = 0, uncached = 0, failed = 0;
+        for (const std::string& path : batch) {
+            const Pending& entry = kinds[path];
+            uint8_t todo = entry.kinds;
+            if (todo & Delete) {
+                todo &= ~Entry;
+            }
+            for (Kind kind : {Change, Entry, Delete}) {
+                if (!(todo & kind)) {
+                    continue;
+                }
+                uint64_t start = OpStats::Now();
+                int res = send_(kind, path);
+                if (res == 0) {
+                    sent++;
+                } else if (res == -ENOENT) {
+                    uncached++;
+                } else {
+                    failed++;
+                }
+                if (stats_) {
+                    stats_->Record(StatOp::Notify, StatPhase::Queue, start - entry.queuedAt);
+                    stats_->Record(StatOp::Notify, StatPhase::Total, OpStats::Now() - entry.queuedAt);
+                    if (res < 0) {
+                        stats_->AddError(StatOp::Notify, res);
+                    }
+                }
+            }
+        }
+
+        lock.lock();
+        counters_.sent += sent;
+        counters_.uncached += uncached;
+        counters_.failed += failed;
+    }
+}
+
+KernelNotifier::Counters KernelNotifier::GetCounters() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Counters counters = counters_;
+    counters.pending = order_.size();
+    return counters;
+}
\ No newline at end of file
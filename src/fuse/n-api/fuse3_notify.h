@@ -0,0 +1,75 @@
+#pragma once
+
+#include "fuse3_op_stats.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Kernel cache invalidations pushed from JS (notifyChange, notifyEntry,
+// notifyDelete), e.g. when replication changed files behind the mount.
+// They are sent by a thread of their own: a notification can block until
+// the kernel releases the inode, which may take until JS answered a request
+// for it. Notifications for a path still queued are merged, so a burst of
+// changes to one file costs one round-trip. Each notification is timed as
+// the "notify" operation of OpStats: queue until it is sent, total until the
+// kernel took it.
+class KernelNotifier {
+public:
+    // Bits; one path may have several queued
+    enum Kind : uint8_t {
+        Change = 1,  // attributes or data of the path (inode)
+        Entry = 2,   // what the name refers to, e.g. it was created (dentry)
+        Delete = 4,  // the name is gone
+    };
+
+    struct Counters {
+        uint64_t queued = 0;
+        uint64_t merged = 0;   // queued for a path already waiting
+        uint64_t sent = 0;
+        uint64_t uncached = 0;  // the kernel had nothing cached for the path
+        uint64_t failed = 0;
+        uint64_t batches = 0;
+        uint64_t pending = 0;
+    };
+
+    // Sends one kind of notification for path. Returns 0, -ENOENT if the
+    // kernel does not know the path, or another negative errno.
+    using SendFn = std::function<int(Kind kind, const std::string& path)>;
+
+    // stats: null when op_stats is off
+    KernelNotifier(SendFn send, std::shared_ptr<OpStats> stats);
+    ~KernelNotifier();
+
+    // Between mount and unmount. Stop drops what was not sent yet.
+    void Start();
+    void Stop();
+
+    // False if not started
+    bool Push(Kind kind, const std::string& path);
+
+    Counters GetCounters();
+
+private:
+    struct Pending {
+        uint8_t kinds = 0;
+        uint64_t queuedAt = 0;
+    };
+
+    void Run();
+
+    SendFn send_;
+    std::shared_ptr<OpStats> stats_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::thread thread_;
+    bool running_ = false;
+    std::vector<std::string> order_;
+    std::unordered_map<std::string, Pending> pending_;
+    Counters counters_;
+};
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "fuse3_op_stats.h"
+#include "fuse3_flight_recorder.h"
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+static const char* const kOpNames[] = {
+    "lookup", "getattr", "setattr", "readdir", "opendir", "releasedir", "open", "create", "read", "write",
+    "flush", "fsync", "release", "mkdir", "unlink", "rmdir", "rename", "chmod", "chown", "truncate",
+    "utimens", "access", "statfs", "notify"
+};
+static_assert(sizeof(kOpNames) / sizeof(kOpNames[0]) == static_cast<size_t>(StatOp::Count),
+              "every StatOp needs a name");
+
+static const char* const kPhaseNames[] = {"queue", "js", "total"};
+
+const char* StatOpName(StatOp op) {
+    return op < StatOp::Count ? kOpNames[static_cast<size_t>(op)] : "unknown";
+}
+
+// Keeps the end of long paths; it tells more than the beginning. A cut
+// through a UTF-8 sequence drops the rest of it.
+void FlightNote::SetPath(std::string_view p) {
+    if (p.size() >= kPathBytes) {
+        p.remove_prefix(p.size() - (kPathBytes - 1));
+        while (!p.empty() && (static_cast<unsigned char>(p.front()) & 0xc0) == 0x80) {
+            p.remove_prefix(1);
+        }
+    }
+    memcpy(path, p.data(), p.size());
+    path[p.size()] = '\0';
+}
+
+void OpTimer::End() {
+    if (!start) {
+        return;
+    }
+    uint64_t now = OpStats::Now();
+    if (recorder) {
+        recorder->Record(*this, now);
+    }
+    if (!stats) {
+        return;
+    }
+    uint64_t ran = running.load(std::memory_order_relaxed);
+    uint64_t done = answered.load(std::memory_order_relaxed);
+    if (ran) {
+        stats->Record(op, StatPhase::Queue, ran - start);
+        if (done >= ran) {
+            stats->Record(op, StatPhase::Js, done - ran);
+        }
+    }
+    stats->Record(op, StatPhase::Total, now - start);
+    if (error < 0) {
+        stats->AddError(op, error);
+    } else if (bytes) {
+        stats->AddBytes(op, bytes);
+    }
+}
+
+OpStats::OpStats() : stripes_(kStripes) {
+    Reset();
+}
+
+uint64_t OpStats::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Values below 4 get a bucket each; above, every power of two is split into
+// four buckets by the two bits below the highest set bit.
+size_t OpStats::BucketOf(uint64_t ns) {
+    if (ns < 4) {
+        return static_cast<size_t>(ns);
+    }
+    unsigned int msb = 63 - __builtin_clzll(ns);
+    size_t bucket = (msb - 1) * 4 + ((ns >> (msb - 2)) & 3);
+    return std::min(bucket, kBuckets - 1);
+}
+
+uint64_t OpStats::BucketLimit(size_t bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    if (bucket >= kBuckets - 1) {
+        return UINT64_MAX;  // it also takes everything from 2^42 on
+    }
+    size_t next = bucket + 1;
+    unsigned int msb = static_cast<unsigned int>(next / 4 + 1);
+    return ((4 + next % 4) << (msb - 2)) - 1;
+}
+
+OpStats::Stripe& OpStats::LocalStripe() {
+    static std::atomic<size_t> nextStripe{0};
+    thread_local size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+    return stripes_[stripe];
+}
+
+void OpStats::Record(StatOp op, StatPhase phase, uint64_t ns) {
+    Histogram& h = LocalStripe().histograms[static_cast<size_t>(op)][static_cast<size_t>(phase)];
+    h.buckets[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    h.sum.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max = h.max.load(std::memory_order_relaxed);
+    while (ns > max && !h.max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void OpStats::AddBytes(StatOp op, uint64_t bytes) {
+    LocalStripe().bytes[static_cast<size_t>(op)].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void OpStats::AddError(StatOp op, int err) {
+    size_t code = std::min<size_t>(err < 0 ? -err : err, kMaxErrno);
+    errors_[static_cast<size_t>(op)][code].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<OpStats::OpSummary> OpStats::Snapshot() const {
+    std::vector<OpSummary> result;
+    std::vector<uint64_t> buckets(kBuckets);
+    for (size_t op = 0; op < kOps; op++) {
+        OpSummary summary;
+        summary.op = static_cast<StatOp>(op);
+        for (size_t phase = 0; phase < kPhases; phase++) {
+            Summary& s = summary.phases[phase];
+            std::fill(buckets.begin(), buckets.end(), 0);
+            for (const Stripe& stripe : stripes_) {
+                const Histogram& h = stripe.histograms[op][phase];
+                for (size_t b = 0; b < kBuckets; b++) {
+                    uint64_t n = h.buckets[b].load(std::memory_order_relaxed);
+                    buckets[b] += n;
+                    s.count += n;
+                }
+                s.sumNs += h.sum.load(std::memory_order_relaxed);
+                s.maxNs = std::max(s.maxNs, h.max.load(std::memory_order_relaxed));
+            }
+            if (s.count == 0) {
+                continue;
+            }
+
+            // Upper end of the bucket holding the requested rank, capped by
+            // the largest value actually seen
+            struct { double q; uint64_t* out; } quantiles[] = {
+                {0.5, &s.p50Ns}, {0.9, &s.p90Ns}, {0.99, &s.p99Ns}, {0.999, &s.p999Ns}
+            };
+            for (auto& quantile : quantiles) {
+                uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile.q * s.count + 0.5));
+                uint64_t seen = 0;
+                for (size_t b = 0; b < kBuckets; b++) {
+                    seen += buckets[b];
+                    if (seen >= rank) {
+                        *quantile.out = std::min(BucketLimit(b), s.maxNs);
+                        break;
+                    }
+                }
+            }
+        }
+        for (const Stripe& stripe : stripes_) {
+            summary.bytes += stripe.bytes[op].load(std::memory_order_relaxed);
+        }
+        for (size_t code = 1; code <= kMaxErrno; code++) {
+            uint64_t n = errors_[op][code].load(std::memory_order_relaxed);
+            if (n) {
+                summary.errors.emplace_back(static_cast<int>(code), n);
+            }
+        }
+
+        if (summary.phases[static_cast<size_t>(StatPhase::Total)].count || !summary.errors.empty()) {
+            result.push_back(std::move(summary));
+        }
+    }
+    return result;
+}
+
+static std::string EscapeLabel(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Prometheus text exposition format. Latencies are summaries with the same
+// quantiles getStats() reports.
+std::string OpStats::RenderPrometheus(const std::string& mountPoint) const {
+    std::vector<OpSummary> ops = Snapshot();
+    std::string mount = "mount=\"" + EscapeLabel(mountPoint) + "\"";
+    std::string out;
+    char line[256];
+
+    out += "# HELP fuse_op_duration_seconds Time FUSE requests spend per phase\n";
+    out += "# TYPE fuse_op_duration_seconds summary\n";
+    for (const OpSummary& op : ops) {
+        for (size_t phase = 0; phase < kPhases; phase++) {
+            const Summary& s = op.phases[phase];
+            if (!s.count) {
+                continue;
+            }
+            std::string labels = mount + ",op=\"" + StatOpName(op.op) + "\",phase=\"" + kPhaseNames[phase] + "\"";
+            struct { const char* q; uint64_t ns; } quantiles[] = {
+                {"0.5", s.p50Ns}, {"0.9", s.p90Ns}, {"0.99", s.p99Ns}, {"0.999", s.p999Ns}
+            };
+            for (auto& quantile : quantiles) {
+                snprintf(line, sizeof(line), ",quantile=\"%s\"} %.9f\n", quantile.q, quantile.ns / 1e9);
+                out += "fuse_op_duration_seconds{" + labels + line;
+            }
+            snprintf(line, sizeof(line), "} %.9f\n", s.sumNs / 1e9);
+            out += "fuse_op_duration_seconds_sum{" + labels + line;
+            snprintf(line, sizeof(line), "} %llu\n", static_cast<unsigned long long>(s.count));
+            out += "fuse_op_duration_seconds_count{" + labels + line;
+        }
+    }
+
+    out += "# HELP fuse_op_bytes_total Payload bytes of read and write requests\n";
+    out += "# TYPE fuse_op_bytes_total counter\n";
+    for (const OpSummary& op : ops) {
+        if (op.op == StatOp::Read || op.op == StatOp::Write) {
+            snprintf(line, sizeof(line), "\"} %llu\n", static_cast<unsigned long long>(op.bytes));
+            out += "fuse_op_bytes_total{" + mount + ",op=\"" + StatOpName(op.op) + line;
+        }
+    }
+
+    out += "# HELP fuse_op_errors_total Failed FUSE requests by errno\n";
+    out += "# TYPE fuse_op_errors_total counter\n";
+    for (const OpSummary& op : ops) {
+        for (const auto& error : op.errors) {
+            snprintf(line, sizeof(line), "\",errno=\"%d\"} %llu\n", error.first,
+                     static_cast<unsigned long long>(error.second));
+            out += "fuse_op_errors_total{" + mount + ",op=\"" + StatOpName(op.op) + line;
+        }
+    }
+    return out;
+}
+
+void OpStats::Reset() {
+    for (Stripe& stripe : stripes_) {
+        for (size_t op = 0; op < kOps; op++) {
+            for (size_t phase = 0; phase < kPhases; phase++) {
+                Histogram& h = stripe.histograms[op][phase];
+                for (size_t b = 0; b < kBuckets; b++) {
+                    h.buckets[b].store(0, std::memory_order_relaxed);
+                }
+                h.sum.store(0, std::memory_order_relaxed);
+                h.max.store(0, std::memory_order_relaxed);
+            }
+            stripe.bytes[op].store(0, std::memory_order_relaxed);
+        }
+    }
+    for (size_t op = 0; op < kOps; op++) {
+        for (size_t code = 0; code <= kMaxErrno; code++) {
+            errors_[op][code].store(0, std::memory_order_relaxed);
+        }
+    }
+    resetAt_.store(std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(
+        std::chrono::system_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+}
\ No newline at end of file
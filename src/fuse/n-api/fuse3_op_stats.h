@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Operations as they are counted, shared by both backends. Notify is the
+// kernel cache invalidations JS pushes (KernelNotifier).
+enum class StatOp : uint8_t {
+    Lookup, Getattr, Setattr, Readdir, Opendir, Releasedir, Open, Create, Read, Write,
+    Flush, Fsync, Release, Mkdir, Unlink, Rmdir, Rename, Chmod, Chown, Truncate,
+    Utimens, Access, Statfs, Notify, Count
+};
+
+// Where a request spends its time. Queue runs from the request reaching the
+// addon until its handler starts on the JS thread, Js from there until the
+// handler calls back, Total until the reply. Requests answered natively
+// (caches, backing files) only have Total.
+enum class StatPhase : uint8_t { Queue, Js, Total, Count };
+
+const char* StatOpName(StatOp op);
+
+// Per-operation latency histograms, byte and errno counters. Recording is a
+// few relaxed atomic increments on a stripe picked per thread, so FUSE
+// workers and the JS thread neither lock nor share cache lines. Histograms
+// are log-linear with four buckets per power of two (values within 25%),
+// recorded in nanoseconds.
+class OpStats {
+public:
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t sumNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t p50Ns = 0;
+        uint64_t p90Ns = 0;
+        uint64_t p99Ns = 0;
+        uint64_t p999Ns = 0;
+    };
+
+    struct OpSummary {
+        StatOp op;
+        Summary phases[static_cast<size_t>(StatPhase::Count)];
+        uint64_t bytes = 0;
+        std::vector<std::pair<int, uint64_t>> errors;  // positive errno, count
+    };
+
+    OpStats();
+
+    void Record(StatOp op, StatPhase phase, uint64_t ns);
+    void AddBytes(StatOp op, uint64_t bytes);
+    // err is a negative errno as used by the JS handlers
+    void AddError(StatOp op, int err);
+
+    // Operations that were seen since the last reset
+    std::vector<OpSummary> Snapshot() const;
+    std::string RenderPrometheus(const std::string& mountPoint) const;
+    // Requests in flight while this runs may be counted in part
+    void Reset();
+    // Wall clock of the last reset, milliseconds since the epoch
+    double ResetAt() const { return resetAt_.load(std::memory_order_relaxed); }
+
+    static uint64_t Now();  // steady clock, nanoseconds
+
+    static constexpr size_t kBuckets = 164;  // up to 2^42 ns, about 73 minutes; the last is open
+    static size_t BucketOf(uint64_t ns);
+    static uint64_t BucketLimit(size_t bucket);  // highest value in bucket
+
+private:
+    static constexpr size_t kStripes = 8;
+    static constexpr size_t kMaxErrno = 134;  // higher ones are counted there
+    static constexpr size_t kOps = static_cast<size_t>(StatOp::Count);
+    static constexpr size_t kPhases = static_cast<size_t>(StatPhase::Count);
+
+    struct Histogram {
+        std::atomic<uint64_t> buckets[kBuckets];
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> max;
+    };
+
+    struct alignas(64) Stripe {
+        Histogram histograms[kOps][kPhases];
+        std::atomic<uint64_t> bytes[kOps];
+    };
+
+    Stripe& LocalStripe();
+
+    std::vector<Stripe> stripes_;
+    std::atomic<uint64_t> errors_[kOps][kMaxErrno + 1];
+    std::atomic<double> resetAt_;
+};
+
+class FlightRecorder;  // fuse3_flight_recorder.h
+
+// What the flight recorder keeps of a request besides its timestamps
+struct FlightNote {
+    static constexpr size_t kPathBytes = 48;
+    char path[kPathBytes];  // the end of the path, NUL-terminated
+    uint64_t fh = 0;
+    uint64_t size = 0;
+    int64_t offset = -1;    // -1: none
+
+    FlightNote() { path[0] = '\0'; }
+    void SetPath(std::string_view p);
+};
+
+// Timestamps of one request on its way through the addon. Begin and End run
+// on the thread that owns the request; the JS thread marks the phases in
+// between, possibly while a shutdown already ends the request.
+struct OpTimer {
+    OpStats* stats = nullptr;  // null when op_stats is off
+    FlightRecorder* recorder = nullptr;  // null when flight_recorder is off
+    StatOp op = StatOp::Count;
+    uint64_t start = 0;  // 0 when neither is on
+    std::atomic<uint64_t> running{0};
+    std::atomic<uint64_t> answered{0};
+    int error = 0;       // set before End
+    uint64_t bytes = 0;  // set before End
+    FlightNote note;     // filled only for the recorder
+
+    void Begin(OpStats* s, StatOp o, FlightRecorder* r = nullptr) {
+        stats = s;
+        recorder = r;
+        op = o;
+        start = s || r ? OpStats::Now() : 0;
+    }
+    // The handler is about to run on the JS thread; the first call counts
+    void Running() {
+        uint64_t unset = 0;
+        if (start) running.compare_exchange_strong(unset, OpStats::Now(), std::memory_order_relaxed);
+    }
+    // A handler called back; the last call counts
+    void Answered() {
+        if (start) answered.store(OpStats::Now(), std::memory_order_relaxed);
+    }
+    void NotePath(std::string_view path) {
+        if (recorder) note.SetPath(path);
+    }
+    void NoteIo(uint64_t fh, uint64_t size, int64_t offset) {
+        if (recorder) {
+            note.fh = fh;
+            note.size = size;
+            note.offset = offset;
+        }
+    }
+    // Records every phase that was reached. Call once.
+    void End();
+};
\ No newline at end of file
@@ -1,370 +1,1427 @@
-#include <napi.h>
-#include <fuse3/fuse.h>
+#include "fuse3_context.h"
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
-#include <mutex>
-#include <condition_variable>
-#include <future>
-#include <unordered_map>
-#include <memory>
-
-// External context
-struct FuseContext {
-    Napi::ThreadSafeFunction tsfn;
-    Napi::ObjectReference operations;
-    std::string mountPoint;
-    struct fuse *fuse;
-    std::thread *fuseThread;
-    bool mounted;
+#include <fcntl.h>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// A JS handler that throws synchronously never calls back. Fail the request
+// instead of parking the FUSE worker forever.
+static std::function<void()> FailOnThrow(const std::shared_ptr<OpCompletion>& completion, const JsReply& reply) {
+    return [completion, reply]() {
+        ReleaseJsReply(reply);
+        completion->cancel.Unwatch();
+        completion->Complete(-EIO);
+    };
+}
+
+// Lets ops.cancel learn about the request reply answers (JS thread)
+static void WatchForCancel(FuseContext* ctx, const std::shared_ptr<OpCompletion>& completion,
+                           const JsReply& reply) {
+    if (ctx->deadlines.Enabled()) {
+        completion->cancel.Watch(reply);
+    }
+}
+
+// How often a waiting worker checks whether the kernel interrupted its request
+static constexpr std::chrono::milliseconds kInterruptPoll(20);
+
+// Waits for the result of a request posted for JS. With op_timeout the wait
+// ends at the deadline of op, with interrupts when the kernel interrupts the
+// request (high-level backend only: fuse_interrupted() needs its context).
+// The handler is then told through ops.cancel and its late answer dropped.
+static int AwaitJs(FuseContext* ctx, const std::shared_ptr<OpCompletion>& completion,
+                   std::future<int>& future, StatOp op) {
+    const FuseDeadlineOptions& deadlines = ctx->deadlines;
+    double timeout = deadlines.For(op);
+    bool interrupts = deadlines.interrupts && !ctx->lowLevel;
+    if (timeout <= 0 && !interrupts) {
+        return future.get();
+    }
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point deadline = deadlines.Deadline(op);
+    while (true) {
+        Clock::time_point until = interrupts ? std::min(deadline, Clock::now() + kInterruptPoll) : deadline;
+        if (future.wait_until(until) == std::future_status::ready) {
+            break;
+        }
+        if (Clock::now() >= deadline) {
+            if (completion->Abandon(deadlines.timeoutErr)) {
+                ctx->deadlineCounters.timeouts++;
+                completion->cancel.Cancel("timeout");
+            }
+            break;
+        }
+        if (interrupts && fuse_interrupted()) {
+            if (completion->Abandon(-EINTR)) {
+                ctx->deadlineCounters.interrupts++;
+                completion->cancel.Cancel("interrupt");
+            }
+            break;
+        }
+    }
+    return future.get();
+}
+
+// The operation the calling high-level worker serves
+static StatOp CurrentOp() {
+    return t_opTimer ? t_opTimer->op : StatOp::Count;
+}
+
+// Wraps request memory owned by libfuse in an external Buffer. Returns false
+// on runtimes that do not allow external buffers; callers then copy.
+bool NewExternalBuffer(Napi::Env env, char* data, size_t size, Napi::Buffer<char>& buffer) {
+    buffer = Napi::Buffer<char>::New(env, data, size, [](Napi::Env, char*) {});
+    if (env.IsExceptionPending()) {
+        env.GetAndClearPendingException();
+        return false;
+    }
+    return true;
+}
+
+// An external Buffer must not outlive the request that owns its memory.
+// Detaching it before the worker is released turns a late access from JS into
+// an empty Buffer instead of a use-after-free.
+void DetachBuffer(Napi::Buffer<char> buffer) {
+    Napi::ArrayBuffer memory = buffer.ArrayBuffer();
+    if (!memory.IsDetached()) {
+        memory.Detach();
+    }
+}
+
+// cb(err, bytesWritten); older handlers report the count as the only argument
+int ParseWriteResult(const JsArgs& info, size_t size) {
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        return -EINVAL;
+    }
+    
+    int result = info[0].As<Napi::Number>().Int32Value();
+    if (result >= 0 && info.Length() > 1 && info[1].IsNumber()) {
+        int64_t written = info[1].As<Napi::Number>().Int64Value();
+        result = written < 0 ? -EIO : static_cast<int>(std::min<int64_t>(written, size));
+    }
+    return result;
+}
+
+// Parent directory of an absolute path ("/a/b" -> "/a", "/a" -> "/")
+static std::string_view ParentPath(std::string_view path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string_view::npos || slash == 0) {
+        return "/";
+    }
+    return path.substr(0, slash);
+}
+
+// Drop cached attributes for a path changed through the mount. Creating or
+// removing an entry also changes the parent's mtime and link count.
+void InvalidateAttrs(FuseContext* ctx, const char* path, bool withParent) {
+    if (!ctx) {
+        return;
+    }
+    // Whatever the change, the probe filter must not hide the path
+    if (ctx->probeFilter) {
+        ctx->probeFilter->Exists(path);
+    }
+    // So is data read ahead of a reader of the path
+    if (ctx->readahead) {
+        ctx->readahead->Invalidate(path);
+    }
+    if (!ctx->attrCache) {
+        return;
+    }
+    ctx->attrCache->Invalidate(path);
+    if (withParent) {
+        ctx->attrCache->Invalidate(ParentPath(path));
+    }
+}
+
+// Same for a directory that went away or moved with everything below it
+void InvalidateAttrTree(FuseContext* ctx, const char* path) {
+    if (ctx && ctx->probeFilter) {
+        ctx->probeFilter->Exists(path);
+    }
+    if (!ctx || !ctx->attrCache) {
+        return;
+    }
+    ctx->attrCache->InvalidatePrefix(path);
+    ctx->attrCache->Invalidate(ParentPath(path));
+}
+
+// Whole part of a JS number as T, or 0 where it does not fit (NaN included)
+template<typename T>
+static T Whole(double value) {
+    if (!(value >= static_cast<double>(std::numeric_limits<T>::min()) &&
+          value < static_cast<double>(std::numeric_limits<T>::max()))) {
+        return 0;
+    }
+    return static_cast<T>(value);
+}
+
+// Seconds may carry a fraction; what it adds to nsec is rounded to whole
+// nanoseconds
+static void SetTime(struct timespec* ts, double sec, double nsec) {
+    if (!std::isfinite(sec) || !std::isfinite(nsec)) {
+        return;
+    }
+    double whole = std::floor(sec);
+    double ns = std::round(nsec + (sec - whole) * 1e9);
+    double carry = std::floor(ns / 1e9);
+    ts->tv_sec = Whole<time_t>(whole + carry);
+    ts->tv_nsec = static_cast<long>(ns - carry * 1e9);
+}
+
+// A Date (milliseconds) or a Number of seconds; anything else leaves ts alone
+static void ReadJsTime(Napi::Value value, struct timespec* ts) {
+    if (value.IsDate()) {
+        double ms = value.As<Napi::Date>().ValueOf();
+        double sec = std::floor(ms / 1000);
+        SetTime(ts, sec, (ms - sec * 1000) * 1e6);
+    } else if (value.IsNumber()) {
+        SetTime(ts, value.As<Napi::Number>().DoubleValue(), 0);
+    }
+}
+
+static bool IsStatArray(Napi::Value value) {
+    return value.IsTypedArray() && value.As<Napi::TypedArray>().TypedArrayType() == napi_float64_array;
+}
+
+// One entry of the binary layout (see StatField)
+static void StatFromFields(const double* fields, struct stat* stbuf, double* ttl) {
+    stbuf->st_mode = Whole<mode_t>(fields[kStatMode]);
+    stbuf->st_size = Whole<off_t>(fields[kStatSize]);
+    stbuf->st_uid = Whole<uid_t>(fields[kStatUid]);
+    stbuf->st_gid = Whole<gid_t>(fields[kStatGid]);
+    stbuf->st_nlink = Whole<nlink_t>(fields[kStatNlink]);
+    SetTime(&stbuf->st_atim, fields[kStatAtimeSec], fields[kStatAtimeNsec]);
+    SetTime(&stbuf->st_mtim, fields[kStatMtimeSec], fields[kStatMtimeNsec]);
+    SetTime(&stbuf->st_ctim, fields[kStatCtimeSec], fields[kStatCtimeNsec]);
+    *ttl = fields[kStatTtl];
+}
+
+// Copy a JS stat reply into a zeroed struct stat: a Stats object, or a
+// Float64Array holding one entry of the binary layout, which is read without
+// a single property lookup. ttl is NaN unless the reply sets one. Returns
+// false for anything else.
+bool ParseJsStat(Napi::Value value, struct stat* stbuf, double* ttl) {
+    *ttl = NAN;
+    if (IsStatArray(value)) {
+        Napi::Float64Array fields = value.As<Napi::Float64Array>();
+        if (fields.ElementLength() < kStatFields) {
+            return false;
+        }
+        StatFromFields(fields.Data(), stbuf, ttl);
+        return true;
+    }
+    if (!value.IsObject()) {
+        return false;
+    }
+
+    // Absent fields come back undefined, so one Get each is enough
+    Napi::Object stat = value.As<Napi::Object>();
+    Napi::Value field = stat.Get("mode");
+    if (field.IsNumber()) {
+        stbuf->st_mode = Whole<mode_t>(field.As<Napi::Number>().DoubleValue());
+    }
+    field = stat.Get("size");
+    if (field.IsNumber()) {
+        stbuf->st_size = Whole<off_t>(field.As<Napi::Number>().DoubleValue());
+    }
+    field = stat.Get("uid");
+    if (field.IsNumber()) {
+        stbuf->st_uid = Whole<uid_t>(field.As<Napi::Number>().DoubleValue());
+    }
+    field = stat.Get("gid");
+    if (field.IsNumber()) {
+        stbuf->st_gid = Whole<gid_t>(field.As<Napi::Number>().DoubleValue());
+    }
+    field = stat.Get("nlink");
+    if (field.IsNumber()) {
+        stbuf->st_nlink = Whole<nlink_t>(field.As<Napi::Number>().DoubleValue());
+    }
+    ReadJsTime(stat.Get("mtime"), &stbuf->st_mtim);
+    ReadJsTime(stat.Get("atime"), &stbuf->st_atim);
+    ReadJsTime(stat.Get("ctime"), &stbuf->st_ctim);
+    field = stat.Get("ttl");
+    if (field.IsNumber()) {
+        *ttl = field.As<Napi::Number>().DoubleValue();
+    }
+    return true;
+}
+
+// Remember a parsed stat. Handlers may shorten or extend the lifetime of a
+// single entry by returning ttl (seconds).
+void CacheJsStat(AttrCache* cache, std::string_view path, const struct stat& stbuf, double ttl) {
+    if (!cache) {
+        return;
+    }
+    if (std::isnan(ttl)) {
+        cache->Insert(path, stbuf);
+    } else {
+        cache->Insert(path, stbuf, ttl);
+    }
+}
+
+bool ForEachJsEntry(const JsArgs& info, const JsEntryFn& each) {
+    Napi::Array list;
+    std::string packed;
+    std::vector<size_t> starts;  // of the names in packed
+    uint32_t count = 0;
+    if (info.Length() >= 2 && info[1].IsString()) {
+        packed = info[1].As<Napi::String>().Utf8Value();
+        for (size_t pos = 0; pos < packed.size();) {
+            size_t end = packed.find('\0', pos);
+            if (end == std::string::npos) {
+                end = packed.size();
+            }
+            if (end > pos) {
+                starts.push_back(pos);
+            }
+            pos = end + 1;
+        }
+        count = static_cast<uint32_t>(starts.size());
+    } else if (info.Length() >= 2 && info[1].IsArray()) {
+        list = info[1].As<Napi::Array>();
+        count = list.Length();
+    } else {
+        return false;
+    }
+
+    // Optional third argument: stats parallel to the names. Entries that are
+    // missing or not stats fall back to a plain name.
+    const double* fields = nullptr;
+    size_t fieldCount = 0;
+    Napi::Array stats;
+    uint32_t statCount = 0;
+    if (info.Length() > 2 && IsStatArray(info[2])) {
+        Napi::Float64Array array = info[2].As<Napi::Float64Array>();
+        fields = array.Data();
+        fieldCount = array.ElementLength();
+    } else if (info.Length() > 2 && info[2].IsArray()) {
+        stats = info[2].As<Napi::Array>();
+        statCount = stats.Length();
+    }
+
+    std::string name;
+    for (uint32_t i = 0; i < count; i++) {
+        if (list.IsEmpty()) {
+            name.assign(packed.c_str() + starts[i]);
+        } else {
+            name = list.Get(i).As<Napi::String>().Utf8Value();
+        }
+
+        struct stat st;
+        memset(&st, 0, sizeof(st));
+        double ttl = NAN;
+        bool known = false;
+        if (fields) {
+            size_t at = static_cast<size_t>(i) * kStatFields;
+            // Mode 0 is no file at all, so it marks an entry without stats
+            known = at + kStatFields <= fieldCount && fields[at + kStatMode] != 0;
+            if (known) {
+                StatFromFields(fields + at, &st, &ttl);
+            }
+        } else if (i < statCount) {
+            known = ParseJsStat(stats.Get(i), &st, &ttl);
+        }
+        each(name, known ? &st : nullptr, ttl);
+    }
+    return true;
+}
+
+// Arguments are copied for the JS thread: the worker may stop waiting (and
+// libfuse free the strings) before the handler runs
+template<typename T>
+struct HeldArg {
+    using Type = T;
+};
+
+template<>
+struct HeldArg<const char*> {
+    using Type = std::string;
 };
 
-extern std::unordered_map<std::string, std::unique_ptr<FuseContext>> g_contexts;
-extern std::mutex g_contexts_mutex;
-extern FuseContext* GetContextFromPath(const char* path);
+// The only string arguments are paths (rename's target)
+static napi_value ToJs(Napi::Env env, FuseContext* ctx, const std::string& value) {
+    return PathToJs(env, ctx, value);
+}
+
+static napi_value ToJs(Napi::Env env, FuseContext*, bool value) {
+    return Napi::Boolean::New(env, value);
+}
 
-// Helper to call JavaScript operation
+template<typename T>
+static napi_value ToJs(Napi::Env env, FuseContext*, T value) {
+    static_assert(std::is_arithmetic<T>::value, "unsupported JS argument type");
+    return Napi::Number::New(env, static_cast<double>(value));
+}
+
+// Calls ops[opName](path, args..., cb) and waits for cb(err). If fh is given,
+// the handle a successful open/create reports as cb(0, fd) is stored there
+// (see WorkerPool::MakeHandle), and whatever else it reports as third
+// argument in openReply. With route the call goes to the JS thread that
+// opened that handle instead of the one serving path.
 template<typename... Args>
-static int CallJsOperation(const std::string& opName, const char* path, Args&&... args) {
-    FuseContext* ctx = GetContextFromPath(path);
+static int CallJsOperationWithHandle(const std::string& opName, const char* path, const uint64_t* route,
+                                     uint64_t* fh, OpenReply* openReply, Args... args) {
+    FuseContext* ctx = CurrentContext();
     if (!ctx) return -EIO;
     
-    auto promise = std::make_shared<std::promise<int>>();
-    std::future<int> future = promise->get_future();
+    auto completion = std::make_shared<OpCompletion>();
+    std::future<int> future = completion->promise.get_future();
     
-    auto callback = [opName, path, promise, ctx, &args...](Napi::Env env, Napi::Function jsCallback) {
+    std::string key = path ? path : "";
+    std::tuple<typename HeldArg<Args>::Type...> held(args...);
+    StatOp op = CurrentOp();
+    auto callback = [opName, key, held, fh, openReply, op, completion, ctx](Napi::Env env) {
+        if (!completion->Started()) {
+            return;
+        }
         try {
-            Napi::Object ops = ctx->operations.Value();
+            Napi::Object ops = JsOperations(ctx);
             Napi::Value opFunc = ops.Get(opName);
             
             if (!opFunc.IsFunction()) {
-                promise->set_value(-ENOSYS);
+                completion->Complete(-ENOSYS);
                 return;
             }
             
-            // Create arguments array
-            std::vector<napi_value> jsArgs;
-            jsArgs.push_back(Napi::String::New(env, path));
-            
-            // Add additional arguments based on operation
-            // This is a simplified version - real implementation would handle each operation's specific args
+            std::vector<napi_value> jsArgs = std::apply([&](const auto&... values) {
+                return std::vector<napi_value>{ ToJs(env, ctx, key), ToJs(env, ctx, values)... };
+            }, held);
             
-            // Create callback for async result
-            auto resultCallback = Napi::Function::New(env, [promise](const Napi::CallbackInfo& info) {
-                if (info.Length() > 0 && info[0].IsNumber()) {
-                    promise->set_value(info[0].As<Napi::Number>().Int32Value());
-                } else {
-                    promise->set_value(0);
+            JsReply reply;
+            uint32_t owner = fh ? ctx->workers->IdOf(Dispatcher::Current()) : 0;
+            auto handler = [fh, openReply, owner, completion](const JsArgs& info) {
+                completion->cancel.Unwatch();
+                int result = info.Length() > 0 && info[0].IsNumber() ? info[0].As<Napi::Number>().Int32Value() : 0;
+                uint64_t handle = 0;
+                bool opened = fh && result >= 0 && info.Length() > 1 && info[1].IsNumber();
+                if (opened && !WorkerPool::MakeHandle(owner, info[1].As<Napi::Number>().Int64Value(), &handle)) {
+                    result = -EOVERFLOW;
+                    opened = false;
                 }
-            });
+                // fh and openReply belong to the waiting worker
+                completion->Complete(result, [&] {
+                    if (opened) {
+                        *fh = handle;
+                        if (openReply && info.Length() > 2) {
+                            ParseOpenReply(info[2], openReply);
+                        }
+                    }
+                });
+            };
+            bool hasReply = NewJsReply(env, ctx->requestSlots, op, handler, &reply);
+            if (!hasReply) {
+                completion->Complete(-EAGAIN);
+                return;
+            }
+            WatchForCancel(ctx, completion, reply);
             
-            jsArgs.push_back(resultCallback);
+            AddJsReply(reply, jsArgs);
             
-            // Call the JavaScript function
-            opFunc.As<Napi::Function>().Call(ops, jsArgs);
+            CallOp(env, ops, opName, opFunc.As<Napi::Function>(), jsArgs, FailOnThrow(completion, reply));
             
         } catch (...) {
-            promise->set_value(-EIO);
+            completion->Complete(-EIO);
         }
     };
     
-    ctx->tsfn.BlockingCall(callback);
-    return future.get();
+    napi_status status = route ? PostHandleJs(ctx, *route, key, std::move(callback), LaneOf(op))
+                               : PostJs(ctx, key, std::move(callback), LaneOf(op));
+    if (status != napi_ok) {
+        return -EIO;
+    }
+    return AwaitJs(ctx, completion, future, CurrentOp());
+}
+
+template<typename... Args>
+static int CallJsOperation(const std::string& opName, const char* path, Args... args) {
+    return CallJsOperationWithHandle(opName, path, nullptr, nullptr, nullptr, args...);
+}
+
+// Calls ops[opName](path, args..., fd, cb) on the JS thread that opened fh
+template<typename... Args>
+static int CallJsHandleOperation(const std::string& opName, const char* path, uint64_t fh, Args... args) {
+    return CallJsOperationWithHandle(opName, path, &fh, nullptr, nullptr, args..., WorkerPool::JsHandle(fh));
 }
 
-// FUSE operation implementations
 int fuse3_getattr(const char *path, struct stat *stbuf, struct fuse_file_info *fi) {
-    FuseContext* ctx = GetContextFromPath(path);
+    FuseContext* ctx = CurrentContext();
     if (!ctx) return -EIO;
     
+    FlushPendingWrites(ctx, path, StatOp::Getattr);
     memset(stbuf, 0, sizeof(struct stat));
     
-    auto promise = std::make_shared<std::promise<int>>();
-    std::future<int> future = promise->get_future();
+    // Served natively when fresh, without touching the Node event loop
+    AttrCache* cache = ctx->attrCache.get();
+    if (cache) {
+        int cachedErr = 0;
+        if (cache->Lookup(path, stbuf, &cachedErr)) {
+            return cachedErr;
+        }
+    }
+    ProbeFilter* filter = ctx->probeFilter.get();
+    if (filter && filter->Absorb(path)) {
+        return -ENOENT;
+    }
     
-    auto callback = [path, stbuf, promise, ctx](Napi::Env env, Napi::Function jsCallback) {
+    auto completion = std::make_shared<OpCompletion>();
+    std::future<int> future = completion->promise.get_future();
+    
+    auto callback = [path = std::string(path), stbuf, cache, filter, completion, ctx](Napi::Env env) {
+        if (!completion->Started()) {
+            return;
+        }
         try {
-            Napi::Object ops = ctx->operations.Value();
+            Napi::Object ops = JsOperations(ctx);
             Napi::Value getattr = ops.Get("getattr");
             
             if (!getattr.IsFunction()) {
                 // Default handling for root
-                if (strcmp(path, "/") == 0) {
-                    stbuf->st_mode = S_IFDIR | 0755;
-                    stbuf->st_nlink = 2;
-                    promise->set_value(0);
+                if (path == "/") {
+                    completion->Complete(0, [stbuf] {
+                        stbuf->st_mode = S_IFDIR | 0755;
+                        stbuf->st_nlink = 2;
+                    });
                 } else {
-                    promise->set_value(-ENOENT);
+                    completion->Complete(-ENOENT);
                 }
                 return;
             }
             
             // Create callback for result
-            auto resultCb = Napi::Function::New(env, [stbuf, promise](const Napi::CallbackInfo& info) {
-                if (info.Length() < 2) {
-                    promise->set_value(-EINVAL);
+            JsReply reply;
+            bool hasReply = NewJsReply(env, ctx->requestSlots, StatOp::Getattr,
+                                      [path, stbuf, cache, filter, completion](const JsArgs& info) {
+                completion->cancel.Unwatch();
+                if (info.Length() < 1) {
+                    completion->Complete(-EINVAL);
                     return;
                 }
                 
                 int err = info[0].As<Napi::Number>().Int32Value();
                 if (err != 0) {
-                    promise->set_value(err);
+                    if (cache && err == -ENOENT) {
+                        cache->InsertNegative(path, err);
+                    }
+                    if (filter && err == -ENOENT) {
+                        filter->Missing(path);
+                    }
+                    completion->Complete(err);
                     return;
                 }
-                
-                Napi::Object stat = info[1].As<Napi::Object>();
-                
-                // Parse stat object
-                if (stat.Has("mode")) {
-                    stbuf->st_mode = stat.Get("mode").As<Napi::Number>().Uint32Value();
-                }
-                if (stat.Has("size")) {
-                    stbuf->st_size = stat.Get("size").As<Napi::Number>().Int64Value();
-                }
-                if (stat.Has("uid")) {
-                    stbuf->st_uid = stat.Get("uid").As<Napi::Number>().Uint32Value();
-                }
-                if (stat.Has("gid")) {
-                    stbuf->st_gid = stat.Get("gid").As<Napi::Number>().Uint32Value();
-                }
-                if (stat.Has("mtime")) {
-                    stbuf->st_mtime = stat.Get("mtime").As<Napi::Number>().Int64Value();
-                }
-                if (stat.Has("atime")) {
-                    stbuf->st_atime = stat.Get("atime").As<Napi::Number>().Int64Value();
+                struct stat st;
+                memset(&st, 0, sizeof(st));
+                double ttl;
+                if (info.Length() < 2 || !ParseJsStat(info[1], &st, &ttl)) {
+                    completion->Complete(-EINVAL);
+                    return;
                 }
-                if (stat.Has("ctime")) {
-                    stbuf->st_ctime = stat.Get("ctime").As<Napi::Number>().Int64Value();
+                CacheJsStat(cache, path, st, ttl);
+                if (filter) {
+                    filter->Exists(path);
                 }
                 
-                promise->set_value(0);
-            });
+                completion->Complete(0, [stbuf, &st] { *stbuf = st; });
+            }, &reply);
+            if (!hasReply) {
+                completion->Complete(-EAGAIN);
+                return;
+            }
+            WatchForCancel(ctx, completion, reply);
             
-            getattr.As<Napi::Function>().Call(ops, {Napi::String::New(env, path), resultCb});
+            std::vector<napi_value> jsArgs{PathToJs(env, ctx, path)};
+            AddJsReply(reply, jsArgs);
+            CallOp(env, ops, "getattr", getattr.As<Napi::Function>(), jsArgs, FailOnThrow(completion, reply));
             
         } catch (...) {
-            promise->set_value(-EIO);
+            completion->Complete(-EIO);
         }
     };
     
-    ctx->tsfn.BlockingCall(callback);
-    return future.get();
+    if (PostJs(ctx, path, std::move(callback)) != napi_ok) {
+        return -EIO;
+    }
+    return AwaitJs(ctx, completion, future, StatOp::Getattr);
 }
 
 int fuse3_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
                   off_t offset, struct fuse_file_info *fi, enum fuse_readdir_flags flags) {
-    FuseContext* ctx = GetContextFromPath(path);
+    FuseContext* ctx = CurrentContext();
     if (!ctx) return -EIO;
     
-    auto promise = std::make_shared<std::promise<int>>();
-    std::future<int> future = promise->get_future();
+    auto completion = std::make_shared<OpCompletion>();
+    std::future<int> future = completion->promise.get_future();
     
-    auto callback = [path, buf, filler, promise, ctx](Napi::Env env, Napi::Function jsCallback) {
+    // Only hand out attributes when the kernel asked for READDIRPLUS
+    bool plus = (flags & FUSE_READDIR_PLUS) != 0;
+    AttrCache* cache = ctx->attrCache.get();
+    ProbeFilter* filter = ctx->probeFilter.get();
+    
+    auto callback = [path = std::string(path), buf, filler, plus, cache, filter, completion, ctx](Napi::Env env) {
+        if (!completion->Started()) {
+            return;
+        }
         try {
-            Napi::Object ops = ctx->operations.Value();
+            Napi::Object ops = JsOperations(ctx);
             Napi::Value readdir = ops.Get("readdir");
             
             if (!readdir.IsFunction()) {
-                promise->set_value(-ENOSYS);
+                completion->Complete(-ENOSYS);
                 return;
             }
             
-            auto resultCb = Napi::Function::New(env, [buf, filler, promise](const Napi::CallbackInfo& info) {
-                if (info.Length() < 2) {
-                    promise->set_value(-EINVAL);
+            JsReply reply;
+            bool hasReply = NewJsReply(env, ctx->requestSlots, StatOp::Readdir,
+                                      [path, buf, filler, plus, cache, filter, completion](const JsArgs& info) {
+                completion->cancel.Unwatch();
+                if (info.Length() < 1) {
+                    completion->Complete(-EINVAL);
                     return;
                 }
                 
                 int err = info[0].As<Napi::Number>().Int32Value();
                 if (err != 0) {
-                    promise->set_value(err);
+                    completion->Complete(err);
+                    return;
+                }
+                if (info.Length() < 2 || !(info[1].IsArray() || info[1].IsString())) {
+                    completion->Complete(-EINVAL);
                     return;
                 }
                 
-                Napi::Array files = info[1].As<Napi::Array>();
-                
-                // Add . and .. entries
-                filler(buf, ".", nullptr, 0, FUSE_FILL_DIR_PLUS);
-                filler(buf, "..", nullptr, 0, FUSE_FILL_DIR_PLUS);
+                // buf belongs to the waiting worker
+                completion->Complete(0, [&] {
+                    // Add . and .. entries
+                    filler(buf, ".", nullptr, 0, (enum fuse_fill_dir_flags)0);
+                    filler(buf, "..", nullptr, 0, (enum fuse_fill_dir_flags)0);
                 
-                // Add files from JavaScript
-                for (uint32_t i = 0; i < files.Length(); i++) {
-                    std::string filename = files.Get(i).As<Napi::String>().Utf8Value();
-                    filler(buf, filename.c_str(), nullptr, 0, FUSE_FILL_DIR_PLUS);
-                }
+                    std::string childPath(path);
+                    if (childPath.back() != '/') {
+                        childPath += '/';
+                    }
+                    size_t dirLength = childPath.size();
                 
-                promise->set_value(0);
-            });
+                    // Add files from JavaScript
+                    ForEachJsEntry(info, [&](std::string& filename, const struct stat* st, double ttl) {
+                        childPath.resize(dirLength);
+                        childPath += filename;
+                        if (filter) {
+                            filter->Exists(childPath);
+                        }
+                        if (!st) {
+                            filler(buf, filename.c_str(), nullptr, 0, (enum fuse_fill_dir_flags)0);
+                            return;
+                        }
+                    
+                        // Prime the attribute cache so the lookups that follow a
+                        // listing (ls -l, Explorer details view) stay native
+                        CacheJsStat(cache, childPath, *st, ttl);
+                    
+                        if (plus) {
+                            filler(buf, filename.c_str(), st, 0, FUSE_FILL_DIR_PLUS);
+                        } else {
+                            filler(buf, filename.c_str(), st, 0, (enum fuse_fill_dir_flags)0);
+                        }
+                    });
+                });
+            }, &reply);
+            if (!hasReply) {
+                completion->Complete(-EAGAIN);
+                return;
+            }
+            WatchForCancel(ctx, completion, reply);
             
-            readdir.As<Napi::Function>().Call(ops, {Napi::String::New(env, path), resultCb});
+            std::vector<napi_value> jsArgs{PathToJs(env, ctx, path)};
+            AddJsReply(reply, jsArgs);
+            CallOp(env, ops, "readdir", readdir.As<Napi::Function>(), jsArgs, FailOnThrow(completion, reply));
             
         } catch (...) {
-            promise->set_value(-EIO);
+            completion->Complete(-EIO);
         }
     };
     
-    ctx->tsfn.BlockingCall(callback);
-    return future.get();
+    if (PostJs(ctx, path, std::move(callback)) != napi_ok) {
+        return -EIO;
+    }
+    return AwaitJs(ctx, completion, future, StatOp::Readdir);
+}
+
+// Calls ops[name](path, cb) for the prewarmer as background work of the
+// thread serving path; not counted as operations. Every way the call can
+// end reaches done, as failed unless the handler answered.
+static void CallPrewarm(FuseContext* ctx, const char* name, StatOp op, const std::string& path,
+                        RequestSlots::Handler handler, std::function<void(int err)> failed) {
+    napi_status status = PostJs(ctx, path, [ctx, name, op, path, handler, failed](Napi::Env env) {
+        Napi::Object ops = JsOperations(ctx);
+        Napi::Value fn = ops.Get(name);
+        if (!fn.IsFunction()) {
+            failed(-ENOSYS);
+            return;
+        }
+        JsReply reply;
+        if (!NewJsReply(env, ctx->requestSlots, op, handler, &reply)) {
+            failed(-EAGAIN);
+            return;
+        }
+        std::vector<napi_value> args{PathToJs(env, ctx, path)};
+        AddJsReply(reply, args);
+        CallOp(env, ops, name, fn.As<Napi::Function>(), args, [failed, reply]() {
+            ReleaseJsReply(reply);
+            failed(-EIO);
+        });
+    }, Dispatcher::Lane::Background);
+    if (status != napi_ok) {
+        failed(-EIO);
+    }
+}
+
+// Answers go into the attr cache and the probe filter like those of the
+// kernel's requests
+std::shared_ptr<Prewarmer> NewPrewarmer(FuseContext* ctx, const Prewarmer::Options& options,
+                                        Prewarmer::ProgressFn progress) {
+    auto list = [ctx](const std::string& path, Prewarmer::ListDone done) {
+        CallPrewarm(ctx, "readdir", StatOp::Readdir, path, [ctx, path, done](const JsArgs& info) {
+            int err = info.Length() > 0 && info[0].IsNumber() ? info[0].As<Napi::Number>().Int32Value() : 0;
+            std::vector<Prewarmer::Child> children;
+            if (err == 0) {
+                std::string childPath(path);
+                if (childPath.back() != '/') {
+                    childPath += '/';
+                }
+                size_t dirLength = childPath.size();
+                bool listed = ForEachJsEntry(info, [&](std::string& name, const struct stat* st, double ttl) {
+                    childPath.resize(dirLength);
+                    childPath += name;
+                    if (ctx->probeFilter) {
+                        ctx->probeFilter->Exists(childPath);
+                    }
+                    if (st) {
+                        CacheJsStat(ctx->attrCache.get(), childPath, *st, ttl);
+                    }
+                    children.push_back(Prewarmer::Child{std::move(name), st != nullptr, st && S_ISDIR(st->st_mode)});
+                });
+                err = listed ? 0 : -EINVAL;
+            }
+            done(err < 0 ? err : 0, children);
+        }, [done](int err) { done(err, {}); });
+    };
+
+    auto stat = [ctx](const std::string& path, Prewarmer::StatDone done) {
+        CallPrewarm(ctx, "getattr", StatOp::Getattr, path, [ctx, path, done](const JsArgs& info) {
+            int err = info.Length() > 0 && info[0].IsNumber() ? info[0].As<Napi::Number>().Int32Value() : 0;
+            struct stat st;
+            memset(&st, 0, sizeof(st));
+            double ttl;
+            if (err == 0 && !ParseJsStat(info[1], &st, &ttl)) {
+                err = -EINVAL;
+            }
+            if (err < 0) {
+                done(err, false);
+                return;
+            }
+            CacheJsStat(ctx->attrCache.get(), path, st, ttl);
+            if (ctx->probeFilter) {
+                ctx->probeFilter->Exists(path);
+            }
+            done(0, S_ISDIR(st.st_mode));
+        }, [done](int err) { done(err, false); });
+    };
+
+    return std::make_shared<Prewarmer>(options, list, stat, std::move(progress));
+}
+
+// Runs on the JS thread, while a backing fd the handler reports is still
+// open; JS may close its own copy as soon as the callback returns.
+void ParseOpenReply(Napi::Value value, OpenReply* reply) {
+    if (value.IsString()) {
+        reply->contentHash = value.As<Napi::String>().Utf8Value();
+        return;
+    }
+    if (!value.IsObject()) {
+        return;
+    }
+
+    Napi::Object object = value.As<Napi::Object>();
+    Napi::Value hash = object.Get("contentHash");
+    if (hash.IsString()) {
+        reply->contentHash = hash.As<Napi::String>().Utf8Value();
+    }
+    Napi::Value fd = object.Get("backingFd");
+    Napi::Value offset = object.Get("backingOffset");
+    if (fd.IsNumber() && fd.As<Napi::Number>().Int32Value() >= 0) {
+        reply->backing.fd = fcntl(fd.As<Napi::Number>().Int32Value(), F_DUPFD_CLOEXEC, 0);
+        if (offset.IsNumber() && offset.As<Napi::Number>().Int64Value() > 0) {
+            reply->backing.offset = offset.As<Napi::Number>().Int64Value();
+        }
+    }
+}
+
+// Content hashes and backing files only describe read-only opens. Handles
+// may be reused once released, so a handle never inherits either. Always
+// takes ownership of the backing fd.
+void BindOpenReply(FuseContext* ctx, uint64_t fh, int flags, OpenReply& reply) {
+    bool readOnly = (flags & O_ACCMODE) == O_RDONLY;
+    if (ctx->contentCache) {
+        if (readOnly && !reply.contentHash.empty()) {
+            ctx->contentCache->Bind(fh, reply.contentHash);
+        } else {
+            ctx->contentCache->Unbind(fh);
+        }
+    }
+
+    if (readOnly && reply.backing.fd >= 0) {
+        ctx->backingFiles.Attach(fh, reply.backing);
+    } else {
+        BackingFiles::File stale;
+        if (ctx->backingFiles.Detach(fh, &stale)) {
+            BackingFiles::Close(stale);
+        }
+        BackingFiles::Close(reply.backing);
+    }
+    reply.backing.fd = -1;
+}
+
+void FlushPendingWrites(FuseContext* ctx, const char* path, StatOp op) {
+    if (ctx && ctx->writeBuffer) {
+        ctx->writeBuffer->FlushPath(path, ctx->deadlines.Deadline(op));
+    }
+}
+
+void UnbindHandle(FuseContext* ctx, uint64_t fh) {
+    if (ctx->readahead) {
+        ctx->readahead->Release(fh);
+    }
+    if (ctx->contentCache) {
+        ctx->contentCache->Unbind(fh);
+    }
+    BackingFiles::File backing;
+    if (ctx->backingFiles.Detach(fh, &backing)) {
+        BackingFiles::Close(backing);
+    }
 }
 
 int fuse3_open(const char *path, struct fuse_file_info *fi) {
-    return CallJsOperation("open", path, fi->flags);
+    OpenReply reply;
+    int res = CallJsOperationWithHandle("open", path, nullptr, &fi->fh, &reply, fi->flags);
+    if (res >= 0) {
+        BindOpenReply(CurrentContext(), fi->fh, fi->flags, reply);
+    }
+    return res;
 }
 
-int fuse3_read(const char *path, char *buf, size_t size, off_t offset,
-               struct fuse_file_info *fi) {
-    FuseContext* ctx = GetContextFromPath(path);
-    if (!ctx) return -EIO;
+// The byte count (or a negative errno) of a read and where the bytes are:
+// in the buf given to StartJsRead, or in memory of JS that is only valid
+// during the call
+using ReadDone = std::function<void(int result, const char* data)>;
+
+// Calls ops.read(path, fd, buffer, size, offset, cb) on the JS thread. With
+// zero_copy_read the handler gets an external Buffer over buf, which is
+// detached again before done runs. Otherwise (or where the runtime refuses
+// external buffers, or buf is null) it gets a Buffer of its own. watch, if
+// given, is the request ops.cancel is told about.
+static void StartJsRead(Napi::Env env, FuseContext* ctx, const char* path, uint64_t fh,
+                        char* buf, size_t size, off_t offset, ReadDone done,
+                        const std::shared_ptr<OpCompletion>& watch = nullptr) {
+    Napi::Object ops = JsOperations(ctx);
+    Napi::Value read = ops.Get("read");
+    if (!read.IsFunction()) {
+        done(-ENOSYS, nullptr);
+        return;
+    }
     
-    auto promise = std::make_shared<std::promise<int>>();
-    std::future<int> future = promise->get_future();
+    Napi::Buffer<char> buffer;
+    bool external = buf && ctx->zeroCopyRead && NewExternalBuffer(env, buf, size, buffer);
+    if (!external) {
+        buffer = Napi::Buffer<char>::New(env, size);
+    }
+    auto jsBuffer = std::make_shared<Napi::Reference<Napi::Buffer<char>>>(
+        Napi::Reference<Napi::Buffer<char>>::New(buffer, 1));
+    auto called = std::make_shared<bool>(false);
     
-    auto callback = [path, buf, size, offset, fi, promise, ctx](Napi::Env env, Napi::Function jsCallback) {
-        try {
-            Napi::Object ops = ctx->operations.Value();
-            Napi::Value read = ops.Get("read");
-            
-            if (!read.IsFunction()) {
-                promise->set_value(-ENOSYS);
+    // buf goes away once done ran
+    auto finish = [external, jsBuffer, called, done](int result, const char* data) {
+        if (*called) {
+            return;
+        }
+        *called = true;
+        if (external) {
+            DetachBuffer(jsBuffer->Value());
+        }
+        done(result, data);
+    };
+    
+    JsReply reply;
+    bool hasReply = NewJsReply(env, ctx->requestSlots, StatOp::Read,
+                              [buf, size, external, jsBuffer, finish, watch](const JsArgs& info) {
+        if (watch) {
+            watch->cancel.Unwatch();
+        }
+        int err = info.Length() > 0 && info[0].IsNumber() ? info[0].As<Napi::Number>().Int32Value() : 0;
+        if (err < 0) {
+            finish(err, nullptr);
+            return;
+        }
+        
+        if (info.Length() > 1 && info[1].IsNumber()) {
+            // cb(err, bytesRead): the data is in the Buffer we passed.
+            int64_t bytesRead = info[1].As<Napi::Number>().Int64Value();
+            if (bytesRead < 0) {
+                finish(-EIO, nullptr);
                 return;
             }
-            
-            auto resultCb = Napi::Function::New(env, [buf, size, promise](const Napi::CallbackInfo& info) {
-                if (info.Length() < 2) {
-                    promise->set_value(-EINVAL);
-                    return;
-                }
-                
-                int err = info[0].As<Napi::Number>().Int32Value();
-                if (err < 0) {
-                    promise->set_value(err);
-                    return;
-                }
-                
-                if (info[1].IsBuffer()) {
-                    Napi::Buffer<char> buffer = info[1].As<Napi::Buffer<char>>();
-                    size_t bytesRead = std::min(size, buffer.Length());
-                    memcpy(buf, buffer.Data(), bytesRead);
-                    promise->set_value(bytesRead);
-                } else {
-                    promise->set_value(0);
-                }
-            });
-            
-            Napi::Buffer<char> buffer = Napi::Buffer<char>::New(env, size);
-            
-            read.As<Napi::Function>().Call(ops, {
-                Napi::String::New(env, path),
-                Napi::Number::New(env, fi->fh),
-                buffer,
-                Napi::Number::New(env, size),
-                Napi::Number::New(env, offset),
-                resultCb
-            });
-            
+            bytesRead = std::min<int64_t>(bytesRead, size);
+            finish(static_cast<int>(bytesRead), external ? buf : jsBuffer->Value().Data());
+        } else if (info.Length() > 1 && info[1].IsBuffer()) {
+            // Older handlers return a Buffer of their own.
+            Napi::Buffer<char> result = info[1].As<Napi::Buffer<char>>();
+            size_t bytesRead = std::min(size, result.Length());
+            finish(static_cast<int>(bytesRead), result.Data());
+        } else {
+            finish(0, nullptr);
+        }
+    }, &reply);
+    if (!hasReply) {
+        finish(-EAGAIN, nullptr);
+        return;
+    }
+    if (watch) {
+        WatchForCancel(ctx, watch, reply);
+    }
+    
+    std::vector<napi_value> args{
+        PathToJs(env, ctx, path),
+        Napi::Number::New(env, WorkerPool::JsHandle(fh)),
+        buffer,
+        Napi::Number::New(env, size),
+        Napi::Number::New(env, offset)
+    };
+    AddJsReply(reply, args);
+    CallOp(env, ops, "read", read.As<Napi::Function>(), args, [finish, watch, reply]() {
+        ReleaseJsReply(reply);
+        if (watch) {
+            watch->cancel.Unwatch();
+        }
+        finish(-EIO, nullptr);
+    });
+}
+
+// Copies what a read delivered into buf, unless it is there already
+static void CopyRead(char* buf, int result, const char* data) {
+    if (result > 0 && data != buf) {
+        memcpy(buf, data, result);
+    }
+}
+
+static int ReadFromJs(FuseContext* ctx, const char *path, uint64_t fh, char *buf, size_t size, off_t offset) {
+    auto completion = std::make_shared<OpCompletion>();
+    std::future<int> future = completion->promise.get_future();
+    
+    // libfuse frees buf as soon as the worker returns. That is after JS
+    // called back, unless a deadline or an interrupt ends the wait: then JS
+    // never gets to see buf and the data is copied in while the worker waits.
+    char* lent = ctx->deadlines.Enabled() ? nullptr : buf;
+    auto callback = [path = std::string(path), fh, buf, lent, size, offset, completion, ctx](Napi::Env env) {
+        if (!completion->Started()) {
+            return;
+        }
+        try {
+            StartJsRead(env, ctx, path.c_str(), fh, lent, size, offset, [completion, buf](int result, const char* data) {
+                completion->Complete(result, [&] { CopyRead(buf, result, data); });
+            }, completion);
         } catch (...) {
-            promise->set_value(-EIO);
+            completion->Complete(-EIO);
         }
     };
     
-    ctx->tsfn.BlockingCall(callback);
-    return future.get();
+    if (PostHandleJs(ctx, fh, path, std::move(callback), Dispatcher::Lane::Data) != napi_ok) {
+        return -EIO;
+    }
+    return AwaitJs(ctx, completion, future, StatOp::Read);
 }
 
-int fuse3_write(const char *path, const char *buf, size_t size, off_t offset,
-                struct fuse_file_info *fi) {
-    FuseContext* ctx = GetContextFromPath(path);
+// Readahead fetches, in the data lane as a sequential reader waits for the
+// block it is served from; never waits for JS and are not counted as
+// operations
+static void ReadFromJsAsync(FuseContext* ctx, const std::string& path, uint64_t fh, char* buf, size_t size,
+                            off_t offset, std::function<void(int)> done) {
+    napi_status status = PostHandleJs(ctx, fh, path, [ctx, path, fh, buf, size, offset, done](Napi::Env env) {
+        try {
+            StartJsRead(env, ctx, path.c_str(), fh, buf, size, offset, [buf, done](int result, const char* data) {
+                CopyRead(buf, result, data);
+                done(result);
+            });
+        } catch (...) {
+            done(-EIO);
+        }
+    }, Dispatcher::Lane::Data);
+    if (status != napi_ok) {
+        done(-EIO);
+    }
+}
+
+std::shared_ptr<Readahead> NewReadahead(FuseContext* ctx, const Readahead::Options& options) {
+    return std::make_shared<Readahead>(
+        options,
+        [ctx](const std::string& path, uint64_t fh, char* dst, size_t size, off_t offset, Readahead::Done done) {
+            ReadFromJsAsync(ctx, path, fh, dst, size, offset, std::move(done));
+        });
+}
+
+// Serves a read from the readahead if it has (or is fetching) the data.
+// The data may still arrive after a deadline or an interrupt ended the wait,
+// so it is then delivered into memory of its own and copied out while the
+// worker waits.
+static bool ReadAhead(FuseContext* ctx, const char* path, uint64_t fh, char* buf, size_t size, off_t offset,
+                      int* res) {
+    auto completion = std::make_shared<OpCompletion>();
+    std::future<int> future = completion->promise.get_future();
+    std::shared_ptr<char> scratch;
+    char* dst = buf;
+    if (ctx->deadlines.Enabled()) {
+        scratch.reset(new char[size > 0 ? size : 1], std::default_delete<char[]>());
+        dst = scratch.get();
+    }
+    bool served = ctx->readahead->Read(path, fh, dst, size, offset, [completion, scratch, buf](int result) {
+        completion->Complete(result, [&] { CopyRead(buf, result, scratch ? scratch.get() : buf); });
+    });
+    if (!served) {
+        return false;
+    }
+    *res = AwaitJs(ctx, completion, future, StatOp::Read);
+    return true;
+}
+
+int fuse3_read(const char *path, char *buf, size_t size, off_t offset,
+               struct fuse_file_info *fi) {
+    FuseContext* ctx = CurrentContext();
     if (!ctx) return -EIO;
+    FlushPendingWrites(ctx, path, StatOp::Read);
+
+    std::string hash;
+    ContentCache* cache = ctx->contentCache.get();
+    if (!cache || !cache->HashOf(fi->fh, &hash)) {
+        // Sequential readers are served from data fetched ahead of them
+        int res;
+        if (ctx->readahead && ReadAhead(ctx, path, fi->fh, buf, size, offset, &res)) {
+            return res;
+        }
+        return ReadFromJs(ctx, path, fi->fh, buf, size, offset);
+    }
+
+    std::vector<ContentCache::Slice> slices;
+    if (cache->Lookup(hash, offset, size, &slices)) {
+        return static_cast<int>(ContentCache::CopySlices(slices, buf));
+    }
+
+    // Read whole chunks so later reads of the same content, through this or
+    // any other path, are served from the cache.
+    const size_t chunk = ContentCache::kChunkSize;
+    off_t start = offset - offset % chunk;
+    size_t length = (offset + size - start + chunk - 1) / chunk * chunk;
+    std::unique_ptr<char[]> chunks(new char[length]);
+    int res = ReadFromJs(ctx, path, fi->fh, chunks.get(), length, start);
+    if (res < 0) {
+        return res;
+    }
+    cache->Insert(hash, start, chunks.get(), res, static_cast<size_t>(res) < length);
+
+    size_t skip = offset - start;
+    if (static_cast<size_t>(res) <= skip) {
+        return 0;
+    }
+    size_t bytesRead = std::min(size, res - skip);
+    memcpy(buf, chunks.get() + skip, bytesRead);
+    return static_cast<int>(bytesRead);
+}
+
+// libfuse prefers read_buf over read. Handles backed by a host file are
+// answered with an fd buffer that libfuse splices (or preads) straight into
+// the reply; everything else is read through fuse3_read into our own memory,
+// which libfuse frees.
+int fuse3_read_buf(const char *path, struct fuse_bufvec **bufp, size_t size, off_t offset,
+                   struct fuse_file_info *fi) {
+    FuseContext* ctx = CurrentContext();
+    if (!ctx) return -EIO;
+
+    struct fuse_bufvec* bufv = static_cast<struct fuse_bufvec*>(malloc(sizeof(struct fuse_bufvec)));
+    if (!bufv) return -ENOMEM;
+    *bufv = FUSE_BUFVEC_INIT(size);
+
+    BackingFiles::File backing;
+    if (ctx->backingFiles.Find(fi->fh, &backing)) {
+        bufv->buf[0].flags = static_cast<enum fuse_buf_flags>(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+        bufv->buf[0].fd = backing.fd;
+        bufv->buf[0].pos = backing.offset + offset;
+        *bufp = bufv;
+        CountBytes(size);
+        return 0;
+    }
+
+    char* mem = static_cast<char*>(malloc(size > 0 ? size : 1));
+    if (!mem) {
+        free(bufv);
+        return -ENOMEM;
+    }
+    int res = fuse3_read(path, mem, size, offset, fi);
+    if (res < 0) {
+        free(mem);
+        free(bufv);
+        return res;
+    }
+    bufv->buf[0].mem = mem;
+    bufv->buf[0].size = res;
+    *bufp = bufv;
+    CountBytes(res);
+    return 0;
+}
+
+// Calls ops.write(path, fd, buffer, size, offset, cb) on the JS thread with
+// an external Buffer over data, which is detached again before done runs,
+// or with copy if given. watch, if given, is the request ops.cancel is told
+// about.
+static void StartJsWrite(Napi::Env env, FuseContext* ctx, const char* path, uint64_t fh,
+                         char* data, size_t size, off_t offset, std::function<void(int)> done,
+                         const std::shared_ptr<OpCompletion>& watch = nullptr,
+                         Napi::Buffer<char> copy = Napi::Buffer<char>()) {
+    Napi::Object ops = JsOperations(ctx);
+    Napi::Value write = ops.Get("write");
+    if (!write.IsFunction()) {
+        done(-ENOSYS);
+        return;
+    }
     
-    auto promise = std::make_shared<std::promise<int>>();
-    std::future<int> future = promise->get_future();
+    Napi::Buffer<char> buffer = copy;
+    bool external = copy.IsEmpty() && NewExternalBuffer(env, data, size, buffer);
+    if (!external && buffer.IsEmpty()) {
+        buffer = Napi::Buffer<char>::Copy(env, data, size);
+    }
+    auto jsBuffer = std::make_shared<Napi::Reference<Napi::Buffer<char>>>(
+        Napi::Reference<Napi::Buffer<char>>::New(buffer, 1));
+    auto called = std::make_shared<bool>(false);
     
-    auto callback = [path, buf, size, offset, fi, promise, ctx](Napi::Env env, Napi::Function jsCallback) {
-        try {
-            Napi::Object ops = ctx->operations.Value();
-            Napi::Value write = ops.Get("write");
-            
-            if (!write.IsFunction()) {
-                promise->set_value(-ENOSYS);
-                return;
-            }
-            
-            auto resultCb = Napi::Function::New(env, [promise](const Napi::CallbackInfo& info) {
-                if (info.Length() < 1) {
-                    promise->set_value(-EINVAL);
-                    return;
+    auto finish = [external, jsBuffer, called, done](int result) {
+        if (*called) {
+            return;
+        }
+        *called = true;
+        if (external) {
+            DetachBuffer(jsBuffer->Value());
+        }
+        done(result);
+    };
+    
+    JsReply reply;
+    bool hasReply = NewJsReply(env, ctx->requestSlots, StatOp::Write, [size, finish, watch](const JsArgs& info) {
+        if (watch) {
+            watch->cancel.Unwatch();
+        }
+        finish(ParseWriteResult(info, size));
+    }, &reply);
+    if (!hasReply) {
+        finish(-EAGAIN);
+        return;
+    }
+    if (watch) {
+        WatchForCancel(ctx, watch, reply);
+    }
+    
+    std::vector<napi_value> args{
+        PathToJs(env, ctx, path),
+        Napi::Number::New(env, WorkerPool::JsHandle(fh)),
+        buffer,
+        Napi::Number::New(env, size),
+        Napi::Number::New(env, offset)
+    };
+    AddJsReply(reply, args);
+    CallOp(env, ops, "write", write.As<Napi::Function>(), args, [finish, watch, reply]() {
+        ReleaseJsReply(reply);
+        if (watch) {
+            watch->cancel.Unwatch();
+        }
+        finish(-EIO);
+    });
+}
+
+int WriteToJs(FuseContext* ctx, const char* path, uint64_t fh, const char* data, size_t size, off_t offset) {
+    auto completion = std::make_shared<OpCompletion>();
+    std::future<int> future = completion->promise.get_future();
+    
+    // data stays valid until this returns, which is after JS called back.
+    // With deadlines the wait may end before; JS then gets a copy, taken
+    // while the worker still waits.
+    char* mutableData = const_cast<char*>(data);
+    auto callback = [path = std::string(path), fh, mutableData, size, offset, completion, ctx](Napi::Env env) {
+        Napi::Buffer<char> copy;
+        bool lend = !ctx->deadlines.Enabled();
+        if (!completion->Started([&] {
+                if (!lend) {
+                    copy = Napi::Buffer<char>::Copy(env, mutableData, size);
                 }
-                
-                int result = info[0].As<Napi::Number>().Int32Value();
-                promise->set_value(result);
-            });
-            
-            Napi::Buffer<char> buffer = Napi::Buffer<char>::Copy(env, buf, size);
-            
-            write.As<Napi::Function>().Call(ops, {
-                Napi::String::New(env, path),
-                Napi::Number::New(env, fi->fh),
-                buffer,
-                Napi::Number::New(env, size),
-                Napi::Number::New(env, offset),
-                resultCb
-            });
-            
+            })) {
+            return;
+        }
+        try {
+            StartJsWrite(env, ctx, path.c_str(), fh, mutableData, size, offset, [completion](int result) {
+                completion->Complete(result);
+            }, completion, copy);
         } catch (...) {
-            promise->set_value(-EIO);
+            completion->Complete(-EIO);
         }
     };
     
-    ctx->tsfn.BlockingCall(callback);
-    return future.get();
+    if (PostHandleJs(ctx, fh, path, std::move(callback), Dispatcher::Lane::Data) != napi_ok) {
+        return -EIO;
+    }
+    int res = AwaitJs(ctx, completion, future, StatOp::Write);
+    InvalidateAttrs(ctx, path);
+    return res;
+}
+
+// Used for timed write-outs of the write buffer, in the data lane as the
+// data may be waited for by a flush; never waits for JS
+static void WriteToJsAsync(FuseContext* ctx, WriteBuffer::ExtentPtr extent, std::function<void(int)> done) {
+    napi_status status = PostHandleJs(ctx, extent->fh, extent->path, [ctx, extent, done](Napi::Env env) {
+        auto finish = [ctx, extent, done](int result) {
+            InvalidateAttrs(ctx, extent->path.c_str());
+            done(result);
+        };
+        try {
+            StartJsWrite(env, ctx, extent->path.c_str(), extent->fh, extent->data.data(),
+                         extent->data.size(), extent->offset, finish);
+        } catch (...) {
+            finish(-EIO);
+        }
+    }, Dispatcher::Lane::Data);
+    if (status != napi_ok) {
+        done(-EIO);
+    }
+}
+
+std::shared_ptr<WriteBuffer> NewWriteBuffer(FuseContext* ctx, const WriteBuffer::Options& options) {
+    WriteBuffer::Options bounded = options;
+    bounded.timeoutErr = ctx->deadlines.timeoutErr;
+    return std::make_shared<WriteBuffer>(
+        bounded,
+        [ctx](const std::string& path, uint64_t fh, const char* data, size_t size, off_t offset) {
+            return WriteToJs(ctx, path.c_str(), fh, data, size, offset);
+        },
+        [ctx](WriteBuffer::ExtentPtr extent, std::function<void(int)> done) {
+            WriteToJsAsync(ctx, std::move(extent), std::move(done));
+        });
+}
+
+// Incoming write data is a fuse_bufvec. A single in-memory buffer, the usual
+// case, is handed to JS without copying. Data spliced into a pipe (or split
+// over several buffers) is first gathered into a per-worker scratch buffer.
+// Either way the memory stays valid until the worker returns, which is after
+// JS called back.
+int fuse3_write_buf(const char *path, struct fuse_bufvec *bufv, off_t offset,
+                    struct fuse_file_info *fi) {
+    FuseContext* ctx = CurrentContext();
+    if (!ctx) return -EIO;
+    
+    char* data;
+    size_t size;
+    if (bufv->count == 1 && !(bufv->buf[0].flags & FUSE_BUF_IS_FD)) {
+        data = static_cast<char*>(bufv->buf[0].mem) + bufv->off;
+        size = bufv->buf[0].size - bufv->off;
+    } else {
+        thread_local std::vector<char> scratch;
+        size = fuse_buf_size(bufv);
+        if (scratch.size() < size) {
+            scratch.resize(size);
+        }
+        struct fuse_bufvec dst = FUSE_BUFVEC_INIT(size);
+        dst.buf[0].mem = scratch.data();
+        ssize_t copied = fuse_buf_copy(&dst, bufv, static_cast<enum fuse_buf_copy_flags>(0));
+        if (copied < 0) {
+            return static_cast<int>(copied);
+        }
+        data = scratch.data();
+        size = static_cast<size_t>(copied);
+    }
+    
+    if (ctx->writeBuffer) {
+        return ctx->writeBuffer->Write(path, fi->fh, data, size, offset, ctx->deadlines.Deadline(StatOp::Write));
+    }
+    return WriteToJs(ctx, path, fi->fh, data, size, offset);
+}
+
+// Options the kernel only takes at mount time
+void AddMountOptions(FuseContext* ctx, struct fuse_args* args) {
+    if (ctx->conn.maxRead > 0) {
+        std::string option = "-omax_read=" + std::to_string(ctx->conn.maxRead);
+        fuse_opt_add_arg(args, option.c_str());
+    }
+}
+
+static void SetCapability(struct fuse_conn_info* conn, unsigned int capability, bool on) {
+    if (on && (conn->capable & capability)) {
+        conn->want |= capability;
+    } else {
+        conn->want &= ~capability;
+    }
+}
+
+// Splicing write data out of /dev/fuse only pays off when the data does not
+// have to be read back into memory for JS, so it is opt-in (splice_read).
+// What was negotiated is kept for getConnectionInfo().
+void ApplyConnectionOptions(FuseContext* ctx, struct fuse_conn_info* conn) {
+    if (!ctx) {
+        return;
+    }
+    const FuseConnOptions& options = ctx->conn;
+    SetCapability(conn, FUSE_CAP_ASYNC_READ, options.asyncRead);
+    SetCapability(conn, FUSE_CAP_PARALLEL_DIROPS, options.parallelDirops);
+    if (options.maxRead > 0) {
+        conn->max_read = options.maxRead;
+    }
+    if (options.maxWrite > 0) {
+        conn->max_write = options.maxWrite;
+    }
+    if (options.maxReadahead > 0) {
+        conn->max_readahead = options.maxReadahead;
+    }
+    if (options.maxBackground > 0) {
+        conn->max_background = options.maxBackground;
+    }
+    if (options.congestionThreshold > 0) {
+        conn->congestion_threshold = options.congestionThreshold;
+    }
+
+    SetCapability(conn, FUSE_CAP_SPLICE_READ, ctx->spliceRead);
+    SetCapability(conn, FUSE_CAP_WRITEBACK_CACHE, ctx->writebackCache);
+#ifdef FUSE_CAP_PASSTHROUGH
+    // libfuse (3.16) only supports passthrough through fuse_lowlevel, and the
+    // kernel does not combine it with the writeback cache
+    if (ctx->lowLevel && ctx->passthrough && !(conn->want & FUSE_CAP_WRITEBACK_CACHE) &&
+        (conn->capable & FUSE_CAP_PASSTHROUGH)) {
+        conn->want |= FUSE_CAP_PASSTHROUGH;
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(ctx->negotiatedMutex);
+    ctx->negotiated = *conn;
+    ctx->connected = true;
+}
+
+void* fuse3_init(struct fuse_conn_info *conn, struct fuse_config *cfg) {
+    FuseContext* ctx = CurrentContext();
+    if (ctx) {
+        cfg->entry_timeout = ctx->conn.entryTimeout;
+        cfg->attr_timeout = ctx->conn.attrTimeout;
+        cfg->negative_timeout = ctx->conn.negativeTimeout;
+        cfg->kernel_cache = ctx->conn.kernelCache;
+        cfg->auto_cache = ctx->conn.autoCache;
+    }
+    ApplyConnectionOptions(ctx, conn);
+    return fuse_get_context()->private_data;
 }
 
 // Simplified implementations for other operations
 int fuse3_create(const char *path, mode_t mode, struct fuse_file_info *fi) {
-    return CallJsOperation("create", path, mode);
+    int res = CallJsOperationWithHandle("create", path, nullptr, &fi->fh, nullptr, mode);
+    InvalidateAttrs(CurrentContext(), path, true);
+    return res;
 }
 
 int fuse3_unlink(const char *path) {
-    return CallJsOperation("unlink", path);
+    FlushPendingWrites(CurrentContext(), path, StatOp::Unlink);
+    int res = CallJsOperation("unlink", path);
+    InvalidateAttrs(CurrentContext(), path, true);
+    return res;
 }
 
 int fuse3_mkdir(const char *path, mode_t mode) {
-    return CallJsOperation("mkdir", path, mode);
+    int res = CallJsOperation("mkdir", path, mode);
+    InvalidateAttrs(CurrentContext(), path, true);
+    return res;
 }
 
 int fuse3_rmdir(const char *path) {
-    return CallJsOperation("rmdir", path);
+    int res = CallJsOperation("rmdir", path);
+    InvalidateAttrTree(CurrentContext(), path);
+    return res;
 }
 
 int fuse3_rename(const char *from, const char *to, unsigned int flags) {
-    return CallJsOperation("rename", from, to);
+    FlushPendingWrites(CurrentContext(), from, StatOp::Rename);
+    int res = CallJsOperation("rename", from, to);
+    FuseContext* ctx = CurrentContext();
+    InvalidateAttrTree(ctx, from);
+    InvalidateAttrTree(ctx, to);
+    return res;
 }
 
 int fuse3_chmod(const char *path, mode_t mode, struct fuse_file_info *fi) {
-    return CallJsOperation("chmod", path, mode);
+    int res = CallJsOperation("chmod", path, mode);
+    InvalidateAttrs(CurrentContext(), path);
+    return res;
 }
 
 int fuse3_chown(const char *path, uid_t uid, gid_t gid, struct fuse_file_info *fi) {
-    return CallJsOperation("chown", path, uid, gid);
+    int res = CallJsOperation("chown", path, uid, gid);
+    InvalidateAttrs(CurrentContext(), path);
+    return res;
 }
 
 int fuse3_truncate(const char *path, off_t size, struct fuse_file_info *fi) {
-    return CallJsOperation("truncate", path, size);
+    FlushPendingWrites(CurrentContext(), path, StatOp::Truncate);
+    int res = CallJsOperation("truncate", path, size);
+    InvalidateAttrs(CurrentContext(), path);
+    return res;
 }
 
 int fuse3_utimens(const char *path, const struct timespec ts[2], struct fuse_file_info *fi) {
-    return CallJsOperation("utimens", path, ts[0].tv_sec, ts[1].tv_sec);
+    int res = CallJsOperation("utimens", path, ts[0].tv_sec, ts[1].tv_sec);
+    InvalidateAttrs(CurrentContext(), path);
+    return res;
 }
 
 int fuse3_release(const char *path, struct fuse_file_info *fi) {
-    return CallJsOperation("release", path, fi->fh);
+    FuseContext* ctx = CurrentContext();
+    if (ctx) {
+        UnbindHandle(ctx, fi->fh);
+    }
+    int flushed = 0;
+    if (ctx && ctx->writeBuffer) {
+        flushed = ctx->writeBuffer->Release(fi->fh);
+    }
+    int res = CallJsHandleOperation("release", path, fi->fh);
+    return flushed < 0 ? flushed : res;
 }
 
 int fuse3_fsync(const char *path, int isdatasync, struct fuse_file_info *fi) {
-    return CallJsOperation("fsync", path, isdatasync, fi->fh);
+    FuseContext* ctx = CurrentContext();
+    if (ctx && ctx->writeBuffer) {
+        int res = ctx->writeBuffer->Flush(fi->fh, ctx->deadlines.Deadline(StatOp::Fsync));
+        if (res < 0) return res;
+    }
+    return CallJsHandleOperation("fsync", path, fi->fh, isdatasync != 0);
 }
 
 int fuse3_flush(const char *path, struct fuse_file_info *fi) {
-    return CallJsOperation("flush", path, fi->fh);
+    // Backed handles are read-only and only go back to JS on release
+    FuseContext* ctx = CurrentContext();
+    BackingFiles::File backing;
+    if (ctx && ctx->backingFiles.Find(fi->fh, &backing)) {
+        return 0;
+    }
+    // close() reports errors of buffered writes from here
+    if (ctx && ctx->writeBuffer) {
+        int res = ctx->writeBuffer->Flush(fi->fh, ctx->deadlines.Deadline(StatOp::Flush));
+        if (res < 0) return res;
+    }
+    return CallJsHandleOperation("flush", path, fi->fh);
 }
 
 int fuse3_access(const char *path, int mask) {
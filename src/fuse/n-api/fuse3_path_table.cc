@@ -0,0 +1,60 @@
+#include "fuse3_path_table.h"
+
+PathTable::Entry& PathTable::Intern(std::string_view path) {
+    auto it = byPath_.find(path);
+    if (it != byPath_.end()) {
+        Entry* entry = it->second.get();
+        lru_.splice(lru_.begin(), lru_, entry->lru);
+        counters_.hits++;
+        return *entry;
+    }
+
+    counters_.misses++;
+    while (!lru_.empty() && byPath_.size() >= options_.maxEntries) {
+        Entry* oldest = lru_.back();
+        lru_.pop_back();
+        byId_.erase(oldest->id);
+        byPath_.erase(byPath_.find(oldest->path));
+        counters_.evictions++;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->id = nextId_++;
+    entry->path = std::string(path);
+    lru_.push_front(entry.get());
+    entry->lru = lru_.begin();
+    byId_[entry->id] = entry.get();
+    std::string_view key = entry->path;
+    return *byPath_.emplace(key, std::move(entry)).first->second;
+}
+
+Napi::String PathTable::StringOf(Napi::Env env, Entry& entry) {
+    if (entry.string.IsEmpty()) {
+        Napi::String string = Napi::String::New(env, entry.path);
+        entry.string = Napi::Reference<Napi::String>::New(string, 1);
+        return string;
+    }
+    return entry.string.Value();
+}
+
+Napi::Value PathTable::ToJs(Napi::Env env, std::string_view path) {
+    Entry& entry = Intern(path);
+    if (options_.ids) {
+        return Napi::Number::New(env, static_cast<double>(entry.id));
+    }
+    return StringOf(env, entry);
+}
+
+Napi::Value PathTable::Lookup(Napi::Env env, uint64_t id) {
+    auto it = byId_.find(id);
+    if (it == byId_.end()) {
+        return env.Undefined();
+    }
+    return StringOf(env, *it->second);
+}
+
+PathTable::Counters PathTable::GetCounters() const {
+    Counters counters = counters_;
+    counters.entries = byPath_.size();
+    return counters;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <napi.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Paths handed to JS handlers, interned on the JS thread (and only used
+// there). Every path gets an integer ID that is never given to another path,
+// and keeps a persistent V8 string once it was passed as a string, so a stat
+// storm over the same few thousand names creates no new strings. With ids
+// on, handlers receive the ID instead and resolve it through Lookup()
+// (pathOf in JS) when they need the text. Beyond maxEntries the least
+// recently used paths are dropped; their IDs stop resolving.
+class PathTable {
+public:
+    struct Options {
+        size_t maxEntries = 16384;
+        bool ids = false;  // hand out IDs instead of strings
+    };
+
+    struct Counters {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t entries = 0;
+    };
+
+    explicit PathTable(const Options& options) : options_(options) {}
+
+    // The ID as a Number with ids on, the cached string otherwise
+    Napi::Value ToJs(Napi::Env env, std::string_view path);
+    // The string of a live ID, undefined otherwise
+    Napi::Value Lookup(Napi::Env env, uint64_t id);
+
+    Counters GetCounters() const;
+    const Options& GetOptions() const { return options_; }
+
+private:
+    struct Entry {
+        uint64_t id;
+        std::string path;
+        Napi::Reference<Napi::String> string;  // empty until first needed
+        std::list<Entry*>::iterator lru;
+    };
+
+    Entry& Intern(std::string_view path);
+    static Napi::String StringOf(Napi::Env env, Entry& entry);
+
+    Options options_;
+    // Keyed by views of each entry's own path, so a lookup copies nothing
+    std::unordered_map<std::string_view, std::unique_ptr<Entry>> byPath_;
+    std::unordered_map<uint64_t, Entry*> byId_;
+    std::list<Entry*> lru_;  // most recently used first
+    uint64_t nextId_ = 1;
+    Counters counters_;
+};
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "fuse3_prewarm.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr std::chrono::milliseconds kReportInterval(500);
+
+static uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static std::string ChildPath(const std::string& dir, const std::string& name) {
+    return dir.empty() || dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+Prewarmer::Prewarmer(const Options& options, ListFn list, StatFn stat, ProgressFn progress)
+    : options_(options), list_(std::move(list)), stat_(std::move(stat)), progress_(std::move(progress)) {}
+
+Prewarmer::~Prewarmer() {
+    Stop();
+}
+
+void Prewarmer::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable() || stopping_) {
+        return;
+    }
+    startNs_ = NowNs();
+    // Roots are stat'ed first: a root may be a file, or missing
+    for (const std::string& root : options_.roots) {
+        tasks_.push_back(Task{root, 0, false});
+    }
+    thread_ = std::thread([this] { Run(); });
+}
+
+void Prewarmer::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        tasks_.clear();
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void Prewarmer::Run() {
+    Clock::duration spacing = options_.rate > 0
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options_.rate))
+        : Clock::duration::zero();
+    Clock::time_point next = Clock::now();      // earliest start of the next call
+    Clock::time_point report = next + kReportInterval;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_ && !(tasks_.empty() && inFlight_ == 0)) {
+        Clock::time_point now = Clock::now();
+        if (now >= report) {
+            Progress progress = SnapshotLocked();
+            lock.unlock();
+            progress_(progress);
+            lock.lock();
+            report = now + kReportInterval;
+            continue;
+        }
+        if (tasks_.empty() || inFlight_ >= kInFlight || now < next) {
+            Clock::time_point until = report;
+            if (!tasks_.empty() && inFlight_ < kInFlight) {
+                until = std::min(until, next);
+            }
+            wake_.wait_until(lock, until);
+            continue;
+        }
+
+        Task task = std::move(tasks_.front());
+        tasks_.pop_front();
+        // Listings below the budget would only bring names that are dropped
+        if (task.list && counters_.entries >= options_.maxEntries) {
+            continue;
+        }
+        inFlight_++;
+        next = std::max(next, now) + spacing;
+        lock.unlock();
+        Issue(task);
+        lock.lock();
+    }
+    if (stopping_) {
+        return;
+    }
+    counters_.done = true;
+    Progress progress = SnapshotLocked();
+    lock.unlock();
+    progress_(progress);
+}
+
+// Handlers may answer twice, or answer and throw within a batch; only the
+// first result counts. Results arriving after the walker is gone are
+// dropped.
+void Prewarmer::Issue(const Task& task) {
+    std::weak_ptr<Prewarmer> weak = weak_from_this();
+    auto once = std::make_shared<std::atomic<bool>>(false);
+    if (task.list) {
+        list_(task.path, [weak, task, once](int err, const std::vector<Child>& children) {
+            std::shared_ptr<Prewarmer> self = weak.lock();
+            if (self && !once->exchange(true)) {
+                self->Listed(task, err, children);
+            }
+        });
+    } else {
+        stat_(task.path, [weak, task, once](int err, bool directory) {
+            std::shared_ptr<Prewarmer> self = weak.lock();
+            if (self && !once->exchange(true)) {
+                self->Stated(task, err, directory);
+            }
+        });
+    }
+}
+
+void Prewarmer::Listed(const Task& task, int err, const std::vector<Child>& children) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_--;
+        if (err < 0) {
+            counters_.errors++;
+        } else if (!stopping_) {
+            counters_.directories++;
+            counters_.depth = std::max(counters_.depth, task.depth);
+            for (const Child& child : children) {
+                if (counters_.entries >= options_.maxEntries) {
+                    break;
+                }
+                if (child.name == "." || child.name == "..") {
+                    continue;
+                }
+                counters_.entries++;
+                unsigned int depth = task.depth + 1;
+                if (!child.stat) {
+                    tasks_.push_back(Task{ChildPath(task.path, child.name), depth, false});
+                } else if (child.directory && depth <= options_.maxDepth) {
+                    tasks_.push_back(Task{ChildPath(task.path, child.name), depth, true});
+                }
+            }
+        }
+    }
+    wake_.notify_one();
+}
+
+void Prewarmer::Stated(const Task& task, int err, bool directory) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_--;
+        counters_.stats++;
+        if (err < 0) {
+            counters_.errors++;
+        } else if (directory && task.depth <= options_.maxDepth && !stopping_) {
+            tasks_.push_back(Task{task.path, task.depth, true});
+        }
+    }
+    wake_.notify_one();
+}
+
+Prewarmer::Progress Prewarmer::SnapshotLocked() const {
+    Progress progress = counters_;
+    progress.pending = tasks_.size() + inFlight_;
+    progress.elapsed = startNs_ ? (NowNs() - startNs_) / 1e9 : 0;
+    return progress;
+}
+
+Prewarmer::Progress Prewarmer::GetProgress() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return SnapshotLocked();
+}
\ No newline at end of file
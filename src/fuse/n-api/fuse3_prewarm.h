@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Walks the tree through the JS handlers once mounted (prewarm), so the
+// first browse of a fresh mount (Explorer over \\wsl$) finds attributes in
+// the attr cache and JS warmed up instead of every directory cold.
+// Directories are listed breadth-first from the roots down to maxDepth
+// levels below them; names a listing returns without stats are stat'ed. The
+// walk stops taking names after maxEntries. Its calls go to the background
+// lane of the dispatchers, so they only run while no request waits, and a
+// thread of the walker sends at most rate of them per second, kInFlight at a
+// time.
+class Prewarmer : public std::enable_shared_from_this<Prewarmer> {
+public:
+    struct Options {
+        std::vector<std::string> roots = {"/"};
+        unsigned int maxDepth = 3;
+        uint64_t maxEntries = 10000;
+        unsigned int rate = 200;  // calls per second, 0 for no limit
+    };
+
+    struct Progress {
+        uint64_t directories = 0;  // listed
+        uint64_t entries = 0;      // names taken from listings
+        uint64_t stats = 0;        // getattr calls answered
+        uint64_t errors = 0;
+        uint64_t pending = 0;      // calls queued or running
+        unsigned int depth = 0;    // deepest level listed
+        double elapsed = 0;        // seconds since the start
+        bool done = false;
+    };
+
+    // A name of a listing; directory is only meaningful with stat
+    struct Child {
+        std::string name;
+        bool stat = false;
+        bool directory = false;
+    };
+
+    // Lists path; done(0, children) or done(-errno, {})
+    using ListDone = std::function<void(int err, const std::vector<Child>& children)>;
+    using ListFn = std::function<void(const std::string& path, ListDone done)>;
+    // Stats path; done(0, isDirectory) or done(-errno, false)
+    using StatDone = std::function<void(int err, bool directory)>;
+    using StatFn = std::function<void(const std::string& path, StatDone done)>;
+    // From the walker thread, about twice a second and once done
+    using ProgressFn = std::function<void(const Progress& progress)>;
+
+    static constexpr unsigned int kInFlight = 4;
+
+    Prewarmer(const Options& options, ListFn list, StatFn stat, ProgressFn progress);
+    ~Prewarmer();
+
+    // After mounting. Stop (before unmounting) drops what was not visited;
+    // a walk that was stopped reports no end.
+    void Start();
+    void Stop();
+
+    Progress GetProgress();
+
+private:
+    struct Task {
+        std::string path;
+        unsigned int depth;
+        bool list;  // otherwise stat
+    };
+
+    void Run();
+    void Issue(const Task& task);
+    void Listed(const Task& task, int err, const std::vector<Child>& children);
+    void Stated(const Task& task, int err, bool directory);
+    Progress SnapshotLocked() const;
+
+    Options options_;
+    ListFn list_;
+    StatFn stat_;
+    ProgressFn progress_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::thread thread_;
+    bool stopping_ = false;
+    std::deque<Task> tasks_;
+    unsigned int inFlight_ = 0;
+    Progress counters_;
+    uint64_t startNs_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "fuse3_probe_filter.h"
+#include <fnmatch.h>
+#include <chrono>
+#include <functional>
+#include <iterator>
+
+static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string_view BaseName(std::string_view path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+ProbeFilter::ProbeFilter(const Options& options) : options_(options) {
+    for (const std::string& rule : options_.rules) {
+        if (rule.empty()) {
+            continue;
+        }
+        (rule.find('/') == std::string::npos ? nameRules_ : pathRules_).push_back(rule);
+    }
+}
+
+bool ProbeFilter::MatchesRule(std::string_view path, std::string_view name) const {
+    if (!nameRules_.empty()) {
+        std::string base(name);
+        for (const std::string& rule : nameRules_) {
+            if (fnmatch(rule.c_str(), base.c_str(), FNM_CASEFOLD) == 0) {
+                return true;
+            }
+        }
+    }
+    if (!pathRules_.empty()) {
+        std::string full(path);
+        for (const std::string& rule : pathRules_) {
+            if (fnmatch(rule.c_str(), full.c_str(), FNM_CASEFOLD | FNM_PATHNAME) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ProbeFilter::Seen(std::string_view path) const {
+    size_t bit = std::hash<std::string_view>()(path) % kSeenBits;
+    return (seen_[bit / 64].load(std::memory_order_relaxed) >> (bit % 64)) & 1;
+}
+
+bool ProbeFilter::Absorb(std::string_view path) {
+    std::string_view name = BaseName(path);
+    if (name.empty()) {
+        return false;
+    }
+
+    if (!rulesOff_.load(std::memory_order_relaxed) && MatchesRule(path, name)) {
+        bool exempt = false;
+        if (anyExempt_.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            exempt = exempt_.count(std::string(path)) > 0;
+        }
+        if (!exempt) {
+            ruleHits_++;
+            return true;
+        }
+    }
+
+    if (options_.learnThreshold == 0 || !anyLearned_.load(std::memory_order_acquire) || Seen(path)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = paths_.find(std::string(path));
+    if (it == paths_.end() || it->second.learnedUntil <= NowNs()) {
+        return false;
+    }
+    learnedHits_++;
+    return true;
+}
+
+void ProbeFilter::Missing(std::string_view path) {
+    if (options_.learnThreshold == 0 || BaseName(path).empty() || Seen(path)) {
+        return;
+    }
+
+    int64_t now = NowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = paths_.find(std::string(path));
+    if (it == paths_.end()) {
+        if (paths_.size() >= kMaxPaths) {
+            // Make room from paths whose window and lease are over; new
+            // paths are not tracked while everything is current
+            for (auto old = paths_.begin(); old != paths_.end();) {
+                if (old->second.windowEnd <= now && old->second.learnedUntil <= now) {
+                    old = paths_.erase(old);
+                } else {
+                    ++old;
+                }
+            }
+            if (paths_.size() >= kMaxPaths) {
+                return;
+            }
+        }
+        it = paths_.emplace(std::string(path), Probe()).first;
+    }
+
+    Probe& entry = it->second;
+    int64_t ttl = static_cast<int64_t>(options_.ttl * 1e9);
+    if (entry.windowEnd <= now) {
+        entry.misses = 0;
+        entry.windowEnd = now + ttl;
+    }
+    if (++entry.misses >= options_.learnThreshold) {
+        entry.learnedUntil = now + ttl;
+        anyLearned_.store(true, std::memory_order_release);
+    }
+}
+
+void ProbeFilter::Exists(std::string_view path) {
+    std::string_view name = BaseName(path);
+    if (name.empty()) {
+        return;
+    }
+    size_t bit = std::hash<std::string_view>()(path) % kSeenBits;
+    seen_[bit / 64].fetch_or(uint64_t(1) << (bit % 64), std::memory_order_relaxed);
+
+    if (!MatchesRule(path, name)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (exempt_.size() >= kMaxExempt) {
+        // Cannot tell these files apart from probes anymore
+        rulesOff_ = true;
+        return;
+    }
+    exempt_.emplace(path);
+    anyExempt_.store(true, std::memory_order_release);
+}
+
+void ProbeFilter::ForgetBelow(std::string_view prefix) {
+    if (!prefix.empty() && prefix.back() == '/') {
+        prefix.remove_suffix(1);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = paths_.begin(); it != paths_.end();) {
+        const std::string& path = it->first;
+        bool below = path.size() > prefix.size() && path.compare(0, prefix.size(), prefix) == 0 &&
+                     path[prefix.size()] == '/';
+        it = below ? paths_.erase(it) : std::next(it);
+    }
+}
+
+ProbeFilter::Counters ProbeFilter::GetCounters() {
+    Counters counters;
+    counters.ruleHits = ruleHits_.load();
+    counters.learnedHits = learnedHits_.load();
+    int64_t now = NowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : paths_) {
+        if (entry.second.learnedUntil > now && !Seen(entry.first)) {
+            counters.learnedNames++;
+        }
+    }
+    return counters;
+}
\ No newline at end of file
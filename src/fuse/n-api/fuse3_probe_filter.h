@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Answers lookups of names that are not there without asking JS. Windows
+// clients (Explorer over \\wsl$, the 9P bridge) probe every directory they
+// show for desktop.ini, Thumbs.db, *.lnk and the like; each probe would be
+// a getattr round-trip ending in ENOENT.
+//
+// Two sources of names:
+// - rules, shell globs matched case-insensitively against the last path
+//   component, or against the whole path when they contain a '/'. A rule is
+//   a promise that no such file exists; one created through the mount is
+//   exempt from then on.
+// - paths JS reported missing learnThreshold times within ttl seconds. A
+//   learned path (its directory and name) is answered for ttl seconds, but
+//   never once it was seen to exist; the same name in another directory is
+//   asked for as usual.
+class ProbeFilter {
+public:
+    struct Options {
+        std::vector<std::string> rules = {"desktop.ini", "thumbs.db", "autorun.inf", "*.lnk"};
+        unsigned int learnThreshold = 4;  // 0 disables learning
+        double ttl = 30.0;                // seconds
+        double negativeTimeout = 10.0;    // seconds the kernel keeps the answer (low-level)
+    };
+
+    struct Counters {
+        uint64_t ruleHits = 0;
+        uint64_t learnedHits = 0;
+        uint64_t learnedNames = 0;
+    };
+
+    explicit ProbeFilter(const Options& options);
+
+    // True if path is known not to exist
+    bool Absorb(std::string_view path);
+    // JS answered ENOENT for path
+    void Missing(std::string_view path);
+    // path exists: JS returned its attributes or listed it, or it was
+    // created or changed through the mount
+    void Exists(std::string_view path);
+    // Paths below prefix may have been created behind the mount's back
+    void ForgetBelow(std::string_view prefix);
+
+    Counters GetCounters();
+    const Options& GetOptions() const { return options_; }
+
+private:
+    static constexpr size_t kMaxPaths = 4096;
+    static constexpr size_t kMaxExempt = 4096;
+    static constexpr size_t kSeenBits = 1 << 16;
+
+    struct Probe {
+        unsigned int misses = 0;
+        int64_t windowEnd = 0;    // steady clock, nanoseconds
+        int64_t learnedUntil = 0;
+    };
+
+    bool MatchesRule(std::string_view path, std::string_view name) const;
+    bool Seen(std::string_view path) const;
+
+    Options options_;
+    std::vector<std::string> nameRules_;
+    std::vector<std::string> pathRules_;
+    // Bloom-style: a set bit may stand for another path, which only means
+    // that path is not learned
+    std::atomic<uint64_t> seen_[kSeenBits / 64] = {};
+    std::atomic<uint64_t> ruleHits_{0};
+    std::atomic<uint64_t> learnedHits_{0};
+    std::atomic<bool> anyExempt_{false};
+    std::atomic<bool> anyLearned_{false};
+    std::atomic<bool> rulesOff_{false};  // too many exempt paths to keep
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Probe> paths_;
+    std::unordered_set<std::string> exempt_;
+};
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "fuse3_readahead.h"
+#include <string.h>
+#include <algorithm>
+
+Readahead::Readahead(const Options& options, FetchFn fetch)
+    : options_(options), fetch_(std::move(fetch)) {}
+
+Readahead::StreamPtr Readahead::StreamOf(const std::string& path, uint64_t fh) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StreamPtr& stream = streams_[fh];
+    if (!stream) {
+        stream = std::make_shared<Stream>();
+        stream->path = path;
+        stream->window = options_.minWindow;
+    }
+    return stream;
+}
+
+// Takes size bytes of the budget all handles share
+bool Readahead::Reserve(size_t size) {
+    size_t used = *used_;
+    do {
+        if (used + size > options_.maxTotal) {
+            return false;
+        }
+    } while (!used_->compare_exchange_weak(used, used + size));
+    return true;
+}
+
+// Fetches still in flight complete into blocks nobody looks at anymore
+void Readahead::Reset(Stream& stream, size_t window) {
+    stream.blocks.clear();
+    stream.eof = false;
+    stream.sequential = 0;
+    stream.window = window;
+}
+
+// Collects the blocks holding [off, off + size), or up to the end of the
+// file. Returns false unless all of it has been fetched or is being fetched.
+bool Readahead::Cover(Stream& stream, size_t size, off_t off, std::vector<BlockPtr>* blocks) {
+    off_t end = off + static_cast<off_t>(size);
+    off_t covered = off;
+    for (const BlockPtr& block : stream.blocks) {
+        off_t blockEnd = block->offset + static_cast<off_t>(block->size);
+        if (blockEnd <= off) {
+            continue;
+        }
+        if (block->offset > covered) {
+            break;
+        }
+        blocks->push_back(block);
+        covered = blockEnd;
+        if (covered >= end || (block->ready && block->result < static_cast<int>(block->size))) {
+            return true;
+        }
+    }
+    return covered >= end || (!blocks->empty() && stream.eof && covered == stream.blocks.back()->offset +
+                              static_cast<off_t>(stream.blocks.back()->size));
+}
+
+// Queues blocks until window bytes behind the reader are fetched or on
+// their way, or the budget is used up
+void Readahead::Refill(Stream& stream, std::vector<BlockPtr>* fetches) {
+    // What the reader has passed is not needed anymore
+    while (!stream.blocks.empty() &&
+           stream.blocks.front()->offset + static_cast<off_t>(stream.blocks.front()->size) <= stream.next) {
+        stream.blocks.pop_front();
+    }
+
+    off_t from = stream.blocks.empty() ? stream.next
+                                       : stream.blocks.back()->offset + static_cast<off_t>(stream.blocks.back()->size);
+    off_t to = stream.next + static_cast<off_t>(stream.window);
+    while (!stream.eof && from < to) {
+        size_t size = std::min<size_t>(kMaxBlock, to - from);
+        if (!Reserve(size)) {
+            return;
+        }
+        auto block = std::make_shared<Block>();
+        block->offset = from;
+        block->size = size;
+        block->budget = used_;
+        block->data.reset(new (std::nothrow) char[block->size]);
+        if (!block->data) {
+            return;
+        }
+        stream.blocks.push_back(block);
+        fetches->push_back(block);
+        from += static_cast<off_t>(block->size);
+    }
+}
+
+void Readahead::Issue(const StreamPtr& stream, const std::string& path, uint64_t fh,
+                      const std::vector<BlockPtr>& fetches) {
+    for (const BlockPtr& block : fetches) {
+        fetch_(path, fh, block->data.get(), block->size, block->offset, [stream, block, window = options_.minWindow](int result) {
+            Complete(stream, block, result, window);
+        });
+    }
+}
+
+// Runs on whichever thread the fetch finished on, possibly after the
+// Readahead is gone
+void Readahead::Complete(const StreamPtr& stream, const BlockPtr& block, int result, size_t minWindow) {
+    std::vector<WaiterPtr> ready;
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        block->ready = true;
+        block->result = std::min<int>(result, static_cast<int>(block->size));
+        bool current = std::find(stream->blocks.begin(), stream->blocks.end(), block) != stream->blocks.end();
+        if (current && result < 0) {
+            // Let the reader go to JS itself from here on
+            Reset(*stream, minWindow);
+        } else if (current && static_cast<size_t>(result) < block->size) {
+            // Nothing to fetch past the end of the file
+            while (stream->blocks.back() != block) {
+                stream->blocks.pop_back();
+            }
+            stream->eof = true;
+        }
+
+        for (auto it = stream->waiters.begin(); it != stream->waiters.end();) {
+            const std::vector<BlockPtr>& blocks = (*it)->blocks;
+            if (std::all_of(blocks.begin(), blocks.end(), [](const BlockPtr& b) { return b->ready; })) {
+                ready.push_back(*it);
+                it = stream->waiters.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (const WaiterPtr& waiter : ready) {
+        waiter->done(Copy(*waiter));
+    }
+}
+
+// Copies the waiter's range out of its (ready) blocks. The result is short
+// where the file ends.
+int Readahead::Copy(const Waiter& waiter) {
+    size_t copied = 0;
+    for (const BlockPtr& block : waiter.blocks) {
+        if (block->result < 0) {
+            return block->result;
+        }
+        off_t from = waiter.offset + static_cast<off_t>(copied);
+        size_t skip = from - block->offset;
+        size_t available = static_cast<size_t>(block->result) > skip ? block->result - skip : 0;
+        size_t length = std::min(available, waiter.size - copied);
+        memcpy(waiter.dst + copied, block->data.get() + skip, length);
+        copied += length;
+        if (copied == waiter.size || static_cast<size_t>(block->result) < block->size) {
+            break;
+        }
+    }
+    return static_cast<int>(copied);
+}
+
+bool Readahead::Read(const std::string& path, uint64_t fh, char* dst, size_t size, off_t off, Done done) {
+    StreamPtr stream = StreamOf(path, fh);
+    std::vector<BlockPtr> fetches;
+    WaiterPtr waiter;
+    std::string fetchPath;
+    bool served = false;
+    {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        std::vector<BlockPtr> blocks;
+        if (!stream->blocks.empty() && Cover(*stream, size, off, &blocks)) {
+            waiter = std::make_shared<Waiter>(Waiter{dst, size, off, std::move(blocks), std::move(done)});
+            stream->window = std::min(stream->window * 2, options_.maxWindow);
+            stream->next = std::max(stream->next, off + static_cast<off_t>(size));
+        } else if (off == stream->next) {
+            stream->sequential++;
+            stream->next = off + static_cast<off_t>(size);
+        } else {
+            Reset(*stream, options_.minWindow);
+            stream->next = off + static_cast<off_t>(size);
+        }
+
+        if (waiter || stream->sequential > 0) {
+            Refill(*stream, &fetches);
+            fetchPath = stream->path;
+        }
+        // Blocks only ever become ready, so a waiter that is not queued here
+        // is served below and Complete never sees it
+        if (waiter && !std::all_of(waiter->blocks.begin(), waiter->blocks.end(),
+                                   [](const BlockPtr& b) { return b->ready; })) {
+            stream->waiters.push_back(waiter);
+            waiter = nullptr;
+            served = true;
+        }
+    }
+
+    Issue(stream, fetchPath, fh, fetches);
+    if (waiter) {
+        waiter->done(Copy(*waiter));
+        served = true;
+    }
+    return served;
+}
+
+void Readahead::Release(uint64_t fh) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.erase(fh);
+}
+
+void Readahead::Invalidate(const std::string& path) {
+    std::vector<StreamPtr> matching;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : streams_) {
+            if (entry.second->path == path) {
+                matching.push_back(entry.second);
+            }
+        }
+    }
+    for (const StreamPtr& stream : matching) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        Reset(*stream, options_.minWindow);
+    }
+}
\ No newline at end of file
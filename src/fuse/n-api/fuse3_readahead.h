@@ -0,0 +1,111 @@
+#pragma once
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-handle readahead. A handle read twice in a row where the previous read
+// ended counts as sequential; from then on the data behind the reader is
+// fetched from JS ahead of time, window bytes of it, and the window doubles
+// with every read served from memory up to maxWindow. A read anywhere else
+// drops what was fetched and starts over, so random access only pays for a
+// map lookup. All handles together hold at most maxTotal bytes; past that a
+// window is not refilled until fetched data is freed.
+class Readahead {
+public:
+    struct Options {
+        size_t minWindow = 256 * 1024;
+        size_t maxWindow = 4 * 1024 * 1024;
+        size_t maxTotal = 64 * 1024 * 1024;
+    };
+
+    using Done = std::function<void(int result)>;
+    // Reads size bytes at off into dst and calls done with the byte count or
+    // a negative errno. Must not block: it is called from FUSE workers.
+    using FetchFn = std::function<void(const std::string& path, uint64_t fh, char* dst, size_t size,
+                                       off_t off, Done done)>;
+
+    Readahead(const Options& options, FetchFn fetch);
+
+    // Returns true if the read is served from fetched data, which may still
+    // be on its way; done then runs exactly once with the byte count (or a
+    // negative errno), possibly before Read returns. On false done is never
+    // called and the caller reads itself. Either way the access is recorded.
+    bool Read(const std::string& path, uint64_t fh, char* dst, size_t size, off_t off, Done done);
+
+    void Release(uint64_t fh);
+    // Forgets everything fetched for path, e.g. after a write to it
+    void Invalidate(const std::string& path);
+
+    const Options& GetOptions() const { return options_; }
+    // Bytes of fetched (or being fetched) data held across all handles
+    size_t Used() const { return *used_; }
+
+private:
+    static constexpr size_t kMaxBlock = 1024 * 1024;  // largest single fetch
+
+    using Budget = std::shared_ptr<std::atomic<size_t>>;
+
+    struct Block {
+        off_t offset;
+        size_t size;
+        std::unique_ptr<char[]> data;
+        bool ready = false;
+        int result = 0;  // bytes read (short at the end of the file) or -errno
+        Budget budget;   // gets size back once the block is gone
+
+        ~Block() {
+            if (budget) {
+                *budget -= size;
+            }
+        }
+    };
+    using BlockPtr = std::shared_ptr<Block>;
+
+    struct Waiter {
+        char* dst;
+        size_t size;
+        off_t offset;
+        std::vector<BlockPtr> blocks;
+        Done done;
+    };
+    using WaiterPtr = std::shared_ptr<Waiter>;
+
+    struct Stream {
+        std::mutex mutex;
+        std::string path;
+        off_t next = -1;          // where a sequential reader reads next
+        unsigned int sequential = 0;
+        size_t window = 0;
+        std::deque<BlockPtr> blocks;  // contiguous, ascending
+        bool eof = false;             // the last block ends the file
+        std::list<WaiterPtr> waiters;
+    };
+    using StreamPtr = std::shared_ptr<Stream>;
+
+    StreamPtr StreamOf(const std::string& path, uint64_t fh);
+    bool Reserve(size_t size);
+    static void Reset(Stream& stream, size_t window);
+    static bool Cover(Stream& stream, size_t size, off_t off, std::vector<BlockPtr>* blocks);
+    void Refill(Stream& stream, std::vector<BlockPtr>* fetches);
+    void Issue(const StreamPtr& stream, const std::string& path, uint64_t fh,
+               const std::vector<BlockPtr>& fetches);
+    static void Complete(const StreamPtr& stream, const BlockPtr& block, int result, size_t minWindow);
+    static int Copy(const Waiter& waiter);
+
+    Options options_;
+    FetchFn fetch_;
+    // Shared with the blocks, which can outlive the Readahead
+    Budget used_ = std::make_shared<std::atomic<size_t>>(0);
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, StreamPtr> streams_;
+};
\ No newline at end of file
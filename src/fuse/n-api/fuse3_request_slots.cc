@@ -0,0 +1,112 @@
+#include "fuse3_request_slots.h"
+#include <algorithm>
+
+RequestSlots::RequestSlots(const Options& options)
+    : options_(options), slots_(std::min(std::max<size_t>(options.size, 1), kMaxSize)) {
+    options_.size = slots_.size();
+    for (size_t i = slots_.size(); i-- > 0;) {
+        Push(static_cast<uint32_t>(i));
+    }
+}
+
+bool RequestSlots::Pop(uint32_t* index) {
+    uint64_t head = free_.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t top = static_cast<uint32_t>(head);
+        if (top == 0) {
+            return false;
+        }
+        uint64_t next = slots_[top - 1].next.load(std::memory_order_relaxed);
+        uint64_t replaced = (((head >> 32) + 1) << 32) | next;
+        if (free_.compare_exchange_weak(head, replaced, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            *index = top - 1;
+            return true;
+        }
+    }
+}
+
+void RequestSlots::Push(uint32_t index) {
+    uint64_t head = free_.load(std::memory_order_relaxed);
+    uint64_t replaced;
+    do {
+        slots_[index].next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        replaced = (((head >> 32) + 1) << 32) | (index + 1);
+    } while (!free_.compare_exchange_weak(head, replaced, std::memory_order_release, std::memory_order_relaxed));
+}
+
+uint64_t RequestSlots::Acquire(Handler& handler, const void* owner) {
+    uint32_t index;
+    if (!Pop(&index)) {
+        exhausted_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    Slot& slot = slots_[index];
+    slot.handler = std::move(handler);
+    slot.owner.store(owner, std::memory_order_relaxed);
+    uint32_t generation = slot.generation.load(std::memory_order_relaxed) + 1;
+    slot.generation.store(generation, std::memory_order_release);
+
+    acquired_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t inUse = inUse_.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint64_t max = maxInUse_.load(std::memory_order_relaxed);
+    while (inUse > max && !maxInUse_.compare_exchange_weak(max, inUse, std::memory_order_relaxed)) {
+    }
+    return (static_cast<uint64_t>(generation) << kIndexBits) | index;
+}
+
+// Whoever moves the generation of a taken slot on owns its handler
+bool RequestSlots::Take(uint64_t id, Handler* handler) {
+    uint64_t index = id & ((uint64_t(1) << kIndexBits) - 1);
+    uint64_t generation = id >> kIndexBits;
+    if (index >= slots_.size() || generation > UINT32_MAX || !(generation & 1)) {
+        return false;
+    }
+    Slot& slot = slots_[index];
+    uint32_t expected = static_cast<uint32_t>(generation);
+    if (!slot.generation.compare_exchange_strong(expected, expected + 1, std::memory_order_acq_rel)) {
+        return false;
+    }
+    *handler = std::move(slot.handler);
+    slot.handler = nullptr;
+    inUse_.fetch_sub(1, std::memory_order_relaxed);
+    Push(static_cast<uint32_t>(index));
+    return true;
+}
+
+// The slot is free again before the handler runs, which may start the next
+// request
+bool RequestSlots::Reply(uint64_t id, const JsArgs& args) {
+    Handler handler;
+    if (!Take(id, &handler)) {
+        stale_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    handler(args);
+    return true;
+}
+
+void RequestSlots::Release(uint64_t id) {
+    Handler handler;
+    Take(id, &handler);
+}
+
+void RequestSlots::ReleaseOwned(const void* owner) {
+    for (size_t index = 0; index < slots_.size(); index++) {
+        Slot& slot = slots_[index];
+        uint32_t generation = slot.generation.load(std::memory_order_acquire);
+        if ((generation & 1) && slot.owner.load(std::memory_order_relaxed) == owner) {
+            Release((static_cast<uint64_t>(generation) << kIndexBits) | index);
+        }
+    }
+}
+
+RequestSlots::Counters RequestSlots::GetCounters() const {
+    Counters counters;
+    counters.size = slots_.size();
+    counters.inUse = inUse_.load(std::memory_order_relaxed);
+    counters.maxInUse = maxInUse_.load(std::memory_order_relaxed);
+    counters.acquired = acquired_.load(std::memory_order_relaxed);
+    counters.exhausted = exhausted_.load(std::memory_order_relaxed);
+    counters.stale = stale_.load(std::memory_order_relaxed);
+    return counters;
+}
\ No newline at end of file
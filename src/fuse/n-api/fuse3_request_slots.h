@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class JsArgs;  // fuse3_js_args.h; only passed through here
+
+// Preallocated slots for requests waiting on JS (request_slots). With them a
+// handler is not given a new callback per request: it gets the reply
+// function of its operation, made once per JS thread, and the id of the
+// request, and answers with reply(id, err, ...). That spares V8 a function
+// and the addon its callback data per request.
+//
+// Free slots are a lock-free stack; slots are taken and given back on the
+// JS threads of the mount. An id carries the generation of its slot, odd
+// while the slot is taken, so an answer to a request that was answered or
+// cancelled already is recognised and dropped, even once the slot is reused.
+// A handler may hold references of the JS thread that took its slot, so
+// the slots JS never answered are freed by that thread (ReleaseOwned).
+class RequestSlots {
+public:
+    // What a request gets when every slot is taken
+    enum class Exhausted {
+        Callback,  // a callback of its own, called like the reply function
+        Fail,      // EAGAIN
+    };
+
+    struct Options {
+        size_t size = 1024;
+        Exhausted exhausted = Exhausted::Callback;
+    };
+
+    struct Counters {
+        uint64_t size = 0;
+        uint64_t inUse = 0;
+        uint64_t maxInUse = 0;
+        uint64_t acquired = 0;
+        uint64_t exhausted = 0;  // requests that found no free slot
+        uint64_t stale = 0;      // answers to ids no longer taken
+    };
+
+    using Handler = std::function<void(const JsArgs& args)>;
+
+    static constexpr size_t kMaxSize = size_t(1) << 20;
+
+    explicit RequestSlots(const Options& options);
+
+    // Takes a slot for handler on behalf of owner and returns its id, or 0
+    // (handler untouched) if none is free
+    uint64_t Acquire(Handler& handler, const void* owner = nullptr);
+    // Runs the handler of id once and frees its slot. False if id is not
+    // taken (anymore).
+    bool Reply(uint64_t id, const JsArgs& args);
+    // Frees the slot of a request that ended without an answer
+    void Release(uint64_t id);
+    // Frees every slot still taken for owner, destroying the handlers on the
+    // calling thread
+    void ReleaseOwned(const void* owner);
+
+    Counters GetCounters() const;
+    const Options& GetOptions() const { return options_; }
+
+private:
+    static constexpr unsigned kIndexBits = 20;
+
+    struct Slot {
+        std::atomic<uint32_t> generation{0};
+        std::atomic<uint32_t> next{0};  // in the free stack, index + 1
+        std::atomic<const void*> owner{nullptr};
+        Handler handler;
+    };
+
+    bool Take(uint64_t id, Handler* handler);
+    bool Pop(uint32_t* index);
+    void Push(uint32_t index);
+
+    Options options_;
+    std::vector<Slot> slots_;
+    // Top of the free stack (index + 1, 0 when empty) and a tag against ABA
+    std::atomic<uint64_t> free_{0};
+    std::atomic<uint64_t> inUse_{0};
+    std::atomic<uint64_t> maxInUse_{0};
+    std::atomic<uint64_t> acquired_{0};
+    std::atomic<uint64_t> exhausted_{0};
+    std::atomic<uint64_t> stale_{0};
+};
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "fuse3_workers.h"
+#include <algorithm>
+#include <functional>
+
+// splitmix64 finalizer: spreads similar paths and ids over the whole range
+static uint64_t Mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+WorkerPool::WorkerPool(std::shared_ptr<Dispatcher> main, const PathTable::Options* paths)
+    : main_(std::move(main)), pathTable_(paths != nullptr) {
+    if (paths) {
+        pathOptions_ = *paths;
+    }
+}
+
+uint64_t WorkerPool::RouteOf(std::string_view key) {
+    return std::hash<std::string_view>()(key);
+}
+
+// The worker scoring highest for the hash of a key
+WorkerPool::WorkerPtr WorkerPool::Route(uint64_t route) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    WorkerPtr best;
+    uint64_t bestScore = 0;
+    for (const WorkerPtr& worker : workers_) {
+        uint64_t score = Mix(route ^ worker->seed);
+        if (!best || score > bestScore) {
+            best = worker;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+WorkerPool::WorkerPtr WorkerPool::Find(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const WorkerPtr& worker : workers_) {
+        if (worker->id == id) {
+            return worker;
+        }
+    }
+    return nullptr;
+}
+
+napi_status WorkerPool::Post(std::string_view key, Dispatcher::Work&& work, Dispatcher::Lane lane) {
+    return PostRoute(RouteOf(key), std::move(work), lane);
+}
+
+// The route goes along with the work, so a worker exiting with it still
+// queued hands it on to the worker now serving its key (Finalize)
+napi_status WorkerPool::PostRoute(uint64_t route, Dispatcher::Work&& work, Dispatcher::Lane lane) {
+    while (WorkerPtr worker = Route(route)) {
+        if (worker->dispatcher->Post(std::move(work), lane, route) == napi_ok) {
+            worker->routed++;
+            return napi_ok;
+        }
+        // Its thread is going away; the others take over
+        Detach(worker->id, false);
+    }
+    mainRouted_++;
+    return main_->Post(std::move(work), lane, route);
+}
+
+napi_status WorkerPool::PostHandle(uint64_t fh, std::string_view key, Dispatcher::Work&& work,
+                                   Dispatcher::Lane lane) {
+    uint32_t owner = static_cast<uint32_t>(fh >> kHandleShift);
+    if (owner == 0) {
+        mainRouted_++;
+        return main_->Post(std::move(work), lane);
+    }
+    uint64_t route = RouteOf(key);
+    WorkerPtr worker = Find(owner);
+    if (worker && worker->dispatcher->Post(std::move(work), lane, route) == napi_ok) {
+        worker->routed++;
+        return napi_ok;
+    }
+    // Nobody else knows the fd; the handler serving the path gets the request
+    return PostRoute(route, std::move(work), lane);
+}
+
+uint32_t WorkerPool::IdOf(const Dispatcher* dispatcher) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const WorkerPtr& worker : workers_) {
+        if (worker->dispatcher.get() == dispatcher) {
+            return worker->id;
+        }
+    }
+    return 0;
+}
+
+uint32_t WorkerPool::Add(Napi::Env env, Napi::Object operations) {
+    auto worker = std::make_shared<Worker>();
+    worker->dispatcher = std::make_shared<Dispatcher>(main_->GetOptions());
+    worker->operations = Napi::Persistent(operations);
+    if (pathTable_) {
+        worker->paths = std::make_unique<PathTable>(pathOptions_);
+    }
+
+    // The finalizer runs on the worker's thread once the function is
+    // released, or when the worker exits without unregistering
+    std::weak_ptr<WorkerPool> pool = weak_from_this();
+    worker->tsfn = Napi::ThreadSafeFunction::New(
+        env,
+        Napi::Function::New(env, [](const Napi::CallbackInfo&) {}),
+        "FUSE3Worker",
+        0,
+        1,
+        [pool, worker](Napi::Env) { Finalize(pool, worker); });
+    worker->dispatcher->Start(worker->tsfn, &worker->operations, worker->paths.get());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Ids go into handles, so they wrap at kMaxId, skipping those in use
+    auto inUse = [this](uint32_t id) {
+        return std::any_of(workers_.begin(), workers_.end(), [id](const WorkerPtr& w) { return w->id == id; });
+    };
+    do {
+        worker->id = nextId_;
+        nextId_ = nextId_ == kMaxId ? 1 : nextId_ + 1;
+    } while (inUse(worker->id));
+    worker->seed = Mix(worker->id);
+    workers_.push_back(worker);
+    return worker->id;
+}
+
+// Takes a worker out of the routing. The thread-safe function is released
+// under the lock, so a finalizer running at the same time cannot free it
+// in between.
+bool WorkerPool::Detach(uint32_t id, bool release) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(workers_.begin(), workers_.end(),
+                           [id](const WorkerPtr& worker) { return worker->id == id; });
+    if (it == workers_.end()) {
+        return false;
+    }
+    WorkerPtr worker = *it;
+    workers_.erase(it);
+    if (release && !worker->released) {
+        worker->released = true;
+        worker->tsfn.Release();
+    }
+    return true;
+}
+
+bool WorkerPool::Remove(uint32_t id) {
+    return Detach(id, true);
+}
+
+void WorkerPool::RemoveAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const WorkerPtr& worker : workers_) {
+        if (!worker->released) {
+            worker->released = true;
+            worker->tsfn.Release();
+        }
+    }
+    workers_.clear();
+}
+
+// On the worker's thread. Work still queued for it (it exited without
+// unregistering, or raced with Remove) is served by the remaining threads,
+// each item by the one now serving its key. Work on a handle it opened goes
+// there as well, as in PostHandle.
+void WorkerPool::Finalize(const std::weak_ptr<WorkerPool>& weak, const WorkerPtr& worker) {
+    std::vector<Dispatcher::Left> left = worker->dispatcher->Close();
+    worker->operations.Reset();
+    worker->paths.reset();
+
+    std::shared_ptr<WorkerPool> pool = weak.lock();
+    if (!pool) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex_);
+        worker->released = true;
+        pool->workers_.erase(std::remove(pool->workers_.begin(), pool->workers_.end(), worker),
+                             pool->workers_.end());
+    }
+    for (Dispatcher::Left& item : left) {
+        pool->PostRoute(item.route, std::move(item.work), item.lane);
+    }
+}
+
+PathTable* WorkerPool::PathsOf(uint32_t id) {
+    WorkerPtr worker = Find(id);
+    return worker ? worker->paths.get() : nullptr;
+}
+
+std::vector<WorkerPool::Counters> WorkerPool::GetCounters() {
+    std::vector<Counters> counters;
+    counters.push_back(Counters{0, mainRouted_.load(), main_->GetCounters()});
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const WorkerPtr& worker : workers_) {
+        counters.push_back(Counters{worker->id, worker->routed.load(), worker->dispatcher->GetCounters()});
+    }
+    return counters;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <napi.h>
+#include "fuse3_dispatch.h"
+#include "fuse3_path_table.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// JS threads serving one mount. The thread that created the mount serves
+// every request until worker_threads register handlers of their own; from
+// then on each request goes to one of the workers, picked by a hash of its
+// path. A path stays with its worker while the set of workers is unchanged,
+// so the calls for one file keep their order while different files are
+// served in parallel. Adding or removing a worker only moves the paths that
+// hash to it (rendezvous hashing).
+//
+// Open handles are different: the fd a handler reports is only known to the
+// thread that opened it, and every thread counts its own. The kernel gets
+// that fd with the id of the thread in the top bits (MakeHandle), so no two
+// open handles share a number in the native tables, and requests on a
+// handle go back to the thread that opened it (PostHandle) even after a
+// rename or a change of workers.
+class WorkerPool : public std::enable_shared_from_this<WorkerPool> {
+public:
+    struct Counters {
+        uint32_t id;          // 0: the thread that created the mount
+        uint64_t routed;      // requests sent to it
+        Dispatcher::Counters dispatch;
+    };
+
+    // Workers' dispatchers take the options of main. paths: options of the
+    // per-thread path table, null when it is off.
+    WorkerPool(std::shared_ptr<Dispatcher> main, const PathTable::Options* paths);
+
+    // Queues work for the thread serving key (a path). Fails like
+    // Dispatcher::Post once the main thread is gone. work is moved along,
+    // not copied, to the worker that takes it.
+    napi_status Post(std::string_view key, Dispatcher::Work&& work,
+                     Dispatcher::Lane lane = Dispatcher::Lane::Metadata);
+    // Queues work for the thread that opened fh. If that worker is gone,
+    // the work goes by key like Post.
+    napi_status PostHandle(uint64_t fh, std::string_view key, Dispatcher::Work&& work,
+                           Dispatcher::Lane lane = Dispatcher::Lane::Metadata);
+
+    static constexpr unsigned int kHandleShift = 48;
+    static constexpr uint64_t kJsHandleMask = (uint64_t(1) << kHandleShift) - 1;
+    static constexpr uint32_t kMaxId = 0xffff;
+
+    // The handle the kernel gets for the fd jsFh opened by thread owner;
+    // false if jsFh does not fit
+    static bool MakeHandle(uint32_t owner, int64_t jsFh, uint64_t* fh) {
+        if (jsFh < 0 || static_cast<uint64_t>(jsFh) > kJsHandleMask) {
+            return false;
+        }
+        *fh = (static_cast<uint64_t>(owner) << kHandleShift) | static_cast<uint64_t>(jsFh);
+        return true;
+    }
+    // The fd the handler of the owning thread knows fh by
+    static uint64_t JsHandle(uint64_t fh) { return fh & kJsHandleMask; }
+    // The id of the thread running dispatcher: 0 for the main thread
+    uint32_t IdOf(const Dispatcher* dispatcher);
+
+    // On a worker's JS thread: serve requests with operations from now on.
+    // Returns the worker's id.
+    uint32_t Add(Napi::Env env, Napi::Object operations);
+    // Stops routing to a worker; what was queued for it still runs there.
+    // Returns false for ids that are not registered (anymore).
+    bool Remove(uint32_t id);
+    void RemoveAll();
+
+    // The path table of a worker (on that worker's thread only)
+    PathTable* PathsOf(uint32_t id);
+
+    std::vector<Counters> GetCounters();
+
+private:
+    struct Worker {
+        uint32_t id;
+        uint64_t seed;
+        std::shared_ptr<Dispatcher> dispatcher;
+        Napi::ThreadSafeFunction tsfn;
+        Napi::ObjectReference operations;
+        std::unique_ptr<PathTable> paths;
+        std::atomic<uint64_t> routed{0};
+        bool released = false;  // under WorkerPool::mutex_
+    };
+    using WorkerPtr = std::shared_ptr<Worker>;
+
+    static uint64_t RouteOf(std::string_view key);
+    WorkerPtr Route(uint64_t route);
+    // Post by the hash of a key
+    napi_status PostRoute(uint64_t route, Dispatcher::Work&& work, Dispatcher::Lane lane);
+    WorkerPtr Find(uint32_t id);
+    bool Detach(uint32_t id, bool release);
+    static void Finalize(const std::weak_ptr<WorkerPool>& pool, const WorkerPtr& worker);
+
+    std::shared_ptr<Dispatcher> main_;
+    std::atomic<uint64_t> mainRouted_{0};
+    bool pathTable_;
+    PathTable::Options pathOptions_;
+
+    std::mutex mutex_;
+    std::vector<WorkerPtr> workers_;
+    uint32_t nextId_ = 1;
+};
\ No newline at end of file
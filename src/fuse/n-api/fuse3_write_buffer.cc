@@ -0,0 +1,236 @@
+#include "fuse3_write_buffer.h"
+#include <errno.h>
+
+WriteBuffer::WriteBuffer(const Options& options, WriteFn write, WriteAsyncFn writeAsync)
+    : options_(options),
+      write_(std::move(write)),
+      writeAsync_(std::move(writeAsync)) {
+    if (options_.maxDelayMs > 0) {
+        timer_ = std::thread(&WriteBuffer::TimerLoop, this);
+    }
+}
+
+WriteBuffer::~WriteBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(timerMutex_);
+        stopping_ = true;
+    }
+    timerWake_.notify_all();
+    if (timer_.joinable()) {
+        timer_.join();
+    }
+}
+
+// Creates the handle and records its path when path is given
+WriteBuffer::HandlePtr WriteBuffer::GetHandle(uint64_t fh, const std::string* path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = handles_.find(fh);
+    if (found != handles_.end()) {
+        if (path && found->second->path != *path) {
+            found->second->path = *path;
+        }
+        return found->second;
+    }
+    if (!path) {
+        return nullptr;
+    }
+    auto handle = std::make_shared<Handle>();
+    handle->path = *path;
+    handles_.emplace(fh, handle);
+    return handle;
+}
+
+int WriteBuffer::TakeError(Handle& handle) {
+    int error = handle.error;
+    handle.error = 0;
+    return error;
+}
+
+// Waits until JS answered every write-out of the handle, so writes reach JS
+// in order. False once deadline passed first.
+bool WriteBuffer::WaitIdle(std::unique_lock<std::mutex>& lock, Handle& handle, Clock::time_point deadline) {
+    auto idle = [&handle] { return handle.inFlight == 0; };
+    if (deadline == Clock::time_point::max()) {
+        handle.idle.wait(lock, idle);
+        return true;
+    }
+    return handle.idle.wait_until(lock, deadline, idle);
+}
+
+// Writes to JS with the handle unlocked, so the timer and FlushPath only
+// wait for this handle while its write-out counts as in flight.
+int WriteBuffer::WriteOut(std::unique_lock<std::mutex>& lock, Handle& handle, const std::string& path,
+                          uint64_t fh, const char* data, size_t size, off_t offset) {
+    handle.inFlight++;
+    (*inFlight_)++;
+    lock.unlock();
+    int res = write_(path, fh, data, size, offset);
+    lock.lock();
+    handle.inFlight--;
+    (*inFlight_)--;
+    handle.idle.notify_all();
+    return res;
+}
+
+int WriteBuffer::FlushLocked(std::unique_lock<std::mutex>& lock, Handle& handle, Clock::time_point deadline) {
+    if (!WaitIdle(lock, handle, deadline)) {
+        return options_.timeoutErr;
+    }
+    if (!handle.pending) {
+        return 0;
+    }
+
+    ExtentPtr extent = std::move(handle.pending);
+    handle.pending.reset();
+    pendingHandles_--;
+    int res = WriteOut(lock, handle, extent->path, extent->fh, extent->data.data(), extent->data.size(),
+                       extent->offset);
+    if (res >= 0 && static_cast<size_t>(res) < extent->data.size()) {
+        // Earlier writes were already acknowledged in full
+        res = -EIO;
+    }
+    return res < 0 ? res : 0;
+}
+
+int WriteBuffer::Write(const std::string& path, uint64_t fh, const char* data, size_t size, off_t offset,
+                       Clock::time_point deadline) {
+    HandlePtr handle = GetHandle(fh, &path);
+    std::unique_lock<std::mutex> lock(handle->mutex);
+    if (handle->error < 0) {
+        return TakeError(*handle);
+    }
+
+    ExtentPtr& pending = handle->pending;
+    bool appends = pending && pending->path == path &&
+        offset == pending->offset + static_cast<off_t>(pending->data.size()) &&
+        pending->data.size() + size <= options_.maxBytes;
+    if (pending && !appends) {
+        int res = FlushLocked(lock, *handle, deadline);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    if (!pending && size >= options_.maxBytes) {
+        // Nothing to merge with
+        if (!WaitIdle(lock, *handle, deadline)) {
+            return options_.timeoutErr;
+        }
+        return WriteOut(lock, *handle, path, fh, data, size, offset);
+    }
+
+    if (!pending) {
+        pending = std::make_shared<Extent>();
+        pending->path = path;
+        pending->fh = fh;
+        pending->offset = offset;
+        pending->data.reserve(options_.maxBytes);
+        handle->since = Clock::now();
+        pendingHandles_++;
+    }
+    pending->data.insert(pending->data.end(), data, data + size);
+
+    if (pending->data.size() >= options_.maxBytes) {
+        int res = FlushLocked(lock, *handle, deadline);
+        if (res < 0) {
+            return res;
+        }
+    }
+    return static_cast<int>(size);
+}
+
+int WriteBuffer::Flush(uint64_t fh, Clock::time_point deadline) {
+    HandlePtr handle = GetHandle(fh, nullptr);
+    if (!handle) {
+        return 0;
+    }
+    std::unique_lock<std::mutex> lock(handle->mutex);
+    int res = FlushLocked(lock, *handle, deadline);
+    int error = TakeError(*handle);
+    return error < 0 ? error : res;
+}
+
+// The synchronous write still ends at the deadline of the write operation
+int WriteBuffer::Release(uint64_t fh) {
+    int res = Flush(fh, Clock::time_point::max());
+    std::lock_guard<std::mutex> lock(mutex_);
+    handles_.erase(fh);
+    return res;
+}
+
+void WriteBuffer::FlushPath(std::string_view path, Clock::time_point deadline) {
+    if (pendingHandles_ == 0 && *inFlight_ == 0) {
+        return;
+    }
+
+    std::vector<HandlePtr> matching;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : handles_) {
+            if (entry.second->path == path) {
+                matching.push_back(entry.second);
+            }
+        }
+    }
+    for (HandlePtr& handle : matching) {
+        std::unique_lock<std::mutex> lock(handle->mutex);
+        // Only a failed write is the handle's error, not a wait that ran out
+        if (!WaitIdle(lock, *handle, deadline)) {
+            continue;
+        }
+        int res = FlushLocked(lock, *handle, deadline);
+        if (res < 0 && handle->error == 0) {
+            handle->error = res;
+        }
+    }
+}
+
+// Hands extents that waited longer than maxDelayMs to JS without blocking,
+// so this thread never waits for the JS thread (which may itself be waiting
+// for the mount thread to stop).
+void WriteBuffer::TimerLoop() {
+    const auto delay = std::chrono::milliseconds(options_.maxDelayMs);
+    std::unique_lock<std::mutex> timerLock(timerMutex_);
+    while (!timerWake_.wait_for(timerLock, delay / 2 + std::chrono::milliseconds(1), [this] { return stopping_; })) {
+        if (pendingHandles_ == 0) {
+            continue;
+        }
+
+        std::vector<HandlePtr> handles;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& entry : handles_) {
+                handles.push_back(entry.second);
+            }
+        }
+
+        auto now = Clock::now();
+        for (HandlePtr& handle : handles) {
+            // A handle that is busy is being written or flushed right now. One
+            // write-out per handle at a time keeps them in order.
+            std::unique_lock<std::mutex> lock(handle->mutex, std::try_to_lock);
+            if (!lock.owns_lock() || !handle->pending || handle->inFlight > 0 || now - handle->since < delay) {
+                continue;
+            }
+            ExtentPtr extent = std::move(handle->pending);
+            handle->pending.reset();
+            pendingHandles_--;
+            handle->inFlight++;
+            (*inFlight_)++;
+            lock.unlock();
+
+            writeAsync_(extent, [handle, extent, inFlight = inFlight_](int res) {
+                std::lock_guard<std::mutex> lock(handle->mutex);
+                if (res >= 0 && static_cast<size_t>(res) < extent->data.size()) {
+                    res = -EIO;
+                }
+                if (res < 0 && handle->error == 0) {
+                    handle->error = res;
+                }
+                handle->inFlight--;
+                (*inFlight)--;
+                handle->idle.notify_all();
+            });
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <sys/types.h>
+#include <errno.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Per-handle write-back buffer. Contiguous writes to a handle are merged
+// into one extent that goes to JS as a single write once it reaches
+// maxBytes, once it is older than maxDelayMs, or when the handle is flushed,
+// fsynced or released. A failed write-out is reported by the next write,
+// flush, fsync or release of the handle. Waiting for an earlier write-out
+// ends at the deadline of the calling operation with timeoutErr, except in
+// Release: the data was acknowledged to the application already, and JS
+// must not see the release before the last write of the handle.
+class WriteBuffer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        size_t maxBytes = 1024 * 1024;
+        unsigned int maxDelayMs = 100;  // 0 flushes on size and close only
+        int timeoutErr = -EIO;
+    };
+
+    struct Extent {
+        std::string path;
+        uint64_t fh = 0;
+        off_t offset = 0;
+        std::vector<char> data;
+    };
+    using ExtentPtr = std::shared_ptr<Extent>;
+
+    // Writes to JS and waits; returns bytes written or -errno.
+    using WriteFn = std::function<int(const std::string& path, uint64_t fh, const char* data, size_t size, off_t offset)>;
+    // Starts a write to JS without blocking; done(result) runs once JS answered.
+    using WriteAsyncFn = std::function<void(ExtentPtr extent, std::function<void(int)> done)>;
+
+    WriteBuffer(const Options& options, WriteFn write, WriteAsyncFn writeAsync);
+    WriteBuffer(const WriteBuffer&) = delete;
+    WriteBuffer& operator=(const WriteBuffer&) = delete;
+    ~WriteBuffer();
+
+    // Returns size once the data is buffered (or written), else -errno
+    int Write(const std::string& path, uint64_t fh, const char* data, size_t size, off_t offset,
+              Clock::time_point deadline = Clock::time_point::max());
+    // Writes out what fh holds; returns the first error since the last call
+    int Flush(uint64_t fh, Clock::time_point deadline = Clock::time_point::max());
+    // Waits for the write-outs of fh, writes what it holds and forgets it
+    int Release(uint64_t fh);
+    // Writes out every handle of path and waits for its write-outs, so reads
+    // and getattr see the data. Errors stay with their handles.
+    void FlushPath(std::string_view path, Clock::time_point deadline = Clock::time_point::max());
+
+private:
+    struct Handle {
+        std::mutex mutex;
+        std::condition_variable idle;
+        std::string path;  // of the last write; guarded by WriteBuffer::mutex_
+        ExtentPtr pending;
+        Clock::time_point since;
+        int inFlight = 0;  // write-outs JS has not answered yet
+        int error = 0;
+    };
+    using HandlePtr = std::shared_ptr<Handle>;
+
+    HandlePtr GetHandle(uint64_t fh, const std::string* path);
+    bool WaitIdle(std::unique_lock<std::mutex>& lock, Handle& handle, Clock::time_point deadline);
+    int WriteOut(std::unique_lock<std::mutex>& lock, Handle& handle, const std::string& path, uint64_t fh,
+                 const char* data, size_t size, off_t offset);
+    int FlushLocked(std::unique_lock<std::mutex>& lock, Handle& handle, Clock::time_point deadline);
+    static int TakeError(Handle& handle);
+    void TimerLoop();
+
+    Options options_;
+    WriteFn write_;
+    WriteAsyncFn writeAsync_;
+
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, HandlePtr> handles_;
+    std::atomic<int> pendingHandles_{0};
+    // Write-outs of all handles; shared with the callbacks of timed ones
+    std::shared_ptr<std::atomic<int>> inFlight_ = std::make_shared<std::atomic<int>>(0);
+
+    std::mutex timerMutex_;
+    std::condition_variable timerWake_;
+    bool stopping_ = false;
+    std::thread timer_;
+};
\ No newline at end of file
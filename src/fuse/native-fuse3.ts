@@ -14,8 +14,18 @@ import { EventEmitter } from 'events';
 import { createRequire } from 'module';
 import path from 'path';
 import fs from 'fs';
-import type { FuseOperations } from './types.js';
-export type { Stats, FuseOperations } from './types.js';
+import type {
+    FuseOperations, Fuse3Options, ContentCacheStats, DispatchStats, FuseStats, ConnectionInfo, PathStats,
+    ProbeFilterStats, DeadlineStats, NotifyStats, FlightRecorderStats, RequestSlotStats, PrewarmStats,
+    WorkerStats, WorkerRegistration
+} from './types.js';
+export type {
+    Stats, FuseOperations, Fuse3Options, ContentCacheStats, OpenReply, BatchedCall, DispatchStats,
+    FuseStats, OperationStats, PhaseStats, ConnectionInfo, PathStats, ProbeFilterStats,
+    DeadlineStats, NotifyStats, FlightRecorderStats, RequestSlotStats, PrewarmStats, WorkerStats,
+    WorkerRegistration, DispatchLane, LaneStats
+} from './types.js';
+export { STAT_FIELDS, StatField, packStats } from './types.js';
 
 const require = createRequire(import.meta.url);
 
@@ -72,6 +82,8 @@ export const ENOSPC = fuseAddon.ENOSPC;
 export const EROFS = fuseAddon.EROFS;
 export const EBUSY = fuseAddon.EBUSY;
 export const ENOTEMPTY = fuseAddon.ENOTEMPTY;
+export const EINTR = fuseAddon.EINTR;
+export const ETIMEDOUT = fuseAddon.ETIMEDOUT;
 
 
 /**
@@ -83,7 +95,7 @@ export class Fuse extends EventEmitter {
     private fuseInstance: any;
     private mountPath: string;
     private operations: FuseOperations;
-    private options: any;
+    private options: Fuse3Options;
     private mounted = false;
 
     // Static error codes
@@ -99,8 +111,10 @@ export class Fuse extends EventEmitter {
     static EROFS = EROFS;
     static EBUSY = EBUSY;
     static ENOTEMPTY = ENOTEMPTY;
+    static EINTR = EINTR;
+    static ETIMEDOUT = ETIMEDOUT;
 
-    constructor(mountPath: string, operations: FuseOperations, options: any = {}) {
+    constructor(mountPath: string, operations: FuseOperations, options: Fuse3Options = {}) {
         super();
         
         if (process.platform !== 'linux') {
@@ -126,6 +140,10 @@ export class Fuse extends EventEmitter {
             this.fuseInstance.on('mount', () => this.emit('mount'));
             this.fuseInstance.on('unmount', () => this.emit('unmount'));
         }
+        // Progress of the pre-warm walk (prewarm option) as 'prewarm' events
+        if (typeof this.fuseInstance.setPrewarmListener === 'function') {
+            this.fuseInstance.setPrewarmListener((progress: PrewarmStats) => this.emit('prewarm', progress));
+        }
     }
 
     mount(callback: (err?: Error | null) => void): void {
@@ -166,6 +184,177 @@ export class Fuse extends EventEmitter {
         });
     }
 
+    /**
+     * Drop the native attribute cache entry of a single path. Call this when
+     * the backing store changed a file without going through the mount.
+     */
+    invalidate(path: string): void {
+        this.fuseInstance.invalidate(path);
+    }
+
+    /**
+     * Drop the native attribute cache entries of path and everything below it.
+     */
+    invalidatePrefix(path: string): void {
+        this.fuseInstance.invalidatePrefix(path);
+    }
+
+    /**
+     * Tell the kernel that the attributes or data of paths changed behind
+     * the mount. Like notifyEntry and notifyDelete, this drops the native
+     * caches at once and sends the notification from a native thread, merged
+     * with others queued for the path. Returns false when not mounted.
+     */
+    notifyChange(paths: string | string[]): boolean {
+        return this.fuseInstance.notifyChange(paths);
+    }
+
+    /**
+     * Tell the kernel that names were created or now refer to other files.
+     */
+    notifyEntry(paths: string | string[]): boolean {
+        return this.fuseInstance.notifyEntry(paths);
+    }
+
+    /**
+     * Tell the kernel that names are gone.
+     */
+    notifyDelete(paths: string | string[]): boolean {
+        return this.fuseInstance.notifyDelete(paths);
+    }
+
+    /**
+     * Kernel notifications queued, merged and sent. Their latency is the
+     * notify operation of getStats().
+     */
+    getNotifyStats(): NotifyStats {
+        return this.fuseInstance.getNotifyStats();
+    }
+
+    /**
+     * The requests the flight recorder holds as Chrome trace JSON (open in
+     * ui.perfetto.dev or chrome://tracing), or null when flight_recorder is
+     * off.
+     */
+    dumpTrace(): string | null {
+        return this.fuseInstance.dumpTrace();
+    }
+
+    /**
+     * Requests recorded and traces written on a trigger, or null when
+     * flight_recorder is off.
+     */
+    getFlightRecorderStats(): FlightRecorderStats | null {
+        return this.fuseInstance.getFlightRecorderStats();
+    }
+
+    /**
+     * Hit, miss and eviction counters of the native content cache, or null
+     * when content_cache is off.
+     */
+    getContentCacheStats(): ContentCacheStats | null {
+        return this.fuseInstance.getContentCacheStats();
+    }
+
+    /**
+     * Wakeups of the JS thread versus requests handed to JS, and the depth of
+     * the native dispatch queue.
+     */
+    getDispatchStats(): DispatchStats {
+        return this.fuseInstance.getDispatchStats();
+    }
+
+    /**
+     * The path behind an ID handlers receive with path_ids on, or undefined
+     * once it dropped out of the path table. An ID never names another path.
+     */
+    pathOf(id: number): string | undefined {
+        return this.fuseInstance.pathOf(id);
+    }
+
+    /**
+     * Hit, miss and eviction counters of the native path table, or null when
+     * path_cache and path_ids are off.
+     */
+    getPathStats(): PathStats | null {
+        return this.fuseInstance.getPathStats();
+    }
+
+    /**
+     * Lookups the probe filter answered without calling getattr, or null
+     * when probe_filter is off.
+     */
+    getProbeFilterStats(): ProbeFilterStats | null {
+        return this.fuseInstance.getProbeFilterStats();
+    }
+
+    /**
+     * Requests failed past op_timeout or on a kernel interrupt, or null when
+     * neither is enabled.
+     */
+    getDeadlineStats(): DeadlineStats | null {
+        return this.fuseInstance.getDeadlineStats();
+    }
+
+    /**
+     * Request slots taken and free, and replies that came too late, or null
+     * when request_slots is off.
+     */
+    getRequestSlotStats(): RequestSlotStats | null {
+        return this.fuseInstance.getRequestSlotStats();
+    }
+
+    /**
+     * Progress of the pre-warm walk, or null when prewarm is off. The same
+     * is emitted as 'prewarm' events while it runs and once it is done.
+     */
+    getPrewarmStats(): PrewarmStats | null {
+        return this.fuseInstance.getPrewarmStats();
+    }
+
+    /**
+     * Stop routing requests to a worker registered with registerWorker().
+     * What was already queued for it still runs there.
+     */
+    removeWorker(id: number): boolean {
+        return this.fuseInstance.removeWorker(id);
+    }
+
+    /**
+     * Requests routed to and dispatch counters of every JS thread serving the
+     * mount, the creating thread (id 0) first.
+     */
+    getWorkerStats(): WorkerStats[] {
+        return this.fuseInstance.getWorkerStats();
+    }
+
+    /**
+     * Capabilities and limits negotiated with the kernel, or null until the
+     * kernel sent INIT (shortly after mount).
+     */
+    getConnectionInfo(): ConnectionInfo | null {
+        return this.fuseInstance.getConnectionInfo();
+    }
+
+    /**
+     * Per-operation latency percentiles (queue wait, JS, total), bytes and
+     * errors since the last reset, or null when op_stats is off.
+     */
+    getStats(): FuseStats | null {
+        return this.fuseInstance.getStats();
+    }
+
+    /**
+     * The same counters in the Prometheus text exposition format.
+     */
+    getPrometheusStats(): string | null {
+        return this.fuseInstance.getStats('prometheus');
+    }
+
+    resetStats(): void {
+        this.fuseInstance.resetStats();
+    }
+
     get mnt(): string {
         return this.mountPath;
     }
@@ -193,4 +382,15 @@ export class Fuse extends EventEmitter {
     }
 }
 
-export type OPERATIONS = Required<FuseOperations>;
\ No newline at end of file
+/**
+ * Call on a worker_threads thread to serve requests of the file system
+ * mounted at mountPoint with operations. Requests are spread over all
+ * registered workers by a hash of their path, so the calls for one file stay
+ * on one worker and in order. The worker stays alive until it unregisters or
+ * the file system is unmounted.
+ */
+export function registerWorker(mountPoint: string, operations: FuseOperations): WorkerRegistration {
+    return fuseAddon.registerWorker(mountPoint, operations);
+}
+
+export type OPERATIONS = Required<FuseOperations>;
\ No newline at end of file
@@ -11,17 +11,450 @@ export const ENOSPC = 28;  // No space left on device
 export const EROFS = 30;   // Read-only file system
 export const EBUSY = 16;   // Device or resource busy
 export const ENOTEMPTY = 39; // Directory not empty
+export const EINTR = 4;    // Interrupted system call
+export const ETIMEDOUT = 110; // Connection timed out
 
-// FUSE file stats interface
+// FUSE file stats interface. Times are Dates or seconds since the epoch.
 export interface Stats {
-    mtime: Date;
-    atime: Date;
-    ctime: Date;
+    mtime: Date | number;
+    atime: Date | number;
+    ctime: Date | number;
     size: number;
     mode: number;
     uid: number;
     gid: number;
     nlink?: number;
+    /** Seconds the native attribute cache may keep this entry (overrides attr_cache_timeout) */
+    ttl?: number;
+}
+
+/**
+ * Binary stat replies: instead of Stats objects, getattr may call back with a
+ * Float64Array holding one entry and readdir with one holding STAT_FIELDS
+ * doubles per name, which the addon reads without property lookups. Times are
+ * split into seconds and nanoseconds; a ttl of NaN keeps the default, and a
+ * readdir entry with mode 0 has no attributes.
+ */
+export const STAT_FIELDS = 12;
+export const StatField = {
+    mode: 0,
+    size: 1,
+    uid: 2,
+    gid: 3,
+    nlink: 4,
+    atimeSec: 5,
+    atimeNsec: 6,
+    mtimeSec: 7,
+    mtimeNsec: 8,
+    ctimeSec: 9,
+    ctimeNsec: 10,
+    ttl: 11
+} as const;
+
+function packTime(target: Float64Array, at: number, time: Date | number): void {
+    if (typeof time === 'number') {
+        target[at] = time;
+        target[at + 1] = 0;
+    } else {
+        const ms = time.getTime();
+        target[at] = Math.floor(ms / 1000);
+        target[at + 1] = (ms - target[at] * 1000) * 1e6;
+    }
+}
+
+/**
+ * Writes stats into the binary layout, entry i at i * STAT_FIELDS. Undefined
+ * entries are left without attributes. The addon copies a reply before the
+ * callback returns, so target can be reused for the next one.
+ */
+export function packStats(
+    stats: ArrayLike<Stats | undefined>,
+    target: Float64Array = new Float64Array(stats.length * STAT_FIELDS)
+): Float64Array {
+    for (let i = 0; i < stats.length; i++) {
+        const stat = stats[i];
+        const at = i * STAT_FIELDS;
+        if (stat === undefined) {
+            target.fill(0, at, at + STAT_FIELDS);
+            continue;
+        }
+        target[at + StatField.mode] = stat.mode;
+        target[at + StatField.size] = stat.size;
+        target[at + StatField.uid] = stat.uid;
+        target[at + StatField.gid] = stat.gid;
+        target[at + StatField.nlink] = stat.nlink ?? 0;
+        packTime(target, at + StatField.atimeSec, stat.atime);
+        packTime(target, at + StatField.mtimeSec, stat.mtime);
+        packTime(target, at + StatField.ctimeSec, stat.ctime);
+        target[at + StatField.ttl] = stat.ttl ?? NaN;
+    }
+    return target;
+}
+
+// Options understood by the native FUSE3 addon. Names follow the libfuse
+// mount options so they can live in filerConfig.fuseOptions unchanged.
+export interface Fuse3Options {
+    /** Run the session with fuse_loop_mt instead of the single-threaded fuse_loop */
+    multithreaded?: boolean;
+    /** Upper bound on worker threads (honoured with libfuse >= 3.12) */
+    max_threads?: number;
+    /** Give every worker its own /dev/fuse file descriptor */
+    clone_fd?: boolean;
+    /** Idle workers kept around before they are torn down */
+    max_idle_threads?: number;
+    /** Answer getattr from a native path -> stat cache (default true) */
+    attr_cache?: boolean;
+    /** Seconds a successful getattr result stays cached (default 1.0) */
+    attr_cache_timeout?: number;
+    /** Seconds an ENOENT result stays cached (default 0, disabled) */
+    attr_cache_negative_timeout?: number;
+    /** Upper bound on cached paths, evicted least recently used first (default 65536) */
+    attr_cache_max_entries?: number;
+    /** Let read handlers fill the FUSE reply memory in place (default true) */
+    zero_copy_read?: boolean;
+    /** Let the kernel splice large write payloads (FUSE_CAP_SPLICE_READ, default false) */
+    splice_read?: boolean;
+    /** Inode-based fuse_lowlevel backend with asynchronous replies (default false) */
+    low_level?: boolean;
+    /** Serve reads of files opened with a content hash from a native cache (default true) */
+    content_cache?: boolean;
+    /** Content cache budget in MiB (default 64, 0 disables the cache) */
+    content_cache_size_mb?: number;
+    /** Let the kernel read backed handles from the host file (FUSE passthrough, low_level only, default true) */
+    passthrough?: boolean;
+    /** Merge contiguous writes per handle before they reach the write handler (default false) */
+    write_coalesce?: boolean;
+    /** Size in KiB at which a merged write is handed to JS (default 1024) */
+    write_coalesce_max_kb?: number;
+    /** Milliseconds a merged write may wait before it is handed to JS, 0 = only on size or close (default 100) */
+    write_coalesce_delay_ms?: number;
+    /** Fetch data ahead of handles that are read sequentially (default true) */
+    readahead?: boolean;
+    /** Initial readahead window in KiB (default 256) */
+    readahead_min_kb?: number;
+    /** Largest readahead window in KiB (default 4096) */
+    readahead_max_kb?: number;
+    /** Readahead data held across all handles in MiB (default 64, 0 disables readahead) */
+    readahead_total_mb?: number;
+    /** Let the kernel cache writes itself (FUSE_CAP_WRITEBACK_CACHE, default false) */
+    writeback_cache?: boolean;
+    /** Drain all requests queued at a JS wakeup in one callback (default true) */
+    batch_dispatch?: boolean;
+    /**
+     * Items of a lane a drain takes per weighted round robin round (defaults 8, 4, 1; at least 1).
+     * Background work is only taken when the other lanes have nothing to run.
+     */
+    metadata_weight?: number;
+    data_weight?: number;
+    background_weight?: number;
+    /**
+     * Items of a lane drained and not answered by JS yet, 0 for no limit (default 0 for every lane).
+     * Only set with op_timeout: without it, handlers that never call back hold their place for good.
+     */
+    metadata_in_flight?: number;
+    data_in_flight?: number;
+    background_in_flight?: number;
+    /** Keep per-operation latency histograms and counters (getStats, default true) */
+    op_stats?: boolean;
+    /** Intern the paths passed to handlers and reuse their JS strings (default true) */
+    path_cache?: boolean;
+    /** Paths kept interned, least recently used dropped first (default 16384) */
+    path_cache_max_entries?: number;
+    /** Pass handlers numeric path IDs instead of strings; resolve them with pathOf() (default false) */
+    path_ids?: boolean;
+    /** Answer lookups of Windows probe names (desktop.ini, *.lnk, ...) with ENOENT natively (default false) */
+    probe_filter?: boolean;
+    /** Globs of names that never exist, matched case-insensitively (default desktop.ini, thumbs.db, autorun.inf, *.lnk) */
+    probe_filter_rules?: string[];
+    /** getattr misses of a path before it is filtered, 0 = never (default 4) */
+    probe_filter_learn?: number;
+    /** Seconds a learned path is filtered for (default 30) */
+    probe_filter_ttl?: number;
+    /** Seconds the kernel keeps a filtered ENOENT, low_level only (default 10) */
+    probe_filter_negative_timeout?: number;
+    /** Seconds a request may wait for its handler before it fails, 0 = forever (default 0) */
+    op_timeout?: number;
+    /** op_timeout per operation, keyed like getStats().ops, e.g. { read: 30, lookup: 2 } */
+    op_timeouts?: Record<string, number>;
+    /** Errno a request past its timeout fails with (default EIO) */
+    op_timeout_errno?: number;
+    /** Fail a request with EINTR once the kernel interrupts it, e.g. on Ctrl-C (default false) */
+    interrupts?: boolean;
+    /** Keep the last requests of every thread for dumpTrace() (default false) */
+    flight_recorder?: boolean;
+    /** Requests kept per thread (default 4096) */
+    flight_recorder_entries?: number;
+    /** Write a trace to flight_recorder_dir when a request takes this many ms, 0 = never (default 0) */
+    flight_recorder_trigger_ms?: number;
+    /** Seconds between triggered traces (default 60) */
+    flight_recorder_cooldown?: number;
+    /** Directory of triggered traces (default /tmp) */
+    flight_recorder_dir?: string;
+    /**
+     * Requests that may wait on JS in preallocated slots, 0 = none (default 0). With slots every
+     * handler gets (...args, reply, id) in place of its callback and answers with reply(id, err, ...)
+     */
+    request_slots?: number;
+    /** What a request gets when every slot is taken: a reply function of its own, or EAGAIN (default 'callback') */
+    request_slots_exhausted?: 'callback' | 'fail';
+    /** Walk the tree through readdir/getattr once mounted, behind every kernel request (default false) */
+    prewarm?: boolean;
+    /** Directories of the walk, absolute within the mount (default ['/']) */
+    prewarm_paths?: string[];
+    /** Levels below a prewarm path that are listed (default 3) */
+    prewarm_depth?: number;
+    /** Names the walk takes from listings before it stops (default 10000) */
+    prewarm_entries?: number;
+    /** Handler calls per second, 0 = no limit (default 200) */
+    prewarm_rate?: number;
+    /** Seconds the kernel caches a looked-up name (default 1) */
+    entry_timeout?: number;
+    /** Seconds the kernel caches attributes (default 1) */
+    attr_timeout?: number;
+    /** Seconds the kernel caches a failed lookup (default 0) */
+    negative_timeout?: number;
+    /** Keep the kernel page cache of a file across opens (default false) */
+    kernel_cache?: boolean;
+    /** Keep it only while mtime and size are unchanged (high-level backend, default false) */
+    auto_cache?: boolean;
+    /** Let the kernel send several reads of a handle at once (FUSE_CAP_ASYNC_READ, default true) */
+    async_read?: boolean;
+    /** Opposite of async_read; async_read wins where both are given */
+    sync_read?: boolean;
+    /** Let the kernel run lookups and readdirs of one directory in parallel (default true) */
+    parallel_dirops?: boolean;
+    /** Largest read request in bytes (mount option) */
+    max_read?: number;
+    /** Largest write request in bytes */
+    max_write?: number;
+    /** Largest write request in pages (at most 256), used when max_write is not given */
+    max_pages?: number;
+    /** Largest kernel readahead in bytes */
+    max_readahead?: number;
+    /** Requests the kernel keeps outstanding in the background (at most 65535) */
+    max_background?: number;
+    /** Background requests at which the kernel reports congestion (at most max_background) */
+    congestion_threshold?: number;
+    [option: string]: unknown;
+}
+
+// What the kernel and the addon settled on at INIT (getConnectionInfo).
+// Capability names are the FUSE_CAP_* flags in lower case without the prefix.
+export interface ConnectionInfo {
+    /** FUSE protocol version, e.g. "7.31" */
+    protocol: string;
+    /** Capabilities the kernel offered */
+    capable: string[];
+    /** Capabilities switched on */
+    want: string[];
+    maxRead: number;
+    maxWrite: number;
+    maxReadahead: number;
+    maxBackground: number;
+    congestionThreshold: number;
+    /** Timestamp granularity in nanoseconds, 0 = 1 */
+    timeGran: number;
+}
+
+// Optional third argument of the open callback. Both parts only apply to
+// read-only opens.
+export interface OpenReply {
+    /**
+     * Marks immutable content. Reads of every file opened with the same hash
+     * share one native cache, so it must identify the exact bytes.
+     */
+    contentHash?: string;
+    /**
+     * Host file holding the content from backingOffset to its end. The addon
+     * duplicates the descriptor and serves all reads from it; the handler may
+     * close its own copy once the callback returned. Only release reaches JS.
+     */
+    backingFd?: number;
+    backingOffset?: number;
+}
+
+// Counters of the native content cache (getContentCacheStats)
+export interface ContentCacheStats {
+    hits: number;
+    misses: number;
+    evictions: number;
+    /** Cached chunks of 128 KiB (the last chunk of a file may be shorter) */
+    entries: number;
+    bytes: number;
+    maxBytes: number;
+}
+
+// One handler call of a drain, as passed to FuseOperations.batch. args ends
+// with the callback the handler would have received.
+export interface BatchedCall {
+    op: string;
+    args: unknown[];
+}
+
+// A JS thread serving a mount (getWorkerStats): id 0 is the thread that
+// created it, the others are worker_threads registered with registerWorker
+export interface WorkerStats extends DispatchStats {
+    id: number;
+    /** Requests routed to this thread */
+    routed: number;
+}
+
+// What registerWorker returns on the worker's thread
+export interface WorkerRegistration {
+    id: number;
+    /** Resolves the path IDs this worker was given (path_ids) */
+    pathOf(id: number): string | undefined;
+    /** Stop receiving requests; returns false if already removed */
+    unregister(): boolean;
+}
+
+// Counters of the native path table (getPathStats)
+export interface PathStats {
+    /** Paths passed to JS that were already interned */
+    hits: number;
+    misses: number;
+    evictions: number;
+    entries: number;
+}
+
+// Counters of the native probe filter (getProbeFilterStats)
+export interface ProbeFilterStats {
+    /** Lookups answered with ENOENT without calling getattr */
+    absorbed: number;
+    ruleHits: number;
+    learnedHits: number;
+    /** Paths learned right now */
+    learnedNames: number;
+}
+
+// Requests failed without their handler (getDeadlineStats)
+export interface DeadlineStats {
+    /** Past op_timeout */
+    timeouts: number;
+    /** Interrupted by the kernel */
+    interrupts: number;
+}
+
+// Progress of the pre-warm walk (getPrewarmStats, 'prewarm' event)
+export interface PrewarmStats {
+    /** Directories listed */
+    directories: number;
+    /** Names taken from listings */
+    entries: number;
+    /** getattr calls answered */
+    stats: number;
+    errors: number;
+    /** Calls queued or running */
+    pending: number;
+    /** Deepest level listed */
+    depth: number;
+    /** Seconds since the walk started */
+    elapsed: number;
+    done: boolean;
+}
+
+// Request slots (getRequestSlotStats)
+export interface RequestSlotStats {
+    size: number;
+    inUse: number;
+    maxInUse: number;
+    acquired: number;
+    /** Requests that found every slot taken */
+    exhausted: number;
+    /** Replies with an id that was answered or cancelled already */
+    stale: number;
+}
+
+// State of the flight recorder (getFlightRecorderStats)
+export interface FlightRecorderStats {
+    /** Requests recorded since the mount, including those overwritten since */
+    recorded: number;
+    /** Rings: the most threads that recorded requests at once */
+    threads: number;
+    /** Traces written on a trigger */
+    dumps: number;
+    /** File of the last of them */
+    lastDump: string | null;
+}
+
+// Kernel cache notifications (getNotifyStats)
+export interface NotifyStats {
+    /** notifyChange/notifyEntry/notifyDelete paths */
+    queued: number;
+    /** Queued for a path that was still waiting */
+    merged: number;
+    sent: number;
+    /** The kernel had nothing cached for the path */
+    uncached: number;
+    failed: number;
+    /** Wakeups of the sending thread */
+    batches: number;
+    pending: number;
+}
+
+// Counters of the native dispatch queue (getDispatchStats)
+export interface DispatchStats {
+    /** Drains run on the JS thread */
+    wakeups: number;
+    /** Requests handed to JS */
+    requests: number;
+    /** Calls of the batch handler */
+    batchCalls: number;
+    /** Most requests run by one drain */
+    maxBatch: number;
+    /** Requests waiting for the JS thread right now */
+    depth: number;
+    maxDepth: number;
+    /** Per lane: metadata requests, data requests, background work */
+    lanes: Record<DispatchLane, LaneStats>;
+}
+
+export type DispatchLane = 'metadata' | 'data' | 'background';
+
+// One lane of a dispatch queue
+export interface LaneStats {
+    /** Items drained */
+    run: number;
+    /** Items waiting right now */
+    depth: number;
+    maxDepth: number;
+    /** Items drained and not answered by JS yet */
+    inFlight: number;
+    maxInFlight: number;
+    /** Time from queueing to the drain */
+    meanWaitMs: number;
+    maxWaitMs: number;
+}
+
+// Latencies of one phase of an operation, in microseconds
+export interface PhaseStats {
+    count: number;
+    mean: number;
+    p50: number;
+    p90: number;
+    p99: number;
+    p999: number;
+    max: number;
+}
+
+export interface OperationStats {
+    /** From the request reaching the addon until the handler starts */
+    queue: PhaseStats;
+    /** From the handler starting until it calls back */
+    js: PhaseStats;
+    /** Until the reply, including requests answered without JS */
+    total: PhaseStats;
+    /** Payload bytes (read and write) */
+    bytes: number;
+    /** Failed requests by errno, e.g. { "2": 17 } for ENOENT */
+    errors: Record<string, number>;
+}
+
+// Result of getStats(); only operations seen since the last reset are listed
+export interface FuseStats {
+    /** When the counters were last reset, ms since the epoch */
+    since: number;
+    ops: Record<string, OperationStats>;
 }
 
 // FUSE error interface
@@ -36,12 +469,16 @@ export interface FuseOperations {
     error?: (err: Error) => void;
     access?: (path: string, mode: number, cb: (err: number) => void) => void;
     statfs?: (path: string, cb: (err: number, stat?: any) => void) => void;
-    getattr?: (path: string, cb: (err: number, stat?: Stats) => void) => void;
+    getattr?: (path: string, cb: (err: number, stat?: Stats | Float64Array) => void) => void;
     fgetattr?: (path: string, fd: number, cb: (err: number, stat?: Stats) => void) => void;
     flush?: (path: string, fd: number, cb: (err: number) => void) => void;
     fsync?: (path: string, datasync: boolean, fd: number, cb: (err: number) => void) => void;
     fsyncdir?: (path: string, datasync: boolean, fd: number, cb: (err: number) => void) => void;
-    readdir?: (path: string, cb: (err: number, files?: string[], stats?: Stats[]) => void) => void;
+    /** files may also be one string of NUL-separated names, stats a Float64Array (see packStats) */
+    readdir?: (
+        path: string,
+        cb: (err: number, files?: string[] | string, stats?: Array<Stats | undefined> | Float64Array) => void
+    ) => void;
     truncate?: (path: string, size: number, cb: (err: number) => void) => void;
     ftruncate?: (path: string, fd: number, size: number, cb: (err: number) => void) => void;
     readlink?: (path: string, cb: (err: number, linkString?: string) => void) => void;
@@ -52,7 +489,8 @@ export interface FuseOperations {
     getxattr?: (path: string, name: string, cb: (err: number, value?: Buffer) => void) => void;
     listxattr?: (path: string, cb: (err: number, list?: string[]) => void) => void;
     removexattr?: (path: string, name: string, cb: (err: number) => void) => void;
-    open?: (path: string, flags: number, cb: (err: number, fd?: number) => void) => void;
+    /** A string third argument is taken as contentHash */
+    open?: (path: string, flags: number, cb: (err: number, fd?: number, reply?: string | OpenReply) => void) => void;
     opendir?: (path: string, flags: number, cb: (err: number, fd?: number) => void) => void;
     read?: (path: string, fd: number, buffer: Buffer, length: number, position: number, cb: (err: number, bytesRead?: number) => void) => void;
     write?: (path: string, fd: number, buffer: Buffer, length: number, position: number, cb: (err: number, bytesWritten?: number) => void) => void;
@@ -66,6 +504,17 @@ export interface FuseOperations {
     symlink?: (src: string, dest: string, cb: (err: number) => void) => void;
     mkdir?: (path: string, mode: number, cb: (err: number) => void) => void;
     rmdir?: (path: string, cb: (err: number) => void) => void;
+    /**
+     * Receives all handler calls of one drain instead of the handlers. It must
+     * make every call (ops[call.op](...call.args)); a throw fails all of them.
+     */
+    batch?: (calls: BatchedCall[]) => void;
+    /**
+     * A request failed without its handler (op_timeout or interrupts). callback
+     * is the one the handler got, or its id with request_slots; what it reports
+     * from now on is dropped.
+     */
+    cancel?: (callback: Function | number, reason: 'timeout' | 'interrupt') => void;
 }
 
 // Type for all operations (required version)
@@ -40,6 +40,8 @@ export class WindowsFuse extends EventEmitter {
     static EROFS = 30;
     static EBUSY = 16;
     static ENOTEMPTY = 39;
+    static EINTR = 4;
+    static ETIMEDOUT = 110;
 
     constructor(_mountPath: string, operations: FuseOperations, options: any = {}) {
         super();
@@ -0,0 +1,50 @@
+/**
+ * Tests of the native FUSE addon classes that run without a mount.
+ *
+ * The cases live in test/native/*.test.cc and are built with the addon
+ * (`npm run build:tests` in src/fuse/n-api) into the fuse3_native_tests binary.
+ * Every case is run on its own, so mocha reports each one.
+ */
+
+import { describe, it, before } from 'mocha';
+import { expect } from 'chai';
+import * as fs from 'fs';
+import * as path from 'path';
+import { execFileSync, spawnSync } from 'child_process';
+
+const NATIVE_TESTS = path.resolve(__dirname, '../src/fuse/n-api/build/Release/fuse3_native_tests');
+
+function listNativeTests(): string[] {
+    if (process.platform !== 'linux' || !fs.existsSync(NATIVE_TESTS)) {
+        return [];
+    }
+    return execFileSync(NATIVE_TESTS, ['--list'], { encoding: 'utf8' })
+        .split('\n')
+        .filter(name => name.length > 0);
+}
+
+describe('Native FUSE addon classes', function() {
+    this.timeout(30000);
+
+    const names = listNativeTests();
+
+    before(function() {
+        if (names.length === 0) {
+            console.log('Skipping native tests - fuse3_native_tests is not built');
+            (this as any).skip();
+        }
+    });
+
+    for (const name of names) {
+        it(name, function() {
+            const result = spawnSync(NATIVE_TESTS, [name], { encoding: 'utf8' });
+            expect(result.status, result.stdout + result.stderr).to.equal(0);
+        });
+    }
+
+    if (names.length === 0) {
+        it('runs the native test binary', function() {
+            // Skipped in before()
+        });
+    }
+});
@@ -0,0 +1,164 @@
+/**
+ * Requests on open handles with several worker_threads serving a mount.
+ *
+ * Every worker counts its file descriptors from 10, like
+ * FuseApiToIFileSystemAdapter, so two workers hand out the same numbers.
+ * Reads through a handle must still reach the worker that opened it, with
+ * that worker's fd, also after a rename moved the path to another worker.
+ *
+ * Needs the built addon (src/fuse/n-api) and /dev/fuse; skipped otherwise.
+ */
+
+import { describe, it, before, after } from 'mocha';
+import { expect } from 'chai';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import { execFileSync } from 'child_process';
+import { Worker } from 'worker_threads';
+
+const ADDON = path.resolve(__dirname, '../src/fuse/n-api/build/Release/fuse3_napi.node');
+const FILE_COUNT = 16;
+const FILE_SIZE = 64;
+
+// The content of a file, derived from the path it was opened by
+function contentOf(filePath: string): string {
+    return filePath.padEnd(FILE_SIZE, '.');
+}
+
+// Runs in each worker: serves the files /f<n> and /r<n> and answers reads
+// only for fds it opened itself
+const WORKER_SOURCE = `
+const { parentPort, workerData } = require('worker_threads');
+const addon = require(workerData.addon);
+const FILE_SIZE = ${FILE_SIZE};
+const contentOf = p => p.padEnd(FILE_SIZE, '.');
+const isFile = p => /^\\/[fr]\\d+$/.test(p);
+const opened = new Map();
+let nextFd = 10;
+const now = new Date();
+const stat = (mode, size) => ({ mode, size, uid: 0, gid: 0, nlink: 1, atime: now, mtime: now, ctime: now });
+
+const registration = addon.registerWorker(workerData.mount, {
+    getattr(p, cb) {
+        if (p === '/') return cb(0, stat(0o40755, 0));
+        if (isFile(p)) return cb(0, stat(0o100644, FILE_SIZE));
+        cb(-2);
+    },
+    readdir(p, cb) { cb(0, []); },
+    open(p, flags, cb) {
+        const fd = nextFd++;
+        opened.set(fd, p);
+        cb(0, fd);
+    },
+    read(p, fd, buffer, size, offset, cb) {
+        const openedPath = opened.get(fd);
+        if (openedPath === undefined) return cb(-9);
+        const data = Buffer.from(contentOf(openedPath)).subarray(offset, offset + size);
+        data.copy(buffer);
+        cb(0, data.length);
+    },
+    rename(from, to, cb) { cb(0); },
+    release(p, fd, cb) {
+        cb(opened.delete(fd) ? 0 : -9);
+    },
+    flush(p, fd, cb) { cb(opened.has(fd) ? 0 : -9); }
+});
+parentPort.postMessage({ id: registration.id });
+parentPort.on('message', () => {
+    registration.unregister();
+    parentPort.postMessage('done');
+});
+`;
+
+describe('FUSE worker threads and open handles', function() {
+    this.timeout(30000);
+
+    const mount = path.join(os.tmpdir(), `fuse-workers-test-${process.pid}`);
+    let fuse: any = null;
+    const workers: Worker[] = [];
+
+    before(async function() {
+        if (process.platform !== 'linux' || !fs.existsSync(ADDON) || !fs.existsSync('/dev/fuse')) {
+            console.log('Skipping worker tests - needs the built addon and /dev/fuse');
+            (this as any).skip();
+        }
+
+        const addon = require(ADDON);
+        fs.mkdirSync(mount, { recursive: true });
+        // Only serves what arrives before the workers registered
+        fuse = new addon.Fuse3(mount, {
+            getattr: (p: string, cb: (err: number, st?: object) => void) => cb(-2),
+            readdir: (p: string, cb: (err: number, names?: string[]) => void) => cb(0, [])
+        }, {});
+        await new Promise<void>((resolve, reject) => {
+            fuse.mount((err: unknown) => (err ? reject(new Error(String(err))) : resolve()));
+        });
+
+        for (let i = 0; i < 2; i++) {
+            const worker = new Worker(WORKER_SOURCE, { eval: true, workerData: { addon: ADDON, mount } });
+            await new Promise((resolve, reject) => {
+                worker.once('message', resolve);
+                worker.once('error', reject);
+            });
+            workers.push(worker);
+        }
+    });
+
+    after(async function() {
+        for (const worker of workers) {
+            await new Promise(resolve => {
+                worker.once('message', resolve);
+                worker.postMessage('unregister');
+            });
+            await worker.terminate();
+        }
+        if (fuse) {
+            for (const tool of ['fusermount3', 'fusermount']) {
+                try {
+                    execFileSync(tool, ['-u', mount], { stdio: 'ignore' });
+                    break;
+                } catch {
+                    // try the next one
+                }
+            }
+            try {
+                fuse.unmount();
+            } catch {
+                // the loop already returned after fusermount
+            }
+            fs.rmdirSync(mount);
+        }
+    });
+
+    it('spreads the opens over both workers', async function() {
+        const handles = await Promise.all(
+            Array.from({ length: FILE_COUNT }, (_, i) => fs.promises.open(path.join(mount, `f${i}`), 'r')));
+        await Promise.all(handles.map(handle => handle.close()));
+
+        const stats = fuse.getWorkerStats().filter((worker: { id: number }) => worker.id !== 0);
+        expect(stats).to.have.length(2);
+        for (const worker of stats) {
+            expect(worker.routed, `requests routed to worker ${worker.id}`).to.be.greaterThan(0);
+        }
+    });
+
+    it('reads every file through the worker that opened it', async function() {
+        const handles = await Promise.all(
+            Array.from({ length: FILE_COUNT }, (_, i) => fs.promises.open(path.join(mount, `f${i}`), 'r')));
+        try {
+            // Renamed paths hash to other workers than the ones holding the fds
+            for (let i = 0; i < FILE_COUNT; i++) {
+                await fs.promises.rename(path.join(mount, `f${i}`), path.join(mount, `r${i}`));
+            }
+            const contents = await Promise.all(handles.map(async handle => {
+                const buffer = Buffer.alloc(FILE_SIZE);
+                const { bytesRead } = await handle.read(buffer, 0, FILE_SIZE, 0);
+                return buffer.subarray(0, bytesRead).toString();
+            }));
+            contents.forEach((content, i) => expect(content).to.equal(contentOf(`/f${i}`)));
+        } finally {
+            await Promise.all(handles.map(handle => handle.close()));
+        }
+    });
+});
@@ -0,0 +1,146 @@
+#include "native_test.h"
+#include "fuse3_attr_cache.h"
+#include <errno.h>
+#include <sys/stat.h>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+struct stat StatOfSize(off_t size) {
+    struct stat st = {};
+    st.st_mode = S_IFREG | 0644;
+    st.st_size = size;
+    return st;
+}
+
+// The clock of the caches made by Ttls; tests move it on
+int64_t fakeNow = 0;
+
+int64_t FakeNow() {
+    return fakeNow;
+}
+
+void Advance(double seconds) {
+    fakeNow += static_cast<int64_t>(seconds * 1e9);
+}
+
+AttrCache::Options Ttls(double ttl, double negativeTtl) {
+    AttrCache::Options options;
+    options.ttl = ttl;
+    options.negativeTtl = negativeTtl;
+    options.now = FakeNow;
+    return options;
+}
+
+}  // namespace
+
+NATIVE_TEST(AttrCache, EntriesExpireAfterTheirTtl) {
+    AttrCache cache(Ttls(0.05, 0));
+    cache.Insert("/a", StatOfSize(42));
+
+    struct stat st = {};
+    int err = 1;
+    EXPECT(cache.Lookup("/a", &st, &err));
+    EXPECT_EQ(err, 0);
+    EXPECT_EQ(st.st_size, 42);
+
+    Advance(0.049);
+    EXPECT(cache.Lookup("/a", &st, &err));
+    Advance(0.001);
+    EXPECT(!cache.Lookup("/a", &st, &err));
+}
+
+NATIVE_TEST(AttrCache, InsertTakesItsOwnTtl) {
+    AttrCache cache(Ttls(0.05, 0));
+    cache.Insert("/a", StatOfSize(1), 60);
+
+    Advance(59);
+    struct stat st = {};
+    int err = 0;
+    EXPECT(cache.Lookup("/a", &st, &err));
+    Advance(1);
+    EXPECT(!cache.Lookup("/a", &st, &err));
+}
+
+NATIVE_TEST(AttrCache, TtlsOutOfRangeAreClampedOrIgnored) {
+    AttrCache cache(Ttls(0.05, 0));
+    cache.Insert("/forever", StatOfSize(1), std::numeric_limits<double>::infinity());
+    Advance(10 * 365 * 86400.0);
+    cache.Insert("/huge", StatOfSize(1), 1e300);
+    cache.Insert("/nan", StatOfSize(1), std::numeric_limits<double>::quiet_NaN());
+    cache.Insert("/negative", StatOfSize(1), -1);
+
+    struct stat st = {};
+    int err = 0;
+    EXPECT(cache.Lookup("/forever", &st, &err));
+    EXPECT(cache.Lookup("/huge", &st, &err));
+    EXPECT(!cache.Lookup("/nan", &st, &err));
+    EXPECT(!cache.Lookup("/negative", &st, &err));
+}
+
+NATIVE_TEST(AttrCache, NegativeEntriesRememberTheError) {
+    AttrCache cache(Ttls(1, 0.05));
+    cache.InsertNegative("/missing", -ENOENT);
+
+    struct stat st = StatOfSize(7);
+    int err = 0;
+    EXPECT(cache.Lookup("/missing", &st, &err));
+    EXPECT_EQ(err, -ENOENT);
+    // st is left alone
+    EXPECT_EQ(st.st_size, 7);
+
+    Advance(0.05);
+    EXPECT(!cache.Lookup("/missing", &st, &err));
+
+    AttrCache::Counters counters = cache.GetCounters();
+    EXPECT_EQ(counters.negativeHits, 1u);
+}
+
+NATIVE_TEST(AttrCache, NegativeCachingIsOffByDefault) {
+    AttrCache cache(AttrCache::Options{});
+    cache.InsertNegative("/missing", -ENOENT);
+
+    struct stat st = {};
+    int err = 0;
+    EXPECT(!cache.Lookup("/missing", &st, &err));
+}
+
+NATIVE_TEST(AttrCache, InvalidatePrefixDropsTheSubtree) {
+    AttrCache cache(Ttls(60, 60));
+    cache.Insert("/dir", StatOfSize(0));
+    cache.Insert("/dir/a", StatOfSize(1));
+    cache.Insert("/dir/sub/b", StatOfSize(2));
+    cache.InsertNegative("/dir/gone", -ENOENT);
+    cache.Insert("/dirty", StatOfSize(3));
+    cache.Insert("/other", StatOfSize(4));
+
+    cache.InvalidatePrefix("/dir/");
+
+    struct stat st = {};
+    int err = 0;
+    EXPECT(!cache.Lookup("/dir", &st, &err));
+    EXPECT(!cache.Lookup("/dir/a", &st, &err));
+    EXPECT(!cache.Lookup("/dir/sub/b", &st, &err));
+    EXPECT(!cache.Lookup("/dir/gone", &st, &err));
+    // Siblings sharing the name prefix stay
+    EXPECT(cache.Lookup("/dirty", &st, &err));
+    EXPECT(cache.Lookup("/other", &st, &err));
+
+    cache.InvalidatePrefix("/");
+    EXPECT(!cache.Lookup("/dirty", &st, &err));
+    EXPECT(!cache.Lookup("/other", &st, &err));
+}
+
+NATIVE_TEST(AttrCache, InvalidateDropsOnlyThePath) {
+    AttrCache cache(Ttls(60, 0));
+    cache.Insert("/dir", StatOfSize(0));
+    cache.Insert("/dir/a", StatOfSize(1));
+
+    cache.Invalidate("/dir");
+
+    struct stat st = {};
+    int err = 0;
+    EXPECT(!cache.Lookup("/dir", &st, &err));
+    EXPECT(cache.Lookup("/dir/a", &st, &err));
+}
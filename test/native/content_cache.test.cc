@@ -0,0 +1,72 @@
+#include "native_test.h"
+#include "fuse3_content_cache.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* kHash = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+std::string Content(size_t size) {
+    std::string content(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        content[i] = static_cast<char>(i % 251);
+    }
+    return content;
+}
+
+}  // namespace
+
+NATIVE_TEST(ContentCache, ShortFinalChunkEndsTheContent) {
+    const size_t size = ContentCache::kChunkSize + 1000;
+    std::string content = Content(size);
+    ContentCache cache(ContentCache::Options{});
+    cache.Insert(kHash, 0, content.data(), content.size(), true);
+
+    // A read across the end comes back short
+    std::vector<ContentCache::Slice> slices;
+    EXPECT(cache.Lookup(kHash, ContentCache::kChunkSize, 4096, &slices));
+    std::vector<char> out(4096);
+    EXPECT_EQ(ContentCache::CopySlices(slices, out.data()), 1000u);
+    EXPECT(std::string(out.data(), 1000) == content.substr(ContentCache::kChunkSize));
+
+    // A read past the end is a hit with nothing in it
+    EXPECT(cache.Lookup(kHash, size + 10, 4096, &slices));
+    EXPECT_EQ(ContentCache::CopySlices(slices, out.data()), 0u);
+}
+
+NATIVE_TEST(ContentCache, PartialChunkWithoutEofIsNotStored) {
+    const size_t size = ContentCache::kChunkSize + 1000;
+    std::string content = Content(size);
+    ContentCache cache(ContentCache::Options{});
+    cache.Insert(kHash, 0, content.data(), content.size(), false);
+
+    std::vector<ContentCache::Slice> slices;
+    EXPECT(cache.Lookup(kHash, 0, 4096, &slices));
+    // The tail may be longer than what was read, so it is a miss
+    EXPECT(!cache.Lookup(kHash, ContentCache::kChunkSize, 4096, &slices));
+}
+
+NATIVE_TEST(ContentCache, ReadsSpanChunks) {
+    const size_t size = 3 * ContentCache::kChunkSize;
+    std::string content = Content(size);
+    ContentCache cache(ContentCache::Options{});
+    cache.Insert(kHash, 0, content.data(), content.size(), false);
+
+    std::vector<ContentCache::Slice> slices;
+    const size_t offset = ContentCache::kChunkSize - 100;
+    EXPECT(cache.Lookup(kHash, offset, 4096, &slices));
+    EXPECT_EQ(slices.size(), 2u);
+    std::vector<char> out(4096);
+    EXPECT_EQ(ContentCache::CopySlices(slices, out.data()), 4096u);
+    EXPECT(std::string(out.data(), 4096) == content.substr(offset, 4096));
+}
+
+NATIVE_TEST(ContentCache, UnalignedInsertIsIgnored) {
+    std::string content = Content(4096);
+    ContentCache cache(ContentCache::Options{});
+    cache.Insert(kHash, 100, content.data(), content.size(), true);
+
+    std::vector<ContentCache::Slice> slices;
+    EXPECT(!cache.Lookup(kHash, 100, 10, &slices));
+}
@@ -0,0 +1,63 @@
+#include "native_test.h"
+#include "fuse3_flight_recorder.h"
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+FlightRecorder::Options SmallRings() {
+    FlightRecorder::Options options;
+    options.entries = 16;
+    return options;
+}
+
+void RecordOne(FlightRecorder& recorder, const char* path) {
+    OpTimer timer;
+    timer.Begin(nullptr, StatOp::Getattr, &recorder);
+    timer.note.SetPath(path);
+    recorder.Record(timer, OpStats::Now());
+}
+
+}  // namespace
+
+NATIVE_TEST(FlightRecorder, ExitedThreadsHandTheirRingOn) {
+    FlightRecorder recorder(SmallRings(), "test");
+    for (int i = 0; i < 5; i++) {
+        std::string path = "/thread" + std::to_string(i);
+        std::thread([&recorder, path] { RecordOne(recorder, path.c_str()); }).join();
+    }
+
+    FlightRecorder::Counters counters = recorder.GetCounters();
+    EXPECT_EQ(counters.recorded, 5u);
+    EXPECT_EQ(counters.threads, 1u);
+    // The records of the threads that exited are kept
+    std::string trace = recorder.Dump();
+    EXPECT(trace.find("/thread0") != std::string::npos);
+    EXPECT(trace.find("/thread4") != std::string::npos);
+}
+
+NATIVE_TEST(FlightRecorder, ThreadsRecordingAtOnceHaveRingsOfTheirOwn) {
+    FlightRecorder recorder(SmallRings(), "test");
+    RecordOne(recorder, "/main");
+    std::thread([&recorder] { RecordOne(recorder, "/other"); }).join();
+    RecordOne(recorder, "/main");
+
+    EXPECT_EQ(recorder.GetCounters().threads, 2u);
+    EXPECT_EQ(recorder.GetCounters().recorded, 3u);
+}
+
+NATIVE_TEST(FlightRecorder, ThreadsMayOutliveTheRecorder) {
+    auto first = std::make_unique<FlightRecorder>(SmallRings(), "first");
+    FlightRecorder second(SmallRings(), "second");
+    std::thread thread([&first, &second] {
+        RecordOne(*first, "/a");
+        first.reset();
+        RecordOne(second, "/b");
+    });
+    thread.join();
+
+    RecordOne(second, "/c");
+    EXPECT_EQ(second.GetCounters().threads, 1u);
+    EXPECT_EQ(second.GetCounters().recorded, 2u);
+}
@@ -0,0 +1,153 @@
+#include "native_test.h"
+#include "fuse3_inode_table.h"
+#include <string>
+
+NATIVE_TEST(InodeTable, TheRootIsPermanent) {
+    InodeTable inodes;
+    std::string path;
+    EXPECT(inodes.GetPath(InodeTable::kRootIno, &path));
+    EXPECT_EQ(path, "/");
+    EXPECT_EQ(inodes.Find("/"), InodeTable::kRootIno);
+
+    inodes.Forget(InodeTable::kRootIno, 100);
+    EXPECT(inodes.GetPath(InodeTable::kRootIno, &path));
+    EXPECT_EQ(inodes.Size(), 1u);
+}
+
+NATIVE_TEST(InodeTable, ANodeLivesUntilEveryLookupIsForgotten) {
+    InodeTable inodes;
+    uint64_t ino = inodes.Ref("/a");
+    EXPECT_EQ(inodes.Ref("/a"), ino);
+    EXPECT_EQ(inodes.Ref("/a"), ino);
+
+    inodes.Forget(ino, 2);
+    std::string path;
+    EXPECT(inodes.GetPath(ino, &path));
+    EXPECT_EQ(path, "/a");
+    EXPECT_EQ(inodes.Find("/a"), ino);
+
+    inodes.Forget(ino, 1);
+    EXPECT(!inodes.GetPath(ino, &path));
+    EXPECT_EQ(inodes.Find("/a"), 0u);
+    EXPECT_EQ(inodes.Size(), 1u);
+}
+
+NATIVE_TEST(InodeTable, ForgettingTooMuchOrUnknownNodesIsHarmless) {
+    InodeTable inodes;
+    uint64_t ino = inodes.Ref("/a");
+    inodes.Forget(ino, 5);
+    inodes.Forget(ino, 1);
+    inodes.Forget(12345, 1);
+    EXPECT_EQ(inodes.Size(), 1u);
+}
+
+NATIVE_TEST(InodeTable, FindDoesNotCountALookup) {
+    InodeTable inodes;
+    EXPECT_EQ(inodes.Find("/a"), 0u);
+    uint64_t ino = inodes.Ref("/a");
+    EXPECT_EQ(inodes.Find("/a"), ino);
+    inodes.Forget(ino, 1);
+    EXPECT_EQ(inodes.Find("/a"), 0u);
+}
+
+// The kernel may still hold a forgotten number in its caches, so it is
+// never handed out again, not even for the same path
+NATIVE_TEST(InodeTable, NumbersAreNotReused) {
+    InodeTable inodes;
+    uint64_t first = inodes.Ref("/a");
+    inodes.Forget(first, 1);
+    uint64_t second = inodes.Ref("/a");
+    EXPECT(second != first);
+    uint64_t other = inodes.Ref("/b");
+    EXPECT(other != first);
+    EXPECT(other != second);
+}
+
+NATIVE_TEST(InodeTable, UnlinkKeepsTheNodeForOpenHandles) {
+    InodeTable inodes;
+    uint64_t ino = inodes.Ref("/a");
+    inodes.Unlink("/a");
+
+    std::string path;
+    EXPECT(inodes.GetPath(ino, &path));
+    EXPECT_EQ(inodes.Find("/a"), 0u);
+    uint64_t next = inodes.Ref("/a");
+    EXPECT(next != ino);
+
+    // The unlinked node goes without taking the new one's path along
+    inodes.Forget(ino, 1);
+    EXPECT(!inodes.GetPath(ino, &path));
+    EXPECT_EQ(inodes.Find("/a"), next);
+}
+
+NATIVE_TEST(InodeTable, RenameMovesTheSubtreeOnly) {
+    InodeTable inodes;
+    uint64_t dir = inodes.Ref("/d");
+    uint64_t child = inodes.Ref("/d/x");
+    uint64_t sibling = inodes.Ref("/dx");
+    uint64_t target = inodes.Ref("/e");
+
+    inodes.Rename("/d", "/e");
+    std::string path;
+    EXPECT(inodes.GetPath(dir, &path));
+    EXPECT_EQ(path, "/e");
+    EXPECT(inodes.GetPath(child, &path));
+    EXPECT_EQ(path, "/e/x");
+    EXPECT(inodes.GetPath(sibling, &path));
+    EXPECT_EQ(path, "/dx");
+    EXPECT_EQ(inodes.Find("/e"), dir);
+    EXPECT_EQ(inodes.Find("/d"), 0u);
+
+    // The replaced target only lives on for open handles
+    EXPECT(inodes.GetPath(target, &path));
+    inodes.Forget(target, 1);
+    EXPECT_EQ(inodes.Find("/e"), dir);
+}
+
+NATIVE_TEST(InodeRefs, LookupsOfAReplyThatFailedAreForgotten) {
+    InodeTable inodes;
+    uint64_t known = inodes.Ref("/d/known");
+    {
+        InodeRefs refs(inodes);
+        EXPECT_EQ(refs.Ref("/d/known"), known);
+        refs.Ref("/d/new");
+        // Not sent
+    }
+    EXPECT_EQ(inodes.Find("/d/new"), 0u);
+    EXPECT_EQ(inodes.Find("/d/known"), known);
+    inodes.Forget(known, 1);
+    EXPECT_EQ(inodes.Find("/d/known"), 0u);
+}
+
+NATIVE_TEST(InodeRefs, LookupsOfASentReplyAreKept) {
+    InodeTable inodes;
+    uint64_t ino;
+    {
+        InodeRefs refs(inodes);
+        ino = refs.Ref("/d/a");
+        refs.Keep();
+    }
+    EXPECT_EQ(inodes.Find("/d/a"), ino);
+    inodes.Forget(ino, 1);
+    EXPECT_EQ(inodes.Find("/d/a"), 0u);
+}
+
+NATIVE_TEST(InodeRefs, UnrefTakesBackAnEntryThatDidNotFit) {
+    InodeTable inodes;
+    {
+        InodeRefs refs(inodes);
+        refs.Ref("/d/a");
+        refs.Ref("/d/b");
+        refs.Unref();
+        EXPECT_EQ(inodes.Find("/d/b"), 0u);
+        refs.Keep();
+    }
+    EXPECT(inodes.Find("/d/a") != 0u);
+    EXPECT_EQ(inodes.Size(), 2u);
+}
+
+NATIVE_TEST(InodeTable, JoinPath) {
+    EXPECT_EQ(JoinPath("/", "a"), "/a");
+    EXPECT_EQ(JoinPath("/d", "a"), "/d/a");
+    EXPECT_EQ(JoinPath("", "a"), "/a");
+}
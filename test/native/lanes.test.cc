@@ -0,0 +1,174 @@
+#include "native_test.h"
+#include "fuse3_lanes.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+using Queues = LaneQueues<int>;
+
+constexpr DispatchLane M = DispatchLane::Metadata;
+constexpr DispatchLane D = DispatchLane::Data;
+constexpr DispatchLane B = DispatchLane::Background;
+
+struct Lanes {
+    LaneOptions options[kDispatchLanes] = {{8, 0}, {4, 0}, {1, 0}};
+
+    Lanes& Weights(unsigned int metadata, unsigned int data, unsigned int background) {
+        options[0].weight = metadata;
+        options[1].weight = data;
+        options[2].weight = background;
+        return *this;
+    }
+    Lanes& InFlight(DispatchLane lane, unsigned int limit) {
+        options[static_cast<size_t>(lane)].inFlight = limit;
+        return *this;
+    }
+};
+
+// Queues count items of lane, numbered from first
+void PushMany(Queues& queues, DispatchLane lane, int first, int count) {
+    for (int i = 0; i < count; i++) {
+        queues.Push(first + i, lane, 0);
+    }
+}
+
+// The lanes of what Pick took, as a string like "MMD"
+std::string PickLanes(Queues& queues, size_t max = 64) {
+    std::vector<Queues::Picked> picked;
+    queues.Pick(max, 0, picked);
+    std::string lanes;
+    for (const Queues::Picked& item : picked) {
+        lanes += item.lane == M ? 'M' : item.lane == D ? 'D' : 'B';
+    }
+    return lanes;
+}
+
+}  // namespace
+
+NATIVE_TEST(Lanes, RoundsFollowTheWeights) {
+    Queues queues(Lanes().Weights(2, 1, 1).options);
+    PushMany(queues, M, 0, 4);
+    PushMany(queues, D, 10, 4);
+    EXPECT_EQ(PickLanes(queues), std::string("MMDMMDDD"));
+}
+
+NATIVE_TEST(Lanes, ItemsOfALaneKeepTheirOrder) {
+    Queues queues(Lanes().options);
+    PushMany(queues, D, 0, 5);
+    std::vector<Queues::Picked> picked;
+    queues.Pick(64, 0, picked);
+    EXPECT_EQ(picked.size(), 5u);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(picked[i].work, i);
+    }
+}
+
+NATIVE_TEST(Lanes, PickStopsAtMax) {
+    Queues queues(Lanes().options);
+    PushMany(queues, M, 0, 10);
+    EXPECT_EQ(PickLanes(queues, 3), std::string("MMM"));
+    EXPECT_EQ(queues.Depth(), 7u);
+}
+
+NATIVE_TEST(Lanes, DataIsNotStarvedByMetadata) {
+    Queues queues(Lanes().options);
+    PushMany(queues, M, 0, 100);
+    queues.Push(1000, D, 0);
+    EXPECT_EQ(PickLanes(queues, 10), std::string("MMMMMMMMDM"));
+}
+
+NATIVE_TEST(Lanes, InFlightLimitHoldsALaneUntilLand) {
+    Queues queues(Lanes().InFlight(D, 2).options);
+    EXPECT(queues.Push(0, D, 0));
+    EXPECT(queues.Push(1, D, 0));
+    EXPECT_EQ(PickLanes(queues), std::string("DD"));
+
+    // At its limit: the item waits, and Pick passes the lane by
+    EXPECT(!queues.Push(2, D, 0));
+    EXPECT(!queues.AnyCanRun());
+    EXPECT_EQ(PickLanes(queues), std::string(""));
+
+    // An answer frees a place
+    EXPECT(queues.Land(D));
+    EXPECT_EQ(PickLanes(queues), std::string("D"));
+    EXPECT(!queues.Land(D));
+}
+
+NATIVE_TEST(Lanes, LimitsOfOneLaneDoNotHoldOthers) {
+    Queues queues(Lanes().InFlight(D, 1).options);
+    PushMany(queues, D, 0, 3);
+    PushMany(queues, M, 10, 2);
+    EXPECT_EQ(PickLanes(queues), std::string("MMD"));
+}
+
+NATIVE_TEST(Lanes, BackgroundWaitsWhileOtherLanesCanRun) {
+    Queues queues(Lanes().options);
+    queues.Push(0, B, 0);
+    PushMany(queues, M, 10, 20);
+    PushMany(queues, D, 100, 6);
+    std::string lanes = PickLanes(queues);
+    EXPECT_EQ(lanes.size(), 27u);
+    EXPECT_EQ(lanes.back(), 'B');
+    EXPECT_EQ(lanes.find('B'), lanes.size() - 1);
+}
+
+NATIVE_TEST(Lanes, BackgroundRunsWhenOtherLanesAreAtTheirLimit) {
+    Queues queues(Lanes().InFlight(D, 1).options);
+    PushMany(queues, D, 0, 2);
+    queues.Push(10, B, 0);
+    EXPECT_EQ(PickLanes(queues), std::string("DB"));
+}
+
+NATIVE_TEST(Lanes, BackgroundTakesItsWeightPerRound) {
+    Queues queues(Lanes().Weights(1, 1, 2).options);
+    PushMany(queues, B, 0, 5);
+    EXPECT_EQ(PickLanes(queues, 3), std::string("BBB"));
+    EXPECT_EQ(queues.Depth(), 2u);
+}
+
+NATIVE_TEST(Lanes, UnpushTakesBackTheLastItem) {
+    Queues queues(Lanes().options);
+    queues.Push(1, D, 0);
+    queues.Push(2, D, 0);
+    int work = 0;
+    queues.Unpush(D, &work);
+    EXPECT_EQ(work, 2);
+    EXPECT_EQ(queues.Depth(), 1u);
+}
+
+NATIVE_TEST(Lanes, TakeAllReturnsWhatNeverRan) {
+    Queues queues(Lanes().options);
+    queues.Push(1, B, 0);
+    queues.Push(2, M, 0);
+    queues.Push(3, D, 0);
+    auto left = queues.TakeAll();
+    EXPECT_EQ(left.size(), 3u);
+    EXPECT_EQ(left[0].first, 2);
+    EXPECT_EQ(left[1].first, 3);
+    EXPECT_EQ(left[2].first, 1);
+    EXPECT_EQ(queues.Depth(), 0u);
+}
+
+NATIVE_TEST(Lanes, CountersTrackWaitsAndFlights) {
+    Queues queues(Lanes().options);
+    queues.Push(1, D, 100);
+    queues.Push(2, D, 300);
+    std::vector<Queues::Picked> picked;
+    queues.Pick(64, 1000, picked);
+
+    LaneCounters counters[kDispatchLanes];
+    queues.GetCounters(counters);
+    const LaneCounters& data = counters[static_cast<size_t>(D)];
+    EXPECT_EQ(data.run, 2u);
+    EXPECT_EQ(data.waitNs, 1600u);
+    EXPECT_EQ(data.maxWaitNs, 900u);
+    EXPECT_EQ(data.inFlight, 2u);
+    EXPECT_EQ(data.maxDepth, 2u);
+    EXPECT_EQ(queues.MaxDepth(), 2u);
+
+    queues.Land(D);
+    queues.GetCounters(counters);
+    EXPECT_EQ(counters[static_cast<size_t>(D)].inFlight, 1u);
+    EXPECT_EQ(counters[static_cast<size_t>(D)].maxInFlight, 2u);
+}
@@ -0,0 +1,45 @@
+#include "native_test.h"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+std::vector<NativeTest>& NativeTests() {
+    static std::vector<NativeTest> tests;
+    return tests;
+}
+
+// fuse3_native_tests [--list] [name...]
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--list") == 0) {
+        for (const NativeTest& test : NativeTests()) {
+            printf("%s\n", test.name.c_str());
+        }
+        return 0;
+    }
+
+    int failed = 0;
+    int run = 0;
+    for (const NativeTest& test : NativeTests()) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc && !selected; i++) {
+            selected = test.name == argv[i];
+        }
+        if (!selected) {
+            continue;
+        }
+        run++;
+        try {
+            test.run();
+            printf("ok %s\n", test.name.c_str());
+        } catch (const std::exception& e) {
+            failed++;
+            printf("FAIL %s\n  %s\n", test.name.c_str(), e.what());
+        }
+    }
+    if (run == 0) {
+        fprintf(stderr, "no tests selected\n");
+        return 2;
+    }
+    printf("%d of %d passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Tests of the addon classes that do not need N-API or a mount. Each
+// NATIVE_TEST registers itself; main.cc runs all of them or the ones named
+// on the command line.
+struct NativeTest {
+    std::string name;
+    void (*run)();
+};
+
+std::vector<NativeTest>& NativeTests();
+
+struct NativeTestRegistration {
+    NativeTestRegistration(const char* name, void (*run)()) { NativeTests().push_back({name, run}); }
+};
+
+struct NativeTestFailure : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+#define NATIVE_TEST(suite, name) \
+    static void suite##_##name(); \
+    static NativeTestRegistration suite##_##name##_registration(#suite "." #name, suite##_##name); \
+    static void suite##_##name()
+
+#define EXPECT(condition) \
+    do { \
+        if (!(condition)) { \
+            std::ostringstream message; \
+            message << __FILE__ << ":" << __LINE__ << ": " << #condition; \
+            throw NativeTestFailure(message.str()); \
+        } \
+    } while (0)
+
+#define EXPECT_EQ(actual, expected) \
+    do { \
+        auto actualValue = (actual); \
+        auto expectedValue = (expected); \
+        if (!(actualValue == expectedValue)) { \
+            std::ostringstream message; \
+            message << __FILE__ << ":" << __LINE__ << ": " << #actual << " is " << actualValue \
+                    << ", expected " << expectedValue; \
+            throw NativeTestFailure(message.str()); \
+        } \
+    } while (0)
+
+// Waits for another thread to make condition true. The deadline is generous
+// so a loaded machine does not fail the test; a passing one returns as soon
+// as the condition holds. Checks that something does NOT happen keep a short
+// sleep instead: a slow machine can only make those pass, never fail.
+template <typename Condition>
+bool WaitUntil(Condition condition, std::chrono::milliseconds deadline = std::chrono::seconds(10)) {
+    auto end = std::chrono::steady_clock::now() + deadline;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > end) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
@@ -0,0 +1,168 @@
+#include "native_test.h"
+#include "fuse3_notify.h"
+#include <errno.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Records what the notifier sends. The first send of gatePath blocks until
+// Open, so what is pushed meanwhile queues up behind it.
+class FakeKernel {
+public:
+    explicit FakeKernel(std::string gatePath = "") : gatePath_(std::move(gatePath)) {}
+
+    int Send(KernelNotifier::Kind kind, const std::string& path) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (path == gatePath_ && !gateSeen_) {
+            gateSeen_ = true;
+            changed_.notify_all();
+            changed_.wait(lock, [this] { return open_; });
+        }
+        sent_.push_back(Name(kind) + " " + path);
+        return path == "/uncached" ? -ENOENT : path == "/broken" ? -EIO : 0;
+    }
+
+    void WaitForGate() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this] { return gateSeen_; });
+    }
+    void Open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        changed_.notify_all();
+    }
+    std::vector<std::string> Sent() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sent_;
+    }
+    size_t SentCount() { return Sent().size(); }
+
+    KernelNotifier::SendFn Fn() {
+        return [this](KernelNotifier::Kind kind, const std::string& path) { return Send(kind, path); };
+    }
+
+private:
+    static std::string Name(KernelNotifier::Kind kind) {
+        return kind == KernelNotifier::Change ? "change" : kind == KernelNotifier::Entry ? "entry" : "delete";
+    }
+
+    std::string gatePath_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool gateSeen_ = false;
+    bool open_ = false;
+    std::vector<std::string> sent_;
+};
+
+}  // namespace
+
+NATIVE_TEST(KernelNotifier, PushFailsUnlessStarted) {
+    FakeKernel kernel;
+    KernelNotifier notifier(kernel.Fn(), nullptr);
+    EXPECT(!notifier.Push(KernelNotifier::Change, "/a"));
+    notifier.Start();
+    EXPECT(notifier.Push(KernelNotifier::Change, "/a"));
+    notifier.Stop();
+    EXPECT(!notifier.Push(KernelNotifier::Change, "/a"));
+}
+
+NATIVE_TEST(KernelNotifier, QueuedNotificationsOfAPathAreMerged) {
+    FakeKernel kernel("/gate");
+    KernelNotifier notifier(kernel.Fn(), nullptr);
+    notifier.Start();
+    notifier.Push(KernelNotifier::Change, "/gate");
+    kernel.WaitForGate();
+
+    notifier.Push(KernelNotifier::Change, "/a");
+    notifier.Push(KernelNotifier::Change, "/b");
+    notifier.Push(KernelNotifier::Change, "/a");
+    notifier.Push(KernelNotifier::Entry, "/a");
+    // Nothing may throw while the gate holds the notifier thread
+    uint64_t pending = notifier.GetCounters().pending;
+    kernel.Open();
+    EXPECT_EQ(pending, 2u);
+    EXPECT(WaitUntil([&] { return notifier.GetCounters().sent == 4; }));
+
+    // In the order the paths were first queued, each kind once
+    std::vector<std::string> expected = {"change /gate", "change /a", "entry /a", "change /b"};
+    EXPECT(kernel.Sent() == expected);
+    KernelNotifier::Counters counters = notifier.GetCounters();
+    EXPECT_EQ(counters.queued, 5u);
+    EXPECT_EQ(counters.merged, 2u);
+    EXPECT_EQ(counters.sent, 4u);
+    EXPECT_EQ(counters.pending, 0u);
+    EXPECT_EQ(counters.batches, 2u);
+}
+
+NATIVE_TEST(KernelNotifier, ADeleteCoversTheEntry) {
+    FakeKernel kernel("/gate");
+    KernelNotifier notifier(kernel.Fn(), nullptr);
+    notifier.Start();
+    notifier.Push(KernelNotifier::Change, "/gate");
+    kernel.WaitForGate();
+
+    notifier.Push(KernelNotifier::Entry, "/a");
+    notifier.Push(KernelNotifier::Delete, "/a");
+    notifier.Push(KernelNotifier::Change, "/a");
+    kernel.Open();
+    EXPECT(WaitUntil([&] { return kernel.SentCount() == 3; }));
+
+    std::vector<std::string> expected = {"change /gate", "change /a", "delete /a"};
+    EXPECT(kernel.Sent() == expected);
+}
+
+NATIVE_TEST(KernelNotifier, AfterSendingAPathQueuesAgain) {
+    FakeKernel kernel;
+    KernelNotifier notifier(kernel.Fn(), nullptr);
+    notifier.Start();
+    notifier.Push(KernelNotifier::Change, "/a");
+    EXPECT(WaitUntil([&] { return kernel.SentCount() == 1; }));
+    notifier.Push(KernelNotifier::Change, "/a");
+    EXPECT(WaitUntil([&] { return kernel.SentCount() == 2; }));
+    EXPECT_EQ(notifier.GetCounters().merged, 0u);
+}
+
+NATIVE_TEST(KernelNotifier, ResultsAreCountedAndTimed) {
+    FakeKernel kernel;
+    auto stats = std::make_shared<OpStats>();
+    KernelNotifier notifier(kernel.Fn(), stats);
+    notifier.Start();
+    notifier.Push(KernelNotifier::Change, "/a");
+    notifier.Push(KernelNotifier::Change, "/uncached");
+    notifier.Push(KernelNotifier::Change, "/broken");
+    EXPECT(WaitUntil([&] {
+        KernelNotifier::Counters counters = notifier.GetCounters();
+        return counters.sent + counters.uncached + counters.failed == 3;
+    }));
+
+    KernelNotifier::Counters counters = notifier.GetCounters();
+    EXPECT_EQ(counters.sent, 1u);
+    EXPECT_EQ(counters.uncached, 1u);
+    EXPECT_EQ(counters.failed, 1u);
+    std::vector<OpStats::OpSummary> snapshot = stats->Snapshot();
+    EXPECT_EQ(snapshot.size(), 1u);
+    EXPECT(snapshot[0].op == StatOp::Notify);
+    EXPECT_EQ(snapshot[0].phases[static_cast<size_t>(StatPhase::Total)].count, 3u);
+    EXPECT_EQ(snapshot[0].errors.size(), 2u);
+}
+
+NATIVE_TEST(KernelNotifier, StopDropsWhatWasNotSent) {
+    FakeKernel kernel("/gate");
+    KernelNotifier notifier(kernel.Fn(), nullptr);
+    notifier.Start();
+    notifier.Push(KernelNotifier::Change, "/gate");
+    kernel.WaitForGate();
+    notifier.Push(KernelNotifier::Change, "/a");
+
+    std::thread stopper([&] { notifier.Stop(); });
+    bool dropped = WaitUntil([&] { return notifier.GetCounters().pending == 0; });
+    kernel.Open();
+    stopper.join();
+    EXPECT(dropped);
+    EXPECT_EQ(kernel.SentCount(), 1u);
+}
@@ -0,0 +1,116 @@
+#include "native_test.h"
+#include "fuse3_op_stats.h"
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// The total phase of op in a snapshot of stats
+OpStats::Summary TotalOf(const OpStats& stats, StatOp op) {
+    for (const OpStats::OpSummary& summary : stats.Snapshot()) {
+        if (summary.op == op) {
+            return summary.phases[static_cast<size_t>(StatPhase::Total)];
+        }
+    }
+    return OpStats::Summary();
+}
+
+}  // namespace
+
+NATIVE_TEST(OpStats, SmallValuesGetABucketEach) {
+    for (uint64_t ns = 0; ns < 4; ns++) {
+        EXPECT_EQ(OpStats::BucketOf(ns), ns);
+        EXPECT_EQ(OpStats::BucketLimit(ns), ns);
+    }
+}
+
+NATIVE_TEST(OpStats, PowersOfTwoStartABucket) {
+    for (unsigned int bit = 2; bit < 42; bit++) {
+        uint64_t power = uint64_t(1) << bit;
+        size_t bucket = OpStats::BucketOf(power);
+        EXPECT_EQ(bucket, (bit - 1) * 4u);
+        EXPECT_EQ(OpStats::BucketLimit(bucket - 1), power - 1);
+        EXPECT_EQ(OpStats::BucketOf(power - 1), bucket - 1);
+    }
+}
+
+// Every bucket ends right before the next one starts, and is at most a
+// quarter of its lower end wide
+NATIVE_TEST(OpStats, BucketsTileTheRange) {
+    for (size_t bucket = 0; bucket + 1 < OpStats::kBuckets; bucket++) {
+        uint64_t limit = OpStats::BucketLimit(bucket);
+        EXPECT_EQ(OpStats::BucketOf(limit), bucket);
+        EXPECT_EQ(OpStats::BucketOf(limit + 1), bucket + 1);
+        if (bucket >= 4) {
+            uint64_t low = OpStats::BucketLimit(bucket - 1) + 1;
+            EXPECT(limit - low + 1 <= low / 4);
+        }
+    }
+}
+
+NATIVE_TEST(OpStats, TheLastBucketTakesEverythingAbove) {
+    size_t last = OpStats::kBuckets - 1;
+    EXPECT_EQ(OpStats::BucketOf(uint64_t(1) << 42), last);
+    EXPECT_EQ(OpStats::BucketOf(UINT64_MAX), last);
+    EXPECT_EQ(OpStats::BucketLimit(last), UINT64_MAX);
+}
+
+NATIVE_TEST(OpStats, ASingleValueIsEveryPercentile) {
+    for (uint64_t ns : {uint64_t(0), uint64_t(1), uint64_t(4096), uint64_t(1000001), UINT64_MAX}) {
+        OpStats stats;
+        stats.Record(StatOp::Read, StatPhase::Total, ns);
+        OpStats::Summary total = TotalOf(stats, StatOp::Read);
+        EXPECT_EQ(total.count, 1u);
+        EXPECT_EQ(total.maxNs, ns);
+        // The bucket's upper end, capped by the largest value seen
+        EXPECT_EQ(total.p50Ns, ns);
+        EXPECT_EQ(total.p999Ns, ns);
+    }
+}
+
+NATIVE_TEST(OpStats, PercentilesAreTheUpperEndOfTheirBucket) {
+    OpStats stats;
+    // 90 fast requests at 100 ns, 9 at 10 us, one at 1 ms
+    for (int i = 0; i < 90; i++) {
+        stats.Record(StatOp::Getattr, StatPhase::Total, 100);
+    }
+    for (int i = 0; i < 9; i++) {
+        stats.Record(StatOp::Getattr, StatPhase::Total, 10000);
+    }
+    stats.Record(StatOp::Getattr, StatPhase::Total, 1000000);
+
+    OpStats::Summary total = TotalOf(stats, StatOp::Getattr);
+    EXPECT_EQ(total.count, 100u);
+    EXPECT_EQ(total.sumNs, 90u * 100 + 9u * 10000 + 1000000);
+    EXPECT_EQ(total.p50Ns, OpStats::BucketLimit(OpStats::BucketOf(100)));
+    EXPECT_EQ(total.p90Ns, OpStats::BucketLimit(OpStats::BucketOf(100)));
+    EXPECT_EQ(total.p99Ns, OpStats::BucketLimit(OpStats::BucketOf(10000)));
+    EXPECT_EQ(total.p999Ns, 1000000u);
+    // Within a quarter of the value
+    EXPECT(total.p50Ns >= 100 && total.p50Ns < 125);
+}
+
+NATIVE_TEST(OpStats, OnlyOperationsSeenAreReported) {
+    OpStats stats;
+    EXPECT(stats.Snapshot().empty());
+    stats.AddError(StatOp::Open, -2);
+    stats.Record(StatOp::Write, StatPhase::Total, 10);
+    std::vector<OpStats::OpSummary> snapshot = stats.Snapshot();
+    EXPECT_EQ(snapshot.size(), 2u);
+
+    stats.Reset();
+    EXPECT(stats.Snapshot().empty());
+}
+
+NATIVE_TEST(OpStats, ErrorsAreCountedByErrno) {
+    OpStats stats;
+    stats.AddError(StatOp::Open, -2);
+    stats.AddError(StatOp::Open, -2);
+    stats.AddError(StatOp::Open, -100000);  // counted with the highest
+    std::vector<OpStats::OpSummary> snapshot = stats.Snapshot();
+    EXPECT_EQ(snapshot.size(), 1u);
+    EXPECT_EQ(snapshot[0].errors.size(), 2u);
+    EXPECT_EQ(snapshot[0].errors[0].first, 2);
+    EXPECT_EQ(snapshot[0].errors[0].second, 2u);
+    EXPECT_EQ(snapshot[0].errors[1].second, 1u);
+}
@@ -0,0 +1,263 @@
+#include "native_test.h"
+#include "fuse3_prewarm.h"
+#include <errno.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A tree of directories and files the walker lists and stats. Calls are
+// answered right away, or held until Answer when hold is set.
+class FakeTree {
+public:
+    std::map<std::string, std::vector<Prewarmer::Child>> dirs;
+    bool hold = false;
+
+    void Dir(const std::string& path, std::vector<Prewarmer::Child> children) { dirs[path] = std::move(children); }
+
+    void List(const std::string& path, Prewarmer::ListDone done) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        calls_.push_back("list " + path);
+        if (hold) {
+            held_.push_back([this, path, done] { AnswerList(path, done); });
+            return;
+        }
+        lock.unlock();
+        AnswerList(path, done);
+    }
+
+    void Stat(const std::string& path, Prewarmer::StatDone done) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        calls_.push_back("stat " + path);
+        if (hold) {
+            held_.push_back([this, path, done] { AnswerStat(path, done); });
+            return;
+        }
+        lock.unlock();
+        AnswerStat(path, done);
+    }
+
+    std::vector<std::string> Calls() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return calls_;
+    }
+    size_t Held() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return held_.size();
+    }
+    // Answers the oldest held call
+    void Answer() {
+        std::function<void()> answer;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            answer = std::move(held_.front());
+            held_.erase(held_.begin());
+        }
+        answer();
+    }
+
+    std::shared_ptr<Prewarmer> Walker(const Prewarmer::Options& options) {
+        return std::make_shared<Prewarmer>(
+            options,
+            [this](const std::string& path, Prewarmer::ListDone done) { List(path, std::move(done)); },
+            [this](const std::string& path, Prewarmer::StatDone done) { Stat(path, std::move(done)); },
+            [this](const Prewarmer::Progress& progress) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                reports_.push_back(progress);
+            });
+    }
+
+    std::vector<Prewarmer::Progress> Reports() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return reports_;
+    }
+
+private:
+    void AnswerList(const std::string& path, const Prewarmer::ListDone& done) {
+        auto it = dirs.find(path);
+        if (it == dirs.end()) {
+            done(-ENOENT, {});
+        } else {
+            done(0, it->second);
+        }
+    }
+    void AnswerStat(const std::string& path, const Prewarmer::StatDone& done) {
+        if (dirs.count(path)) {
+            done(0, true);
+        } else if (path.find("missing") != std::string::npos) {
+            done(-ENOENT, false);
+        } else {
+            done(0, false);
+        }
+    }
+
+    std::mutex mutex_;
+    std::vector<std::string> calls_;
+    std::vector<std::function<void()>> held_;
+    std::vector<Prewarmer::Progress> reports_;
+};
+
+Prewarmer::Child Named(const std::string& name, bool stat = false, bool directory = false) {
+    Prewarmer::Child child;
+    child.name = name;
+    child.stat = stat;
+    child.directory = directory;
+    return child;
+}
+
+Prewarmer::Options Unlimited() {
+    Prewarmer::Options options;
+    options.rate = 0;
+    return options;
+}
+
+bool Done(const std::shared_ptr<Prewarmer>& walker) {
+    return walker->GetProgress().done;
+}
+
+}  // namespace
+
+NATIVE_TEST(Prewarmer, WalksBreadthFirstDownToMaxDepth) {
+    FakeTree tree;
+    tree.Dir("/", {Named("."), Named(".."), Named("a", true, true), Named("f", true, false), Named("b")});
+    tree.Dir("/a", {Named("deep", true, true)});
+    tree.Dir("/b", {});
+    tree.Dir("/a/deep", {Named("deeper", true, true)});
+    tree.Dir("/a/deep/deeper", {});
+    Prewarmer::Options options = Unlimited();
+    options.maxDepth = 2;
+    auto walker = tree.Walker(options);
+    walker->Start();
+    EXPECT(WaitUntil([&] { return Done(walker); }));
+
+    // Names without stats are stat'ed; the root first, as it may be a file
+    std::vector<std::string> expected = {"stat /", "list /", "list /a", "stat /b", "list /a/deep", "list /b"};
+    EXPECT(tree.Calls() == expected);
+    Prewarmer::Progress progress = walker->GetProgress();
+    EXPECT_EQ(progress.directories, 4u);
+    EXPECT_EQ(progress.entries, 5u);  // a, f, b, deep, deeper
+    EXPECT_EQ(progress.stats, 2u);
+    EXPECT_EQ(progress.depth, 2u);
+    EXPECT_EQ(progress.pending, 0u);
+    EXPECT_EQ(progress.errors, 0u);
+}
+
+NATIVE_TEST(Prewarmer, StopsTakingNamesAtMaxEntries) {
+    FakeTree tree;
+    tree.Dir("/", {Named("a", true, true), Named("b", true, true), Named("c", true, true)});
+    tree.Dir("/a", {Named("x", true, true)});
+    tree.Dir("/b", {});
+    tree.Dir("/c", {});
+    Prewarmer::Options options = Unlimited();
+    options.maxEntries = 2;
+    auto walker = tree.Walker(options);
+    walker->Start();
+    EXPECT(WaitUntil([&] { return Done(walker); }));
+
+    // Listings past the budget would only bring names that are dropped
+    std::vector<std::string> expected = {"stat /", "list /"};
+    EXPECT(tree.Calls() == expected);
+    EXPECT_EQ(walker->GetProgress().entries, 2u);
+}
+
+NATIVE_TEST(Prewarmer, ErrorsAreCountedAndTheWalkGoesOn) {
+    FakeTree tree;
+    tree.Dir("/", {Named("missing"), Named("gone", true, true), Named("ok")});
+    Prewarmer::Options options = Unlimited();
+    auto walker = tree.Walker(options);
+    walker->Start();
+    EXPECT(WaitUntil([&] { return Done(walker); }));
+
+    Prewarmer::Progress progress = walker->GetProgress();
+    EXPECT_EQ(progress.errors, 2u);  // stat of missing, listing of gone
+    EXPECT_EQ(progress.stats, 3u);
+    EXPECT_EQ(progress.directories, 1u);
+}
+
+NATIVE_TEST(Prewarmer, KeepsAtMostKInFlightCallsRunning) {
+    FakeTree tree;
+    std::vector<Prewarmer::Child> names;
+    for (int i = 0; i < 10; i++) {
+        names.push_back(Named("f" + std::to_string(i)));
+    }
+    tree.Dir("/", names);
+    tree.hold = true;
+    auto walker = tree.Walker(Unlimited());
+    walker->Start();
+    // The root stat and listing go one at a time
+    EXPECT(WaitUntil([&] { return tree.Held() == 1; }));
+    tree.Answer();
+    EXPECT(WaitUntil([&] { return tree.Held() == 1; }));
+    tree.Answer();
+    EXPECT(WaitUntil([&] { return tree.Held() == Prewarmer::kInFlight; }));
+
+    // Nothing more starts while they are out
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(tree.Held(), size_t(Prewarmer::kInFlight));
+    EXPECT_EQ(walker->GetProgress().pending, 10u);
+
+    tree.Answer();
+    EXPECT(WaitUntil([&] { return tree.Held() == Prewarmer::kInFlight; }));
+    EXPECT_EQ(walker->GetProgress().pending, 9u);
+    EXPECT(WaitUntil([&] {
+        if (tree.Held() > 0) {
+            tree.Answer();
+        }
+        return Done(walker);
+    }));
+    EXPECT_EQ(walker->GetProgress().stats, 11u);
+}
+
+NATIVE_TEST(Prewarmer, OnlyTheFirstAnswerCounts) {
+    auto walker = std::make_shared<Prewarmer>(
+        Unlimited(),
+        [](const std::string&, Prewarmer::ListDone done) { done(0, {}); },
+        [](const std::string&, Prewarmer::StatDone done) {
+            done(0, false);
+            done(0, true);
+            done(-EIO, false);
+        },
+        [](const Prewarmer::Progress&) {});
+    walker->Start();
+    EXPECT(WaitUntil([&] { return Done(walker); }));
+    Prewarmer::Progress progress = walker->GetProgress();
+    EXPECT_EQ(progress.stats, 1u);
+    EXPECT_EQ(progress.errors, 0u);
+    EXPECT_EQ(progress.directories, 0u);
+}
+
+NATIVE_TEST(Prewarmer, ReportsTheEndOnce) {
+    FakeTree tree;
+    tree.Dir("/", {Named("f")});
+    auto walker = tree.Walker(Unlimited());
+    walker->Start();
+    EXPECT(WaitUntil([&] { return !tree.Reports().empty() && tree.Reports().back().done; }));
+    walker->Stop();
+    std::vector<Prewarmer::Progress> reports = tree.Reports();
+    EXPECT_EQ(std::count_if(reports.begin(), reports.end(), [](const Prewarmer::Progress& p) { return p.done; }), 1);
+    EXPECT_EQ(reports.back().stats, 2u);
+}
+
+NATIVE_TEST(Prewarmer, AStoppedWalkReportsNoEndAndDropsLateAnswers) {
+    FakeTree tree;
+    tree.Dir("/", {Named("a"), Named("b")});
+    tree.hold = true;
+    auto walker = tree.Walker(Unlimited());
+    walker->Start();
+    EXPECT(WaitUntil([&] { return tree.Held() == 1; }));
+
+    walker->Stop();
+    EXPECT(!Done(walker));
+    walker.reset();
+    tree.Answer();  // the walker is gone
+    EXPECT(tree.Reports().empty());
+    std::vector<std::string> expected = {"stat /"};
+    EXPECT(tree.Calls() == expected);
+}
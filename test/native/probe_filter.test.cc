@@ -0,0 +1,71 @@
+#include "native_test.h"
+#include "fuse3_probe_filter.h"
+
+namespace {
+
+ProbeFilter::Options Learning(unsigned int threshold) {
+    ProbeFilter::Options options;
+    options.rules = {"desktop.ini"};
+    options.learnThreshold = threshold;
+    options.ttl = 30;
+    return options;
+}
+
+void MissTimes(ProbeFilter& filter, const char* path, unsigned int times) {
+    for (unsigned int i = 0; i < times; i++) {
+        filter.Missing(path);
+    }
+}
+
+}  // namespace
+
+NATIVE_TEST(ProbeFilter, RulesMatchNamesInEveryDirectory) {
+    ProbeFilter filter(Learning(0));
+    EXPECT(filter.Absorb("/desktop.ini"));
+    EXPECT(filter.Absorb("/a/b/Desktop.INI"));
+    EXPECT(!filter.Absorb("/a/b/readme.txt"));
+    EXPECT_EQ(filter.GetCounters().ruleHits, 2u);
+}
+
+NATIVE_TEST(ProbeFilter, CreatedFilesAreExemptFromRules) {
+    ProbeFilter filter(Learning(0));
+    filter.Exists("/a/desktop.ini");
+    EXPECT(!filter.Absorb("/a/desktop.ini"));
+    EXPECT(filter.Absorb("/b/desktop.ini"));
+}
+
+NATIVE_TEST(ProbeFilter, LearnsAPathAfterRepeatedMisses) {
+    ProbeFilter filter(Learning(3));
+    MissTimes(filter, "/a/.hidden", 2);
+    EXPECT(!filter.Absorb("/a/.hidden"));
+    filter.Missing("/a/.hidden");
+    EXPECT(filter.Absorb("/a/.hidden"));
+    EXPECT_EQ(filter.GetCounters().learnedNames, 1u);
+}
+
+NATIVE_TEST(ProbeFilter, LearnedPathsStayInTheirDirectory) {
+    ProbeFilter filter(Learning(2));
+    MissTimes(filter, "/a/config.json", 2);
+    EXPECT(filter.Absorb("/a/config.json"));
+    EXPECT(!filter.Absorb("/b/config.json"));
+    EXPECT(!filter.Absorb("/config.json"));
+}
+
+NATIVE_TEST(ProbeFilter, ExistingPathsAreNotLearned) {
+    ProbeFilter filter(Learning(2));
+    MissTimes(filter, "/a/x", 2);
+    EXPECT(filter.Absorb("/a/x"));
+    filter.Exists("/a/x");
+    EXPECT(!filter.Absorb("/a/x"));
+    MissTimes(filter, "/a/x", 4);
+    EXPECT(!filter.Absorb("/a/x"));
+}
+
+NATIVE_TEST(ProbeFilter, ForgetBelowDropsLearnedPathsUnderThePrefix) {
+    ProbeFilter filter(Learning(1));
+    filter.Missing("/a/b/x");
+    filter.Missing("/ab/x");
+    filter.ForgetBelow("/a/");
+    EXPECT(!filter.Absorb("/a/b/x"));
+    EXPECT(filter.Absorb("/ab/x"));
+}
@@ -0,0 +1,186 @@
+#include "native_test.h"
+#include "fuse3_readahead.h"
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A file of size bytes where byte i is i % 251. Fetches are answered when
+// the test says so, like JS answering later.
+struct FakeFile {
+    size_t size;
+    struct Fetch {
+        char* dst;
+        size_t size;
+        off_t offset;
+        Readahead::Done done;
+    };
+    std::vector<Fetch> fetches;
+    size_t fetched = 0;
+
+    explicit FakeFile(size_t fileSize) : size(fileSize) {}
+
+    Readahead::FetchFn Fetcher() {
+        return [this](const std::string&, uint64_t, char* dst, size_t length, off_t off, Readahead::Done done) {
+            fetches.push_back({dst, length, off, std::move(done)});
+            fetched++;
+        };
+    }
+
+    void AnswerAll() {
+        std::vector<Fetch> answering;
+        answering.swap(fetches);
+        for (Fetch& fetch : answering) {
+            size_t from = std::min(static_cast<size_t>(fetch.offset), size);
+            size_t length = std::min(fetch.size, size - from);
+            for (size_t i = 0; i < length; i++) {
+                fetch.dst[i] = static_cast<char>((from + i) % 251);
+            }
+            fetch.done(static_cast<int>(length));
+        }
+    }
+
+    bool Holds(const char* data, off_t offset, size_t length) const {
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] != static_cast<char>((offset + i) % 251)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+Readahead::Options Windows(size_t minWindow, size_t maxWindow) {
+    Readahead::Options options;
+    options.minWindow = minWindow;
+    options.maxWindow = maxWindow;
+    return options;
+}
+
+constexpr size_t kRead = 4096;
+
+}  // namespace
+
+NATIVE_TEST(Readahead, SequentialReaderIsServedAhead) {
+    FakeFile file(1024 * 1024);
+    Readahead readahead(Windows(64 * 1024, 256 * 1024), file.Fetcher());
+    char buf[kRead];
+
+    EXPECT(!readahead.Read("/f", 1, buf, kRead, 0, [](int) {}));
+    // The second read in a row fetches the window behind it
+    EXPECT(!readahead.Read("/f", 1, buf, kRead, kRead, [](int) {}));
+    EXPECT_EQ(file.fetches.size(), 1u);
+    EXPECT_EQ(file.fetches[0].offset, static_cast<off_t>(2 * kRead));
+    file.AnswerAll();
+
+    int result = 0;
+    EXPECT(readahead.Read("/f", 1, buf, kRead, 2 * kRead, [&result](int res) { result = res; }));
+    EXPECT_EQ(result, static_cast<int>(kRead));
+    EXPECT(file.Holds(buf, 2 * kRead, kRead));
+}
+
+NATIVE_TEST(Readahead, ShortFetchEndsTheFile) {
+    const size_t fileSize = 3 * kRead + 100;
+    FakeFile file(fileSize);
+    Readahead readahead(Windows(64 * 1024, 256 * 1024), file.Fetcher());
+    char buf[kRead];
+
+    readahead.Read("/f", 1, buf, kRead, 0, [](int) {});
+    readahead.Read("/f", 1, buf, kRead, kRead, [](int) {});
+    file.AnswerAll();
+
+    int result = -1;
+    EXPECT(readahead.Read("/f", 1, buf, kRead, 2 * kRead, [&result](int res) { result = res; }));
+    EXPECT_EQ(result, static_cast<int>(kRead));
+
+    // The read across the end comes back short
+    EXPECT(readahead.Read("/f", 1, buf, kRead, 3 * kRead, [&result](int res) { result = res; }));
+    EXPECT_EQ(result, 100);
+    EXPECT(file.Holds(buf, 3 * kRead, 100));
+
+    // Nothing is fetched past the end, and reads there are served empty
+    size_t fetched = file.fetched;
+    EXPECT(readahead.Read("/f", 1, buf, kRead, 3 * kRead + 100, [&result](int res) { result = res; }));
+    EXPECT_EQ(result, 0);
+    EXPECT_EQ(file.fetched, fetched);
+}
+
+NATIVE_TEST(Readahead, RandomAccessStartsOver) {
+    FakeFile file(4 * 1024 * 1024);
+    Readahead readahead(Windows(64 * 1024, 256 * 1024), file.Fetcher());
+    char buf[kRead];
+
+    readahead.Read("/f", 1, buf, kRead, 0, [](int) {});
+    readahead.Read("/f", 1, buf, kRead, kRead, [](int) {});
+    file.AnswerAll();
+    size_t fetched = file.fetched;
+
+    // A jump is not served and fetches nothing
+    EXPECT(!readahead.Read("/f", 1, buf, kRead, 2 * 1024 * 1024, [](int) {}));
+    EXPECT_EQ(file.fetched, fetched);
+    // Neither is going back to data fetched before the jump
+    EXPECT(!readahead.Read("/f", 1, buf, kRead, 2 * kRead, [](int) {}));
+    EXPECT_EQ(file.fetched, fetched);
+    EXPECT_EQ(readahead.Used(), 0u);
+}
+
+NATIVE_TEST(Readahead, FailedFetchLetsTheReaderGoToJs) {
+    FakeFile file(1024 * 1024);
+    Readahead readahead(Windows(64 * 1024, 256 * 1024), file.Fetcher());
+    char buf[kRead];
+
+    readahead.Read("/f", 1, buf, kRead, 0, [](int) {});
+    readahead.Read("/f", 1, buf, kRead, kRead, [](int) {});
+    int result = 0;
+    EXPECT(readahead.Read("/f", 1, buf, kRead, 2 * kRead, [&result](int res) { result = res; }));
+    for (FakeFile::Fetch& fetch : file.fetches) {
+        fetch.done(-EIO);
+    }
+    file.fetches.clear();
+    EXPECT_EQ(result, -EIO);
+    EXPECT(!readahead.Read("/f", 1, buf, kRead, 3 * kRead, [](int) {}));
+}
+
+NATIVE_TEST(Readahead, InvalidateDropsFetchedData) {
+    FakeFile file(1024 * 1024);
+    Readahead readahead(Windows(64 * 1024, 256 * 1024), file.Fetcher());
+    char buf[kRead];
+
+    readahead.Read("/f", 1, buf, kRead, 0, [](int) {});
+    readahead.Read("/f", 1, buf, kRead, kRead, [](int) {});
+    file.AnswerAll();
+    readahead.Invalidate("/f");
+    EXPECT(!readahead.Read("/f", 1, buf, kRead, 2 * kRead, [](int) {}));
+}
+
+NATIVE_TEST(Readahead, HandlesShareTheTotalBudget) {
+    FakeFile file(16 * 1024 * 1024);
+    Readahead::Options options = Windows(1024 * 1024, 1024 * 1024);
+    options.maxTotal = 2 * 1024 * 1024;
+    Readahead readahead(options, file.Fetcher());
+    char buf[kRead];
+
+    for (uint64_t fh = 1; fh <= 3; fh++) {
+        readahead.Read("/f", fh, buf, kRead, 0, [](int) {});
+        readahead.Read("/f", fh, buf, kRead, kRead, [](int) {});
+    }
+    // The third handle found the budget used up
+    EXPECT_EQ(file.fetches.size(), 2u);
+    EXPECT_EQ(readahead.Used(), options.maxTotal);
+    EXPECT(!readahead.Read("/f", 3, buf, kRead, 2 * kRead, [](int) {}));
+    file.AnswerAll();
+
+    // Released handles give their share back
+    readahead.Release(1);
+    EXPECT_EQ(readahead.Used(), 1024u * 1024u);
+    readahead.Read("/f", 3, buf, kRead, 3 * kRead, [](int) {});
+    EXPECT_EQ(file.fetches.size(), 1u);
+    readahead.Release(2);
+    readahead.Release(3);
+    file.AnswerAll();
+    EXPECT_EQ(readahead.Used(), 0u);
+}
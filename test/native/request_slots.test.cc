@@ -0,0 +1,208 @@
+#include "native_test.h"
+#include "fuse3_request_slots.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// RequestSlots only passes the answer through to the handler, so the
+// N-API arguments (fuse3_js_args.h) are stood in for by a number
+class JsArgs {
+public:
+    explicit JsArgs(int value) : value(value) {}
+    int value;
+};
+
+namespace {
+
+RequestSlots::Options Slots(size_t size, RequestSlots::Exhausted exhausted = RequestSlots::Exhausted::Callback) {
+    RequestSlots::Options options;
+    options.size = size;
+    options.exhausted = exhausted;
+    return options;
+}
+
+// A handler adding the answer to *sum
+RequestSlots::Handler AddTo(int* sum) {
+    return [sum](const JsArgs& args) { *sum += args.value; };
+}
+
+}  // namespace
+
+NATIVE_TEST(RequestSlots, ReplyRunsTheHandlerWithTheAnswer) {
+    RequestSlots slots(Slots(4));
+    int sum = 0;
+    RequestSlots::Handler handler = AddTo(&sum);
+    uint64_t id = slots.Acquire(handler);
+    EXPECT(id != 0);
+    EXPECT_EQ(slots.GetCounters().inUse, 1u);
+
+    EXPECT(slots.Reply(id, JsArgs(7)));
+    EXPECT_EQ(sum, 7);
+    EXPECT_EQ(slots.GetCounters().inUse, 0u);
+}
+
+NATIVE_TEST(RequestSlots, ASecondAnswerIsDropped) {
+    RequestSlots slots(Slots(4));
+    int sum = 0;
+    RequestSlots::Handler handler = AddTo(&sum);
+    uint64_t id = slots.Acquire(handler);
+
+    EXPECT(slots.Reply(id, JsArgs(1)));
+    EXPECT(!slots.Reply(id, JsArgs(1)));
+    EXPECT_EQ(sum, 1);
+    EXPECT_EQ(slots.GetCounters().stale, 1u);
+}
+
+NATIVE_TEST(RequestSlots, AnAnswerAfterReleaseIsDropped) {
+    RequestSlots slots(Slots(4));
+    int sum = 0;
+    RequestSlots::Handler handler = AddTo(&sum);
+    uint64_t id = slots.Acquire(handler);
+
+    slots.Release(id);
+    EXPECT(!slots.Reply(id, JsArgs(1)));
+    EXPECT_EQ(sum, 0);
+}
+
+NATIVE_TEST(RequestSlots, AStaleIdDoesNotReachTheNextRequestInItsSlot) {
+    RequestSlots slots(Slots(1));
+    int first = 0;
+    int second = 0;
+    RequestSlots::Handler handler = AddTo(&first);
+    uint64_t old = slots.Acquire(handler);
+    EXPECT(slots.Reply(old, JsArgs(1)));
+
+    handler = AddTo(&second);
+    uint64_t reused = slots.Acquire(handler);
+    EXPECT(reused != 0);
+    EXPECT(reused != old);
+
+    EXPECT(!slots.Reply(old, JsArgs(10)));
+    EXPECT_EQ(second, 0);
+    EXPECT(slots.Reply(reused, JsArgs(2)));
+    EXPECT_EQ(first, 1);
+    EXPECT_EQ(second, 2);
+}
+
+NATIVE_TEST(RequestSlots, MadeUpIdsAreDropped) {
+    RequestSlots slots(Slots(2));
+    EXPECT(!slots.Reply(0, JsArgs(1)));
+    EXPECT(!slots.Reply(~uint64_t(0), JsArgs(1)));
+    // An even generation is never taken
+    EXPECT(!slots.Reply(uint64_t(2) << 20, JsArgs(1)));
+    EXPECT_EQ(slots.GetCounters().stale, 3u);
+}
+
+// The caller applies the policy (NewJsReply); the slots leave it the
+// handler to fall back on
+NATIVE_TEST(RequestSlots, ExhaustionLeavesTheHandlerToTheCaller) {
+    RequestSlots slots(Slots(2, RequestSlots::Exhausted::Fail));
+    EXPECT(slots.GetOptions().exhausted == RequestSlots::Exhausted::Fail);
+    int sum = 0;
+    RequestSlots::Handler a = AddTo(&sum);
+    RequestSlots::Handler b = AddTo(&sum);
+    RequestSlots::Handler c = AddTo(&sum);
+    uint64_t first = slots.Acquire(a);
+    EXPECT(first != 0);
+    EXPECT(slots.Acquire(b) != 0);
+
+    EXPECT_EQ(slots.Acquire(c), 0u);
+    EXPECT(c != nullptr);
+    c(JsArgs(5));
+    EXPECT_EQ(sum, 5);
+    EXPECT_EQ(slots.GetCounters().exhausted, 1u);
+
+    // A freed slot is taken again
+    EXPECT(slots.Reply(first, JsArgs(1)));
+    EXPECT(slots.Acquire(c) != 0);
+    RequestSlots::Counters counters = slots.GetCounters();
+    EXPECT_EQ(counters.inUse, 2u);
+    EXPECT_EQ(counters.maxInUse, 2u);
+    EXPECT_EQ(counters.acquired, 3u);
+}
+
+NATIVE_TEST(RequestSlots, SizeIsClamped) {
+    EXPECT_EQ(RequestSlots(Slots(0)).GetOptions().size, 1u);
+    EXPECT_EQ(RequestSlots(Slots(RequestSlots::kMaxSize + 1)).GetOptions().size, RequestSlots::kMaxSize);
+}
+
+NATIVE_TEST(RequestSlots, ReleaseOwnedFreesOnlyThatOwner) {
+    RequestSlots slots(Slots(4));
+    int sum = 0;
+    int mine = 0;
+    int theirs = 0;
+    RequestSlots::Handler a = AddTo(&sum);
+    RequestSlots::Handler b = AddTo(&sum);
+    uint64_t ownedId = slots.Acquire(a, &mine);
+    uint64_t otherId = slots.Acquire(b, &theirs);
+
+    slots.ReleaseOwned(&mine);
+    EXPECT(!slots.Reply(ownedId, JsArgs(1)));
+    EXPECT(slots.Reply(otherId, JsArgs(2)));
+    EXPECT_EQ(sum, 2);
+}
+
+NATIVE_TEST(RequestSlots, ConcurrentClaimsAndAnswersKeepCount) {
+    constexpr size_t kSize = 8;
+    constexpr int kThreads = 8;
+    constexpr int kRounds = 20000;
+    RequestSlots slots(Slots(kSize));
+    std::atomic<int> answered{0};
+    std::atomic<int> acquired{0};
+    std::atomic<int> replied{0};
+    std::atomic<int> wrong{0};  // EXPECT cannot throw off the main thread
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < kRounds; i++) {
+                RequestSlots::Handler handler = [&answered](const JsArgs& args) { answered += args.value; };
+                uint64_t id = slots.Acquire(handler);
+                if (id == 0) {
+                    continue;
+                }
+                acquired++;
+                // Every other request is released, the rest answered twice
+                if (i % 2) {
+                    slots.Release(id);
+                    wrong += slots.Reply(id, JsArgs(1));
+                } else {
+                    replied++;
+                    wrong += !slots.Reply(id, JsArgs(1));
+                    wrong += slots.Reply(id, JsArgs(1));
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(wrong.load(), 0);
+    RequestSlots::Counters counters = slots.GetCounters();
+    EXPECT_EQ(answered.load(), replied.load());
+    EXPECT_EQ(counters.inUse, 0u);
+    EXPECT(counters.maxInUse <= kSize);
+    EXPECT_EQ(counters.acquired, static_cast<uint64_t>(acquired.load()));
+    EXPECT_EQ(counters.acquired + counters.exhausted, static_cast<uint64_t>(kThreads) * kRounds);
+
+    // Every slot made it back to the free stack, once
+    std::vector<RequestSlots::Handler> handlers(kSize + 1, [](const JsArgs&) {});
+    for (size_t i = 0; i < kSize; i++) {
+        EXPECT(slots.Acquire(handlers[i]) != 0);
+    }
+    EXPECT_EQ(slots.Acquire(handlers[kSize]), 0u);
+}
+
+NATIVE_TEST(RequestSlots, RacingAnswersRunTheHandlerOnce) {
+    RequestSlots slots(Slots(64));
+    for (int round = 0; round < 2000; round++) {
+        std::atomic<int> runs{0};
+        RequestSlots::Handler handler = [&runs](const JsArgs&) { runs++; };
+        uint64_t id = slots.Acquire(handler);
+        std::thread other([&]() { slots.Reply(id, JsArgs(0)); });
+        slots.Reply(id, JsArgs(0));
+        other.join();
+        EXPECT_EQ(runs.load(), 1);
+    }
+}
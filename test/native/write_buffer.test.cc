@@ -0,0 +1,246 @@
+#include "native_test.h"
+#include "fuse3_write_buffer.h"
+#include <errno.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Stands in for the JS write handler. Synchronous writes are answered with
+// syncResult right away; timed write-outs wait until the test answers them.
+struct FakeJs {
+    struct Call {
+        std::string path;
+        off_t offset;
+        size_t size;
+        bool timed;
+    };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Call> calls;
+    std::vector<std::function<void()>> unanswered;
+    int syncResult = 0;  // 0 answers with the full size
+
+    WriteBuffer::WriteFn Write() {
+        return [this](const std::string& path, uint64_t, const char*, size_t size, off_t offset) {
+            std::lock_guard<std::mutex> lock(mutex);
+            calls.push_back({path, offset, size, false});
+            changed.notify_all();
+            return syncResult != 0 ? syncResult : static_cast<int>(size);
+        };
+    }
+
+    WriteBuffer::WriteAsyncFn WriteAsync(int result) {
+        return [this, result](WriteBuffer::ExtentPtr extent, std::function<void(int)> done) {
+            std::lock_guard<std::mutex> lock(mutex);
+            calls.push_back({extent->path, extent->offset, extent->data.size(), true});
+            int res = result != 0 ? result : static_cast<int>(extent->data.size());
+            unanswered.push_back([done, res] { done(res); });
+            changed.notify_all();
+        };
+    }
+
+    size_t Count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return calls.size();
+    }
+
+    // Waits until the timer handed count write-outs to JS
+    bool AwaitTimed(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::seconds(5), [&] { return unanswered.size() >= count; });
+    }
+
+    void AnswerAll() {
+        std::vector<std::function<void()>> answers;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            answers.swap(unanswered);
+        }
+        for (auto& answer : answers) {
+            answer();
+        }
+    }
+};
+
+WriteBuffer::Options Buffered(unsigned int delayMs) {
+    WriteBuffer::Options options;
+    options.maxBytes = 64;
+    options.maxDelayMs = delayMs;
+    options.timeoutErr = -ETIMEDOUT;
+    return options;
+}
+
+}  // namespace
+
+NATIVE_TEST(WriteBuffer, MergesContiguousWrites) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(0), js.Write(), js.WriteAsync(0));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT_EQ(buffer.Write("/a", 1, "efgh", 4, 4), 4);
+    EXPECT(js.calls.empty());
+
+    EXPECT_EQ(buffer.Flush(1), 0);
+    EXPECT_EQ(js.calls.size(), 1u);
+    EXPECT_EQ(js.calls[0].offset, 0);
+    EXPECT_EQ(js.calls[0].size, 8u);
+}
+
+NATIVE_TEST(WriteBuffer, FailedWriteOutReachesFlush) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(5), js.Write(), js.WriteAsync(-ENOSPC));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT(js.AwaitTimed(1));
+    js.AnswerAll();
+
+    EXPECT_EQ(buffer.Flush(1), -ENOSPC);
+    // Reported once
+    EXPECT_EQ(buffer.Flush(1), 0);
+}
+
+NATIVE_TEST(WriteBuffer, FailedWriteOutReachesRelease) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(5), js.Write(), js.WriteAsync(-EIO));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT(js.AwaitTimed(1));
+    js.AnswerAll();
+
+    EXPECT_EQ(buffer.Release(1), -EIO);
+    EXPECT_EQ(buffer.Flush(1), 0);
+}
+
+NATIVE_TEST(WriteBuffer, FailedWriteOutReachesNextWrite) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(5), js.Write(), js.WriteAsync(-EIO));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT(js.AwaitTimed(1));
+    js.AnswerAll();
+
+    EXPECT_EQ(buffer.Write("/a", 1, "efgh", 4, 4), -EIO);
+}
+
+NATIVE_TEST(WriteBuffer, ShortWriteIsAnError) {
+    FakeJs js;
+    js.syncResult = 2;
+    WriteBuffer buffer(Buffered(0), js.Write(), js.WriteAsync(0));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT_EQ(buffer.Flush(1), -EIO);
+}
+
+NATIVE_TEST(WriteBuffer, WriteOutsReachJsInOrder) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(5), js.Write(), js.WriteAsync(0));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT(js.AwaitTimed(1));
+
+    // The timer does not start a second write-out while the first is unanswered
+    EXPECT_EQ(buffer.Write("/a", 1, "efgh", 4, 100), 4);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(js.Count(), 1u);
+
+    // Neither does a flush
+    std::thread flusher([&buffer] { buffer.Flush(1); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(js.Count(), 1u);
+
+    js.AnswerAll();
+    flusher.join();
+    EXPECT_EQ(js.calls.size(), 2u);
+    EXPECT_EQ(js.calls[0].offset, 0);
+    EXPECT_EQ(js.calls[1].offset, 100);
+}
+
+NATIVE_TEST(WriteBuffer, WaitEndsAtDeadline) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(5), js.Write(), js.WriteAsync(0));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT(js.AwaitTimed(1));
+    EXPECT_EQ(buffer.Write("/a", 1, "efgh", 4, 100), 4);
+
+    auto started = Clock::now();
+    EXPECT_EQ(buffer.Flush(1, started + std::chrono::milliseconds(30)), -ETIMEDOUT);
+    EXPECT(Clock::now() - started < std::chrono::seconds(2));
+    EXPECT_EQ(buffer.Write("/a", 1, "x", 1, 200, Clock::now() + std::chrono::milliseconds(30)), -ETIMEDOUT);
+
+    // The buffered data is still written once JS answers
+    js.AnswerAll();
+    EXPECT_EQ(buffer.Flush(1), 0);
+    EXPECT_EQ(js.calls.size(), 2u);
+    EXPECT_EQ(js.calls[1].offset, 100);
+}
+
+NATIVE_TEST(WriteBuffer, ReleaseWaitsForWriteOutInFlight) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(5), js.Write(), js.WriteAsync(0));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT(js.AwaitTimed(1));
+    EXPECT_EQ(buffer.Write("/a", 1, "efgh", 4, 100), 4);
+
+    bool released = false;
+    std::mutex mutex;
+    std::thread releaser([&] {
+        buffer.Release(1);
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT(!released);
+    }
+    EXPECT_EQ(js.Count(), 1u);
+
+    // Once JS answered, the buffered data is written before release returns
+    js.AnswerAll();
+    releaser.join();
+    EXPECT_EQ(js.calls.size(), 2u);
+    EXPECT_EQ(js.calls[1].offset, 100);
+    EXPECT(!js.calls[1].timed);
+
+    // Nothing is left pending: the handle is gone and FlushPath has no work
+    EXPECT_EQ(buffer.Flush(1), 0);
+    buffer.FlushPath("/a");
+    EXPECT_EQ(js.Count(), 2u);
+}
+
+NATIVE_TEST(WriteBuffer, FlushPathOnlyWritesThatPath) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(0), js.Write(), js.WriteAsync(0));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT_EQ(buffer.Write("/b", 2, "efgh", 4, 0), 4);
+
+    buffer.FlushPath("/b");
+    EXPECT_EQ(js.calls.size(), 1u);
+    EXPECT_EQ(js.calls[0].path, std::string("/b"));
+
+    EXPECT_EQ(buffer.Release(1), 0);
+    EXPECT_EQ(js.calls.size(), 2u);
+    EXPECT_EQ(js.calls[1].path, std::string("/a"));
+}
+
+NATIVE_TEST(WriteBuffer, FlushPathWaitsForWriteOuts) {
+    FakeJs js;
+    WriteBuffer buffer(Buffered(5), js.Write(), js.WriteAsync(0));
+    EXPECT_EQ(buffer.Write("/a", 1, "abcd", 4, 0), 4);
+    EXPECT(js.AwaitTimed(1));
+
+    std::thread reader([&buffer] { buffer.FlushPath("/a"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    js.AnswerAll();
+    reader.join();
+
+    // A flush that runs out of time leaves no error with the handle
+    EXPECT_EQ(buffer.Write("/a", 1, "efgh", 4, 4), 4);
+    EXPECT(js.AwaitTimed(1));
+    buffer.FlushPath("/a", Clock::now() + std::chrono::milliseconds(10));
+    js.AnswerAll();
+    EXPECT_EQ(buffer.Flush(1), 0);
+}
@@ -27,6 +27,20 @@ const TEST_SUITES: TestSuite[] = [
         type: 'component',
         timeout: 60000
     },
+    {
+        name: 'Native FUSE Addon Tests',
+        file: './fuse-native.test.js',
+        platform: 'linux',
+        type: 'component',
+        timeout: 60000
+    },
+    {
+        name: 'FUSE Worker Thread Tests',
+        file: './fuse-workers.test.js',
+        platform: 'linux',
+        type: 'component',
+        timeout: 60000
+    },
     {
         name: 'Windows ProjFS Component Tests',
         file: './projfs-windows.test.js',
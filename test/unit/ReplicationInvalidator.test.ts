@@ -0,0 +1,121 @@
+/**
+ * Objects arriving through replication must invalidate the FUSE attribute cache
+ */
+
+import {describe, it, beforeEach} from 'mocha';
+import {expect} from 'chai';
+import {ReplicationInvalidator} from '../../src/filer/ReplicationInvalidator.js';
+import type {StoredObject, StoredObjectEvent} from '../../src/filer/ReplicationInvalidator.js';
+
+// Stands in for onUnversionedObj / onVersionedObj
+class FakeEvent implements StoredObjectEvent {
+    listeners: Array<(result: StoredObject) => void> = [];
+
+    addListener(listener: (result: StoredObject) => void): () => void {
+        this.listeners.push(listener);
+        return () => {
+            this.listeners = this.listeners.filter(l => l !== listener);
+        };
+    }
+
+    emit(result: StoredObject): void {
+        for (const listener of this.listeners) {
+            listener(result);
+        }
+    }
+}
+
+// Stands in for the native attribute cache: invalidate drops a path, invalidatePrefix the path
+// and everything below it
+class FakeAttrCache {
+    stats = new Map<string, number>();
+    prefixCalls = 0;
+
+    invalidate(path: string, recursive: boolean): void {
+        if (recursive) {
+            this.prefixCalls++;
+        }
+        for (const cached of [...this.stats.keys()]) {
+            if (cached === path || (recursive && cached.startsWith(path === '/' ? '/' : `${path}/`))) {
+                this.stats.delete(cached);
+            }
+        }
+    }
+}
+
+describe('ReplicationInvalidator', function() {
+    const hash = 'a'.repeat(64);
+    let unversioned: FakeEvent;
+    let versioned: FakeEvent;
+    let cache: FakeAttrCache;
+    let invalidator: ReplicationInvalidator;
+
+    beforeEach(function() {
+        unversioned = new FakeEvent();
+        versioned = new FakeEvent();
+        cache = new FakeAttrCache();
+        for (const path of [
+            '/objects',
+            `/objects/${hash}`,
+            `/objects/${hash}/raw.txt`,
+            '/types',
+            '/types/ChatMessage',
+            `/types/ChatMessage/${hash}`,
+            '/chats/topic/messages',
+            '/debug/commit-hash.txt'
+        ]) {
+            cache.stats.set(path, 1);
+        }
+        invalidator = new ReplicationInvalidator(
+            (path, recursive) => cache.invalidate(path, recursive),
+            [unversioned, versioned]
+        );
+        invalidator.start();
+    });
+
+    it('drops the cached stats of every view of a replicated object', async function() {
+        unversioned.emit({hash, obj: {$type$: 'ChatMessage'}});
+
+        expect(cache.stats.has(`/objects/${hash}`)).to.equal(false);
+        expect(cache.stats.has('/objects')).to.equal(false);
+        // Nothing below a hash changes
+        expect(cache.stats.has(`/objects/${hash}/raw.txt`)).to.equal(true);
+
+        await new Promise(resolve => setImmediate(resolve));
+        expect(cache.stats.has(`/types/ChatMessage/${hash}`)).to.equal(false);
+        expect(cache.stats.has('/types')).to.equal(false);
+        expect(cache.stats.has('/chats/topic/messages')).to.equal(false);
+        expect(cache.stats.has('/debug/commit-hash.txt')).to.equal(true);
+    });
+
+    it('leaves the chats alone for objects that are not part of a chat', function() {
+        versioned.emit({hash, obj: {$type$: 'Person'}});
+        invalidator.flush();
+
+        expect(cache.stats.has(`/objects/${hash}`)).to.equal(false);
+        expect(cache.stats.has('/chats/topic/messages')).to.equal(true);
+        expect(cache.stats.has(`/types/ChatMessage/${hash}`)).to.equal(true);
+    });
+
+    it('invalidates the type and chat views once for a burst of objects', function() {
+        for (let i = 0; i < 100; i++) {
+            unversioned.emit({hash: i.toString(16).padStart(64, '0'), obj: {$type$: 'ChatMessage'}});
+        }
+        expect(cache.prefixCalls).to.equal(0);
+        expect(cache.stats.has(`/types/ChatMessage/${hash}`)).to.equal(true);
+
+        invalidator.flush();
+        expect(cache.prefixCalls).to.equal(2);
+        expect(cache.stats.has(`/types/ChatMessage/${hash}`)).to.equal(false);
+        expect(cache.stats.has('/chats/topic/messages')).to.equal(false);
+    });
+
+    it('stops following the events once stopped', function() {
+        invalidator.stop();
+        unversioned.emit({hash, obj: {$type$: 'ChatMessage'}});
+
+        expect(cache.stats.has(`/objects/${hash}`)).to.equal(true);
+        expect(unversioned.listeners).to.have.length(0);
+        expect(versioned.listeners).to.have.length(0);
+    });
+});